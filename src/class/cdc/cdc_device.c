@@ -30,6 +30,10 @@ typedef struct {
   uint8_t ep_notify;
   uint8_t line_state; // Bit 0: DTR, Bit 1: RTS
 
+  #if CFG_TUD_CDC_TX_COALESCE_SOF
+  volatile uint16_t tx_coalesce_countdown; // SOFs left until pending tx data is auto-flushed, 0 is not armed
+  #endif
+
   /*------------- From this point, data is not cleared by bus reset -------------*/
   TU_ATTR_ALIGNED(4) cdc_line_coding_t line_coding;
   char wanted_char;
@@ -109,6 +113,56 @@ TU_ATTR_ALWAYS_INLINE static inline uint8_t find_cdc_itf(uint8_t ep_addr) {
   return TUSB_INDEX_INVALID_8;
 }
 
+#if CFG_TUD_CDC_TX_COALESCE_SOF
+TU_VERIFY_STATIC(CFG_TUD_CDC_TX_COALESCE_SOF <= UINT16_MAX, "CFG_TUD_CDC_TX_COALESCE_SOF is too large");
+
+// Send pending tx data if coalesce threshold is reached, otherwise arm the SOF auto-flush countdown.
+// Return number of queued bytes
+static uint32_t tx_coalesce(cdcd_interface_t *p_cdc) {
+  tu_edpt_stream_t *stream_tx = &p_cdc->tx_stream;
+  const uint16_t    ff_count  = tu_fifo_count(&stream_tx->ff);
+  const uint16_t    threshold = tu_min16(CFG_TUD_CDC_TX_COALESCE_THRESHOLD, tu_fifo_depth(&stream_tx->ff));
+
+  if (ff_count >= threshold) {
+    p_cdc->tx_coalesce_countdown = 0;
+    return tu_edpt_stream_write_xfer(stream_tx);
+  }
+
+  // deadline is counted from the first pending byte, further writes do not postpone it
+  if (ff_count > 0 && p_cdc->tx_coalesce_countdown == 0 && tu_edpt_stream_is_opened(stream_tx)) {
+    p_cdc->tx_coalesce_countdown = CFG_TUD_CDC_TX_COALESCE_SOF;
+    usbd_sof_enable(p_cdc->rhport, SOF_CONSUMER_CDC, true);
+  }
+
+  return 0;
+}
+
+static bool tx_coalesce_armed(void) {
+  for (uint8_t i = 0; i < CFG_TUD_CDC; i++) {
+    if (_cdcd_itf[i].tx_coalesce_countdown != 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Deferred from SOF isr when countdown expired
+static void tx_coalesce_flush(void *param) {
+  const uint8_t     itf   = (uint8_t)(uintptr_t)param;
+  cdcd_interface_t *p_cdc = &_cdcd_itf[itf];
+  tu_edpt_stream_write_xfer(&p_cdc->tx_stream);
+
+  // stop SOF interrupt if no other interface is waiting for auto-flush
+  if (!tx_coalesce_armed()) {
+    usbd_sof_enable(p_cdc->rhport, SOF_CONSUMER_CDC, false);
+    // tx_coalesce() in another thread may have armed its countdown (and enabled SOF) in between
+    if (tx_coalesce_armed()) {
+      usbd_sof_enable(p_cdc->rhport, SOF_CONSUMER_CDC, true);
+    }
+  }
+}
+#endif
+
 //--------------------------------------------------------------------+
 // APPLICATION API
 //--------------------------------------------------------------------+
@@ -196,13 +250,24 @@ void tud_cdc_n_read_flush(uint8_t itf) {
 uint32_t tud_cdc_n_write(uint8_t itf, const void* buffer, uint32_t bufsize) {
   TU_VERIFY(itf < CFG_TUD_CDC, 0);
   cdcd_interface_t *p_cdc = &_cdcd_itf[itf];
+#if CFG_TUD_CDC_TX_COALESCE_SOF
+  TU_VERIFY(bufsize > 0, 0);
+  const uint32_t count = tu_fifo_write_n(&p_cdc->tx_stream.ff, buffer, (uint16_t)bufsize);
+  tx_coalesce(p_cdc);
+  return count;
+#else
   return tu_edpt_stream_write(&p_cdc->tx_stream, buffer, bufsize);
+#endif
 }
 
 uint32_t tud_cdc_n_write_flush(uint8_t itf) {
   TU_VERIFY(itf < CFG_TUD_CDC, 0);
   cdcd_interface_t *p_cdc = &_cdcd_itf[itf];
+#if CFG_TUD_CDC_TX_COALESCE_SOF
+  return tx_coalesce(p_cdc);
+#else
   return tu_edpt_stream_write_xfer(&p_cdc->tx_stream);
+#endif
 }
 
 uint32_t tud_cdc_n_write_available(uint8_t itf) {
@@ -271,6 +336,10 @@ void cdcd_reset(uint8_t rhport) {
     tu_edpt_stream_close(&p_cdc->rx_stream);
     tu_edpt_stream_close(&p_cdc->tx_stream);
   }
+
+#if CFG_TUD_CDC_TX_COALESCE_SOF
+  usbd_sof_enable(rhport, SOF_CONSUMER_CDC, false);
+#endif
 }
 
 uint16_t cdcd_open(uint8_t rhport, const tusb_desc_interface_t* itf_desc, uint16_t max_len) {
@@ -512,4 +581,22 @@ bool cdcd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_
   return true;
 }
 
+void cdcd_sof_isr(uint8_t rhport, uint32_t frame_count) {
+  (void)rhport;
+  (void)frame_count;
+
+#if CFG_TUD_CDC_TX_COALESCE_SOF
+  for (uint8_t itf = 0; itf < CFG_TUD_CDC; itf++) {
+    cdcd_interface_t *p_cdc     = &_cdcd_itf[itf];
+    const uint16_t    countdown = p_cdc->tx_coalesce_countdown;
+    if (countdown > 0) {
+      p_cdc->tx_coalesce_countdown = (uint16_t)(countdown - 1u);
+      if (countdown == 1) {
+        usbd_defer_func(tx_coalesce_flush, (void *)(uintptr_t)itf, true);
+      }
+    }
+  }
+#endif
+}
+
 #endif
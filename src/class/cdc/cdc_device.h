@@ -66,6 +66,19 @@
   #define CFG_TUD_CDC_TX_OVERWRITABLE_IF_NOT_CONNECTED 1
 #endif
 
+// Coalesce small writes (Nagle-style) to maximize bytes per bulk transaction. Written and flushed data is held in the
+// TX FIFO until it reaches CFG_TUD_CDC_TX_COALESCE_THRESHOLD bytes or this number of SOFs has elapsed since the first
+// pending byte, then it is flushed automatically. 0 is disabled i.e. data is sent as soon as a packet is filled or
+// tud_cdc_n_write_flush() is called.
+#ifndef CFG_TUD_CDC_TX_COALESCE_SOF
+  #define CFG_TUD_CDC_TX_COALESCE_SOF 0
+#endif
+
+// Number of pending bytes that trigger an immediate transfer when coalescing is enabled
+#ifndef CFG_TUD_CDC_TX_COALESCE_THRESHOLD
+  #define CFG_TUD_CDC_TX_COALESCE_THRESHOLD CFG_TUD_CDC_TX_EPSIZE
+#endif
+
 // Backward compatible: tud_cdc_configure_t and tud_cdc_configure() are no longer used.
 // Configuration is now done via compile-time macros above.
 typedef struct {
@@ -128,7 +141,8 @@ TU_ATTR_ALWAYS_INLINE static inline uint32_t tud_cdc_n_write_str(uint8_t itf, ch
   return tud_cdc_n_write(itf, str, strlen(str));
 }
 
-// Force sending data if possible, return number of forced bytes
+// Force sending data if possible, return number of forced bytes.
+// If CFG_TUD_CDC_TX_COALESCE_SOF is enabled, data below the coalesce threshold is left to the SOF auto-flush instead.
 uint32_t tud_cdc_n_write_flush(uint8_t itf);
 
 // Return the number of bytes (characters) available for writing to TX FIFO buffer in a single n_write operation.
@@ -284,6 +298,7 @@ void     cdcd_reset           (uint8_t rhport);
 uint16_t cdcd_open            (uint8_t rhport, tusb_desc_interface_t const * itf_desc, uint16_t max_len);
 bool     cdcd_control_xfer_cb (uint8_t rhport, uint8_t stage, tusb_control_request_t const * request);
 bool     cdcd_xfer_cb         (uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes);
+void     cdcd_sof_isr         (uint8_t rhport, uint32_t frame_count);
 
 #ifdef __cplusplus
  }
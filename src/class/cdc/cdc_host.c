@@ -53,6 +53,8 @@ typedef struct {
     cdc_line_control_state_t control_state;      // DTR, RTS
   } line, requested_line;
 
+  cdc_notify_uart_state_t serial_state; // last serial state reported by device
+
   tuh_xfer_cb_t user_complete_cb; // required since we handle request internally first
 
   union {
@@ -76,14 +78,28 @@ typedef struct {
     uint8_t tx_ff_buf[CFG_TUH_CDC_TX_BUFSIZE];
     uint8_t rx_ff_buf[CFG_TUH_CDC_RX_BUFSIZE];
   } stream;
+
+  #if CFG_TUH_CDC_RX_DOUBLE_BUFFER
+  struct {
+    tuh_xfer_t xfer[2];
+    uint8_t queued; // bit i is set if xfer[i] is queued
+  } rx_queue;
+  #endif
 } cdch_interface_t;
 
 typedef struct {
   TUH_EPBUF_DEF(tx, CFG_TUH_CDC_TX_EPSIZE);
   TUH_EPBUF_DEF(rx, CFG_TUH_CDC_RX_EPSIZE);
+  #if CFG_TUH_CDC_RX_DOUBLE_BUFFER
+  TUH_EPBUF_DEF(rx2, CFG_TUH_CDC_RX_EPSIZE);
+  #endif
   TUH_EPBUF_DEF(ctrl, 8);
 } cdch_epbuf_t;
 
+#if CFG_TUH_CDC_RX_DOUBLE_BUFFER && !CFG_TUH_EDPT_XFER_QUEUE
+  #error "CFG_TUH_CDC_RX_DOUBLE_BUFFER requires CFG_TUH_EDPT_XFER_QUEUE"
+#endif
+
 static cdch_interface_t cdch_data[CFG_TUH_CDC];
 CFG_TUH_MEM_SECTION static cdch_epbuf_t cdch_epbuf[CFG_TUH_CDC];
 
@@ -115,6 +131,7 @@ static void     ftdi_internal_control_complete(cdch_interface_t *p_cdc, tuh_xfer
 static bool     ftdi_set_baudrate(cdch_interface_t *p_cdc, tuh_xfer_cb_t complete_cb, uintptr_t user_data);
 static bool     ftdi_set_data_format(cdch_interface_t *p_cdc, tuh_xfer_cb_t complete_cb, uintptr_t user_data);
 static bool     ftdi_set_modem_ctrl(cdch_interface_t *p_cdc, tuh_xfer_cb_t complete_cb, uintptr_t user_data);
+static void     ftdi_rx_xfer_complete(cdch_interface_t *p_cdc, uint8_t idx, const uint8_t *buf, uint32_t xferred_bytes);
   #endif
 
   //------------- CP210X prototypes -------------//
@@ -368,6 +385,7 @@ static cdch_interface_t * make_new_itf(uint8_t daddr, tusb_desc_interface_t cons
       p_cdc->bInterfaceProtocol = itf_desc->bInterfaceProtocol;
       p_cdc->line.coding        = (cdc_line_coding_t) { 0, 0, 0, 0 };
       p_cdc->line.control_state.value = 0;
+      p_cdc->serial_state.value       = 0;
       return p_cdc;
     }
   }
@@ -390,6 +408,11 @@ TU_ATTR_WEAK void tuh_cdc_rx_cb(uint8_t idx) {
   (void) idx;
 }
 
+TU_ATTR_WEAK void tuh_cdc_serial_state_cb(uint8_t idx, cdc_notify_uart_state_t serial_state) {
+  (void) idx;
+  (void) serial_state;
+}
+
 TU_ATTR_WEAK void tuh_cdc_tx_complete_cb(uint8_t idx) {
   (void) idx;
 }
@@ -441,6 +464,13 @@ bool tuh_cdc_get_control_line_state_local(uint8_t idx, uint16_t* line_state) {
   return true;
 }
 
+bool tuh_cdc_get_serial_state_local(uint8_t idx, cdc_notify_uart_state_t* serial_state) {
+  cdch_interface_t * p_cdc = get_itf(idx);
+  TU_VERIFY(p_cdc);
+  *serial_state = p_cdc->serial_state;
+  return true;
+}
+
 bool tuh_cdc_get_line_coding_local(uint8_t idx, cdc_line_coding_t * line_coding) {
   cdch_interface_t * p_cdc = get_itf(idx);
   TU_VERIFY(p_cdc);
@@ -448,6 +478,98 @@ bool tuh_cdc_get_line_coding_local(uint8_t idx, cdc_line_coding_t * line_coding)
   return true;
 }
 
+//--------------------------------------------------------------------+
+// RX Transfer
+//--------------------------------------------------------------------+
+
+// Push received data to RX FIFO and invoke callback
+static void rx_xfer_complete(cdch_interface_t *p_cdc, uint8_t idx, const uint8_t *buf, uint32_t xferred_bytes) {
+  #if CFG_TUH_CDC_FTDI
+  if (p_cdc->serial_drid == SERIAL_DRIVER_FTDI) {
+    ftdi_rx_xfer_complete(p_cdc, idx, buf, xferred_bytes);
+    return;
+  }
+  #endif
+
+  tu_edpt_stream_read_xfer_complete_with_buf(&p_cdc->stream.rx, buf, xferred_bytes);
+  tuh_cdc_rx_cb(idx); // invoke receive callback
+}
+
+#if CFG_TUH_CDC_RX_DOUBLE_BUFFER
+static void rx_queue_complete(tuh_xfer_t *xfer);
+
+// Queue idle RX transfers as long as FIFO has room for all queued transfers
+static void rx_queue_fill(cdch_interface_t *p_cdc) {
+  tu_edpt_stream_t *stream = &p_cdc->stream.rx;
+  TU_VERIFY(p_cdc->mounted && tu_edpt_stream_is_opened(stream),);
+
+  const uint8_t idx   = get_idx_by_ptr(p_cdc);
+  cdch_epbuf_t *epbuf = &cdch_epbuf[idx];
+
+  #if OSAL_MUTEX_REQUIRED
+  // tuh_cdc_read() can be called by application task while usbh task completes a transfer
+  osal_mutex_lock(stream->ff.mutex_rd, OSAL_TIMEOUT_WAIT_FOREVER);
+  #endif
+
+  for (uint8_t i = 0; i < 2; i++) {
+    const uint8_t queued_count = (uint8_t) ((p_cdc->rx_queue.queued & 1u) + (p_cdc->rx_queue.queued >> 1));
+    if (tu_fifo_remaining(&stream->ff) < (uint32_t) (queued_count + 1) * stream->xfer_len) {
+      break;
+    }
+    if (p_cdc->rx_queue.queued & (1u << i)) {
+      continue;
+    }
+
+    tuh_xfer_t *xfer  = &p_cdc->rx_queue.xfer[i];
+    xfer->daddr       = p_cdc->daddr;
+    xfer->ep_addr     = stream->ep_addr;
+    xfer->buffer      = (i == 0) ? epbuf->rx : epbuf->rx2;
+    xfer->buflen      = stream->xfer_len;
+    xfer->complete_cb = rx_queue_complete;
+    xfer->user_data   = idx;
+
+    p_cdc->rx_queue.queued |= (uint8_t) (1u << i);
+    if (!tuh_edpt_xfer_queue(xfer)) {
+      p_cdc->rx_queue.queued &= (uint8_t) ~(1u << i);
+      break;
+    }
+  }
+
+  #if OSAL_MUTEX_REQUIRED
+  osal_mutex_unlock(stream->ff.mutex_rd);
+  #endif
+}
+
+static void rx_queue_complete(tuh_xfer_t *xfer) {
+  const uint8_t idx = (uint8_t) xfer->user_data;
+  cdch_interface_t *p_cdc = &cdch_data[idx];
+  const uint8_t xfer_id = (xfer == &p_cdc->rx_queue.xfer[0]) ? 0 : 1;
+
+  #if OSAL_MUTEX_REQUIRED
+  osal_mutex_lock(p_cdc->stream.rx.ff.mutex_rd, OSAL_TIMEOUT_WAIT_FOREVER);
+  #endif
+  p_cdc->rx_queue.queued &= (uint8_t) ~(1u << xfer_id);
+  #if OSAL_MUTEX_REQUIRED
+  osal_mutex_unlock(p_cdc->stream.rx.ff.mutex_rd);
+  #endif
+
+  // aborted or failed e.g device is unplugged, queue is restarted by next tuh_cdc_read()
+  TU_VERIFY(xfer->result == XFER_RESULT_SUCCESS && p_cdc->daddr == xfer->daddr,);
+
+  rx_xfer_complete(p_cdc, idx, xfer->buffer, xfer->actual_len);
+  rx_queue_fill(p_cdc);
+}
+#endif
+
+// Prepare for incoming data if there is room in RX FIFO
+static void rx_prepare(cdch_interface_t *p_cdc) {
+  #if CFG_TUH_CDC_RX_DOUBLE_BUFFER
+  rx_queue_fill(p_cdc);
+  #else
+  (void) tu_edpt_stream_read_xfer(&p_cdc->stream.rx);
+  #endif
+}
+
 //--------------------------------------------------------------------+
 // Write
 //--------------------------------------------------------------------+
@@ -484,7 +606,9 @@ uint32_t tuh_cdc_write_available(uint8_t idx) {
 uint32_t tuh_cdc_read (uint8_t idx, void * buffer, uint32_t bufsize) {
   cdch_interface_t * p_cdc = get_itf(idx);
   TU_VERIFY(p_cdc);
-  return tu_edpt_stream_read(&p_cdc->stream.rx, buffer, bufsize);
+  const uint32_t count = tu_fifo_read_n(&p_cdc->stream.rx.ff, buffer, (uint16_t) bufsize);
+  rx_prepare(p_cdc);
+  return count;
 }
 
 uint32_t tuh_cdc_read_available(uint8_t idx) {
@@ -504,7 +628,7 @@ bool tuh_cdc_read_clear (uint8_t idx) {
   TU_VERIFY(p_cdc);
 
   tu_edpt_stream_clear(&p_cdc->stream.rx);
-  (void)tu_edpt_stream_read_xfer(&p_cdc->stream.rx);
+  rx_prepare(p_cdc);
   return true;
 }
 
@@ -684,21 +808,7 @@ bool cdch_xfer_cb(uint8_t daddr, uint8_t ep_addr, xfer_result_t event, uint32_t
       (void)tu_edpt_stream_write_zlp_if_needed(&p_cdc->stream.tx, xferred_bytes);
     }
   } else if (ep_addr == p_cdc->stream.rx.ep_addr) {
-    #if CFG_TUH_CDC_FTDI
-    if (p_cdc->serial_drid == SERIAL_DRIVER_FTDI) {
-      // FTDI reserve 2 bytes for status
-      // uint8_t status[2] = {p_cdc->stream.rx.ep_buf[0], p_cdc->stream.rx.ep_buf[1]};
-      if (xferred_bytes > 2) {
-        tu_edpt_stream_read_xfer_complete_with_buf(&p_cdc->stream.rx, p_cdc->stream.rx.ep_buf + 2, xferred_bytes - 2);
-
-        tuh_cdc_rx_cb(idx); // invoke receive callback
-      }
-    } else
-    #endif
-    {
-      tu_edpt_stream_read_xfer_complete(&p_cdc->stream.rx, xferred_bytes);
-      tuh_cdc_rx_cb(idx); // invoke receive callback
-    }
+    rx_xfer_complete(p_cdc, idx, p_cdc->stream.rx.ep_buf, xferred_bytes);
 
     // prepare for next transfer if needed
     tu_edpt_stream_read_xfer(&p_cdc->stream.rx);
@@ -724,7 +834,22 @@ static bool open_ep_stream_pair(cdch_interface_t *p_cdc, tusb_desc_endpoint_t co
     TU_ASSERT(tuh_edpt_open(p_cdc->daddr, desc_ep));
     const uint8_t     ep_dir = tu_edpt_dir(desc_ep->bEndpointAddress);
     tu_edpt_stream_t *stream = (ep_dir == TUSB_DIR_IN) ? &p_cdc->stream.rx : &p_cdc->stream.tx;
-    tu_edpt_stream_open(stream, p_cdc->daddr, desc_ep, tu_edpt_packet_size(desc_ep));
+    const uint16_t    mps    = tu_edpt_packet_size(desc_ep);
+
+    // host knows OUT transfer length and sends ZLP if needed, IN transfer only completes on short packet or when full
+    uint16_t epsize = CFG_TUH_CDC_TX_EPSIZE;
+    if (ep_dir == TUSB_DIR_IN) {
+      bool rx_short_terminated = CFG_TUH_CDC_RX_NEED_ZLP;
+      #if CFG_TUH_CDC_FTDI
+      // FTDI sends a short packet (at least status) every latency timer period
+      rx_short_terminated = rx_short_terminated || (p_cdc->serial_drid == SERIAL_DRIVER_FTDI);
+      #endif
+      epsize = rx_short_terminated ? CFG_TUH_CDC_RX_EPSIZE : mps;
+    }
+    if (epsize >= mps) {
+      epsize = (uint16_t) (epsize - (epsize % mps));
+    }
+    tu_edpt_stream_open(stream, p_cdc->daddr, desc_ep, epsize);
     tu_edpt_stream_clear(stream);
 
     desc_ep = (const tusb_desc_endpoint_t *)tu_desc_next(desc_ep);
@@ -769,7 +894,7 @@ static void set_config_complete(cdch_interface_t *p_cdc, bool success) {
     p_cdc->mounted    = true;
     tuh_cdc_mount_cb(idx);
     // Prepare for incoming data
-    tu_edpt_stream_read_xfer(&p_cdc->stream.rx);
+    rx_prepare(p_cdc);
   } else {
     // clear the interface entry
     p_cdc->daddr            = 0;
@@ -1187,6 +1312,47 @@ static bool ftdi_set_baudrate(cdch_interface_t *p_cdc, tuh_xfer_cb_t complete_cb
                           value, index, complete_cb, user_data);
 }
 
+//------------- Data -------------//
+
+// Each packet starts with 2 status bytes: modem status and line status, followed by data. Status of all packets is
+// merged into serial state, with line errors being reported if they occur in any packet of the transfer.
+static void ftdi_rx_xfer_complete(cdch_interface_t *p_cdc, uint8_t idx, const uint8_t *buf, uint32_t xferred_bytes) {
+  tu_edpt_stream_t *stream = &p_cdc->stream.rx;
+  uint8_t modem_status = 0;
+  uint8_t line_status  = 0;
+  uint32_t data_count  = 0;
+
+  while (xferred_bytes >= 2) {
+    uint32_t const pkt_len = tu_min32(xferred_bytes, stream->mps);
+    modem_status = buf[0]; // latest
+    line_status |= buf[1];
+    if (pkt_len > 2) {
+      tu_edpt_stream_read_xfer_complete_with_buf(stream, buf + 2, pkt_len - 2);
+      data_count += pkt_len - 2;
+    }
+    buf += pkt_len;
+    xferred_bytes -= pkt_len;
+  }
+
+  cdc_notify_uart_state_t serial_state = {.value = 0};
+  serial_state.bRxCarrier  = (modem_status & FTDI_RS0_RLSD) ? 1u : 0u;
+  serial_state.bTxCarrier  = (modem_status & FTDI_RS0_DSR) ? 1u : 0u;
+  serial_state.bRingSignal = (modem_status & FTDI_RS0_RI) ? 1u : 0u;
+  serial_state.bBreak      = (line_status & FTDI_RS_BI) ? 1u : 0u;
+  serial_state.bFraming    = (line_status & FTDI_RS_FE) ? 1u : 0u;
+  serial_state.bParity     = (line_status & FTDI_RS_PE) ? 1u : 0u;
+  serial_state.bOverRun    = (line_status & FTDI_RS_OE) ? 1u : 0u;
+
+  if (data_count > 0) {
+    tuh_cdc_rx_cb(idx); // invoke receive callback
+  }
+
+  if (serial_state.value != p_cdc->serial_state.value) {
+    p_cdc->serial_state = serial_state;
+    tuh_cdc_serial_state_cb(idx, serial_state);
+  }
+}
+
 static bool ftdi_set_modem_ctrl(cdch_interface_t *p_cdc, tuh_xfer_cb_t complete_cb, uintptr_t user_data) {
   uint16_t line_state = (uint16_t) ((p_cdc->requested_line.control_state.dtr ? FTDI_SIO_SET_DTR_HIGH : FTDI_SIO_SET_DTR_LOW) |
                                     (p_cdc->requested_line.control_state.rts ? FTDI_SIO_SET_RTS_HIGH : FTDI_SIO_SET_RTS_LOW));
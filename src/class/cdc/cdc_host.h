@@ -23,17 +23,30 @@ extern "C" {
   #define CFG_TUH_CDC_RX_BUFSIZE TUH_EPSIZE_BULK_MAX
 #endif
 
-// RX Endpoint size
+// RX Endpoint size. Adapters that terminate each burst with a short packet (FTDI, or CFG_TUH_CDC_RX_NEED_ZLP) receive
+// up to this many bytes (rounded down to multiple of max packet size) per transfer, otherwise one packet per transfer
 #ifndef CFG_TUH_CDC_RX_EPSIZE
   #define CFG_TUH_CDC_RX_EPSIZE TUH_EPSIZE_BULK_MAX
 #endif
 
+// Device always ends a burst with a short packet or ZLP, so that RX can use multi-packet transfers of
+// CFG_TUH_CDC_RX_EPSIZE. Otherwise data of a burst which is multiple of max packet size is held back until next burst
+#ifndef CFG_TUH_CDC_RX_NEED_ZLP
+  #define CFG_TUH_CDC_RX_NEED_ZLP 0
+#endif
+
+// Keep two RX transfers (each with its own CFG_TUH_CDC_RX_EPSIZE buffer) queued on bulk IN endpoint, so that it is
+// re-armed right after a transfer completes instead of waiting for host task. Requires CFG_TUH_EDPT_XFER_QUEUE
+#ifndef CFG_TUH_CDC_RX_DOUBLE_BUFFER
+  #define CFG_TUH_CDC_RX_DOUBLE_BUFFER 0
+#endif
+
 // TX FIFO size
 #ifndef CFG_TUH_CDC_TX_BUFSIZE
   #define CFG_TUH_CDC_TX_BUFSIZE TUH_EPSIZE_BULK_MAX
 #endif
 
-// TX Endpoint size
+// TX Endpoint size, maximum bytes per transfer (rounded down to multiple of max packet size)
 #ifndef CFG_TUH_CDC_TX_EPSIZE
   #define CFG_TUH_CDC_TX_EPSIZE TUH_EPSIZE_BULK_MAX
 #endif
@@ -58,6 +71,10 @@ bool tuh_cdc_mounted(uint8_t idx);
 // are invoked previously or CFG_TUH_CDC_LINE_STATE_ON_ENUM is defined.
 bool tuh_cdc_get_control_line_state_local(uint8_t idx, uint16_t *line_state);
 
+// Get serial state (DCD, DSR, ring, break and framing/parity/overrun errors) last reported by device.
+// Currently only reported by FTDI, which sends it with every received packet
+bool tuh_cdc_get_serial_state_local(uint8_t idx, cdc_notify_uart_state_t *serial_state);
+
 // Get current DTR status
 TU_ATTR_ALWAYS_INLINE static inline bool tuh_cdc_get_dtr(uint8_t idx) {
   uint16_t line_state;
@@ -228,6 +245,9 @@ extern void tuh_cdc_umount_cb(uint8_t idx);
 // Invoked when received new data
 extern void tuh_cdc_rx_cb(uint8_t idx);
 
+// Invoked when serial state reported by device is changed
+extern void tuh_cdc_serial_state_cb(uint8_t idx, cdc_notify_uart_state_t serial_state);
+
 // Invoked when a TX is complete and therefore space becomes available in TX buffer
 extern void tuh_cdc_tx_complete_cb(uint8_t idx);
 
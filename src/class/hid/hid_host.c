@@ -793,4 +793,385 @@ uint8_t tuh_hid_parse_report_descriptor(tuh_hid_report_info_t* report_info_arr,
   return report_num;
 }
 
+
+//--------------------------------------------------------------------+
+// Report Descriptor Compiler
+//--------------------------------------------------------------------+
+enum {
+  HID_COMPILE_GLOBAL_STACK = 4,  // push/pop depth
+  HID_COMPILE_USAGE_MAX    = 16, // usage (range) items per main item
+  HID_COMPILE_REPORT_MAX   = 16  // number of report id + type combinations
+};
+
+typedef struct {
+  int32_t  logical_min;
+  int32_t  logical_max;
+  uint32_t report_size;
+  uint32_t report_count;
+  uint16_t usage_page;
+  uint8_t  report_id;
+  uint8_t  logical_max_size; // item data size of logical maximum in bytes
+} hid_compile_global_t;
+
+typedef struct {
+  uint16_t page;
+  uint16_t min;
+  uint16_t max;
+  bool     extended; // page is given by usage itself, otherwise it is current usage page at main item
+} hid_compile_usage_t;
+
+typedef struct {
+  hid_compile_global_t global;
+  hid_compile_global_t stack[HID_COMPILE_GLOBAL_STACK];
+  uint8_t stack_count;
+
+  hid_compile_usage_t usages[HID_COMPILE_USAGE_MAX];
+  uint8_t usage_count;
+  bool usage_min_pending; // usage minimum is waiting for its maximum
+  uint8_t delimiter_depth;
+  uint8_t delimiter_set;  // only first usage of delimiter set is used
+
+  struct {
+    uint8_t  id;
+    uint8_t  type;
+    uint16_t bits;
+  } reports[HID_COMPILE_REPORT_MAX];
+  uint8_t report_count;
+} hid_compile_state_t;
+
+// Bit position of next main item for report id + type, NULL if there is too many reports
+static uint16_t* compile_report_bits(hid_compile_state_t* st, uint8_t report_id, uint8_t report_type) {
+  for (uint8_t i = 0; i < st->report_count; i++) {
+    if (st->reports[i].id == report_id && st->reports[i].type == report_type) {
+      return &st->reports[i].bits;
+    }
+  }
+  TU_VERIFY(st->report_count < HID_COMPILE_REPORT_MAX, NULL);
+  st->reports[st->report_count].id = report_id;
+  st->reports[st->report_count].type = report_type;
+  st->reports[st->report_count].bits = report_id ? 8 : 0; // report ID byte precedes data
+  return &st->reports[st->report_count++].bits;
+}
+
+// Usage of element idx of a variable main item, last usage is repeated if there is fewer usages than elements
+static void compile_element_usage(const hid_compile_state_t* st, uint32_t idx, uint16_t* page, uint16_t* usage) {
+  for (uint8_t i = 0; i < st->usage_count; i++) {
+    const hid_compile_usage_t* u = &st->usages[i];
+    uint32_t const n = (uint32_t) (u->max - u->min) + 1;
+    if (idx < n || i + 1 == st->usage_count) {
+      *page = u->page;
+      *usage = (uint16_t) (u->min + TU_MIN(idx, n - 1));
+      return;
+    }
+    idx -= n;
+  }
+  *page = st->global.usage_page;
+  *usage = 0;
+}
+
+// Add fields of an Input/Output/Feature item. Return false if field table is full
+static bool compile_main_item(hid_compile_state_t* st, uint8_t report_type, uint8_t flags, tuh_hid_field_t* fields,
+                              uint16_t field_max, uint16_t* field_num) {
+  const hid_compile_global_t* g = &st->global;
+  uint16_t* p_bits = compile_report_bits(st, g->report_id, report_type);
+  TU_VERIFY(p_bits);
+
+  uint32_t const bit_size = g->report_size;
+  uint32_t const count = g->report_count;
+  uint32_t const bit_offset = *p_bits;
+  TU_VERIFY(bit_size == 0 || count <= UINT16_MAX / bit_size);
+  TU_VERIFY(bit_offset + bit_size * count <= UINT16_MAX);
+  *p_bits = (uint16_t) (bit_offset + bit_size * count);
+
+  if ((flags & HID_CONSTANT) || bit_size == 0 || bit_size > 32 || count == 0) {
+    return true; // padding or unsupported element size, only advance position
+  }
+
+  // some devices encode unsigned maximum with minimal bytes e.g 0xFF for 255, which sign-extends to -1
+  int32_t logical_max = g->logical_max;
+  if (g->logical_min >= 0 && logical_max < 0 && g->logical_max_size < 4) {
+    logical_max &= (int32_t) ((1u << (8 * g->logical_max_size)) - 1);
+  }
+
+  // usage without explicit page takes usage page in effect at main item (HID 1.11 6.2.2.8)
+  for (uint8_t i = 0; i < st->usage_count; i++) {
+    if (!st->usages[i].extended) {
+      st->usages[i].page = g->usage_page;
+    }
+  }
+
+  tuh_hid_field_t field = {
+    .logical_min = g->logical_min,
+    .logical_max = logical_max,
+    .usage_page  = g->usage_page,
+    .bit_offset  = (uint16_t) bit_offset,
+    .bit_size    = (uint8_t) bit_size,
+    .report_id   = g->report_id,
+    .report_type = report_type,
+    .flags       = flags
+  };
+
+  if (!(flags & HID_VARIABLE)) {
+    // array: element is index into usages, take the overall range
+    if (st->usage_count > 0) {
+      field.usage_page = st->usages[0].page;
+      field.usage_min = st->usages[0].min;
+      field.usage_max = st->usages[0].max;
+      for (uint8_t i = 1; i < st->usage_count; i++) {
+        field.usage_min = TU_MIN(field.usage_min, st->usages[i].min);
+        field.usage_max = TU_MAX(field.usage_max, st->usages[i].max);
+      }
+    }
+    field.count = (uint16_t) count;
+    TU_VERIFY(*field_num < field_max);
+    fields[(*field_num)++] = field;
+    return true;
+  }
+
+  // variable: split into runs of consecutive usages, repeated last usage is merged into its run
+  uint32_t start = 0;
+  bool repeating = false;
+  compile_element_usage(st, 0, &field.usage_page, &field.usage_min);
+  field.usage_max = field.usage_min;
+
+  for (uint32_t i = 1; i <= count; i++) {
+    uint16_t page = 0, usage = 0;
+    if (i < count) {
+      compile_element_usage(st, i, &page, &usage);
+      if (page == field.usage_page) {
+        if (!repeating && usage == field.usage_max + 1) {
+          field.usage_max = usage;
+          continue;
+        }
+        if (usage == field.usage_max) {
+          repeating = true;
+          continue;
+        }
+      }
+    }
+
+    field.bit_offset = (uint16_t) (bit_offset + start * bit_size);
+    field.count = (uint16_t) (i - start);
+    TU_VERIFY(*field_num < field_max);
+    fields[(*field_num)++] = field;
+
+    start = i;
+    repeating = false;
+    field.usage_page = page;
+    field.usage_min = usage;
+    field.usage_max = usage;
+  }
+
+  return true;
+}
+
+static void compile_add_usage(hid_compile_state_t* st, uint8_t size, uint32_t data, bool is_min, bool is_max) {
+  if (st->delimiter_set > 1) {
+    return; // alternative usages of delimiter set are ignored
+  }
+
+  // extended usage (4 bytes) includes usage page in upper 16 bits
+  bool const extended = (size == 4);
+  uint16_t const usage = (uint16_t) data;
+
+  if (is_max) {
+    if (st->usage_min_pending) {
+      hid_compile_usage_t* u = &st->usages[st->usage_count - 1];
+      u->max = TU_MAX(usage, u->min);
+      st->usage_min_pending = false;
+    }
+    return;
+  }
+
+  if (st->usage_count < HID_COMPILE_USAGE_MAX) {
+    hid_compile_usage_t* u = &st->usages[st->usage_count++];
+    u->page = extended ? (uint16_t) (data >> 16) : 0;
+    u->extended = extended;
+    u->min = usage;
+    u->max = usage;
+    st->usage_min_pending = is_min;
+  }
+}
+
+uint16_t tuh_hid_report_compile(tuh_hid_field_t* fields, uint16_t field_max, const uint8_t* desc_report,
+                                uint16_t desc_len) {
+  hid_compile_state_t st;
+  tu_memclr(&st, sizeof(st));
+  uint16_t field_num = 0;
+
+  while (desc_len > 0) {
+    uint8_t const header = *desc_report++;
+    desc_len--;
+
+    uint8_t const tag = header >> 4;
+    uint8_t const type = (header >> 2) & 0x03;
+    uint16_t size = header & 0x03;
+    if (size == 3) {
+      size = 4; // HID 1.11 6.2.2.2 3 is 4 bytes
+    }
+
+    if (header == 0xFE) {
+      // long item: bDataSize, bLongItemTag, data. Not defined by HID 1.11, skip it
+      TU_VERIFY(desc_len >= 2, field_num);
+      size = (uint16_t) (desc_report[0] + 2);
+    }
+    if (size > desc_len) {
+      break; // truncated item
+    }
+
+    // item data is little endian, signed value is sign extended from its size
+    uint32_t udata = 0;
+    for (uint8_t i = 0; i < size && i < 4; i++) {
+      udata |= (uint32_t) desc_report[i] << (8 * i);
+    }
+    int32_t sdata = (int32_t) udata;
+    if (size == 1) {
+      sdata = (int8_t) udata;
+    } else if (size == 2) {
+      sdata = (int16_t) udata;
+    }
+
+    if (header != 0xFE) {
+      switch (type) {
+        case RI_TYPE_MAIN: {
+          uint8_t report_type = HID_REPORT_TYPE_INVALID;
+          switch (tag) {
+            case RI_MAIN_INPUT: report_type = HID_REPORT_TYPE_INPUT; break;
+            case RI_MAIN_OUTPUT: report_type = HID_REPORT_TYPE_OUTPUT; break;
+            case RI_MAIN_FEATURE: report_type = HID_REPORT_TYPE_FEATURE; break;
+            default: break;
+          }
+          if (report_type != HID_REPORT_TYPE_INVALID &&
+              !compile_main_item(&st, report_type, (uint8_t) udata, fields, field_max, &field_num)) {
+            return field_num;
+          }
+
+          // local items only apply to the next main item
+          st.usage_count = 0;
+          st.usage_min_pending = false;
+          st.delimiter_depth = 0;
+          st.delimiter_set = 0;
+          break;
+        }
+
+        case RI_TYPE_GLOBAL:
+          switch (tag) {
+            case RI_GLOBAL_USAGE_PAGE: st.global.usage_page = (uint16_t) udata; break;
+            case RI_GLOBAL_LOGICAL_MIN: st.global.logical_min = sdata; break;
+            case RI_GLOBAL_LOGICAL_MAX:
+              st.global.logical_max = sdata;
+              st.global.logical_max_size = (uint8_t) size;
+              break;
+            case RI_GLOBAL_REPORT_SIZE: st.global.report_size = udata; break;
+            case RI_GLOBAL_REPORT_ID: st.global.report_id = (uint8_t) udata; break;
+            case RI_GLOBAL_REPORT_COUNT: st.global.report_count = udata; break;
+
+            case RI_GLOBAL_PUSH:
+              TU_VERIFY(st.stack_count < HID_COMPILE_GLOBAL_STACK, field_num);
+              st.stack[st.stack_count++] = st.global;
+              break;
+
+            case RI_GLOBAL_POP:
+              TU_VERIFY(st.stack_count > 0, field_num);
+              st.global = st.stack[--st.stack_count];
+              break;
+
+            default: break; // physical range and unit are not compiled
+          }
+          break;
+
+        case RI_TYPE_LOCAL:
+          switch (tag) {
+            case RI_LOCAL_USAGE: compile_add_usage(&st, (uint8_t) size, udata, false, false); break;
+            case RI_LOCAL_USAGE_MIN: compile_add_usage(&st, (uint8_t) size, udata, true, false); break;
+            case RI_LOCAL_USAGE_MAX: compile_add_usage(&st, (uint8_t) size, udata, false, true); break;
+
+            case RI_LOCAL_DELIMITER:
+              if (udata == 1) {
+                st.delimiter_depth++;
+                st.delimiter_set++;
+              } else if (st.delimiter_depth > 0) {
+                st.delimiter_depth--;
+              }
+              break;
+
+            default: break;
+          }
+          break;
+
+        default: break;
+      }
+    }
+
+    desc_report += size;
+    desc_len = (uint16_t) (desc_len - size);
+  }
+
+  return field_num;
+}
+
+//--------------------------------------------------------------------+
+// Report Field Extraction
+//--------------------------------------------------------------------+
+
+// Read bit_size bits at bit_pos, caller makes sure they are within len
+TU_ATTR_ALWAYS_INLINE static inline uint32_t field_read_bits(const uint8_t* report, uint16_t len, uint32_t bit_pos,
+                                                             uint8_t bit_size) {
+  uint32_t const byte = bit_pos >> 3;
+  uint8_t const shift = (uint8_t) (bit_pos & 7);
+  uint32_t raw;
+
+  if (shift + bit_size <= 32 && byte + 4 <= len) {
+    // fast path: single word read
+    raw = tu_le32toh(tu_unaligned_read32(report + byte)) >> shift;
+  } else {
+    // near end of report or element straddles 5 bytes
+    uint64_t raw64 = 0;
+    uint32_t const nbytes = (shift + bit_size + 7u) / 8;
+    for (uint32_t i = 0; i < nbytes; i++) {
+      raw64 |= (uint64_t) report[byte + i] << (8 * i);
+    }
+    raw = (uint32_t) (raw64 >> shift);
+  }
+
+  if (bit_size < 32) {
+    raw &= (1u << bit_size) - 1;
+  }
+  return raw;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline int32_t field_sign_extend(const tuh_hid_field_t* field, uint32_t raw) {
+  if (field->logical_min < 0 && field->bit_size < 32 && (raw & (1u << (field->bit_size - 1)))) {
+    raw |= ~((1u << field->bit_size) - 1);
+  }
+  return (int32_t) raw;
+}
+
+bool tuh_hid_field_get(const tuh_hid_field_t* field, uint16_t idx, const uint8_t* report, uint16_t len,
+                       int32_t* value) {
+  TU_VERIFY(idx < field->count);
+  uint32_t const bit_pos = field->bit_offset + (uint32_t) idx * field->bit_size;
+  TU_VERIFY(bit_pos + field->bit_size <= 8u * len);
+
+  *value = field_sign_extend(field, field_read_bits(report, len, bit_pos, field->bit_size));
+  return true;
+}
+
+uint16_t tuh_hid_field_get_all(const tuh_hid_field_t* field, const uint8_t* report, uint16_t len, int32_t* values,
+                               uint16_t max) {
+  // number of elements within report
+  uint32_t const len_bits = 8u * len;
+  uint16_t count = TU_MIN(field->count, max);
+  if (field->bit_offset + (uint32_t) count * field->bit_size > len_bits) {
+    count = (field->bit_offset >= len_bits) ? 0 : (uint16_t) ((len_bits - field->bit_offset) / field->bit_size);
+  }
+
+  uint32_t bit_pos = field->bit_offset;
+  for (uint16_t i = 0; i < count; i++) {
+    values[i] = field_sign_extend(field, field_read_bits(report, len, bit_pos, field->bit_size));
+    bit_pos += field->bit_size;
+  }
+  return count;
+}
+
 #endif
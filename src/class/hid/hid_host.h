@@ -70,6 +70,44 @@ bool tuh_hid_mounted(uint8_t dev_addr, uint8_t idx);
 TU_ATTR_UNUSED uint8_t tuh_hid_parse_report_descriptor(tuh_hid_report_info_t *reports_info_arr, uint8_t arr_count,
                                                        const uint8_t *desc_report, uint16_t desc_len);
 
+//--------------------------------------------------------------------+
+// Report Field API
+// Report descriptor is compiled once (e.g in tuh_hid_mount_cb) into a table of fields, which is then used to extract
+// values from each received report without parsing descriptor again.
+//--------------------------------------------------------------------+
+
+// Compiled Input/Output/Feature main item
+// - Variable item is split into fields of consecutive usages: element i has usage min(usage_min + i, usage_max)
+// - Array item: element is an index, usage = usage_min + (value - logical_min)
+typedef struct {
+  int32_t  logical_min;
+  int32_t  logical_max;
+  uint16_t usage_page;
+  uint16_t usage_min;
+  uint16_t usage_max;
+  uint16_t bit_offset;  // of first element, counted from start of report including report ID byte (if any)
+  uint16_t count;       // number of elements
+  uint8_t  bit_size;    // size of each element, 1-32
+  uint8_t  report_id;   // 0 if device does not use report ID
+  uint8_t  report_type; // hid_report_type_t
+  uint8_t  flags;       // data of main item e.g HID_VARIABLE, HID_RELATIVE
+} tuh_hid_field_t;
+
+// Compile report descriptor into field table, constant (padding) items are skipped.
+// Return number of fields, which is limited to field_max
+uint16_t tuh_hid_report_compile(tuh_hid_field_t *fields, uint16_t field_max, const uint8_t *desc_report,
+                                uint16_t desc_len);
+
+// Extract element idx of field from report as received by tuh_hid_report_received_cb(). Value is sign extended if
+// logical minimum is negative. Return false if element is not within report (len).
+// Note: caller should check field->report_id matches first byte of report if device uses report ID
+bool tuh_hid_field_get(const tuh_hid_field_t *field, uint16_t idx, const uint8_t *report, uint16_t len,
+                       int32_t *value);
+
+// Extract up to max elements of field into values. Return number of extracted elements
+uint16_t tuh_hid_field_get_all(const tuh_hid_field_t *field, const uint8_t *report, uint16_t len, int32_t *values,
+                               uint16_t max);
+
 //--------------------------------------------------------------------+
 // Control Endpoint API
 //--------------------------------------------------------------------+
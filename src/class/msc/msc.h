@@ -39,7 +39,8 @@ typedef enum
 {
   MSC_PROTOCOL_CBI              = 0 ,  ///< Control/Bulk/Interrupt protocol (with command completion interrupt)
   MSC_PROTOCOL_CBI_NO_INTERRUPT = 1 ,  ///< Control/Bulk/Interrupt protocol (without command completion interrupt)
-  MSC_PROTOCOL_BOT              = 0x50 ///< Bulk-Only Transport
+  MSC_PROTOCOL_BOT              = 0x50,///< Bulk-Only Transport
+  MSC_PROTOCOL_UAS              = 0x62 ///< USB Attached SCSI
 }msc_protocol_type_t;
 
 /// MassStorage Class-Specific Control Request
@@ -101,8 +102,29 @@ typedef enum {
   SCSI_CMD_READ_FORMAT_CAPACITY         = 0x23, ///< The command allows the Host to request a list of the possible format capacities for an installed writable media. This command also has the capability to report the writable capacity for a media when it is installed
   SCSI_CMD_READ_10                      = 0x28, ///< The READ (10) command requests that the device server read the specified logical block(s) and transfer them to the data-in buffer.
   SCSI_CMD_WRITE_10                     = 0x2A, ///< The WRITE (10) command requests that the device server transfer the specified logical block(s) from the data-out buffer and write them.
+  SCSI_CMD_SYNCHRONIZE_CACHE_10         = 0x35, ///< Ensure logical blocks in volatile cache of the device are written to the medium.
+  SCSI_CMD_WRITE_SAME_10                = 0x41, ///< Write a single block of data-out to a range of logical blocks, optionally unmapping them.
+  SCSI_CMD_UNMAP                        = 0x42, ///< Unmap (deallocate, TRIM) logical blocks listed in the parameter list.
+  SCSI_CMD_MODE_SELECT_10               = 0x55, ///< MODE SELECT(10) with 16-bit parameter list length
+  SCSI_CMD_READ_16                      = 0x88, ///< The READ (16) command is READ (10) with 64-bit LBA and 32-bit transfer length.
+  SCSI_CMD_WRITE_16                     = 0x8A, ///< The WRITE (16) command is WRITE (10) with 64-bit LBA and 32-bit transfer length.
+  SCSI_CMD_SYNCHRONIZE_CACHE_16         = 0x91, ///< SYNCHRONIZE CACHE (10) with 64-bit LBA and 32-bit block count.
+  SCSI_CMD_WRITE_SAME_16                = 0x93, ///< WRITE SAME (10) with 64-bit LBA and 32-bit block count.
+  SCSI_CMD_SERVICE_ACTION_IN_16         = 0x9E, ///< Service action in (16), sub-command is specified by service action field e.g READ CAPACITY (16)
 }scsi_cmd_type_t;
 
+/// SCSI Service Action for \ref SCSI_CMD_SERVICE_ACTION_IN_16
+typedef enum {
+  SCSI_SERVICE_ACTION_READ_CAPACITY_16 = 0x10, ///< The READ CAPACITY (16) command returns 64-bit capacity of the logical unit
+}scsi_service_action_in_t;
+
+/// SCSI Vital Product Data page code of INQUIRY command with EVPD bit set
+typedef enum {
+  SCSI_VPD_PAGE_SUPPORTED          = 0x00, ///< List of supported VPD pages
+  SCSI_VPD_PAGE_BLOCK_LIMITS       = 0xB0, ///< Transfer, UNMAP and WRITE SAME limits
+  SCSI_VPD_PAGE_LB_PROVISIONING    = 0xB2, ///< Logical block provisioning (thin provisioning) support
+}scsi_vpd_page_t;
+
 /// SCSI Sense Key
 typedef enum {
   SCSI_SENSE_NONE            = 0x00, ///< no specific Sense Key. This would be the case for a successful command
@@ -120,6 +142,12 @@ typedef enum {
   SCSI_SENSE_MISCOMPARE      = 0x0e  ///< Indicates that the source data did not match the data read from the medium.
 }scsi_sense_key_type_t;
 
+/// SCSI Status, reported by UAS Sense IU (BOT only has passed/failed in CSW)
+typedef enum {
+  SCSI_STATUS_GOOD            = 0x00,
+  SCSI_STATUS_CHECK_CONDITION = 0x02, ///< Sense data is available
+}scsi_status_t;
+
 
 typedef enum {
   SCSI_PDT_DIRECT_ACCESS = 0x0,
@@ -375,6 +403,275 @@ typedef struct TU_ATTR_PACKED
 TU_VERIFY_STATIC(sizeof(scsi_read10_t) == 10, "size is not correct");
 TU_VERIFY_STATIC(sizeof(scsi_write10_t) == 10, "size is not correct");
 
+/// SCSI Read Capacity 16 Command (Service Action In 16)
+typedef struct TU_ATTR_PACKED
+{
+  uint8_t  cmd_code       ; ///< SCSI OpCode for \ref SCSI_CMD_SERVICE_ACTION_IN_16
+  uint8_t  service_action ; ///< \ref SCSI_SERVICE_ACTION_READ_CAPACITY_16 (lower 5 bits)
+  uint64_t lba            ; ///< Obsolete
+  uint32_t alloc_length   ; ///< Maximum number of bytes of response data
+  uint8_t  pmi            ; ///< Obsolete
+  uint8_t  control        ;
+} scsi_read_capacity16_t;
+
+TU_VERIFY_STATIC(sizeof(scsi_read_capacity16_t) == 16, "size is not correct");
+
+/// SCSI Read Capacity 16 Response Data
+typedef struct TU_ATTR_PACKED
+{
+  uint64_t last_lba             ; ///< The last Logical Block Address of the device
+  uint32_t block_size           ; ///< Block size in bytes
+  uint8_t  protection           ; ///< P_TYPE and PROT_EN
+  uint8_t  lb_per_pb_exponent   ; ///< P_I_EXPONENT and logical blocks per physical block exponent
+  uint16_t lowest_aligned_lba   ; ///< LBPME, LBPRZ and lowest aligned LBA
+  uint8_t  reserved[16]         ;
+} scsi_read_capacity16_resp_t;
+
+TU_VERIFY_STATIC(sizeof(scsi_read_capacity16_resp_t) == 32, "size is not correct");
+
+/// SCSI Read 16 Command
+typedef struct TU_ATTR_PACKED
+{
+  uint8_t  cmd_code    ; ///< SCSI OpCode
+  uint8_t  flags       ;
+  uint64_t lba         ; ///< The first Logical Block Address (LBA) accessed by this command
+  uint32_t block_count ; ///< Number of Blocks used by this command
+  uint8_t  group       ;
+  uint8_t  control     ;
+} scsi_read16_t, scsi_write16_t;
+
+TU_VERIFY_STATIC(sizeof(scsi_read16_t) == 16, "size is not correct");
+TU_VERIFY_STATIC(sizeof(scsi_write16_t) == 16, "size is not correct");
+
+/// SCSI Write Same 10 Command
+typedef struct TU_ATTR_PACKED
+{
+  uint8_t  cmd_code    ; ///< SCSI OpCode for \ref SCSI_CMD_WRITE_SAME_10
+  uint8_t  flags       ; ///< UNMAP (bit 3) and ANCHOR (bit 4)
+  uint32_t lba         ; ///< The first Logical Block Address (LBA) written by this command
+  uint8_t  group       ;
+  uint16_t block_count ; ///< Number of Blocks written with the data-out block
+  uint8_t  control     ;
+} scsi_write_same10_t;
+
+/// SCSI Write Same 16 Command
+typedef struct TU_ATTR_PACKED
+{
+  uint8_t  cmd_code    ; ///< SCSI OpCode for \ref SCSI_CMD_WRITE_SAME_16
+  uint8_t  flags       ; ///< UNMAP (bit 3), ANCHOR (bit 4) and NDOB (bit 0)
+  uint64_t lba         ; ///< The first Logical Block Address (LBA) written by this command
+  uint32_t block_count ; ///< Number of Blocks written with the data-out block
+  uint8_t  group       ;
+  uint8_t  control     ;
+} scsi_write_same16_t;
+
+TU_VERIFY_STATIC(sizeof(scsi_write_same10_t) == 10, "size is not correct");
+TU_VERIFY_STATIC(sizeof(scsi_write_same16_t) == 16, "size is not correct");
+
+#define SCSI_WRITE_SAME_FLAG_UNMAP  0x08
+
+/// SCSI Unmap Command
+typedef struct TU_ATTR_PACKED
+{
+  uint8_t  cmd_code     ; ///< SCSI OpCode for \ref SCSI_CMD_UNMAP
+  uint8_t  anchor       ;
+  uint8_t  reserved[4]  ;
+  uint8_t  group        ;
+  uint16_t param_length ; ///< Length of parameter list in data-out
+  uint8_t  control      ;
+} scsi_unmap_t;
+
+/// SCSI Unmap parameter list header, followed by block descriptors
+typedef struct TU_ATTR_PACKED
+{
+  uint16_t data_length       ; ///< Number of bytes following this field
+  uint16_t block_desc_length ; ///< Number of bytes of block descriptors
+  uint8_t  reserved[4]       ;
+} scsi_unmap_param_header_t;
+
+/// SCSI Unmap block descriptor
+typedef struct TU_ATTR_PACKED
+{
+  uint64_t lba         ; ///< First block to unmap
+  uint32_t block_count ; ///< Number of blocks to unmap
+  uint8_t  reserved[4] ;
+} scsi_unmap_block_desc_t;
+
+TU_VERIFY_STATIC(sizeof(scsi_unmap_t) == 10, "size is not correct");
+TU_VERIFY_STATIC(sizeof(scsi_unmap_param_header_t) == 8, "size is not correct");
+TU_VERIFY_STATIC(sizeof(scsi_unmap_block_desc_t) == 16, "size is not correct");
+
+/// SCSI Synchronize Cache 10 Command
+typedef struct TU_ATTR_PACKED
+{
+  uint8_t  cmd_code    ; ///< SCSI OpCode for \ref SCSI_CMD_SYNCHRONIZE_CACHE_10
+  uint8_t  flags       ;
+  uint32_t lba         ; ///< First block to synchronize
+  uint8_t  group       ;
+  uint16_t block_count ; ///< Number of blocks, zero means until end of medium
+  uint8_t  control     ;
+} scsi_sync_cache10_t;
+
+/// SCSI Synchronize Cache 16 Command
+typedef struct TU_ATTR_PACKED
+{
+  uint8_t  cmd_code    ; ///< SCSI OpCode for \ref SCSI_CMD_SYNCHRONIZE_CACHE_16
+  uint8_t  flags       ;
+  uint64_t lba         ; ///< First block to synchronize
+  uint32_t block_count ; ///< Number of blocks, zero means until end of medium
+  uint8_t  group       ;
+  uint8_t  control     ;
+} scsi_sync_cache16_t;
+
+TU_VERIFY_STATIC(sizeof(scsi_sync_cache10_t) == 10, "size is not correct");
+TU_VERIFY_STATIC(sizeof(scsi_sync_cache16_t) == 16, "size is not correct");
+
+/// SCSI Block Limits VPD page (0xB0)
+typedef struct TU_ATTR_PACKED
+{
+  uint8_t  peripheral                  ; ///< Peripheral qualifier and device type
+  uint8_t  page_code                   ; ///< \ref SCSI_VPD_PAGE_BLOCK_LIMITS
+  uint16_t page_length                 ; ///< 0x3C
+  uint8_t  wsnz                        ; ///< Bit 0: WRITE SAME with zero block count is not supported
+  uint8_t  max_compare_write_length    ;
+  uint16_t opt_xfer_length_granularity ;
+  uint32_t max_xfer_length             ;
+  uint32_t opt_xfer_length             ;
+  uint32_t max_prefetch_length         ;
+  uint32_t max_unmap_lba_count         ; ///< Maximum blocks per UNMAP command, zero if not supported
+  uint32_t max_unmap_block_desc_count  ; ///< Maximum block descriptors per UNMAP command
+  uint32_t opt_unmap_granularity       ; ///< Optimal unmap granularity in blocks e.g erase block
+  uint32_t unmap_granularity_alignment ; ///< Bit 31: UGAVALID
+  uint64_t max_write_same_length       ; ///< Maximum blocks per WRITE SAME command, zero if not supported
+  uint8_t  reserved[20]                ;
+} scsi_vpd_block_limits_t;
+
+/// SCSI Logical Block Provisioning VPD page (0xB2)
+typedef struct TU_ATTR_PACKED
+{
+  uint8_t  peripheral         ; ///< Peripheral qualifier and device type
+  uint8_t  page_code          ; ///< \ref SCSI_VPD_PAGE_LB_PROVISIONING
+  uint16_t page_length        ; ///< 0x04
+  uint8_t  threshold_exponent ;
+  uint8_t  flags              ; ///< LBPU (bit 7): UNMAP, LBPWS (bit 6): WRITE SAME(16) unmap, LBPWS10 (bit 5): WRITE SAME(10) unmap
+  uint8_t  provisioning_type  ; ///< 2: thin provisioned
+  uint8_t  reserved           ;
+} scsi_vpd_lb_provisioning_t;
+
+TU_VERIFY_STATIC(sizeof(scsi_vpd_block_limits_t) == 64, "size is not correct");
+TU_VERIFY_STATIC(sizeof(scsi_vpd_lb_provisioning_t) == 8, "size is not correct");
+
+//--------------------------------------------------------------------+
+// USB Attached SCSI (UAS) Information Unit
+//--------------------------------------------------------------------+
+
+/// UAS Pipe Usage descriptor, follows each endpoint descriptor of UAS interface
+enum {
+  UAS_DESC_TYPE_PIPE_USAGE = 0x24,
+  UAS_DESC_PIPE_USAGE_LEN  = 4,
+};
+
+/// UAS Pipe ID in Pipe Usage descriptor
+typedef enum {
+  UAS_PIPE_ID_COMMAND  = 1,
+  UAS_PIPE_ID_STATUS   = 2,
+  UAS_PIPE_ID_DATA_IN  = 3,
+  UAS_PIPE_ID_DATA_OUT = 4,
+}uas_pipe_id_t;
+
+/// UAS Information Unit ID
+typedef enum {
+  UAS_IU_ID_COMMAND     = 0x01, ///< host to device on command pipe
+  UAS_IU_ID_SENSE       = 0x03, ///< device to host on status pipe, SCSI status of a command
+  UAS_IU_ID_RESPONSE    = 0x04, ///< device to host on status pipe, result of task management or invalid IU
+  UAS_IU_ID_TASK_MGMT   = 0x05, ///< host to device on command pipe
+  UAS_IU_ID_READ_READY  = 0x06, ///< device to host on status pipe, device is ready to send data on data-in pipe
+  UAS_IU_ID_WRITE_READY = 0x07, ///< device to host on status pipe, device is ready to receive data on data-out pipe
+}uas_iu_id_t;
+
+/// UAS Task Management Function
+typedef enum {
+  UAS_TMF_ABORT_TASK         = 0x01,
+  UAS_TMF_ABORT_TASK_SET     = 0x02,
+  UAS_TMF_CLEAR_TASK_SET     = 0x04,
+  UAS_TMF_LOGICAL_UNIT_RESET = 0x08,
+  UAS_TMF_I_T_NEXUS_RESET    = 0x10,
+  UAS_TMF_CLEAR_ACA          = 0x40,
+  UAS_TMF_QUERY_TASK         = 0x80,
+  UAS_TMF_QUERY_TASK_SET     = 0x81,
+  UAS_TMF_QUERY_ASYNC_EVENT  = 0x82,
+}uas_tmf_t;
+
+/// UAS Response Code in Response IU
+typedef enum {
+  UAS_RESPONSE_TMF_COMPLETE      = 0x00,
+  UAS_RESPONSE_INVALID_IU        = 0x02,
+  UAS_RESPONSE_TMF_NOT_SUPPORTED = 0x04,
+  UAS_RESPONSE_TMF_FAILED        = 0x05,
+  UAS_RESPONSE_TMF_SUCCEEDED     = 0x08,
+  UAS_RESPONSE_INCORRECT_LUN     = 0x09,
+  UAS_RESPONSE_OVERLAPPED_TAG    = 0x0A,
+}uas_response_code_t;
+
+/// UAS IU Header, also the whole Read Ready and Write Ready IU
+typedef struct TU_ATTR_PACKED
+{
+  uint8_t  iu_id    ; ///< \ref uas_iu_id_t
+  uint8_t  reserved ;
+  uint16_t tag      ; ///< Command tag chosen by host (Big Endian), echoed back in status pipe IUs
+} uas_iu_header_t;
+
+TU_VERIFY_STATIC(sizeof(uas_iu_header_t) == 4, "size is not correct");
+
+/// UAS Command IU
+typedef struct TU_ATTR_PACKED
+{
+  uas_iu_header_t header;
+  uint8_t  prio_attr   ; ///< bit 2..0 task attribute, bit 6..3 command priority
+  uint8_t  reserved1   ;
+  uint8_t  add_cdb_len ; ///< bit 7..2 additional CDB length in dwords
+  uint8_t  reserved2   ;
+  uint8_t  lun[8]      ; ///< SAM LUN, single level LUN is in lun[1]
+  uint8_t  cdb[16]     ;
+} uas_command_iu_t;
+
+TU_VERIFY_STATIC(sizeof(uas_command_iu_t) == 32, "size is not correct");
+
+/// UAS Sense IU with fixed format sense data
+typedef struct TU_ATTR_PACKED
+{
+  uas_iu_header_t header;
+  uint16_t status_qualifier ;
+  uint8_t  status           ; ///< \ref scsi_status_t
+  uint8_t  reserved[7]      ;
+  uint16_t sense_length     ; ///< Length of sense data (Big Endian)
+  uint8_t  sense_data[18]   ;
+} uas_sense_iu_t;
+
+TU_VERIFY_STATIC(sizeof(uas_sense_iu_t) == 34, "size is not correct");
+
+/// UAS Response IU
+typedef struct TU_ATTR_PACKED
+{
+  uas_iu_header_t header;
+  uint8_t add_response_info[3];
+  uint8_t response_code; ///< \ref uas_response_code_t
+} uas_response_iu_t;
+
+TU_VERIFY_STATIC(sizeof(uas_response_iu_t) == 8, "size is not correct");
+
+/// UAS Task Management IU
+typedef struct TU_ATTR_PACKED
+{
+  uas_iu_header_t header;
+  uint8_t  function  ; ///< \ref uas_tmf_t
+  uint8_t  reserved  ;
+  uint16_t task_tag  ; ///< Tag of the command to manage (Big Endian)
+  uint8_t  lun[8]    ;
+} uas_task_mgmt_iu_t;
+
+TU_VERIFY_STATIC(sizeof(uas_task_mgmt_iu_t) == 16, "size is not correct");
+
 #ifdef __cplusplus
  }
 #endif
@@ -9,12 +9,19 @@
 
 #if (CFG_TUD_ENABLED && CFG_TUD_MSC)
 
-#include "device/dcd.h"         // for faking dcd_event_xfer_complete
 #include "device/usbd.h"
 #include "device/usbd_pvt.h"
 
 #include "msc_device.h"
 
+#if CFG_TUD_UAS
+  #include "uas_device.h"
+#endif
+
+#if CFG_TUD_MSC_CACHE
+  #include "msc_device_cache.h"
+#endif
+
 // Level where CFG_TUSB_DEBUG must be at least for this driver is logged
 #ifndef CFG_TUD_MSC_LOG_LEVEL
   #define CFG_TUD_MSC_LOG_LEVEL   CFG_TUD_LOG_LEVEL
@@ -32,6 +39,14 @@ TU_ATTR_WEAK uint32_t tud_msc_inquiry2_cb(uint8_t lun, scsi_inquiry_resp_t *inqu
   (void) lun; (void) inquiry_resp; (void) bufsize;
   return 0;
 }
+TU_ATTR_WEAK uint32_t tud_msc_read10_map_cb(uint8_t lun, uint32_t lba, uint32_t offset, void const** buffer, uint32_t bufsize) {
+  (void) lun; (void) lba; (void) offset; (void) buffer; (void) bufsize;
+  return 0;
+}
+TU_ATTR_WEAK uint32_t tud_msc_write10_map_cb(uint8_t lun, uint32_t lba, uint32_t offset, uint8_t** buffer, uint32_t bufsize) {
+  (void) lun; (void) lba; (void) offset; (void) buffer; (void) bufsize;
+  return 0;
+}
 
 //--------------------------------------------------------------------+
 // MACRO CONSTANT TYPEDEF
@@ -65,13 +80,25 @@ typedef struct {
   uint8_t add_sense_qualifier;
 
   bool pending_io; // pending async IO
+
+  // READ10/WRITE10 buffer ring shared by media I/O and USB transfer. Filled buffers are consumed from buf_head:
+  // READ10: filled by media read, consumed by USB IN. WRITE10: filled by USB OUT, consumed by media write
+  bool     xfer_busy;     // data stage USB transfer is in progress
+  bool     io_failed;     // READ10: media read failed, fail op once queued data is sent
+  uint8_t  buf_head;
+  uint8_t  buf_count;
+  uint16_t buf_offset;    // WRITE10: bytes of head buffer already consumed by media write
+  uint16_t buf_len[CFG_TUD_MSC_EPBUF_COUNT];
+  uint8_t* buf_addr[CFG_TUD_MSC_EPBUF_COUNT]; // class buffer or application memory mapped by read10/write10_map_cb()
+  uint32_t ahead_len;     // READ10: bytes read from media, WRITE10: bytes received from host
 }mscd_interface_t;
 
 static mscd_interface_t _mscd_itf;
 
+// Buffer 0 is also used for CBW, CSW and non READ10/WRITE10 data stage
 CFG_TUD_MEM_SECTION static struct {
   TUD_EPBUF_DEF(buf, CFG_TUD_MSC_EP_BUFSIZE);
-} _mscd_epbuf;
+} _mscd_epbuf[CFG_TUD_MSC_EPBUF_COUNT];
 
 TU_VERIFY_STATIC(CFG_TUD_MSC_EP_BUFSIZE >= 64, "CFG_TUD_MSC_EP_BUFSIZE must be at least 64");
 
@@ -79,30 +106,60 @@ TU_VERIFY_STATIC(CFG_TUD_MSC_EP_BUFSIZE >= 64, "CFG_TUD_MSC_EP_BUFSIZE must be a
 // INTERNAL OBJECT & FUNCTION DECLARATION
 //--------------------------------------------------------------------+
 static int32_t proc_builtin_scsi(uint8_t lun, uint8_t const scsi_cmd[16], uint8_t* buffer, uint32_t bufsize);
+static bool check_lba_range(uint8_t lun, uint64_t lba, uint32_t block_count, uint32_t* block_size);
 static void proc_read10_cmd(mscd_interface_t* p_msc);
+static void proc_read10_xfer(mscd_interface_t* p_msc);
+static void proc_read10_media(mscd_interface_t* p_msc);
+static void proc_read10_host_done(mscd_interface_t* p_msc, uint32_t xferred_bytes);
 static void proc_read_io_data(mscd_interface_t* p_msc, int32_t nbytes);
 static void proc_write10_cmd(mscd_interface_t* p_msc);
+static void proc_write10_xfer(mscd_interface_t* p_msc);
+static void proc_write10_media(mscd_interface_t* p_msc);
 static void proc_write10_host_data(mscd_interface_t* p_msc, uint32_t xferred_bytes);
-static void proc_write_io_data(mscd_interface_t* p_msc, uint32_t xferred_bytes, int32_t nbytes);
+static void proc_write_io_data(mscd_interface_t* p_msc, int32_t nbytes);
 static bool proc_stage_status(mscd_interface_t* p_msc);
 
 TU_ATTR_ALWAYS_INLINE static inline bool is_data_in(uint8_t dir) {
   return tu_bit_test(dir, 7);
 }
 
+TU_ATTR_ALWAYS_INLINE static inline uint8_t* rdwr_buf(uint8_t idx) {
+  return _mscd_epbuf[idx].buf;
+}
+
+// index of the first free buffer in the ring
+TU_ATTR_ALWAYS_INLINE static inline uint8_t rdwr_buf_tail(mscd_interface_t const* p_msc) {
+  return (uint8_t) ((p_msc->buf_head + p_msc->buf_count) % CFG_TUD_MSC_EPBUF_COUNT);
+}
+
+// Length of application mapped memory usable for data stage. Anything but the last chunk must be a multiple of
+// 512 (bulk packet size of both full and high speed) to avoid short packet in the middle of data stage.
+TU_ATTR_ALWAYS_INLINE static inline uint32_t rdwr_map_len(uint32_t mapped_len, uint32_t bufsize) {
+  return (mapped_len >= bufsize) ? bufsize : (mapped_len & ~UINT32_C(511));
+}
+
+TU_ATTR_ALWAYS_INLINE static inline void rdwr_buf_reset(mscd_interface_t* p_msc) {
+  p_msc->xfer_busy  = false;
+  p_msc->io_failed  = false;
+  p_msc->buf_head   = 0;
+  p_msc->buf_count  = 0;
+  p_msc->buf_offset = 0;
+  p_msc->ahead_len  = 0;
+}
+
 TU_ATTR_ALWAYS_INLINE static inline bool send_csw(mscd_interface_t* p_msc) {
   // Data residue is always = host expect - actual transferred
   uint8_t rhport = p_msc->rhport;
   p_msc->csw.data_residue = p_msc->cbw.total_bytes - p_msc->xferred_len;
   p_msc->stage = MSC_STAGE_STATUS_SENT;
-  memcpy(_mscd_epbuf.buf, &p_msc->csw, sizeof(msc_csw_t)); //-V1086
-  return usbd_edpt_xfer(rhport, p_msc->ep_in , _mscd_epbuf.buf, sizeof(msc_csw_t), false);
+  memcpy(_mscd_epbuf[0].buf, &p_msc->csw, sizeof(msc_csw_t)); //-V1086
+  return usbd_edpt_xfer(rhport, p_msc->ep_in , _mscd_epbuf[0].buf, sizeof(msc_csw_t), false);
 }
 
 TU_ATTR_ALWAYS_INLINE static inline bool prepare_cbw(mscd_interface_t* p_msc) {
   uint8_t rhport = p_msc->rhport;
   p_msc->stage = MSC_STAGE_CMD;
-  return usbd_edpt_xfer(rhport, p_msc->ep_out,  _mscd_epbuf.buf, sizeof(msc_cbw_t), false);
+  return usbd_edpt_xfer(rhport, p_msc->ep_out,  _mscd_epbuf[0].buf, sizeof(msc_cbw_t), false);
 }
 
 static void fail_scsi_op(mscd_interface_t* p_msc, uint8_t status) {
@@ -129,29 +186,53 @@ static void fail_scsi_op(mscd_interface_t* p_msc, uint8_t status) {
   }
 }
 
-TU_ATTR_ALWAYS_INLINE static inline uint32_t rdwr10_get_lba(uint8_t const command[]) {
-  // use offsetof to avoid pointer to the odd/unaligned address
-  const uint32_t lba = tu_unaligned_read32(command + offsetof(scsi_write10_t, lba));
-  return tu_ntohl(lba); // lba is in Big Endian
+TU_ATTR_ALWAYS_INLINE static inline bool is_cmd_read(uint8_t cmd) {
+  return cmd == SCSI_CMD_READ_10 || cmd == SCSI_CMD_READ_16;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline bool is_cmd_write(uint8_t cmd) {
+  return cmd == SCSI_CMD_WRITE_10 || cmd == SCSI_CMD_WRITE_16;
+}
+
+// READ10/WRITE10 or READ16/WRITE16
+TU_ATTR_ALWAYS_INLINE static inline bool is_cmd_rdwr(uint8_t cmd) {
+  return is_cmd_read(cmd) || is_cmd_write(cmd);
+}
+
+TU_ATTR_ALWAYS_INLINE static inline uint64_t rdwr_get_lba(uint8_t const command[]) {
+  // use offsetof to avoid pointer to the odd/unaligned address, lba is in Big Endian
+  if (command[0] == SCSI_CMD_READ_16 || command[0] == SCSI_CMD_WRITE_16) {
+    const uint32_t lba_high = tu_unaligned_read32(command + offsetof(scsi_write16_t, lba));
+    const uint32_t lba_low  = tu_unaligned_read32(command + offsetof(scsi_write16_t, lba) + 4);
+    return (((uint64_t) tu_ntohl(lba_high)) << 32) | tu_ntohl(lba_low);
+  } else {
+    const uint32_t lba = tu_unaligned_read32(command + offsetof(scsi_write10_t, lba));
+    return tu_ntohl(lba);
+  }
 }
 
-TU_ATTR_ALWAYS_INLINE static inline uint16_t rdwr10_get_blockcount(msc_cbw_t const* cbw) {
-  uint16_t const block_count = tu_unaligned_read16(cbw->command + offsetof(scsi_write10_t, block_count));
-  return tu_ntohs(block_count);
+TU_ATTR_ALWAYS_INLINE static inline uint32_t rdwr_get_blockcount(msc_cbw_t const* cbw) {
+  if (cbw->command[0] == SCSI_CMD_READ_16 || cbw->command[0] == SCSI_CMD_WRITE_16) {
+    uint32_t const block_count = tu_unaligned_read32(cbw->command + offsetof(scsi_write16_t, block_count));
+    return tu_ntohl(block_count);
+  } else {
+    uint16_t const block_count = tu_unaligned_read16(cbw->command + offsetof(scsi_write10_t, block_count));
+    return tu_ntohs(block_count);
+  }
 }
 
-TU_ATTR_ALWAYS_INLINE static inline uint16_t rdwr10_get_blocksize(msc_cbw_t const* cbw) {
+TU_ATTR_ALWAYS_INLINE static inline uint32_t rdwr_get_blocksize(msc_cbw_t const* cbw) {
   // first extract block count in the command
-  uint16_t const block_count = rdwr10_get_blockcount(cbw);
+  uint32_t const block_count = rdwr_get_blockcount(cbw);
   if (block_count == 0) {
     return 0; // invalid block count
   }
-  return (uint16_t) (cbw->total_bytes / block_count);
+  return cbw->total_bytes / block_count;
 }
 
-static uint8_t rdwr10_validate_cmd(msc_cbw_t const* cbw) {
+static uint8_t rdwr_validate_cmd(msc_cbw_t const* cbw) {
   uint8_t status = MSC_CSW_STATUS_PASSED;
-  uint16_t const block_count = rdwr10_get_blockcount(cbw);
+  uint32_t const block_count = rdwr_get_blockcount(cbw);
 
   if (cbw->total_bytes == 0) {
     if (block_count > 0) {
@@ -161,10 +242,10 @@ static uint8_t rdwr10_validate_cmd(msc_cbw_t const* cbw) {
       // no data transfer, only exist in complaint test suite
     }
   } else {
-    if (SCSI_CMD_READ_10 == cbw->command[0] && !is_data_in(cbw->dir)) {
+    if (is_cmd_read(cbw->command[0]) && !is_data_in(cbw->dir)) {
       TU_LOG_DRV("  SCSI case 10 (Ho <> Di)\r\n");
       status = MSC_CSW_STATUS_PHASE_ERROR;
-    } else if (SCSI_CMD_WRITE_10 == cbw->command[0] && is_data_in(cbw->dir)) {
+    } else if (is_cmd_write(cbw->command[0]) && is_data_in(cbw->dir)) {
       TU_LOG_DRV("  SCSI case 8 (Hi <> Do)\r\n");
       status = MSC_CSW_STATUS_PHASE_ERROR;
     } else if (0 == block_count) {
@@ -255,6 +336,48 @@ TU_ATTR_WEAK bool tud_msc_is_writable_cb(uint8_t lun) {
   return true;
 }
 
+TU_ATTR_WEAK void tud_msc_block_limits_cb(uint8_t lun, uint32_t* max_unmap_blocks, uint32_t* unmap_granularity,
+                                          uint32_t* max_write_same_blocks) {
+  (void) lun; (void) max_unmap_blocks; (void) unmap_granularity; (void) max_write_same_blocks;
+}
+
+TU_ATTR_WEAK bool tud_msc_unmap_cb(uint8_t lun, uint64_t lba, uint32_t block_count) {
+  (void) lun; (void) lba; (void) block_count;
+  return false;
+}
+
+TU_ATTR_WEAK bool tud_msc_write_same_cb(uint8_t lun, uint64_t lba, uint32_t block_count, uint8_t const* block,
+                                        uint32_t block_size, bool unmap) {
+  (void) lun; (void) lba; (void) block_count; (void) block; (void) block_size; (void) unmap;
+  return false;
+}
+
+TU_ATTR_WEAK bool tud_msc_sync_cache_cb(uint8_t lun, uint64_t lba, uint32_t block_count) {
+  (void) lun; (void) lba; (void) block_count;
+  return false; // not handled, passed to tud_msc_scsi_cb()
+}
+
+// Default: forward to READ10 callback if LBA is within 32-bit
+TU_ATTR_WEAK int32_t tud_msc_read16_cb(uint8_t lun, uint64_t lba, uint32_t offset, void* buffer, uint32_t bufsize) {
+  TU_VERIFY(lba <= UINT32_MAX, TUD_MSC_RET_ERROR);
+  return tud_msc_read10_cb(lun, (uint32_t) lba, offset, buffer, bufsize);
+}
+
+// Default: forward to WRITE10 callback if LBA is within 32-bit
+TU_ATTR_WEAK int32_t tud_msc_write16_cb(uint8_t lun, uint64_t lba, uint32_t offset, uint8_t* buffer, uint32_t bufsize) {
+  TU_VERIFY(lba <= UINT32_MAX, TUD_MSC_RET_ERROR);
+  return tud_msc_write10_cb(lun, (uint32_t) lba, offset, buffer, bufsize);
+}
+
+// Default: use 32-bit capacity callback
+TU_ATTR_WEAK void tud_msc_capacity16_cb(uint8_t lun, uint64_t* block_count, uint32_t* block_size) {
+  uint32_t block_count_u32 = 0;
+  uint16_t block_size_u16  = 0;
+  tud_msc_capacity_cb(lun, &block_count_u32, &block_size_u16);
+  *block_count = block_count_u32;
+  *block_size  = block_size_u16;
+}
+
 //--------------------------------------------------------------------+
 // Debug
 //--------------------------------------------------------------------+
@@ -271,7 +394,15 @@ TU_ATTR_UNUSED tu_static tu_lookup_entry_t const _msc_scsi_cmd_lookup[] = {
   { .key = SCSI_CMD_REQUEST_SENSE                , .data = "Request Sense" },
   { .key = SCSI_CMD_READ_FORMAT_CAPACITY         , .data = "Read Format Capacity" },
   { .key = SCSI_CMD_READ_10                      , .data = "Read10" },
-  { .key = SCSI_CMD_WRITE_10                     , .data = "Write10" }
+  { .key = SCSI_CMD_WRITE_10                     , .data = "Write10" },
+  { .key = SCSI_CMD_SYNCHRONIZE_CACHE_10         , .data = "Synchronize Cache10" },
+  { .key = SCSI_CMD_WRITE_SAME_10                , .data = "Write Same10" },
+  { .key = SCSI_CMD_UNMAP                        , .data = "Unmap" },
+  { .key = SCSI_CMD_READ_16                      , .data = "Read16" },
+  { .key = SCSI_CMD_WRITE_16                     , .data = "Write16" },
+  { .key = SCSI_CMD_SYNCHRONIZE_CACHE_16         , .data = "Synchronize Cache16" },
+  { .key = SCSI_CMD_WRITE_SAME_16                , .data = "Write Same16" },
+  { .key = SCSI_CMD_SERVICE_ACTION_IN_16         , .data = "Service Action In16" }
 };
 
 TU_ATTR_UNUSED tu_static tu_lookup_table_t const _msc_scsi_cmd_table = {
@@ -297,6 +428,13 @@ TU_ATTR_ALWAYS_INLINE static inline void set_sense_medium_not_present(uint8_t lu
   (void) tud_msc_set_sense(lun, SCSI_SENSE_NOT_READY, 0x3A, 0x00);
 }
 
+TU_ATTR_ALWAYS_INLINE static inline void set_sense_write_error(uint8_t lun) {
+  // MEDIUM ERROR, WRITE ERROR if not already set by callback
+  if (_mscd_itf.sense_key == 0) {
+    (void) tud_msc_set_sense(lun, SCSI_SENSE_MEDIUM_ERROR, 0x0C, 0x00);
+  }
+}
+
 static void proc_async_io_done(void *bytes_io) {
   mscd_interface_t *p_msc = &_mscd_itf;
   TU_VERIFY(p_msc->pending_io, );
@@ -306,11 +444,13 @@ static void proc_async_io_done(void *bytes_io) {
   p_msc->pending_io = false;
   switch (cmd) {
     case SCSI_CMD_READ_10:
+    case SCSI_CMD_READ_16:
       proc_read_io_data(p_msc, nbytes);
       break;
 
     case SCSI_CMD_WRITE_10:
-      proc_write_io_data(p_msc, (uint32_t) nbytes, nbytes);
+    case SCSI_CMD_WRITE_16:
+      proc_write_io_data(p_msc, nbytes);
       break;
 
     default: break; // nothing to do
@@ -322,12 +462,44 @@ static void proc_async_io_done(void *bytes_io) {
   }
 }
 
+// Retry media I/O which was busy or did not consume all data
+static void proc_rdwr_retry(void *param) {
+  (void) param;
+  mscd_interface_t *p_msc = &_mscd_itf;
+  TU_VERIFY(p_msc->stage == MSC_STAGE_DATA, );
+
+  switch (p_msc->cbw.command[0]) {
+    case SCSI_CMD_READ_10:
+    case SCSI_CMD_READ_16:
+      proc_read10_media(p_msc);
+      break;
+
+    case SCSI_CMD_WRITE_10:
+    case SCSI_CMD_WRITE_16:
+      proc_write10_media(p_msc);
+      break;
+
+    default: break; // nothing to do
+  }
+
+  if (p_msc->stage == MSC_STAGE_STATUS) {
+    proc_stage_status(p_msc);
+  }
+}
+
 bool tud_msc_async_io_done(int32_t bytes_io, bool in_isr) {
-  // Precheck to avoid queueing multiple RW done callback
-  TU_VERIFY(_mscd_itf.pending_io);
   if (bytes_io == 0) {
     bytes_io = TUD_MSC_RET_ERROR; // 0 is treated as error, no reason to call this with BUSY here
   }
+
+  #if CFG_TUD_UAS
+  if (!_mscd_itf.pending_io) {
+    return uasd_async_io_done(bytes_io, in_isr);
+  }
+  #endif
+
+  // Precheck to avoid queueing multiple RW done callback
+  TU_VERIFY(_mscd_itf.pending_io);
   usbd_defer_func(proc_async_io_done, (void *) (intptr_t) bytes_io, in_isr);
   return true;
 }
@@ -374,6 +546,7 @@ static void proc_bot_reset(mscd_interface_t* p_msc) {
   p_msc->stage       = MSC_STAGE_CMD;
   p_msc->total_len   = 0;
   p_msc->xferred_len = 0;
+  rdwr_buf_reset(p_msc);
   p_msc->sense_key           = 0;
   p_msc->add_sense_code      = 0;
   p_msc->add_sense_qualifier = 0;
@@ -465,7 +638,7 @@ bool mscd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t event, uint32_t
         return true;
       }
 
-      const uint32_t signature = tu_le32toh(tu_unaligned_read32(_mscd_epbuf.buf));
+      const uint32_t signature = tu_le32toh(tu_unaligned_read32(_mscd_epbuf[0].buf));
 
       if (!(xferred_bytes == sizeof(msc_cbw_t) && signature == MSC_CBW_SIGNATURE)) {
         // BOT 6.6.1 If CBW is not valid stall both endpoints until reset recovery
@@ -476,7 +649,7 @@ bool mscd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t event, uint32_t
         return false;
       }
 
-      memcpy(p_cbw, _mscd_epbuf.buf, sizeof(msc_cbw_t));
+      memcpy(p_cbw, _mscd_epbuf[0].buf, sizeof(msc_cbw_t));
 
       TU_LOG_DRV("  SCSI Command [Lun%u]: %s\r\n", p_cbw->lun, tu_lookup_find(&_msc_scsi_cmd_table, p_cbw->command[0]));
       // TU_LOG_MEM(CFG_TUD_MSC_LOG_LEVEL, p_cbw, xferred_bytes, 2);
@@ -490,15 +663,16 @@ bool mscd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t event, uint32_t
       p_msc->stage = MSC_STAGE_DATA;
       p_msc->total_len = p_cbw->total_bytes;
       p_msc->xferred_len = 0;
+      rdwr_buf_reset(p_msc);
 
-      // Read10 or Write10
-      if ((SCSI_CMD_READ_10 == p_cbw->command[0]) || (SCSI_CMD_WRITE_10 == p_cbw->command[0])) {
-        uint8_t const status = rdwr10_validate_cmd(p_cbw);
+      // Read10/16 or Write10/16
+      if (is_cmd_rdwr(p_cbw->command[0])) {
+        uint8_t const status = rdwr_validate_cmd(p_cbw);
 
         if (status != MSC_CSW_STATUS_PASSED) {
           fail_scsi_op(p_msc, status);
         } else if (p_cbw->total_bytes > 0) {
-          if (SCSI_CMD_READ_10 == p_cbw->command[0]) {
+          if (is_cmd_read(p_cbw->command[0])) {
             proc_read10_cmd(p_msc);
           } else {
             proc_write10_cmd(p_msc);
@@ -518,17 +692,12 @@ bool mscd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t event, uint32_t
           } else {
             // Didn't check for case 9 (Ho > Dn), which requires examining scsi command first
             // but it is OK to just receive data then responded with failed status
-            TU_ASSERT(usbd_edpt_xfer(rhport, p_msc->ep_out, _mscd_epbuf.buf, (uint16_t) p_msc->total_len, false));
+            TU_ASSERT(usbd_edpt_xfer(rhport, p_msc->ep_out, _mscd_epbuf[0].buf, (uint16_t) p_msc->total_len, false));
           }
         } else {
-          // First process if it is a built-in commands
-          int32_t resplen = proc_builtin_scsi(p_cbw->lun, p_cbw->command, _mscd_epbuf.buf, CFG_TUD_MSC_EP_BUFSIZE);
-
-          // Invoke user callback if not built-in
-          if ((resplen < 0) && (p_msc->sense_key == 0)) {
-            resplen = tud_msc_scsi_cb(p_cbw->lun, p_cbw->command, _mscd_epbuf.buf,
-                                      (uint16_t) tu_min32(p_msc->total_len, CFG_TUD_MSC_EP_BUFSIZE));
-          }
+          // Built-in commands first, then application callback
+          int32_t resplen = mscd_proc_scsi_cmd(p_cbw->lun, p_cbw->command, _mscd_epbuf[0].buf, CFG_TUD_MSC_EP_BUFSIZE,
+                                               p_msc->total_len);
 
           if (resplen < 0) {
             // unsupported command
@@ -551,7 +720,7 @@ bool mscd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t event, uint32_t
             } else {
               // cannot return more than host expect
               p_msc->total_len = tu_min32((uint32_t)resplen, p_cbw->total_bytes);
-              TU_ASSERT(usbd_edpt_xfer(rhport, p_msc->ep_in, _mscd_epbuf.buf, (uint16_t) p_msc->total_len, false));
+              TU_ASSERT(usbd_edpt_xfer(rhport, p_msc->ep_in, _mscd_epbuf[0].buf, (uint16_t) p_msc->total_len, false));
             }
           }
         }
@@ -561,26 +730,20 @@ bool mscd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t event, uint32_t
 
     case MSC_STAGE_DATA:
       TU_LOG_DRV("  SCSI Data [Lun%u]\r\n", p_cbw->lun);
-      TU_ASSERT(xferred_bytes <= CFG_TUD_MSC_EP_BUFSIZE); // sanity check to avoid buffer overflow
-      // TU_LOG_MEM(CFG_TUD_MSC_LOG_LEVEL, _mscd_epbuf.buf, xferred_bytes, 2);
-
-      if (SCSI_CMD_READ_10 == p_cbw->command[0]) {
-        p_msc->xferred_len += xferred_bytes;
+      // TU_LOG_MEM(CFG_TUD_MSC_LOG_LEVEL, _mscd_epbuf[0].buf, xferred_bytes, 2);
 
-        if ( p_msc->xferred_len >= p_msc->total_len ) {
-          // Data Stage is complete
-          p_msc->stage = MSC_STAGE_STATUS;
-        }else {
-          proc_read10_cmd(p_msc);
-        }
-      } else if (SCSI_CMD_WRITE_10 == p_cbw->command[0]) {
+      // READ/WRITE transfer can be larger than class buffer with application mapped memory
+      if (is_cmd_read(p_cbw->command[0])) {
+        proc_read10_host_done(p_msc, xferred_bytes);
+      } else if (is_cmd_write(p_cbw->command[0])) {
         proc_write10_host_data(p_msc, xferred_bytes);
       } else {
+        TU_ASSERT(xferred_bytes <= CFG_TUD_MSC_EP_BUFSIZE); // sanity check to avoid buffer overflow
         p_msc->xferred_len += xferred_bytes;
 
         // OUT transfer, invoke callback if needed
         if ( !is_data_in(p_cbw->dir) ) {
-          int32_t cb_result = tud_msc_scsi_cb(p_cbw->lun, p_cbw->command, _mscd_epbuf.buf, (uint16_t) p_msc->total_len);
+          int32_t cb_result = mscd_proc_scsi_out(p_cbw->lun, p_cbw->command, _mscd_epbuf[0].buf, p_msc->total_len);
 
           if ( cb_result < 0 ) {
             // unsupported command
@@ -616,10 +779,12 @@ bool mscd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t event, uint32_t
         // if complete_cb() is invoked after queuing the status.
         switch (p_cbw->command[0]) {
           case SCSI_CMD_READ_10:
+          case SCSI_CMD_READ_16:
             tud_msc_read10_complete_cb(p_cbw->lun);
             break;
 
           case SCSI_CMD_WRITE_10:
+          case SCSI_CMD_WRITE_16:
             tud_msc_write10_complete_cb(p_cbw->lun);
             break;
 
@@ -653,6 +818,225 @@ bool mscd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t event, uint32_t
 /* SCSI Command Process
  *------------------------------------------------------------------*/
 
+// Process non READ/WRITE command: built-in first then invoke user callback if not built-in.
+// Return response's length, negative if failed. Also used by UAS driver which shares command set and sense data.
+int32_t mscd_proc_scsi_cmd(uint8_t lun, uint8_t const scsi_cmd[16], uint8_t* buffer, uint32_t bufsize, uint32_t xfer_len) {
+  int32_t resplen = proc_builtin_scsi(lun, scsi_cmd, buffer, bufsize);
+
+  if ((resplen < 0) && (_mscd_itf.sense_key == 0)) {
+    resplen = tud_msc_scsi_cb(lun, scsi_cmd, buffer, (uint16_t) tu_min32(xfer_len, bufsize));
+  }
+
+  return resplen;
+}
+
+#if CFG_TUD_MSC_CACHE
+// Write back cached data of LUN, set sense to WRITE ERROR if failed
+static bool cache_flush(uint8_t lun) {
+  if (tud_msc_cache_flush(lun)) {
+    return true;
+  }
+  set_sense_write_error(lun);
+  return false;
+}
+#endif
+
+// Media is about to be modified by UNMAP/WRITE SAME without going through the cache: write back and drop cached data
+static bool cache_discard(uint8_t lun) {
+  #if CFG_TUD_MSC_CACHE
+  TU_VERIFY(cache_flush(lun));
+  tud_msc_cache_invalidate(lun);
+  #else
+  (void) lun;
+  #endif
+  return true;
+}
+
+// LBA and block count of 10-byte or 16-byte (group 4) CDB with READ10/READ16 layout
+static void cdb_get_range(uint8_t const scsi_cmd[16], uint64_t* lba, uint32_t* block_count) {
+  if ((scsi_cmd[0] >> 5) == 4) {
+    uint32_t const lba_high = tu_unaligned_read32(scsi_cmd + offsetof(scsi_write16_t, lba));
+    uint32_t const lba_low  = tu_unaligned_read32(scsi_cmd + offsetof(scsi_write16_t, lba) + 4);
+    *lba = (((uint64_t) tu_ntohl(lba_high)) << 32) | tu_ntohl(lba_low);
+    *block_count = tu_ntohl(tu_unaligned_read32(scsi_cmd + offsetof(scsi_write16_t, block_count)));
+  } else {
+    *lba = tu_ntohl(tu_unaligned_read32(scsi_cmd + offsetof(scsi_write10_t, lba)));
+    *block_count = tu_ntohs(tu_unaligned_read16(scsi_cmd + offsetof(scsi_write10_t, block_count)));
+  }
+}
+
+typedef struct {
+  uint32_t max_unmap_blocks;
+  uint32_t unmap_granularity;
+  uint32_t max_write_same_blocks;
+} mscd_block_limits_t;
+
+static void get_block_limits(uint8_t lun, mscd_block_limits_t* limits) {
+  tu_memclr(limits, sizeof(mscd_block_limits_t));
+  tud_msc_block_limits_cb(lun, &limits->max_unmap_blocks, &limits->unmap_granularity, &limits->max_write_same_blocks);
+
+  // data-out block of WRITE SAME must fit in class buffer
+  uint64_t block_count;
+  uint32_t block_size;
+  tud_msc_capacity16_cb(lun, &block_count, &block_size);
+  if (block_size > CFG_TUD_MSC_EP_BUFSIZE) {
+    limits->max_write_same_blocks = 0;
+  }
+}
+
+// Check range is within medium, set sense to LBA OUT OF RANGE otherwise
+static bool check_lba_range(uint8_t lun, uint64_t lba, uint32_t block_count, uint32_t* block_size) {
+  uint64_t capacity;
+  tud_msc_capacity16_cb(lun, &capacity, block_size);
+  if (lba > capacity || block_count > capacity - lba) {
+    (void) tud_msc_set_sense(lun, SCSI_SENSE_ILLEGAL_REQUEST, 0x21, 0x00);
+    return false;
+  }
+  return true;
+}
+
+// INQUIRY with EVPD: provisioning related pages, other pages are passed to application
+static int32_t proc_inquiry_vpd(uint8_t lun, uint8_t page_code, uint8_t* buffer, uint32_t bufsize) {
+  mscd_block_limits_t limits;
+  get_block_limits(lun, &limits);
+
+  switch (page_code) {
+    case SCSI_VPD_PAGE_SUPPORTED: {
+      uint8_t const page[] = {0, SCSI_VPD_PAGE_SUPPORTED, 0, 3,
+                              SCSI_VPD_PAGE_SUPPORTED, SCSI_VPD_PAGE_BLOCK_LIMITS, SCSI_VPD_PAGE_LB_PROVISIONING};
+      TU_VERIFY(0 == tu_memcpy_s(buffer, bufsize, page, sizeof(page)), -1);
+      return sizeof(page);
+    }
+
+    case SCSI_VPD_PAGE_BLOCK_LIMITS: {
+      scsi_vpd_block_limits_t page;
+      tu_memclr(&page, sizeof(page));
+      page.page_code = SCSI_VPD_PAGE_BLOCK_LIMITS;
+      page.page_length = tu_htons(sizeof(page) - 4);
+      page.wsnz = 1;
+      if (limits.max_unmap_blocks) {
+        page.max_unmap_lba_count = tu_htonl(limits.max_unmap_blocks);
+        // parameter list must fit in class buffer
+        page.max_unmap_block_desc_count = tu_htonl((uint32_t) ((CFG_TUD_MSC_EP_BUFSIZE - sizeof(scsi_unmap_param_header_t)) /
+                                                               sizeof(scsi_unmap_block_desc_t)));
+        page.opt_unmap_granularity = tu_htonl(limits.unmap_granularity);
+      }
+      page.max_write_same_length = tu_htonll((uint64_t) limits.max_write_same_blocks);
+      TU_VERIFY(0 == tu_memcpy_s(buffer, bufsize, &page, sizeof(page)), -1);
+      return sizeof(page);
+    }
+
+    case SCSI_VPD_PAGE_LB_PROVISIONING: {
+      scsi_vpd_lb_provisioning_t page;
+      tu_memclr(&page, sizeof(page));
+      page.page_code = SCSI_VPD_PAGE_LB_PROVISIONING;
+      page.page_length = tu_htons(sizeof(page) - 4);
+      if (limits.max_unmap_blocks) {
+        page.flags = 0x80; // LBPU
+        if (limits.max_write_same_blocks) {
+          page.flags |= 0x60; // LBPWS and LBPWS10
+        }
+        page.provisioning_type = 2; // thin provisioned
+      }
+      TU_VERIFY(0 == tu_memcpy_s(buffer, bufsize, &page, sizeof(page)), -1);
+      return sizeof(page);
+    }
+
+    default:
+      return -1;
+  }
+}
+
+// Process data-out of UNMAP and WRITE SAME. Negative if it is not an built-in command (or not supported by application)
+// or indicate Failed status, in which case sense key is set.
+static int32_t proc_builtin_scsi_out(uint8_t lun, uint8_t const scsi_cmd[16], uint8_t const* buffer, uint32_t len) {
+  mscd_block_limits_t limits;
+  get_block_limits(lun, &limits);
+
+  switch (scsi_cmd[0]) {
+    case SCSI_CMD_UNMAP: {
+      TU_VERIFY(limits.max_unmap_blocks > 0, -1);
+      if (!tud_msc_is_writable_cb(lun)) {
+        (void) tud_msc_set_sense(lun, SCSI_SENSE_DATA_PROTECT, 0x27, 0x00);
+        return -1;
+      }
+      if (len < sizeof(scsi_unmap_param_header_t)) {
+        return 0; // no block descriptor
+      }
+
+      uint32_t const desc_len = tu_min32(tu_ntohs(tu_unaligned_read16(buffer + offsetof(scsi_unmap_param_header_t, block_desc_length))),
+                                         len - (uint32_t) sizeof(scsi_unmap_param_header_t));
+      uint32_t const desc_count = desc_len / sizeof(scsi_unmap_block_desc_t);
+      uint8_t const* desc = buffer + sizeof(scsi_unmap_param_header_t);
+      uint32_t block_size;
+
+      // validate all descriptors before unmapping any of them
+      for (uint32_t i = 0; i < desc_count; i++) {
+        uint8_t const* p = desc + i * sizeof(scsi_unmap_block_desc_t);
+        uint32_t const block_count = tu_ntohl(tu_unaligned_read32(p + offsetof(scsi_unmap_block_desc_t, block_count)));
+        uint64_t const lba = ((uint64_t) tu_ntohl(tu_unaligned_read32(p)) << 32) | tu_ntohl(tu_unaligned_read32(p + 4));
+        TU_VERIFY(check_lba_range(lun, lba, block_count, &block_size), -1);
+        if (block_count > limits.max_unmap_blocks) {
+          (void) tud_msc_set_sense(lun, SCSI_SENSE_ILLEGAL_REQUEST, 0x26, 0x00); // INVALID FIELD IN PARAMETER LIST
+          return -1;
+        }
+      }
+
+      TU_VERIFY(cache_discard(lun), -1);
+      for (uint32_t i = 0; i < desc_count; i++) {
+        uint8_t const* p = desc + i * sizeof(scsi_unmap_block_desc_t);
+        uint32_t const block_count = tu_ntohl(tu_unaligned_read32(p + offsetof(scsi_unmap_block_desc_t, block_count)));
+        uint64_t const lba = ((uint64_t) tu_ntohl(tu_unaligned_read32(p)) << 32) | tu_ntohl(tu_unaligned_read32(p + 4));
+        if (block_count > 0 && !tud_msc_unmap_cb(lun, lba, block_count)) {
+          set_sense_write_error(lun);
+          return -1;
+        }
+      }
+      return 0;
+    }
+
+    case SCSI_CMD_WRITE_SAME_10:
+    case SCSI_CMD_WRITE_SAME_16: {
+      TU_VERIFY(limits.max_write_same_blocks > 0, -1);
+      if (!tud_msc_is_writable_cb(lun)) {
+        (void) tud_msc_set_sense(lun, SCSI_SENSE_DATA_PROTECT, 0x27, 0x00);
+        return -1;
+      }
+
+      uint64_t lba;
+      uint32_t block_count;
+      uint32_t block_size;
+      cdb_get_range(scsi_cmd, &lba, &block_count);
+      TU_VERIFY(check_lba_range(lun, lba, block_count, &block_size), -1);
+      if (block_count == 0 || block_count > limits.max_write_same_blocks || len < block_size) {
+        (void) tud_msc_set_sense(lun, SCSI_SENSE_ILLEGAL_REQUEST, 0x24, 0x00); // INVALID FIELD IN CDB
+        return -1;
+      }
+
+      TU_VERIFY(cache_discard(lun), -1);
+      bool const unmap = (scsi_cmd[1] & SCSI_WRITE_SAME_FLAG_UNMAP) != 0;
+      if (!tud_msc_write_same_cb(lun, lba, block_count, buffer, block_size, unmap)) {
+        set_sense_write_error(lun);
+        return -1;
+      }
+      return 0;
+    }
+
+    default:
+      return -1;
+  }
+}
+
+int32_t mscd_proc_scsi_out(uint8_t lun, uint8_t const scsi_cmd[16], uint8_t* buffer, uint32_t len) {
+  int32_t ret = proc_builtin_scsi_out(lun, scsi_cmd, buffer, len);
+
+  if ((ret < 0) && (_mscd_itf.sense_key == 0)) {
+    ret = tud_msc_scsi_cb(lun, scsi_cmd, buffer, (uint16_t) len);
+  }
+
+  return ret;
+}
+
 // return response's length (copied to buffer). Negative if it is not an built-in command or indicate Failed status (CSW)
 // In case of a failed status, sense key must be set for reason of failure
 static int32_t proc_builtin_scsi(uint8_t lun, uint8_t const scsi_cmd[16], uint8_t* buffer, uint32_t bufsize) {
@@ -678,6 +1062,18 @@ static int32_t proc_builtin_scsi(uint8_t lun, uint8_t const scsi_cmd[16], uint8_
     case SCSI_CMD_START_STOP_UNIT: {
       resplen = 0;
       scsi_start_stop_unit_t const* start_stop = (scsi_start_stop_unit_t const*)scsi_cmd;
+      #if CFG_TUD_MSC_CACHE
+      // stop or eject: write back cached data first, drop it on eject since media may be changed
+      if (!start_stop->start || start_stop->load_eject) {
+        if (!cache_flush(lun)) {
+          resplen = -1;
+          break;
+        }
+        if (!start_stop->start && start_stop->load_eject) {
+          tud_msc_cache_invalidate(lun);
+        }
+      }
+      #endif
       if (!tud_msc_start_stop_cb(lun, start_stop->power_condition, start_stop->start, start_stop->load_eject)) {
         // Failed status response
         resplen = -1;
@@ -693,6 +1089,13 @@ static int32_t proc_builtin_scsi(uint8_t lun, uint8_t const scsi_cmd[16], uint8_
     case SCSI_CMD_PREVENT_ALLOW_MEDIUM_REMOVAL: {
       resplen = 0;
       scsi_prevent_allow_medium_removal_t const* prevent_allow = (scsi_prevent_allow_medium_removal_t const*)scsi_cmd;
+      #if CFG_TUD_MSC_CACHE
+      // host allows removal before ejecting media
+      if (!prevent_allow->prohibit_removal && !cache_flush(lun)) {
+        resplen = -1;
+        break;
+      }
+      #endif
       if (!tud_msc_prevent_allow_medium_removal_cb(lun, prevent_allow->prohibit_removal, prevent_allow->control)) {
         // Failed status response
         resplen = -1;
@@ -705,13 +1108,38 @@ static int32_t proc_builtin_scsi(uint8_t lun, uint8_t const scsi_cmd[16], uint8_
       break;
     }
 
-    case SCSI_CMD_READ_CAPACITY_10: {
+    case SCSI_CMD_SYNCHRONIZE_CACHE_10:
+    case SCSI_CMD_SYNCHRONIZE_CACHE_16: {
+      resplen = 0;
+      #if CFG_TUD_MSC_CACHE
+      if (!cache_flush(lun)) {
+        resplen = -1;
+        break;
+      }
+      #endif
+
+      uint64_t lba;
       uint32_t block_count;
+      cdb_get_range(scsi_cmd, &lba, &block_count);
+      if (!tud_msc_sync_cache_cb(lun, lba, block_count)) {
+        #if CFG_TUD_MSC_CACHE
+        // media is already synced by the cache flush, only fail if callback reports an error with sense
+        if (p_msc->sense_key != 0) {
+          resplen = -1;
+        }
+        #else
+        // not handled by callback (sense is not set): passed to tud_msc_scsi_cb()
+        resplen = -1;
+        #endif
+      }
+      break;
+    }
+
+    case SCSI_CMD_READ_CAPACITY_10: {
+      uint64_t block_count;
       uint32_t block_size;
-      uint16_t block_size_u16;
 
-      tud_msc_capacity_cb(lun, &block_count, &block_size_u16);
-      block_size = (uint32_t)block_size_u16;
+      tud_msc_capacity16_cb(lun, &block_count, &block_size);
 
       // Invalid block size/count from callback, possibly unit is not ready
       // stall this request, set sense key to NOT READY
@@ -725,7 +1153,8 @@ static int32_t proc_builtin_scsi(uint8_t lun, uint8_t const scsi_cmd[16], uint8_
       } else {
         scsi_read_capacity10_resp_t read_capa10;
 
-        read_capa10.last_lba = tu_htonl(block_count-1);
+        // SBC-3: last lba is 0xFFFFFFFF if it does not fit, host should then use READ CAPACITY (16)
+        read_capa10.last_lba = tu_htonl((uint32_t) tu_min64(block_count-1, UINT32_MAX));
         read_capa10.block_size = tu_htonl(block_size);
 
         resplen = sizeof(read_capa10);
@@ -734,6 +1163,45 @@ static int32_t proc_builtin_scsi(uint8_t lun, uint8_t const scsi_cmd[16], uint8_
       break;
     }
 
+    case SCSI_CMD_SERVICE_ACTION_IN_16: {
+      scsi_read_capacity16_t const* cmd_capa16 = (scsi_read_capacity16_t const*) scsi_cmd;
+      if ((cmd_capa16->service_action & 0x1Fu) != SCSI_SERVICE_ACTION_READ_CAPACITY_16) {
+        resplen = -1; // other service actions are handled by application
+        break;
+      }
+
+      uint64_t block_count;
+      uint32_t block_size;
+      tud_msc_capacity16_cb(lun, &block_count, &block_size);
+
+      if (block_count == 0 || block_size == 0) {
+        resplen = -1;
+
+        // set default sense if not set by callback
+        if (p_msc->sense_key == 0) {
+          set_sense_medium_not_present(lun);
+        }
+      } else {
+        scsi_read_capacity16_resp_t read_capa16;
+        tu_memclr(&read_capa16, sizeof(read_capa16));
+        read_capa16.last_lba   = tu_htonll(block_count-1);
+        read_capa16.block_size = tu_htonl(block_size);
+
+        // LBPME: logical block provisioning (UNMAP) is enabled
+        mscd_block_limits_t limits;
+        get_block_limits(lun, &limits);
+        if (limits.max_unmap_blocks) {
+          read_capa16.lowest_aligned_lba = tu_htons(0x8000);
+        }
+
+        // response is truncated to allocation length
+        const uint32_t alloc_len = tu_ntohl(tu_unaligned_read32(scsi_cmd + offsetof(scsi_read_capacity16_t, alloc_length)));
+        resplen = (int32_t) tu_min32(sizeof(read_capa16), alloc_len);
+        TU_VERIFY(0 == tu_memcpy_s(buffer, bufsize, &read_capa16, (size_t) resplen));
+      }
+      break;
+    }
+
     case SCSI_CMD_READ_FORMAT_CAPACITY: {
       scsi_read_format_capacity_data_t read_fmt_capa = {
         .list_length = 8,
@@ -767,10 +1235,23 @@ static int32_t proc_builtin_scsi(uint8_t lun, uint8_t const scsi_cmd[16], uint8_
     }
 
     case SCSI_CMD_INQUIRY: {
+      if (scsi_cmd[1] & 0x01) {
+        // EVPD: vital product data page
+        resplen = proc_inquiry_vpd(lun, scsi_cmd[2], buffer, bufsize);
+        break;
+      }
+
       scsi_inquiry_resp_t *inquiry_rsp = (scsi_inquiry_resp_t *) buffer;
       tu_memclr(inquiry_rsp, sizeof(scsi_inquiry_resp_t));
       inquiry_rsp->is_removable = 1;
       inquiry_rsp->version = 2;
+
+      // claim SPC-4 if provisioning is supported, hosts only query VPD pages and READ CAPACITY (16) for SPC-3 or later
+      mscd_block_limits_t limits;
+      get_block_limits(lun, &limits);
+      if (limits.max_unmap_blocks || limits.max_write_same_blocks) {
+        inquiry_rsp->version = 6;
+      }
       inquiry_rsp->response_data_format = 2;
       inquiry_rsp->additional_length = sizeof(scsi_inquiry_resp_t) - 5;
 
@@ -798,6 +1279,20 @@ static int32_t proc_builtin_scsi(uint8_t lun, uint8_t const scsi_cmd[16], uint8_
 
       resplen = sizeof(mode_resp);
       TU_VERIFY(0 == tu_memcpy_s(buffer, bufsize, &mode_resp, (size_t) resplen));
+
+      #if CFG_TUD_MSC_CACHE
+      // Caching mode page with WCE (write back cache enabled), host then sends SYNCHRONIZE CACHE to flush it
+      scsi_mode_sense6_t const* mode_sense = (scsi_mode_sense6_t const*) scsi_cmd;
+      if (mode_sense->page_code == 0x08 || mode_sense->page_code == 0x3F) {
+        uint8_t caching_page[20] = {0x08, sizeof(caching_page) - 2};
+        if (mode_sense->page_control != 1) {
+          caching_page[2] = 0x04; // WCE, not changeable
+        }
+        TU_VERIFY(0 == tu_memcpy_s(buffer + resplen, bufsize - (uint32_t) resplen, caching_page, sizeof(caching_page)));
+        resplen += (int32_t) sizeof(caching_page);
+        buffer[0] = (uint8_t) (resplen - 1); // mode data length
+      }
+      #endif
       break;
     }
 
@@ -831,28 +1326,83 @@ static int32_t proc_builtin_scsi(uint8_t lun, uint8_t const scsi_cmd[16], uint8_
 }
 
 static void proc_read10_cmd(mscd_interface_t* p_msc) {
+  #if CFG_TUD_MSC_CACHE
+  // cache reads whole erase blocks of media on behalf of application, which therefore cannot check the range
+  msc_cbw_t const* p_cbw = &p_msc->cbw;
+  uint32_t block_size;
+  if (!check_lba_range(p_cbw->lun, rdwr_get_lba(p_cbw->command), rdwr_get_blockcount(p_cbw), &block_size)) {
+    fail_scsi_op(p_msc, MSC_CSW_STATUS_FAILED);
+    return;
+  }
+  #endif
+
+  proc_read10_media(p_msc);
+}
+
+// Read next chunk from media into a free buffer. This is also invoked while previous chunks are still transferred
+// to host so that media I/O and USB transfer are overlapped when there is more than one buffer.
+static void proc_read10_media(mscd_interface_t* p_msc) {
   msc_cbw_t const* p_cbw = &p_msc->cbw;
-  uint16_t const block_sz = rdwr10_get_blocksize(p_cbw); // already verified non-zero
+  TU_VERIFY(!p_msc->pending_io && !p_msc->io_failed, );
+  TU_VERIFY(p_msc->buf_count < CFG_TUD_MSC_EPBUF_COUNT && p_msc->ahead_len < p_cbw->total_bytes, );
+
+  uint32_t const block_sz = rdwr_get_blocksize(p_cbw); // already verified non-zero
   TU_VERIFY(block_sz != 0, );
-  // Adjust lba & offset with transferred bytes
-  uint32_t const lba = rdwr10_get_lba(p_cbw->command) + (p_msc->xferred_len / block_sz);
-  uint32_t const offset = p_msc->xferred_len % block_sz;
+  // Adjust lba & offset with bytes read so far
+  uint64_t const lba = rdwr_get_lba(p_cbw->command) + (p_msc->ahead_len / block_sz);
+  uint32_t const offset = p_msc->ahead_len % block_sz;
+
+  const uint8_t tail = rdwr_buf_tail(p_msc);
+  const uint32_t remaining = p_cbw->total_bytes - p_msc->ahead_len;
+
+  // zero-copy: transfer directly from application memory if mapped
+  void const* mapped = NULL;
+  uint32_t mapped_len = 0;
+  if (lba <= UINT32_MAX && !CFG_TUD_MSC_CACHE) {
+    mapped_len = rdwr_map_len(tud_msc_read10_map_cb(p_cbw->lun, (uint32_t) lba, offset, &mapped, remaining), remaining);
+  }
+  if (mapped != NULL && mapped_len > 0) {
+    p_msc->buf_addr[tail] = (uint8_t*) (uintptr_t) mapped;
+    proc_read_io_data(p_msc, (int32_t) tu_min32(mapped_len, UINT16_MAX & ~UINT32_C(511)));
+    return;
+  }
 
   // remaining bytes capped at class buffer
-  int32_t nbytes = (int32_t)tu_min32(CFG_TUD_MSC_EP_BUFSIZE, p_cbw->total_bytes - p_msc->xferred_len);
+  int32_t nbytes = (int32_t)tu_min32(CFG_TUD_MSC_EP_BUFSIZE, remaining);
 
+  p_msc->buf_addr[tail] = rdwr_buf(tail);
   p_msc->pending_io = true;
-  nbytes = tud_msc_read10_cb(p_cbw->lun, lba, offset, _mscd_epbuf.buf, (uint32_t)nbytes);
+  #if CFG_TUD_MSC_CACHE
+  nbytes = mscd_cache_read(p_cbw->lun, lba, offset, block_sz, p_msc->buf_addr[tail], (uint32_t)nbytes);
+  #else
+  if (p_cbw->command[0] == SCSI_CMD_READ_16) {
+    nbytes = tud_msc_read16_cb(p_cbw->lun, lba, offset, p_msc->buf_addr[tail], (uint32_t)nbytes);
+  } else {
+    nbytes = tud_msc_read10_cb(p_cbw->lun, (uint32_t) lba, offset, p_msc->buf_addr[tail], (uint32_t)nbytes);
+  }
+  #endif
   if (nbytes != TUD_MSC_RET_ASYNC) {
     p_msc->pending_io = false;
     proc_read_io_data(p_msc, nbytes);
   }
 }
 
+// Send head buffer to host if endpoint is idle
+static void proc_read10_xfer(mscd_interface_t* p_msc) {
+  TU_VERIFY(!p_msc->xfer_busy && p_msc->buf_count > 0, );
+  p_msc->xfer_busy = true;
+  const uint8_t head = p_msc->buf_head;
+  TU_ASSERT(usbd_edpt_xfer(p_msc->rhport, p_msc->ep_in, p_msc->buf_addr[head], p_msc->buf_len[head], false),);
+}
+
 static void proc_read_io_data(mscd_interface_t* p_msc, int32_t nbytes) {
-  const uint8_t rhport = p_msc->rhport;
   if (nbytes > 0) {
-    TU_ASSERT(usbd_edpt_xfer(rhport, p_msc->ep_in, _mscd_epbuf.buf, (uint16_t) nbytes, false),);
+    p_msc->buf_len[rdwr_buf_tail(p_msc)] = (uint16_t) nbytes;
+    p_msc->buf_count++;
+    p_msc->ahead_len += (uint32_t) nbytes;
+
+    proc_read10_xfer(p_msc);
+    proc_read10_media(p_msc); // prefetch next chunk while this one is on the wire
   } else {
     // nbytes is status
     switch (nbytes) {
@@ -860,12 +1410,16 @@ static void proc_read_io_data(mscd_interface_t* p_msc, int32_t nbytes) {
         // error -> endpoint is stalled & status in CSW set to failed
         TU_LOG_DRV("  IO read() failed\r\n");
         set_sense_medium_not_present(p_msc->cbw.lun);
-        fail_scsi_op(p_msc, MSC_CSW_STATUS_FAILED);
+        if (p_msc->xfer_busy || p_msc->buf_count > 0) {
+          p_msc->io_failed = true; // data already read is sent first
+        } else {
+          fail_scsi_op(p_msc, MSC_CSW_STATUS_FAILED);
+        }
         break;
 
       case TUD_MSC_RET_BUSY:
-        // not ready yet -> fake a transfer complete so that this driver callback will fire again
-        dcd_event_xfer_complete(rhport, p_msc->ep_in, 0, XFER_RESULT_SUCCESS, false);
+        // not ready yet -> retry later in usbd task
+        usbd_defer_func(proc_rdwr_retry, NULL, false);
         break;
 
       default: break; // nothing to do
@@ -873,6 +1427,26 @@ static void proc_read_io_data(mscd_interface_t* p_msc, int32_t nbytes) {
   }
 }
 
+// data of head buffer is sent to host
+static void proc_read10_host_done(mscd_interface_t* p_msc, uint32_t xferred_bytes) {
+  p_msc->xfer_busy = false;
+  p_msc->xferred_len += xferred_bytes;
+  p_msc->buf_head = (uint8_t) ((p_msc->buf_head + 1) % CFG_TUD_MSC_EPBUF_COUNT);
+  p_msc->buf_count--;
+
+  if (p_msc->xferred_len >= p_msc->total_len) {
+    // Data Stage is complete
+    p_msc->stage = MSC_STAGE_STATUS;
+  } else if (p_msc->buf_count > 0) {
+    proc_read10_xfer(p_msc);
+    proc_read10_media(p_msc);
+  } else if (p_msc->io_failed) {
+    fail_scsi_op(p_msc, MSC_CSW_STATUS_FAILED);
+  } else {
+    proc_read10_media(p_msc);
+  }
+}
+
 static void proc_write10_cmd(mscd_interface_t* p_msc) {
   msc_cbw_t const* p_cbw = &p_msc->cbw;
   const bool writable = tud_msc_is_writable_cb(p_cbw->lun);
@@ -885,31 +1459,100 @@ static void proc_write10_cmd(mscd_interface_t* p_msc) {
     return;
   }
 
-  // remaining bytes capped at class buffer
-  uint16_t nbytes = (uint16_t)tu_min32(CFG_TUD_MSC_EP_BUFSIZE, p_cbw->total_bytes - p_msc->xferred_len);
+  #if CFG_TUD_MSC_CACHE
+  uint32_t block_size;
+  if (!check_lba_range(p_cbw->lun, rdwr_get_lba(p_cbw->command), rdwr_get_blockcount(p_cbw), &block_size)) {
+    fail_scsi_op(p_msc, MSC_CSW_STATUS_FAILED);
+    return;
+  }
+  #endif
+
+  proc_write10_xfer(p_msc);
+}
+
+// Receive next chunk from host into a free buffer if endpoint is idle
+static void proc_write10_xfer(mscd_interface_t* p_msc) {
+  msc_cbw_t const* p_cbw = &p_msc->cbw;
+  TU_VERIFY(!p_msc->xfer_busy && p_msc->buf_count < CFG_TUD_MSC_EPBUF_COUNT, );
+  TU_VERIFY(p_msc->ahead_len < p_cbw->total_bytes, );
+
+  const uint8_t tail = rdwr_buf_tail(p_msc);
+  const uint32_t remaining = p_cbw->total_bytes - p_msc->ahead_len;
+
+  // zero-copy: receive directly into application staging memory if mapped
+  uint32_t const block_sz = rdwr_get_blocksize(p_cbw); // already verified non-zero
+  TU_VERIFY(block_sz != 0, );
+  uint64_t const lba = rdwr_get_lba(p_cbw->command) + (p_msc->ahead_len / block_sz);
+  uint32_t const offset = p_msc->ahead_len % block_sz;
+
+  uint8_t* mapped = NULL;
+  uint32_t mapped_len = 0;
+  if (lba <= UINT32_MAX && !CFG_TUD_MSC_CACHE) {
+    mapped_len = rdwr_map_len(tud_msc_write10_map_cb(p_cbw->lun, (uint32_t) lba, offset, &mapped, remaining), remaining);
+  }
+
+  uint16_t nbytes;
+  if (mapped != NULL && mapped_len > 0) {
+    p_msc->buf_addr[tail] = mapped;
+    nbytes = (uint16_t) tu_min32(mapped_len, UINT16_MAX & ~UINT32_C(511));
+  } else {
+    // remaining bytes capped at class buffer
+    p_msc->buf_addr[tail] = rdwr_buf(tail);
+    nbytes = (uint16_t)tu_min32(CFG_TUD_MSC_EP_BUFSIZE, remaining);
+  }
+
   // Write10 callback will be called later when usb transfer complete
-  TU_ASSERT(usbd_edpt_xfer(p_msc->rhport, p_msc->ep_out, _mscd_epbuf.buf, nbytes, false),);
+  p_msc->xfer_busy = true;
+  TU_ASSERT(usbd_edpt_xfer(p_msc->rhport, p_msc->ep_out, p_msc->buf_addr[tail], nbytes, false),);
 }
 
 // process new data arrived from WRITE10
 static void proc_write10_host_data(mscd_interface_t* p_msc, uint32_t xferred_bytes) {
+  p_msc->xfer_busy = false;
+  if (xferred_bytes > 0) {
+    p_msc->buf_len[rdwr_buf_tail(p_msc)] = (uint16_t) xferred_bytes;
+    p_msc->buf_count++;
+    p_msc->ahead_len += xferred_bytes;
+  }
+
+  proc_write10_xfer(p_msc); // receive next chunk while this one is written to media
+  proc_write10_media(p_msc);
+}
+
+// Write head buffer to media
+static void proc_write10_media(mscd_interface_t* p_msc) {
   msc_cbw_t const* p_cbw = &p_msc->cbw;
-  uint16_t const block_sz = rdwr10_get_blocksize(p_cbw); // already verified non-zero
+  TU_VERIFY(!p_msc->pending_io && p_msc->buf_count > 0, );
+
+  uint32_t const block_sz = rdwr_get_blocksize(p_cbw); // already verified non-zero
   TU_VERIFY(block_sz != 0, );
 
-  // Adjust lba & offset with transferred bytes
-  uint32_t const lba = rdwr10_get_lba(p_cbw->command) + (p_msc->xferred_len / block_sz);
+  // Adjust lba & offset with bytes written so far
+  uint64_t const lba = rdwr_get_lba(p_cbw->command) + (p_msc->xferred_len / block_sz);
   uint32_t const offset = p_msc->xferred_len % block_sz;
 
+  const uint8_t head = p_msc->buf_head;
+  uint8_t* buf = p_msc->buf_addr[head] + p_msc->buf_offset;
+  const uint32_t len = (uint32_t) (p_msc->buf_len[head] - p_msc->buf_offset);
+
   p_msc->pending_io = true;
-  int32_t nbytes =  tud_msc_write10_cb(p_cbw->lun, lba, offset, _mscd_epbuf.buf, xferred_bytes);
+  int32_t nbytes;
+  #if CFG_TUD_MSC_CACHE
+  nbytes = mscd_cache_write(p_cbw->lun, lba, offset, block_sz, buf, len);
+  #else
+  if (p_cbw->command[0] == SCSI_CMD_WRITE_16) {
+    nbytes = tud_msc_write16_cb(p_cbw->lun, lba, offset, buf, len);
+  } else {
+    nbytes = tud_msc_write10_cb(p_cbw->lun, (uint32_t) lba, offset, buf, len);
+  }
+  #endif
   if (nbytes != TUD_MSC_RET_ASYNC) {
     p_msc->pending_io = false;
-    proc_write_io_data(p_msc, xferred_bytes, nbytes);
+    proc_write_io_data(p_msc, nbytes);
   }
 }
 
-static void proc_write_io_data(mscd_interface_t* p_msc, uint32_t xferred_bytes, int32_t nbytes) {
+static void proc_write_io_data(mscd_interface_t* p_msc, int32_t nbytes) {
   if (nbytes < 0) {
     // nbytes is status
     switch (nbytes) {
@@ -923,25 +1566,27 @@ static void proc_write_io_data(mscd_interface_t* p_msc, uint32_t xferred_bytes,
       default: break; // nothing to do
     }
   } else {
-    if ((uint32_t)nbytes < xferred_bytes) {
-      // Application consume less than what we got including TUD_MSC_RET_BUSY (0)
-      const uint32_t left_over = xferred_bytes - (uint32_t)nbytes;
-      if (nbytes > 0) {
-        memmove(_mscd_epbuf.buf, _mscd_epbuf.buf + nbytes, left_over);
-      }
+    const uint8_t head = p_msc->buf_head;
+    p_msc->xferred_len += (uint32_t) nbytes;
+    p_msc->buf_offset = (uint16_t) (p_msc->buf_offset + nbytes);
 
-      // fake a transfer complete with adjusted parameters --> callback will be invoked with adjusted parameters
-      dcd_event_xfer_complete(p_msc->rhport, p_msc->ep_out, left_over, XFER_RESULT_SUCCESS, false);
+    if (p_msc->buf_offset < p_msc->buf_len[head]) {
+      // Application consume less than what we got including TUD_MSC_RET_BUSY (0)
+      // -> callback will be invoked again later with the remaining data
+      usbd_defer_func(proc_rdwr_retry, NULL, false);
     } else {
-      // Application consume all bytes in our buffer
-      p_msc->xferred_len += xferred_bytes;
+      // Application consume all bytes in head buffer
+      p_msc->buf_offset = 0;
+      p_msc->buf_head = (uint8_t) ((head + 1) % CFG_TUD_MSC_EPBUF_COUNT);
+      p_msc->buf_count--;
 
       if (p_msc->xferred_len >= p_msc->total_len) {
         // Data Stage is complete
         p_msc->stage = MSC_STAGE_STATUS;
       } else {
-        // prepare to receive more data from host
-        proc_write10_cmd(p_msc);
+        // prepare to receive more data from host and write next received chunk if any
+        proc_write10_xfer(p_msc);
+        proc_write10_media(p_msc);
       }
     }
   }
@@ -29,6 +29,12 @@
   #error CFG_TUD_MSC_EP_BUFSIZE must be defined, value of a block size should work well, the more the better
 #endif
 
+// Number of CFG_TUD_MSC_EP_BUFSIZE buffers used for READ10/WRITE10 data stage. With 2 or more, media I/O of the next
+// chunk (tud_msc_read10_cb/tud_msc_write10_cb) is overlapped with the USB transfer of the previous one.
+#ifndef CFG_TUD_MSC_EPBUF_COUNT
+  #define CFG_TUD_MSC_EPBUF_COUNT 1
+#endif
+
 // Return value of callback functions
 enum {
   TUD_MSC_RET_BUSY = 0,   // Busy, e.g disk I/O is not ready
@@ -37,6 +43,7 @@ enum {
 };
 
 TU_VERIFY_STATIC(CFG_TUD_MSC_EP_BUFSIZE < UINT16_MAX, "Size is not correct");
+TU_VERIFY_STATIC(CFG_TUD_MSC_EPBUF_COUNT >= 1 && CFG_TUD_MSC_EPBUF_COUNT <= 8, "Buffer count is not correct");
 
 //--------------------------------------------------------------------+
 // Application API
@@ -67,10 +74,32 @@ bool tud_msc_async_io_done(int32_t bytes_io, bool in_isr);
     - TUD_MSC_RET_ASYNC
         Data I/O will be done asynchronously in a background task. Application should return immediately.
         tud_msc_async_io_done() must be called once IO/ is done to signal completion.
+  - If CFG_TUD_MSC_EPBUF_COUNT > 1, callback can be invoked while a previous chunk is still being transferred on USB,
+    buffer address may change between calls. There is at most one outstanding (async) I/O at a time.
 */
 int32_t tud_msc_read10_cb (uint8_t lun, uint32_t lba, uint32_t offset, void* buffer, uint32_t bufsize);
 int32_t tud_msc_write10_cb (uint8_t lun, uint32_t lba, uint32_t offset, uint8_t* buffer, uint32_t bufsize);
 
+// Invoked when received SCSI READ16/WRITE16 command with 64-bit LBA, same semantics as READ10/WRITE10 callbacks.
+// Optional: default implementation forwards to tud_msc_read10_cb()/tud_msc_write10_cb() and fails if LBA exceeds 32-bit
+int32_t tud_msc_read16_cb (uint8_t lun, uint64_t lba, uint32_t offset, void* buffer, uint32_t bufsize);
+int32_t tud_msc_write16_cb (uint8_t lun, uint64_t lba, uint32_t offset, uint8_t* buffer, uint32_t bufsize);
+
+/*
+  Optional zero-copy READ10/WRITE10 for memory-mapped media e.g RAM disk or memory-mapped QSPI flash.
+  Invoked before tud_msc_read10_cb() / tud_msc_write10_cb() with the same address parameters.
+  - Application set *buffer to the backing store (READ10) or a staging buffer (WRITE10) for this address and return
+    its usable length up to bufsize. Data is transferred directly from/to it, class buffer is not used.
+  - Return 0 to use class buffer and tud_msc_read10_cb() / tud_msc_write10_cb() as usual.
+  - Memory must be accessible by USB controller (DMA). Returned length is rounded down to multiple of 512 unless it
+    covers bufsize.
+  - READ10: tud_msc_read10_cb() is not invoked for mapped data.
+  - WRITE10: tud_msc_write10_cb() is still invoked with buffer = *buffer when data is received, application can commit
+    staging buffer there or simply return bufsize if data is already in place.
+*/
+uint32_t tud_msc_read10_map_cb(uint8_t lun, uint32_t lba, uint32_t offset, void const** buffer, uint32_t bufsize);
+uint32_t tud_msc_write10_map_cb(uint8_t lun, uint32_t lba, uint32_t offset, uint8_t** buffer, uint32_t bufsize);
+
 // Invoked when received SCSI_CMD_INQUIRY, v1, application should use v2 if possible
 // Application fill vendor id, product id and revision with string up to 8, 16, 4 characters respectively
 void tud_msc_inquiry_cb(uint8_t lun, uint8_t vendor_id[8], uint8_t product_id[16], uint8_t product_rev[4]);
@@ -88,10 +117,18 @@ bool tud_msc_test_unit_ready_cb(uint8_t lun);
 // Application update block count and block size
 void tud_msc_capacity_cb(uint8_t lun, uint32_t* block_count, uint16_t* block_size);
 
+// Invoked when received SCSI_CMD_READ_CAPACITY_10 and READ CAPACITY (16) to determine the disk size.
+// Optional: only needed for media larger than 2^32 blocks, default implementation uses tud_msc_capacity_cb()
+void tud_msc_capacity16_cb(uint8_t lun, uint64_t* block_count, uint32_t* block_size);
+
 /**
  * Invoked when received an SCSI command not in built-in list below.
- * - READ_CAPACITY10, READ_FORMAT_CAPACITY, INQUIRY, TEST_UNIT_READY, START_STOP_UNIT, MODE_SENSE6, REQUEST_SENSE
- * - READ10 and WRITE10 has their own callbacks
+ * - READ_CAPACITY10, READ_CAPACITY16, READ_FORMAT_CAPACITY, INQUIRY, TEST_UNIT_READY, START_STOP_UNIT, MODE_SENSE6,
+ *   REQUEST_SENSE
+ * - UNMAP and WRITE_SAME10/16 if supported in tud_msc_block_limits_cb()
+ * - SYNCHRONIZE_CACHE10/16 if handled by tud_msc_sync_cache_cb() or CFG_TUD_MSC_CACHE is enabled
+ * - INQUIRY VPD pages other than supported pages, block limits and logical block provisioning
+ * - READ10/16 and WRITE10/16 has their own callbacks
  *
  * \param[in]   lun         Logical unit number
  * \param[in]   scsi_cmd    SCSI command contents which application must examine to response accordingly
@@ -122,10 +159,10 @@ bool tud_msc_prevent_allow_medium_removal_cb(uint8_t lun, uint8_t prohibit_remov
 // Invoked when received REQUEST_SENSE
 int32_t tud_msc_request_sense_cb(uint8_t lun, void* buffer, uint16_t bufsize);
 
-// Invoked when Read10 command is complete
+// Invoked when Read10/Read16 command is complete
 void tud_msc_read10_complete_cb(uint8_t lun);
 
-// Invoke when Write10 command is complete, can be used to flush flash caching
+// Invoke when Write10/Write16 command is complete, can be used to flush flash caching
 void tud_msc_write10_complete_cb(uint8_t lun);
 
 // Invoked when command in tud_msc_scsi_cb is complete
@@ -134,6 +171,29 @@ void tud_msc_scsi_complete_cb(uint8_t lun, uint8_t const scsi_cmd[16]);
 // Invoked to check if device is writable as part of SCSI WRITE10
 bool tud_msc_is_writable_cb(uint8_t lun);
 
+// Invoked for Block Limits VPD page, READ CAPACITY (16) and before UNMAP/WRITE SAME to get provisioning limits.
+// Application set maximum blocks per UNMAP / WRITE SAME and optimal unmap granularity (e.g erase block) in blocks.
+// Optional: default leaves them at 0 which means not supported, the commands are then passed to tud_msc_scsi_cb().
+// WRITE SAME is not supported if block size is larger than CFG_TUD_MSC_EP_BUFSIZE.
+void tud_msc_block_limits_cb(uint8_t lun, uint32_t* max_unmap_blocks, uint32_t* unmap_granularity,
+                             uint32_t* max_write_same_blocks);
+
+// Invoked for each block range of UNMAP command (TRIM). Blocks can be erased or marked free for garbage collection.
+// Return false if failed, tinyusb fails the command with MEDIUM ERROR if sense is not set.
+bool tud_msc_unmap_cb(uint8_t lun, uint64_t lba, uint32_t block_count);
+
+// Invoked when received WRITE SAME(10/16): write block (block_size bytes) to every block of the range. If unmap is
+// true, host allows to unmap the range instead when block is all zeros.
+// Return false if failed, tinyusb fails the command with MEDIUM ERROR if sense is not set.
+bool tud_msc_write_same_cb(uint8_t lun, uint64_t lba, uint32_t block_count, uint8_t const* block, uint32_t block_size,
+                           bool unmap);
+
+// Invoked when received SYNCHRONIZE CACHE(10/16), block_count = 0 means until end of medium. With CFG_TUD_MSC_CACHE,
+// the driver cache is already flushed when invoked. Return false with sense set (e.g WRITE ERROR) if failed.
+// Optional: default returns false without sense i.e not handled, the command is then passed to tud_msc_scsi_cb(),
+// or completes with GOOD status with CFG_TUD_MSC_CACHE.
+bool tud_msc_sync_cache_cb(uint8_t lun, uint64_t lba, uint32_t block_count);
+
 //--------------------------------------------------------------------+
 // Internal Class Driver API
 //--------------------------------------------------------------------+
@@ -144,6 +204,12 @@ uint16_t mscd_open            (uint8_t rhport, tusb_desc_interface_t const * itf
 bool     mscd_control_xfer_cb (uint8_t rhport, uint8_t stage, tusb_control_request_t const * p_request);
 bool     mscd_xfer_cb         (uint8_t rhport, uint8_t ep_addr, xfer_result_t event, uint32_t xferred_bytes);
 
+// Process SCSI command other than READ/WRITE (built-in or tud_msc_scsi_cb), shared with UAS driver
+int32_t  mscd_proc_scsi_cmd   (uint8_t lun, uint8_t const scsi_cmd[16], uint8_t* buffer, uint32_t bufsize, uint32_t xfer_len);
+
+// Process data-out received for SCSI command other than WRITE (built-in or tud_msc_scsi_cb), shared with UAS driver
+int32_t  mscd_proc_scsi_out   (uint8_t lun, uint8_t const scsi_cmd[16], uint8_t* buffer, uint32_t len);
+
 #ifdef __cplusplus
  }
 #endif
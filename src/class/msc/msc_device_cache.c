@@ -0,0 +1,206 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2019 Ha Thach (tinyusb.org)
+ * SPDX-License-Identifier: MIT
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#include "tusb_option.h"
+
+#if CFG_TUD_ENABLED && CFG_TUD_MSC && CFG_TUD_MSC_CACHE
+
+#include "msc_device.h"
+#include "msc_device_cache.h"
+
+//--------------------------------------------------------------------+
+// MACRO CONSTANT TYPEDEF
+//--------------------------------------------------------------------+
+typedef struct {
+  uint64_t addr;       // byte address of erase block on media
+  uint32_t block_size;
+  uint32_t len;        // bytes of erase block within media, less than erase size for last block only
+  uint32_t lru;        // access stamp, smallest is least recently used
+  uint8_t lun;
+  uint8_t valid;
+  uint8_t dirty;
+} mscd_cache_line_t;
+
+static mscd_cache_line_t _cache_line[CFG_TUD_MSC_CACHE_LINES];
+static uint32_t _cache_stamp;
+
+TU_ATTR_ALIGNED(4) static uint8_t _cache_buf[CFG_TUD_MSC_CACHE_LINES][CFG_TUD_MSC_CACHE_ERASE_SIZE];
+
+//--------------------------------------------------------------------+
+// Helper
+//--------------------------------------------------------------------+
+// Transfer whole line from/to media. Return line length, TUD_MSC_RET_BUSY or TUD_MSC_RET_ERROR
+static int32_t line_media_io(uint8_t idx, bool is_write) {
+  mscd_cache_line_t const* line = &_cache_line[idx];
+  uint8_t* data = _cache_buf[idx];
+  uint32_t done = 0;
+
+  while (done < line->len) {
+    uint64_t const addr = line->addr + done;
+    uint64_t const lba = addr / line->block_size;
+    uint32_t const offset = (uint32_t) (addr % line->block_size);
+    uint32_t const remaining = line->len - done;
+
+    int32_t const nbytes = is_write ? tud_msc_write16_cb(line->lun, lba, offset, data + done, remaining) :
+                                      tud_msc_read16_cb(line->lun, lba, offset, data + done, remaining);
+    if (nbytes == TUD_MSC_RET_BUSY) {
+      return TUD_MSC_RET_BUSY; // whole line is transferred again on retry
+    }
+    if (nbytes < 0) {
+      return TUD_MSC_RET_ERROR;
+    }
+    done += tu_min32((uint32_t) nbytes, remaining);
+  }
+
+  return (int32_t) done;
+}
+
+static int32_t line_writeback(uint8_t idx) {
+  int32_t const ret = line_media_io(idx, true);
+  if (ret > 0) {
+    _cache_line[idx].dirty = 0;
+  }
+  return ret;
+}
+
+static int32_t line_find(uint8_t lun, uint64_t addr) {
+  for (uint8_t i = 0; i < CFG_TUD_MSC_CACHE_LINES; i++) {
+    mscd_cache_line_t const* line = &_cache_line[i];
+    if (line->valid && line->lun == lun && line->addr == addr) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+// Evict least recently used line (writing it back if dirty) and assign it to erase block at addr. Line is read from
+// media unless it is going to be overwritten entirely. Return line length or TUD_MSC_RET_BUSY/TUD_MSC_RET_ERROR
+static int32_t line_alloc(uint8_t lun, uint64_t addr, uint32_t block_size, uint32_t len, bool fill, uint8_t* p_idx) {
+  uint8_t idx = 0;
+  for (uint8_t i = 0; i < CFG_TUD_MSC_CACHE_LINES; i++) {
+    if (!_cache_line[i].valid) {
+      idx = i;
+      break;
+    }
+    if (_cache_line[i].lru < _cache_line[idx].lru) {
+      idx = i;
+    }
+  }
+
+  mscd_cache_line_t* line = &_cache_line[idx];
+  if (line->valid && line->dirty) {
+    int32_t const ret = line_writeback(idx);
+    TU_VERIFY(ret > 0, ret);
+  }
+
+  line->addr = addr;
+  line->block_size = block_size;
+  line->len = len;
+  line->lun = lun;
+  line->valid = 1;
+  line->dirty = 0;
+
+  if (fill) {
+    int32_t const ret = line_media_io(idx, false);
+    if (ret <= 0) {
+      line->valid = 0;
+      return ret;
+    }
+  }
+
+  *p_idx = idx;
+  return (int32_t) len;
+}
+
+// Process read/write of erase blocks covering [lba:offset, +bufsize)
+static int32_t cache_rdwr(uint8_t lun, uint64_t lba, uint32_t offset, uint32_t block_size, uint8_t* buffer,
+                          uint32_t bufsize, bool is_write) {
+  uint64_t block_count = 0;
+  uint32_t capacity_block_size = 0;
+  tud_msc_capacity16_cb(lun, &block_count, &capacity_block_size);
+  uint64_t const media_size = block_count * block_size;
+
+  // range is checked by driver, never access media beyond its end
+  TU_VERIFY(lba < block_count, TUD_MSC_RET_ERROR);
+  uint64_t addr = lba * block_size + offset;
+  TU_VERIFY(addr < media_size && bufsize <= media_size - addr, TUD_MSC_RET_ERROR);
+  uint32_t total = 0;
+
+  while (total < bufsize) {
+    uint64_t const line_addr = addr - (addr % CFG_TUD_MSC_CACHE_ERASE_SIZE);
+    uint32_t const line_offset = (uint32_t) (addr - line_addr);
+    uint32_t const line_len = (uint32_t) tu_min64(CFG_TUD_MSC_CACHE_ERASE_SIZE, media_size - line_addr);
+    TU_VERIFY(line_len > line_offset, total ? (int32_t) total : TUD_MSC_RET_ERROR);
+    uint32_t const nbytes = tu_min32(bufsize - total, line_len - line_offset);
+
+    int32_t const found = line_find(lun, line_addr);
+    uint8_t idx = (uint8_t) found;
+    if (found < 0) {
+      bool const overwrite = is_write && line_offset == 0 && nbytes == line_len;
+      int32_t const ret = line_alloc(lun, line_addr, block_size, line_len, !overwrite, &idx);
+      if (ret <= 0) {
+        // report what is done so far, remaining is retried by driver
+        return total ? (int32_t) total : ret;
+      }
+    }
+
+    uint8_t* data = _cache_buf[idx] + line_offset;
+    if (is_write) {
+      memcpy(data, buffer + total, nbytes);
+      _cache_line[idx].dirty = 1;
+    } else {
+      memcpy(buffer + total, data, nbytes);
+    }
+    _cache_line[idx].lru = ++_cache_stamp;
+
+    total += nbytes;
+    addr += nbytes;
+  }
+
+  return (int32_t) total;
+}
+
+//--------------------------------------------------------------------+
+// Application API
+//--------------------------------------------------------------------+
+bool tud_msc_cache_flush(uint8_t lun) {
+  for (uint8_t i = 0; i < CFG_TUD_MSC_CACHE_LINES; i++) {
+    mscd_cache_line_t const* line = &_cache_line[i];
+    if (line->valid && line->dirty && line->lun == lun) {
+      TU_VERIFY(line_writeback(i) > 0);
+    }
+  }
+  return true;
+}
+
+void tud_msc_cache_invalidate(uint8_t lun) {
+  for (uint8_t i = 0; i < CFG_TUD_MSC_CACHE_LINES; i++) {
+    if (_cache_line[i].lun == lun) {
+      tu_memclr(&_cache_line[i], sizeof(mscd_cache_line_t));
+    }
+  }
+}
+
+//--------------------------------------------------------------------+
+// Internal Class Driver API
+//--------------------------------------------------------------------+
+int32_t mscd_cache_read(uint8_t lun, uint64_t lba, uint32_t offset, uint32_t block_size, void* buffer, uint32_t bufsize) {
+  if ((CFG_TUD_MSC_CACHE_ERASE_SIZE % block_size) != 0) {
+    return tud_msc_read16_cb(lun, lba, offset, buffer, bufsize);
+  }
+  return cache_rdwr(lun, lba, offset, block_size, (uint8_t*) buffer, bufsize, false);
+}
+
+int32_t mscd_cache_write(uint8_t lun, uint64_t lba, uint32_t offset, uint32_t block_size, uint8_t const* buffer,
+                         uint32_t bufsize) {
+  if ((CFG_TUD_MSC_CACHE_ERASE_SIZE % block_size) != 0) {
+    return tud_msc_write16_cb(lun, lba, offset, (uint8_t*) (uintptr_t) buffer, bufsize);
+  }
+  return cache_rdwr(lun, lba, offset, block_size, (uint8_t*) (uintptr_t) buffer, bufsize, true);
+}
+
+#endif
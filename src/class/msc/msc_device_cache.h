@@ -0,0 +1,70 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2019 Ha Thach (tinyusb.org)
+ * SPDX-License-Identifier: MIT
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#ifndef TUSB_MSC_DEVICE_CACHE_H_
+#define TUSB_MSC_DEVICE_CACHE_H_
+
+#include "common/tusb_common.h"
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+//--------------------------------------------------------------------+
+// Class Driver Configuration
+//--------------------------------------------------------------------+
+
+// Erase block size of media in bytes, which is also the cache line size. Must be multiple of LUN's block size,
+// otherwise the cache is bypassed for that LUN.
+#ifndef CFG_TUD_MSC_CACHE_ERASE_SIZE
+  #define CFG_TUD_MSC_CACHE_ERASE_SIZE 4096
+#endif
+
+// Number of cache lines, RAM used is CFG_TUD_MSC_CACHE_LINES * CFG_TUD_MSC_CACHE_ERASE_SIZE
+#ifndef CFG_TUD_MSC_CACHE_LINES
+  #define CFG_TUD_MSC_CACHE_LINES 2
+#endif
+
+TU_VERIFY_STATIC(CFG_TUD_MSC_CACHE_ERASE_SIZE >= 512 && (CFG_TUD_MSC_CACHE_ERASE_SIZE % 512) == 0,
+                 "Erase size must be multiple of 512");
+TU_VERIFY_STATIC(CFG_TUD_MSC_CACHE_LINES >= 1 && CFG_TUD_MSC_CACHE_LINES <= 255, "Cache line count is not correct");
+
+//--------------------------------------------------------------------+
+// Application API
+//
+// Erase block cache between the MSC/UAS driver and media callbacks:
+// - Media is only accessed in whole erase blocks: tud_msc_read16_cb()/tud_msc_write16_cb() (defaults forward to the
+//   READ10/WRITE10 callbacks) are invoked with erase block aligned address and size (smaller for last block of media).
+// - Host writes into the same erase block are coalesced, dirty lines are written back on eviction or flush.
+// - Least recently used line is evicted, hot FAT/directory sectors therefore stay cached.
+// - Cache is flushed on SYNCHRONIZE CACHE, START STOP UNIT and PREVENT ALLOW MEDIUM REMOVAL (allow) i.e eject.
+//   MODE SENSE reports caching page with WCE so that host sends SYNCHRONIZE CACHE.
+// - READ/WRITE beyond the end of medium is rejected with LBA OUT OF RANGE by the driver.
+// Media callbacks must complete synchronously (TUD_MSC_RET_ASYNC is treated as error) and zero-copy map callbacks
+// are not used.
+//--------------------------------------------------------------------+
+
+// Write back all dirty lines of LUN to media. Return false if media is busy or failed, dirty lines are kept
+bool tud_msc_cache_flush(uint8_t lun);
+
+// Discard all lines of LUN including dirty ones e.g when media is changed
+void tud_msc_cache_invalidate(uint8_t lun);
+
+//--------------------------------------------------------------------+
+// Internal Class Driver API
+//--------------------------------------------------------------------+
+
+// Media read/write through cache with the same parameters and return value as tud_msc_read16_cb()/write16_cb()
+int32_t mscd_cache_read(uint8_t lun, uint64_t lba, uint32_t offset, uint32_t block_size, void* buffer, uint32_t bufsize);
+int32_t mscd_cache_write(uint8_t lun, uint64_t lba, uint32_t offset, uint32_t block_size, uint8_t const* buffer,
+                         uint32_t bufsize);
+
+#ifdef __cplusplus
+ }
+#endif
+
+#endif /* TUSB_MSC_DEVICE_CACHE_H_ */
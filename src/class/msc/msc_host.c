@@ -14,6 +14,10 @@
 
 #include "msc_host.h"
 
+#if CFG_TUH_MSC_CACHE
+  #include "msc_host_cache.h"
+#endif
+
 // Level where CFG_TUSB_DEBUG must be at least for this driver is logged
 #ifndef CFG_TUH_MSC_LOG_LEVEL
   #define CFG_TUH_MSC_LOG_LEVEL   CFG_TUH_LOG_LEVEL
@@ -29,8 +33,24 @@ enum {
   MSC_STAGE_CMD,
   MSC_STAGE_DATA,
   MSC_STAGE_STATUS,
+  MSC_STAGE_RECOVERY, // Bulk-Only reset recovery after transport error, failed command is still active
+};
+
+// Reset recovery steps (BOT 5.3.4)
+enum {
+  MSC_RECOVERY_RESET = 0,
+  MSC_RECOVERY_CLEAR_IN,
+  MSC_RECOVERY_CLEAR_OUT,
 };
 
+// SCSI command waiting in queue while another one is in progress
+typedef struct {
+  msc_cbw_t cbw;
+  void* buffer;
+  tuh_msc_complete_cb_t complete_cb;
+  uintptr_t complete_arg;
+} msch_cmd_t;
+
 typedef struct {
   uint8_t itf_num;
   uint8_t ep_in;
@@ -43,13 +63,19 @@ typedef struct {
   // SCSI command data
   uint8_t stage;
   void* buffer;
+  uint32_t data_xferred; // data stage bytes transferred so far, can span multiple transfers
   tuh_msc_complete_cb_t complete_cb;
   uintptr_t complete_arg;
 
   struct {
     uint32_t block_size;
-    uint32_t block_count;
+    uint64_t block_count;
   } capacity[CFG_TUH_MSC_MAXLUN];
+
+  #if CFG_TUH_MSC_QUEUE_DEPTH
+  tu_fifo_t cmd_ff;
+  uint8_t cmd_ff_buf[CFG_TUH_MSC_QUEUE_DEPTH * sizeof(msch_cmd_t)];
+  #endif
 } msch_interface_t;
 
 typedef struct {
@@ -60,6 +86,14 @@ typedef struct {
 static msch_interface_t _msch_itf[CFG_TUH_DEVICE_MAX];
 CFG_TUH_MEM_SECTION static msch_epbuf_t _msch_epbuf[CFG_TUH_DEVICE_MAX];
 
+// Mutex for command stage and queue, since commands can be submitted from application and usbh task
+#if OSAL_MUTEX_REQUIRED
+static osal_mutex_def_t _msch_mutexdef;
+static osal_mutex_t _msch_mutex;
+#else
+#define _msch_mutex   NULL
+#endif
+
 TU_ATTR_ALWAYS_INLINE static inline msch_interface_t* get_itf(uint8_t daddr) {
   return &_msch_itf[daddr - 1];
 }
@@ -68,6 +102,16 @@ TU_ATTR_ALWAYS_INLINE static inline msch_epbuf_t* get_epbuf(uint8_t daddr) {
   return &_msch_epbuf[daddr - 1];
 }
 
+// Largest data stage transfer per usbh_edpt_xfer(): multiple of both full and high speed bulk packet size
+#define MSCH_DATA_XFER_MAX 0xFE00u
+
+// Queue next chunk of data stage
+static bool data_stage_xfer(uint8_t daddr, msch_interface_t* p_msc, msc_cbw_t const* cbw) {
+  uint8_t const ep_data = (cbw->dir & TUSB_DIR_IN_MASK) ? p_msc->ep_in : p_msc->ep_out;
+  uint16_t const len = (uint16_t) tu_min32(cbw->total_bytes - p_msc->data_xferred, MSCH_DATA_XFER_MAX);
+  return usbh_edpt_xfer(daddr, ep_data, ((uint8_t*) p_msc->buffer) + p_msc->data_xferred, len);
+}
+
 //--------------------------------------------------------------------+
 // Weak stubs: invoked if no strong implementation is available
 //--------------------------------------------------------------------+
@@ -88,6 +132,11 @@ uint8_t tuh_msc_get_maxlun(uint8_t dev_addr) {
 }
 
 uint32_t tuh_msc_get_block_count(uint8_t dev_addr, uint8_t lun) {
+  msch_interface_t* p_msc = get_itf(dev_addr);
+  return (uint32_t) tu_min64(p_msc->capacity[lun].block_count, UINT32_MAX);
+}
+
+uint64_t tuh_msc_get_block_count64(uint8_t dev_addr, uint8_t lun) {
   msch_interface_t* p_msc = get_itf(dev_addr);
   return p_msc->capacity[lun].block_count;
 }
@@ -105,9 +154,12 @@ bool tuh_msc_mounted(uint8_t dev_addr) {
 bool tuh_msc_ready(uint8_t dev_addr) {
   msch_interface_t* p_msc = get_itf(dev_addr);
   TU_VERIFY(p_msc->mounted);
+  #if CFG_TUH_MSC_QUEUE_DEPTH
+  TU_VERIFY(tu_fifo_empty(&p_msc->cmd_ff));
+  #endif
   const bool epin_busy = usbh_edpt_busy(dev_addr, p_msc->ep_in);
   const bool epout_busy = usbh_edpt_busy(dev_addr, p_msc->ep_out);
-  return !epin_busy && !epout_busy;
+  return p_msc->stage == MSC_STAGE_IDLE && !epin_busy && !epout_busy;
 }
 
 //--------------------------------------------------------------------+
@@ -120,27 +172,206 @@ static inline void cbw_init(msc_cbw_t* cbw, uint8_t lun) {
   cbw->lun       = lun;
 }
 
+// Invoke complete callback of a command which did not finish its status stage
+static void cmd_complete_failed(uint8_t daddr, msc_cbw_t const* cbw, void* data, uint32_t data_residue,
+                                tuh_msc_complete_cb_t complete_cb, uintptr_t arg) {
+  if (complete_cb != NULL) {
+    msc_csw_t const csw = {
+        .signature    = MSC_CSW_SIGNATURE,
+        .tag          = cbw->tag,
+        .data_residue = data_residue,
+        .status       = MSC_CSW_STATUS_FAILED
+    };
+    tuh_msc_complete_data_t const cb_data = {
+        .cbw = cbw,
+        .csw = &csw,
+        .scsi_data = data,
+        .user_arg = arg
+    };
+    (void) complete_cb(daddr, &cb_data);
+  }
+}
+
+// Send CBW of a command, stage must already be claimed (set to MSC_STAGE_CMD)
+static bool cmd_submit(uint8_t daddr, msc_cbw_t const* cbw, void* data, tuh_msc_complete_cb_t complete_cb,
+                       uintptr_t arg) {
+  msch_interface_t* p_msc = get_itf(daddr);
+  msch_epbuf_t* epbuf = get_epbuf(daddr);
+
+  // claim endpoint
+  if (usbh_edpt_claim(daddr, p_msc->ep_out)) {
+    epbuf->cbw = *cbw;
+    p_msc->buffer = data;
+    p_msc->complete_cb = complete_cb;
+    p_msc->complete_arg = arg;
+    p_msc->data_xferred = 0;
+
+    if (usbh_edpt_xfer(daddr, p_msc->ep_out, (uint8_t*) &epbuf->cbw, sizeof(msc_cbw_t))) {
+      return true;
+    }
+    (void) usbh_edpt_release(daddr, p_msc->ep_out);
+  }
+
+  p_msc->stage = MSC_STAGE_IDLE;
+  return false;
+}
+
+// Start next queued command if interface is idle. Invoked on CSW completion to keep bulk pipe busy
+static void cmd_queue_next(uint8_t daddr) {
+#if CFG_TUH_MSC_QUEUE_DEPTH
+  msch_interface_t* p_msc = get_itf(daddr);
+
+  while (true) {
+    msch_cmd_t cmd;
+    bool has_cmd = false;
+
+    (void) osal_mutex_lock(_msch_mutex, OSAL_TIMEOUT_WAIT_FOREVER);
+    if (p_msc->stage == MSC_STAGE_IDLE && tu_fifo_read_n(&p_msc->cmd_ff, &cmd, sizeof(cmd)) == sizeof(cmd)) {
+      p_msc->stage = MSC_STAGE_CMD;
+      has_cmd = true;
+    }
+    (void) osal_mutex_unlock(_msch_mutex);
+
+    if (!has_cmd) {
+      return; // nothing to do
+    }
+
+    if (cmd_submit(daddr, &cmd.cbw, cmd.buffer, cmd.complete_cb, cmd.complete_arg)) {
+      return; // command kicked-off, we are done
+    }
+
+    // complete callback as failed and continue with next queued command
+    cmd_complete_failed(daddr, &cmd.cbw, cmd.buffer, cmd.cbw.total_bytes, cmd.complete_cb, cmd.complete_arg);
+  }
+#else
+  (void) daddr;
+#endif
+}
+
+// Complete active command as failed and release interface. Next queued command is started if still configured
+static void cmd_fail_active(uint8_t daddr) {
+  msch_interface_t* p_msc = get_itf(daddr);
+  msc_cbw_t const cbw = get_epbuf(daddr)->cbw;
+  void* const data = p_msc->buffer;
+  uint32_t const data_residue = cbw.total_bytes - tu_min32(p_msc->data_xferred, cbw.total_bytes);
+  tuh_msc_complete_cb_t const complete_cb = p_msc->complete_cb;
+  uintptr_t const arg = p_msc->complete_arg;
+
+  p_msc->stage = MSC_STAGE_IDLE;
+  if (p_msc->configured) {
+    cmd_queue_next(daddr);
+  }
+
+  cmd_complete_failed(daddr, &cbw, data, data_residue, complete_cb, arg);
+}
+
+static void recovery_complete(tuh_xfer_t* xfer);
+
+static bool recovery_request(uint8_t daddr, uint8_t step) {
+  msch_interface_t* p_msc = get_itf(daddr);
+  tusb_control_request_t request;
+
+  if (step == MSC_RECOVERY_RESET) {
+    // Bulk-Only Mass Storage Reset
+    request = (tusb_control_request_t) {
+        .bmRequestType_bit = {
+            .recipient = TUSB_REQ_RCPT_INTERFACE,
+            .type      = TUSB_REQ_TYPE_CLASS,
+            .direction = TUSB_DIR_OUT
+        },
+        .bRequest = MSC_REQ_RESET,
+        .wValue   = 0,
+        .wIndex   = p_msc->itf_num,
+        .wLength  = 0
+    };
+  } else {
+    request = (tusb_control_request_t) {
+        .bmRequestType_bit = {
+            .recipient = TUSB_REQ_RCPT_ENDPOINT,
+            .type      = TUSB_REQ_TYPE_STANDARD,
+            .direction = TUSB_DIR_OUT
+        },
+        .bRequest = TUSB_REQ_CLEAR_FEATURE,
+        .wValue   = TUSB_REQ_FEATURE_EDPT_HALT,
+        .wIndex   = (step == MSC_RECOVERY_CLEAR_IN) ? p_msc->ep_in : p_msc->ep_out,
+        .wLength  = 0
+    };
+  }
+
+  tuh_xfer_t xfer = {
+      .daddr       = daddr,
+      .ep_addr     = 0,
+      .setup       = &request,
+      .buffer      = NULL,
+      .complete_cb = recovery_complete,
+      .user_data   = step
+  };
+
+  return tuh_control_xfer(&xfer);
+}
+
+static void recovery_complete(tuh_xfer_t* xfer) {
+  uint8_t const daddr = xfer->daddr;
+  uint8_t const step = (uint8_t) xfer->user_data;
+  msch_interface_t* p_msc = get_itf(daddr);
+  TU_VERIFY(p_msc->configured && p_msc->stage == MSC_STAGE_RECOVERY,); // closed meanwhile
+
+  if (xfer->result == XFER_RESULT_SUCCESS && step != MSC_RECOVERY_RESET) {
+    (void) usbh_edpt_clear_stall(daddr, (step == MSC_RECOVERY_CLEAR_IN) ? p_msc->ep_in : p_msc->ep_out);
+  }
+
+  // pipe may not be halted and reject CLEAR_FEATURE, carry on with remaining steps anyway
+  if (step < MSC_RECOVERY_CLEAR_OUT && recovery_request(daddr, step + 1)) {
+    return;
+  }
+
+  TU_LOG_DRV("  MSCh reset recovery done\r\n");
+  cmd_fail_active(daddr);
+}
+
+// Active command failed mid-way e.g transfer error or invalid CSW. Do reset recovery so that device and both bulk
+// pipes are back in sync, then complete command as failed and start next queued one
+static void cmd_abort(uint8_t daddr) {
+  msch_interface_t* p_msc = get_itf(daddr);
+  TU_LOG_DRV("  MSCh command failed at stage %u\r\n", p_msc->stage);
+
+  p_msc->stage = MSC_STAGE_RECOVERY;
+  if (!recovery_request(daddr, MSC_RECOVERY_RESET)) {
+    cmd_fail_active(daddr); // control queue full or device gone
+  }
+}
+
 bool tuh_msc_scsi_command(uint8_t daddr, msc_cbw_t const* cbw, void* data,
                           tuh_msc_complete_cb_t complete_cb, uintptr_t arg) {
   msch_interface_t* p_msc = get_itf(daddr);
   TU_VERIFY(p_msc->configured);
 
-  // claim endpoint
-  TU_VERIFY(usbh_edpt_claim(daddr, p_msc->ep_out));
-  msch_epbuf_t* epbuf = get_epbuf(daddr);
-
-  epbuf->cbw = *cbw;
-  p_msc->buffer = data;
-  p_msc->complete_cb = complete_cb;
-  p_msc->complete_arg = arg;
-  p_msc->stage = MSC_STAGE_CMD;
+  // Start command if idle, otherwise queue it. Test-and-{claim|enqueue} is one critical section so that a command
+  // completing in between cannot strand this one in the queue.
+  bool claimed = false;
+  bool is_queued = false;
+  (void) osal_mutex_lock(_msch_mutex, OSAL_TIMEOUT_WAIT_FOREVER);
+  if (p_msc->stage == MSC_STAGE_IDLE) {
+    p_msc->stage = MSC_STAGE_CMD;
+    claimed = true;
+  } else {
+    #if CFG_TUH_MSC_QUEUE_DEPTH
+    msch_cmd_t const cmd = {
+        .cbw          = *cbw,
+        .buffer       = data,
+        .complete_cb  = complete_cb,
+        .complete_arg = arg
+    };
+    is_queued = tu_fifo_write_n(&p_msc->cmd_ff, &cmd, sizeof(cmd)) == sizeof(cmd);
+    #endif
+  }
+  (void) osal_mutex_unlock(_msch_mutex);
 
-  if (!usbh_edpt_xfer(daddr, p_msc->ep_out, (uint8_t*) &epbuf->cbw, sizeof(msc_cbw_t))) {
-    (void) usbh_edpt_release(daddr, p_msc->ep_out);
-    return false;
+  if (!claimed) {
+    return is_queued;
   }
 
-  return true;
+  return cmd_submit(daddr, cbw, data, complete_cb, arg);
 }
 
 bool tuh_msc_read_capacity(uint8_t dev_addr, uint8_t lun, scsi_read_capacity10_resp_t* response,
@@ -159,6 +390,28 @@ bool tuh_msc_read_capacity(uint8_t dev_addr, uint8_t lun, scsi_read_capacity10_r
   return tuh_msc_scsi_command(dev_addr, &cbw, response, complete_cb, arg);
 }
 
+bool tuh_msc_read_capacity16(uint8_t dev_addr, uint8_t lun, scsi_read_capacity16_resp_t* response,
+                             tuh_msc_complete_cb_t complete_cb, uintptr_t arg) {
+  msch_interface_t* p_msc = get_itf(dev_addr);
+  TU_VERIFY(p_msc->configured);
+
+  msc_cbw_t cbw;
+  cbw_init(&cbw, lun);
+
+  cbw.total_bytes = sizeof(scsi_read_capacity16_resp_t);
+  cbw.dir         = TUSB_DIR_IN_MASK;
+  cbw.cmd_len     = sizeof(scsi_read_capacity16_t);
+
+  scsi_read_capacity16_t const cmd_capa16 = {
+      .cmd_code       = SCSI_CMD_SERVICE_ACTION_IN_16,
+      .service_action = SCSI_SERVICE_ACTION_READ_CAPACITY_16,
+      .alloc_length   = tu_htonl(sizeof(scsi_read_capacity16_resp_t))
+  };
+  memcpy(cbw.command, &cmd_capa16, cbw.cmd_len); //-V1086
+
+  return tuh_msc_scsi_command(dev_addr, &cbw, response, complete_cb, arg);
+}
+
 bool tuh_msc_inquiry(uint8_t dev_addr, uint8_t lun, scsi_inquiry_resp_t* response,
                      tuh_msc_complete_cb_t complete_cb, uintptr_t arg) {
   msch_interface_t* p_msc = get_itf(dev_addr);
@@ -219,10 +472,14 @@ bool tuh_msc_read10(uint8_t dev_addr, uint8_t lun, void* buffer, uint32_t lba, u
   msch_interface_t* p_msc = get_itf(dev_addr);
   TU_VERIFY(p_msc->mounted);
 
+  // data length of CBW must match transfer length of CDB
+  uint32_t const block_size = p_msc->capacity[lun].block_size;
+  TU_VERIFY(block_size == 0 || block_count <= UINT32_MAX / block_size);
+
   msc_cbw_t cbw;
   cbw_init(&cbw, lun);
 
-  cbw.total_bytes = block_count * p_msc->capacity[lun].block_size;
+  cbw.total_bytes = block_count * block_size;
   cbw.dir = TUSB_DIR_IN_MASK;
   cbw.cmd_len = sizeof(scsi_read10_t);
 
@@ -241,10 +498,14 @@ bool tuh_msc_write10(uint8_t dev_addr, uint8_t lun, void const* buffer, uint32_t
   msch_interface_t* p_msc = get_itf(dev_addr);
   TU_VERIFY(p_msc->mounted);
 
+  // data length of CBW must match transfer length of CDB
+  uint32_t const block_size = p_msc->capacity[lun].block_size;
+  TU_VERIFY(block_size == 0 || block_count <= UINT32_MAX / block_size);
+
   msc_cbw_t cbw;
   cbw_init(&cbw, lun);
 
-  cbw.total_bytes = block_count * p_msc->capacity[lun].block_size;
+  cbw.total_bytes = block_count * block_size;
   cbw.dir         = TUSB_DIR_OUT;
   cbw.cmd_len     = sizeof(scsi_write10_t);
 
@@ -258,6 +519,73 @@ bool tuh_msc_write10(uint8_t dev_addr, uint8_t lun, void const* buffer, uint32_t
   return tuh_msc_scsi_command(dev_addr, &cbw, (void*) (uintptr_t) buffer, complete_cb, arg);
 }
 
+bool tuh_msc_read16(uint8_t dev_addr, uint8_t lun, void* buffer, uint64_t lba, uint32_t block_count,
+                    tuh_msc_complete_cb_t complete_cb, uintptr_t arg) {
+  msch_interface_t* p_msc = get_itf(dev_addr);
+  TU_VERIFY(p_msc->mounted);
+
+  // data length of CBW must match transfer length of CDB
+  uint32_t const block_size = p_msc->capacity[lun].block_size;
+  TU_VERIFY(block_size == 0 || block_count <= UINT32_MAX / block_size);
+
+  msc_cbw_t cbw;
+  cbw_init(&cbw, lun);
+
+  cbw.total_bytes = block_count * block_size;
+  cbw.dir = TUSB_DIR_IN_MASK;
+  cbw.cmd_len = sizeof(scsi_read16_t);
+
+  scsi_read16_t const cmd_read16 = {
+      .cmd_code    = SCSI_CMD_READ_16,
+      .lba         = tu_htonll(lba),
+      .block_count = tu_htonl(block_count)
+  };
+  memcpy(cbw.command, &cmd_read16, cbw.cmd_len); //-V1086
+
+  return tuh_msc_scsi_command(dev_addr, &cbw, buffer, complete_cb, arg);
+}
+
+bool tuh_msc_write16(uint8_t dev_addr, uint8_t lun, void const* buffer, uint64_t lba, uint32_t block_count,
+                     tuh_msc_complete_cb_t complete_cb, uintptr_t arg) {
+  msch_interface_t* p_msc = get_itf(dev_addr);
+  TU_VERIFY(p_msc->mounted);
+
+  // data length of CBW must match transfer length of CDB
+  uint32_t const block_size = p_msc->capacity[lun].block_size;
+  TU_VERIFY(block_size == 0 || block_count <= UINT32_MAX / block_size);
+
+  msc_cbw_t cbw;
+  cbw_init(&cbw, lun);
+
+  cbw.total_bytes = block_count * block_size;
+  cbw.dir         = TUSB_DIR_OUT;
+  cbw.cmd_len     = sizeof(scsi_write16_t);
+
+  scsi_write16_t const cmd_write16 = {
+      .cmd_code    = SCSI_CMD_WRITE_16,
+      .lba         = tu_htonll(lba),
+      .block_count = tu_htonl(block_count)
+  };
+  memcpy(cbw.command, &cmd_write16, cbw.cmd_len); //-V1086
+
+  return tuh_msc_scsi_command(dev_addr, &cbw, (void*) (uintptr_t) buffer, complete_cb, arg);
+}
+
+bool tuh_msc_sync_cache(uint8_t dev_addr, uint8_t lun, tuh_msc_complete_cb_t complete_cb, uintptr_t arg) {
+  msch_interface_t* p_msc = get_itf(dev_addr);
+  TU_VERIFY(p_msc->mounted);
+
+  msc_cbw_t cbw;
+  cbw_init(&cbw, lun);
+
+  cbw.total_bytes = 0;
+  cbw.dir         = TUSB_DIR_OUT;
+  cbw.cmd_len     = 10;
+  cbw.command[0]  = SCSI_CMD_SYNCHRONIZE_CACHE_10; // lba = 0 and block count = 0: whole medium
+
+  return tuh_msc_scsi_command(dev_addr, &cbw, NULL, complete_cb, arg);
+}
+
 #if 0
 // MSC interface Reset (not used now)
 bool tuh_msc_reset(uint8_t dev_addr) {
@@ -283,10 +611,23 @@ bool msch_init(void) {
   TU_LOG_DRV("sizeof(msch_interface_t) = %u\r\n", sizeof(msch_interface_t));
   TU_LOG_DRV("sizeof(msch_epbuf_t) = %u\r\n", sizeof(msch_epbuf_t));
   tu_memclr(_msch_itf, sizeof(_msch_itf));
+
+  #if OSAL_MUTEX_REQUIRED
+  _msch_mutex = osal_mutex_create(&_msch_mutexdef);
+  TU_ASSERT(_msch_mutex);
+  #endif
+
   return true;
 }
 
 bool msch_deinit(void) {
+  #if OSAL_MUTEX_REQUIRED
+  if (_msch_mutex) {
+    osal_mutex_delete(_msch_mutex);
+    _msch_mutex = NULL;
+  }
+  #endif
+
   return true;
 }
 
@@ -302,6 +643,33 @@ void msch_close(uint8_t dev_addr) {
     tuh_msc_umount_cb(dev_addr);
   }
 
+  #if CFG_TUH_MSC_CACHE
+  msch_cache_close(dev_addr);
+  #endif
+
+  // new commands are rejected from now on
+  p_msc->configured = false;
+  p_msc->mounted = false;
+
+  // complete active command as failed, its transfer or recovery callback will never come
+  if (p_msc->stage != MSC_STAGE_IDLE) {
+    cmd_fail_active(dev_addr);
+  }
+
+  #if CFG_TUH_MSC_QUEUE_DEPTH
+  // complete queued commands as failed
+  while (true) {
+    msch_cmd_t cmd;
+    (void) osal_mutex_lock(_msch_mutex, OSAL_TIMEOUT_WAIT_FOREVER);
+    bool const has_cmd = (tu_fifo_read_n(&p_msc->cmd_ff, &cmd, sizeof(cmd)) == sizeof(cmd));
+    (void) osal_mutex_unlock(_msch_mutex);
+    if (!has_cmd) {
+      break;
+    }
+    cmd_complete_failed(dev_addr, &cmd.cbw, cmd.buffer, cmd.cbw.total_bytes, cmd.complete_cb, cmd.complete_arg);
+  }
+  #endif
+
   tu_memclr(p_msc, sizeof(msch_interface_t));
 }
 
@@ -314,35 +682,67 @@ bool msch_xfer_cb(uint8_t dev_addr, uint8_t ep_addr, xfer_result_t event, uint32
   switch (p_msc->stage) {
     case MSC_STAGE_CMD:
       // Must be Command Block
-      TU_ASSERT(ep_addr == p_msc->ep_out && event == XFER_RESULT_SUCCESS && xferred_bytes == sizeof(msc_cbw_t));
+      if (ep_addr != p_msc->ep_out || event != XFER_RESULT_SUCCESS || xferred_bytes != sizeof(msc_cbw_t)) {
+        cmd_abort(dev_addr);
+        break;
+      }
       if (cbw->total_bytes && p_msc->buffer) {
         // Data stage if any
         p_msc->stage = MSC_STAGE_DATA;
-        uint8_t const ep_data = (cbw->dir & TUSB_DIR_IN_MASK) ? p_msc->ep_in : p_msc->ep_out;
-        TU_ASSERT(usbh_edpt_xfer(dev_addr, ep_data, p_msc->buffer, (uint16_t) cbw->total_bytes));
+        if (!data_stage_xfer(dev_addr, p_msc, cbw)) {
+          cmd_abort(dev_addr);
+        }
         break;
       }
       TU_ATTR_FALLTHROUGH; // fallthrough to data stage
 
     case MSC_STAGE_DATA:
+      if (p_msc->stage == MSC_STAGE_DATA) {
+        // large data stage is split into multiple transfers, continue unless short packet or error
+        const bool is_full_chunk = (xferred_bytes == tu_min32(cbw->total_bytes - p_msc->data_xferred, MSCH_DATA_XFER_MAX));
+        p_msc->data_xferred += xferred_bytes;
+        if (event == XFER_RESULT_SUCCESS && is_full_chunk && p_msc->data_xferred < cbw->total_bytes) {
+          if (!data_stage_xfer(dev_addr, p_msc, cbw)) {
+            cmd_abort(dev_addr);
+          }
+          break;
+        }
+      }
+
       // Status stage
       p_msc->stage = MSC_STAGE_STATUS;
-      TU_ASSERT(usbh_edpt_xfer(dev_addr, p_msc->ep_in, (uint8_t*) csw, (uint16_t) sizeof(msc_csw_t)));
+      if (!usbh_edpt_xfer(dev_addr, p_msc->ep_in, (uint8_t*) csw, (uint16_t) sizeof(msc_csw_t))) {
+        cmd_abort(dev_addr);
+      }
       break;
 
-    case MSC_STAGE_STATUS:
-      // SCSI op is complete
+    case MSC_STAGE_STATUS: {
+      if (event != XFER_RESULT_SUCCESS || xferred_bytes != sizeof(msc_csw_t) ||
+          csw->signature != MSC_CSW_SIGNATURE || csw->tag != cbw->tag ||
+          csw->status == MSC_CSW_STATUS_PHASE_ERROR) {
+        cmd_abort(dev_addr); // no valid CSW or phase error
+        break;
+      }
+
+      // SCSI op is complete. Save its result since next queued command is started before invoking callback
+      msc_cbw_t const cbw_done = *cbw;
+      msc_csw_t const csw_done = *csw;
+      tuh_msc_complete_cb_t const complete_cb = p_msc->complete_cb;
+      tuh_msc_complete_data_t const cb_data = {
+          .cbw = &cbw_done,
+          .csw = &csw_done,
+          .scsi_data = p_msc->buffer,
+          .user_arg = p_msc->complete_arg
+      };
+
       p_msc->stage = MSC_STAGE_IDLE;
-      if (p_msc->complete_cb != NULL) {
-        tuh_msc_complete_data_t const cb_data = {
-            .cbw = cbw,
-            .csw = csw,
-            .scsi_data = p_msc->buffer,
-            .user_arg = p_msc->complete_arg
-        };
-        (void) p_msc->complete_cb(dev_addr, &cb_data);
+      cmd_queue_next(dev_addr);
+
+      if (complete_cb != NULL) {
+        (void) complete_cb(dev_addr, &cb_data);
       }
       break;
+    }
 
     default:
       // unknown state
@@ -359,6 +759,8 @@ static void config_get_maxlun_complete(tuh_xfer_t* xfer);
 static bool config_test_unit_ready_complete(uint8_t dev_addr, tuh_msc_complete_data_t const* cb_data);
 static bool config_request_sense_complete(uint8_t dev_addr, tuh_msc_complete_data_t const* cb_data);
 static bool config_read_capacity_complete(uint8_t dev_addr, tuh_msc_complete_data_t const* cb_data);
+static bool config_read_capacity16_complete(uint8_t dev_addr, tuh_msc_complete_data_t const* cb_data);
+static void config_mount_complete(uint8_t dev_addr);
 
 uint16_t msch_open(uint8_t rhport, uint8_t dev_addr, const tusb_desc_interface_t *desc_itf, uint16_t max_len) {
   (void) rhport;
@@ -387,6 +789,10 @@ uint16_t msch_open(uint8_t rhport, uint8_t dev_addr, const tusb_desc_interface_t
 
   p_msc->itf_num = desc_itf->bInterfaceNumber;
 
+  #if CFG_TUH_MSC_QUEUE_DEPTH
+  (void) tu_fifo_config(&p_msc->cmd_ff, p_msc->cmd_ff_buf, sizeof(p_msc->cmd_ff_buf), false);
+  #endif
+
   return drv_len;
 }
 
@@ -482,17 +888,50 @@ static bool config_read_capacity_complete(uint8_t dev_addr, tuh_msc_complete_dat
 
   // Capacity response field: Block size and Last LBA are both Big-Endian
   scsi_read_capacity10_resp_t* resp = (scsi_read_capacity10_resp_t*) (uintptr_t) enum_buf;
-  p_msc->capacity[cbw->lun].block_count = (uint32_t) (tu_ntohl(resp->last_lba) + 1u);
+  const uint32_t last_lba = tu_ntohl(resp->last_lba);
+  p_msc->capacity[cbw->lun].block_count = (uint64_t) last_lba + 1u;
   p_msc->capacity[cbw->lun].block_size  = tu_ntohl(resp->block_size);
 
+  if (last_lba == UINT32_MAX) {
+    // capacity does not fit into 32-bit, use READ CAPACITY (16)
+    TU_LOG_DRV("SCSI Read Capacity (16)\r\n");
+    TU_ASSERT(tuh_msc_read_capacity16(dev_addr, cbw->lun, (scsi_read_capacity16_resp_t*) (uintptr_t) enum_buf,
+                                      config_read_capacity16_complete, 0));
+    return true;
+  }
+
+  config_mount_complete(dev_addr);
+  return true;
+}
+
+static bool config_read_capacity16_complete(uint8_t dev_addr, tuh_msc_complete_data_t const* cb_data) {
+  msc_cbw_t const* cbw = cb_data->cbw;
+  msc_csw_t const* csw = cb_data->csw;
+  msch_interface_t* p_msc = get_itf(dev_addr);
+  uint8_t* enum_buf = usbh_get_enum_buf();
+
+  if (csw->status == 0) {
+    scsi_read_capacity16_resp_t* resp = (scsi_read_capacity16_resp_t*) (uintptr_t) enum_buf;
+    p_msc->capacity[cbw->lun].block_count = tu_ntohll(resp->last_lba) + 1u;
+    p_msc->capacity[cbw->lun].block_size  = tu_ntohl(resp->block_size);
+  } else {
+    // keep 32-bit capacity from READ CAPACITY (10)
+    TU_LOG_DRV("  Read Capacity (16) failed\r\n");
+  }
+
+  config_mount_complete(dev_addr);
+  return true;
+}
+
+static void config_mount_complete(uint8_t dev_addr) {
+  msch_interface_t* p_msc = get_itf(dev_addr);
+
   // Mark enumeration is complete
   p_msc->mounted = true;
   tuh_msc_mount_cb(dev_addr);
 
   // notify usbh that driver enumeration is complete
   usbh_driver_set_config_complete(dev_addr, p_msc->itf_num);
-
-  return true;
 }
 
 #endif
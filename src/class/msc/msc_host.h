@@ -22,6 +22,12 @@ extern "C" {
   #define CFG_TUH_MSC_MAXLUN 4
 #endif
 
+// Number of SCSI commands per device that can be queued while another one is in progress. Queued commands are
+// issued in order on CSW completion. 0 disables queue: command API fails while interface is busy.
+#ifndef CFG_TUH_MSC_QUEUE_DEPTH
+  #define CFG_TUH_MSC_QUEUE_DEPTH 4
+#endif
+
 typedef struct {
   const msc_cbw_t *cbw;       // SCSI command
   const msc_csw_t *csw;       // SCSI status
@@ -39,21 +45,27 @@ typedef bool (*tuh_msc_complete_cb_t)(uint8_t dev_addr, const tuh_msc_complete_d
 // This function true after tuh_msc_mounted_cb() and false after tuh_msc_unmounted_cb()
 bool tuh_msc_mounted(uint8_t dev_addr);
 
-// Check if the interface is currently ready or busy transferring data
+// Check if the interface is idle: no command in progress or queued
 bool tuh_msc_ready(uint8_t dev_addr);
 
 // Get Max Lun
 uint8_t tuh_msc_get_maxlun(uint8_t dev_addr);
 
-// Get number of block
+// Get number of block, clamped to UINT32_MAX for device larger than 2^32 blocks
 uint32_t tuh_msc_get_block_count(uint8_t dev_addr, uint8_t lun);
 
+// Get number of block as 64-bit, capacity is retrieved with READ CAPACITY (16) if needed
+uint64_t tuh_msc_get_block_count64(uint8_t dev_addr, uint8_t lun);
+
 // Get block size in bytes
 uint32_t tuh_msc_get_block_size(uint8_t dev_addr, uint8_t lun);
 
 // Perform a full SCSI command (cbw, data, csw) in non-blocking manner.
 // Complete callback is invoked when SCSI op is complete.
-// return true if success, false if there is already pending operation.
+// If another command is in progress, this one is queued and issued once previous ones complete.
+// On transport error, reset recovery is done before callback is invoked with failed status. Active and queued commands
+// are also completed as failed when device is unplugged.
+// return true if success, false if interface is busy and command queue is full.
 // NOTE: buffer must be accessible by USB/DMA controller, aligned correctly and multiple of cache line if enabled
 bool tuh_msc_scsi_command(uint8_t daddr, const msc_cbw_t *cbw, void *data, tuh_msc_complete_cb_t complete_cb,
                           uintptr_t arg);
@@ -86,6 +98,22 @@ bool tuh_msc_read10(uint8_t dev_addr, uint8_t lun, void *buffer, uint32_t lba, u
 bool tuh_msc_write10(uint8_t dev_addr, uint8_t lun, const void *buffer, uint32_t lba, uint16_t block_count,
                      tuh_msc_complete_cb_t complete_cb, uintptr_t arg);
 
+// Perform SCSI Read 16 command. Read n blocks starting from 64-bit LBA to buffer
+// Complete callback is invoked when SCSI op is complete.
+// NOTE: buffer must be accessible by USB/DMA controller, aligned correctly and multiple of cache line if enabled
+bool tuh_msc_read16(uint8_t dev_addr, uint8_t lun, void *buffer, uint64_t lba, uint32_t block_count,
+                    tuh_msc_complete_cb_t complete_cb, uintptr_t arg);
+
+// Perform SCSI Write 16 command. Write n blocks starting from 64-bit LBA to device
+// Complete callback is invoked when SCSI op is complete.
+// NOTE: buffer must be accessible by USB/DMA controller, aligned correctly and multiple of cache line if enabled
+bool tuh_msc_write16(uint8_t dev_addr, uint8_t lun, const void *buffer, uint64_t lba, uint32_t block_count,
+                     tuh_msc_complete_cb_t complete_cb, uintptr_t arg);
+
+// Perform SCSI Synchronize Cache 10 command for the whole medium, e.g before device is removed
+// Complete callback is invoked when SCSI op is complete.
+bool tuh_msc_sync_cache(uint8_t dev_addr, uint8_t lun, tuh_msc_complete_cb_t complete_cb, uintptr_t arg);
+
 // Perform SCSI Read Capacity 10 command
 // Complete callback is invoked when SCSI op is complete.
 // Note: during enumeration, host stack already carried out this request. Application can retrieve capacity by
@@ -93,6 +121,12 @@ bool tuh_msc_write10(uint8_t dev_addr, uint8_t lun, const void *buffer, uint32_t
 bool tuh_msc_read_capacity(uint8_t dev_addr, uint8_t lun, scsi_read_capacity10_resp_t *response,
                            tuh_msc_complete_cb_t complete_cb, uintptr_t arg);
 
+// Perform SCSI Read Capacity 16 command
+// Complete callback is invoked when SCSI op is complete.
+// Note: during enumeration, host stack already issues this if Read Capacity 10 reports 0xFFFFFFFF as last LBA
+bool tuh_msc_read_capacity16(uint8_t dev_addr, uint8_t lun, scsi_read_capacity16_resp_t *response,
+                             tuh_msc_complete_cb_t complete_cb, uintptr_t arg);
+
 //------------- Application Callback -------------//
 
 // Invoked when a device with MassStorage interface is mounted
@@ -0,0 +1,531 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2019 Ha Thach (tinyusb.org)
+ * SPDX-License-Identifier: MIT
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#include "tusb_option.h"
+
+#if CFG_TUH_ENABLED && CFG_TUH_MSC && CFG_TUH_MSC_CACHE
+
+#include "host/usbh.h"
+#include "host/usbh_pvt.h"
+
+#include "msc_host_cache.h"
+
+TU_VERIFY_STATIC(CFG_TUH_MSC_CACHE_LINE_SIZE >= 512 && (CFG_TUH_MSC_CACHE_LINE_SIZE % 512) == 0,
+                 "Cache line size must be multiple of 512");
+TU_VERIFY_STATIC(CFG_TUH_MSC_CACHE_WAYS >= 1, "Cache must have at least 1 way");
+
+//--------------------------------------------------------------------+
+// MACRO CONSTANT TYPEDEF
+//--------------------------------------------------------------------+
+enum {
+  OP_NONE = 0,
+  OP_READ,
+  OP_WRITE,
+  OP_SYNC,
+  OP_DONE,
+};
+
+enum {
+  IO_FETCH = 0, // read line for user operation
+  IO_PREFETCH,  // read-ahead line
+  IO_WRITEBACK, // write dirty line
+  IO_SYNC,      // SYNCHRONIZE CACHE
+};
+
+// Line metadata, stored in arena after line data
+typedef struct {
+  uint64_t lba;  // first block of line
+  uint32_t lru;  // access stamp, smallest is least recently used
+  uint8_t daddr;
+  uint8_t lun;
+  uint8_t valid;
+  uint8_t dirty;
+} cache_line_t;
+
+typedef struct {
+  uint8_t state;
+  uint8_t daddr;
+  uint8_t lun;
+  bool success;
+  uint8_t* buffer;
+  uint64_t lba;
+  uint32_t count;      // remaining blocks
+  uint16_t sync_index; // next line to check for write back
+  bool sync_sent;
+  tuh_msc_cache_cb_t complete_cb;
+  uintptr_t arg;
+} cache_op_t;
+
+typedef struct {
+  uint8_t* data;
+  cache_line_t* lines;
+  uint16_t line_count;
+  uint16_t ways;
+  uint16_t set_count;
+  uint32_t stamp;
+
+  cache_op_t op;
+
+  // Cache I/O in flight, at most one at a time
+  struct {
+    bool active;
+    uint8_t kind;
+    uint8_t daddr;
+    uint16_t line;
+  } io;
+
+  // Read-ahead: next_lba is end of previous read, prefetch [lba, end) once sequential access is detected
+  struct {
+    uint8_t daddr;
+    uint8_t lun;
+    uint64_t next_lba;
+    uint64_t lba;
+    uint64_t end;
+  } ra;
+} msch_cache_t;
+
+static msch_cache_t _cache;
+
+#if OSAL_MUTEX_REQUIRED
+static osal_mutex_def_t _cache_mutexdef;
+static osal_mutex_t _cache_mutex;
+#else
+#define _cache_mutex   NULL
+#endif
+
+static bool cache_io_complete(uint8_t daddr, tuh_msc_complete_data_t const* cb_data);
+
+//--------------------------------------------------------------------+
+// Line Helper
+//--------------------------------------------------------------------+
+TU_ATTR_ALWAYS_INLINE static inline uint8_t* line_data(uint16_t idx) {
+  return _cache.data + (uint32_t) idx * CFG_TUH_MSC_CACHE_LINE_SIZE;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline uint32_t blocks_per_line(uint8_t daddr, uint8_t lun) {
+  return CFG_TUH_MSC_CACHE_LINE_SIZE / tuh_msc_get_block_size(daddr, lun);
+}
+
+// Number of blocks held by line, last line of device can be partial
+static uint32_t line_blocks(uint8_t daddr, uint8_t lun, uint64_t line_lba) {
+  uint64_t const block_count = tuh_msc_get_block_count64(daddr, lun);
+  return (uint32_t) tu_min64(blocks_per_line(daddr, lun), block_count - line_lba);
+}
+
+static uint16_t line_set_first(uint8_t daddr, uint8_t lun, uint64_t line_lba) {
+  uint64_t const line_no = line_lba / blocks_per_line(daddr, lun);
+  uint16_t const set = (uint16_t) ((line_no ^ daddr ^ ((uint64_t) lun << 4)) % _cache.set_count);
+  return (uint16_t) (set * _cache.ways);
+}
+
+static void line_touch(uint16_t idx) {
+  _cache.lines[idx].lru = ++_cache.stamp;
+}
+
+// Return line index holding line_lba or -1 if not cached
+static int32_t line_find(uint8_t daddr, uint8_t lun, uint64_t line_lba) {
+  uint16_t const first = line_set_first(daddr, lun, line_lba);
+  for (uint16_t i = first; i < first + _cache.ways; i++) {
+    cache_line_t const* line = &_cache.lines[i];
+    if (line->valid && line->daddr == daddr && line->lun == lun && line->lba == line_lba) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+// Pick line to replace in set: invalid one first, then least recently used. Prefetch only replaces clean line
+static int32_t line_victim(uint8_t daddr, uint8_t lun, uint64_t line_lba, bool clean_only) {
+  uint16_t const first = line_set_first(daddr, lun, line_lba);
+  int32_t victim = -1;
+  for (uint16_t i = first; i < first + _cache.ways; i++) {
+    cache_line_t const* line = &_cache.lines[i];
+    if (!line->valid) {
+      return i;
+    }
+    if (clean_only && line->dirty) {
+      continue;
+    }
+    if (victim < 0 || line->lru < _cache.lines[victim].lru) {
+      victim = i;
+    }
+  }
+  return victim;
+}
+
+// Read or write a whole line, 16-byte commands are only used when needed
+static bool line_io(uint8_t kind, uint16_t idx) {
+  cache_line_t const* line = &_cache.lines[idx];
+  uint32_t const count = line_blocks(line->daddr, line->lun, line->lba);
+  bool const is_write = (kind == IO_WRITEBACK);
+  bool const use16 = (line->lba + count > UINT32_MAX) || (count > UINT16_MAX);
+  bool ret;
+
+  _cache.io.active = true;
+  _cache.io.kind = kind;
+  _cache.io.daddr = line->daddr;
+  _cache.io.line = idx;
+
+  if (is_write) {
+    ret = use16 ? tuh_msc_write16(line->daddr, line->lun, line_data(idx), line->lba, count, cache_io_complete, 0) :
+                  tuh_msc_write10(line->daddr, line->lun, line_data(idx), (uint32_t) line->lba, (uint16_t) count,
+                                  cache_io_complete, 0);
+  } else {
+    ret = use16 ? tuh_msc_read16(line->daddr, line->lun, line_data(idx), line->lba, count, cache_io_complete, 0) :
+                  tuh_msc_read10(line->daddr, line->lun, line_data(idx), (uint32_t) line->lba, (uint16_t) count,
+                                 cache_io_complete, 0);
+  }
+
+  if (!ret) {
+    _cache.io.active = false;
+  }
+  return ret;
+}
+
+// Assign line to a new lba and read it from device
+static bool line_fetch(uint8_t kind, uint16_t idx, uint8_t daddr, uint8_t lun, uint64_t line_lba) {
+  cache_line_t* line = &_cache.lines[idx];
+  line->daddr = daddr;
+  line->lun = lun;
+  line->lba = line_lba;
+  line->valid = 0; // valid once read is complete
+  line->dirty = 0;
+  line_touch(idx);
+  return line_io(kind, idx);
+}
+
+//--------------------------------------------------------------------+
+// Engine
+//--------------------------------------------------------------------+
+static void op_complete(bool success) {
+  _cache.op.state = OP_DONE;
+  _cache.op.success = success;
+}
+
+// Process user operation until an I/O is needed. Return true if operation still needs processing
+static bool op_step(void) {
+  cache_op_t* op = &_cache.op;
+
+  while (!_cache.io.active) {
+    switch (op->state) {
+      case OP_READ:
+      case OP_WRITE: {
+        if (op->count == 0) {
+          if (op->state == OP_READ) {
+            _cache.ra.next_lba = op->lba;
+          }
+          op_complete(true);
+          return false;
+        }
+
+        uint32_t const block_size = tuh_msc_get_block_size(op->daddr, op->lun);
+        uint32_t const bpl = blocks_per_line(op->daddr, op->lun);
+        uint64_t const line_lba = op->lba - (op->lba % bpl);
+        int32_t idx = line_find(op->daddr, op->lun, line_lba);
+
+        if (idx < 0) {
+          idx = line_victim(op->daddr, op->lun, line_lba, false);
+          cache_line_t* victim = &_cache.lines[idx];
+
+          if (victim->valid && victim->dirty) {
+            if (!line_io(IO_WRITEBACK, (uint16_t) idx)) {
+              op_complete(false);
+            }
+            return true;
+          }
+
+          if (op->state == OP_WRITE && op->lba == line_lba && op->count >= line_blocks(op->daddr, op->lun, line_lba)) {
+            // whole line is overwritten, no need to read it first
+            victim->daddr = op->daddr;
+            victim->lun = op->lun;
+            victim->lba = line_lba;
+            victim->valid = 1;
+            victim->dirty = 0;
+          } else {
+            if (!line_fetch(IO_FETCH, (uint16_t) idx, op->daddr, op->lun, line_lba)) {
+              op_complete(false);
+            }
+            return true;
+          }
+        }
+
+        // hit: copy between user buffer and line
+        uint32_t const nblocks = (uint32_t) tu_min64(op->count, line_lba + bpl - op->lba);
+        uint32_t const nbytes = nblocks * block_size;
+        uint8_t* p_line = line_data((uint16_t) idx) + (uint32_t) (op->lba - line_lba) * block_size;
+
+        if (op->state == OP_READ) {
+          memcpy(op->buffer, p_line, nbytes);
+        } else {
+          memcpy(p_line, op->buffer, nbytes);
+          _cache.lines[idx].dirty = 1;
+        }
+        line_touch((uint16_t) idx);
+
+        op->buffer += nbytes;
+        op->lba += nblocks;
+        op->count -= nblocks;
+        break;
+      }
+
+      case OP_SYNC:
+        // write back dirty lines of this LUN one by one, then ask device to flush its own cache
+        while (op->sync_index < _cache.line_count) {
+          uint16_t const idx = op->sync_index++;
+          cache_line_t const* line = &_cache.lines[idx];
+          if (line->valid && line->dirty && line->daddr == op->daddr && line->lun == op->lun) {
+            if (!line_io(IO_WRITEBACK, idx)) {
+              op_complete(false);
+            }
+            return true;
+          }
+        }
+
+        if (!op->sync_sent) {
+          op->sync_sent = true;
+          _cache.io.active = true;
+          _cache.io.kind = IO_SYNC;
+          _cache.io.daddr = op->daddr;
+          if (!tuh_msc_sync_cache(op->daddr, op->lun, cache_io_complete, 0)) {
+            _cache.io.active = false;
+            op_complete(false);
+          }
+          return true;
+        }
+
+        op_complete(true);
+        return false;
+
+      default:
+        return false;
+    }
+  }
+
+  return true;
+}
+
+// Prefetch next line of sequential read when idle, stop if line cannot be replaced
+static void prefetch_step(void) {
+  while (!_cache.io.active && _cache.ra.lba < _cache.ra.end) {
+    uint8_t const daddr = _cache.ra.daddr;
+    uint8_t const lun = _cache.ra.lun;
+    uint32_t const bpl = blocks_per_line(daddr, lun);
+    uint64_t const line_lba = _cache.ra.lba - (_cache.ra.lba % bpl);
+
+    _cache.ra.lba = line_lba + bpl;
+    if (line_find(daddr, lun, line_lba) >= 0) {
+      continue;
+    }
+
+    int32_t const idx = line_victim(daddr, lun, line_lba, true);
+    if (idx < 0 || !line_fetch(IO_PREFETCH, (uint16_t) idx, daddr, lun, line_lba)) {
+      _cache.ra.end = 0;
+    }
+  }
+}
+
+// Run engine, must be called with mutex locked. Mutex is unlocked before invoking complete callback so that
+// application can start next operation from within the callback.
+static void cache_step_unlock(void) {
+  bool const was_read = (_cache.op.state == OP_READ);
+  if (!op_step() && was_read && _cache.op.state == OP_DONE && _cache.op.success) {
+    // end of sequential read: prefetch the lines following it
+    if (_cache.ra.end != 0) {
+      uint64_t const block_count = tuh_msc_get_block_count64(_cache.ra.daddr, _cache.ra.lun);
+      uint32_t const bpl = blocks_per_line(_cache.ra.daddr, _cache.ra.lun);
+      _cache.ra.lba = _cache.ra.next_lba;
+      _cache.ra.end = tu_min64(_cache.ra.next_lba + (uint64_t) CFG_TUH_MSC_CACHE_READ_AHEAD * bpl, block_count);
+    }
+  }
+
+  if (_cache.op.state == OP_NONE || _cache.op.state == OP_DONE) {
+    prefetch_step();
+  }
+
+  cache_op_t done = {0};
+  if (_cache.op.state == OP_DONE) {
+    done = _cache.op;
+    _cache.op.state = OP_NONE;
+  }
+  (void) osal_mutex_unlock(_cache_mutex);
+
+  if (done.complete_cb != NULL) {
+    done.complete_cb(done.daddr, done.lun, done.success, done.arg);
+  }
+}
+
+static bool cache_io_complete(uint8_t daddr, tuh_msc_complete_data_t const* cb_data) {
+  bool const success = (cb_data->csw->status == MSC_CSW_STATUS_PASSED);
+
+  (void) osal_mutex_lock(_cache_mutex, OSAL_TIMEOUT_WAIT_FOREVER);
+
+  // device may have been closed while I/O was in flight
+  if (_cache.io.active && _cache.io.daddr == daddr) {
+    cache_line_t* line = &_cache.lines[_cache.io.line];
+    _cache.io.active = false;
+
+    switch (_cache.io.kind) {
+      case IO_FETCH:
+      case IO_PREFETCH:
+        line->valid = success ? 1 : 0;
+        if (!success) {
+          if (_cache.io.kind == IO_FETCH) {
+            op_complete(false);
+          } else {
+            _cache.ra.end = 0;
+          }
+        }
+        break;
+
+      case IO_WRITEBACK:
+        if (success) {
+          line->dirty = 0;
+        } else {
+          op_complete(false); // line stays dirty
+        }
+        break;
+
+      case IO_SYNC:
+        // device without volatile cache may reject SYNCHRONIZE CACHE, data is already written at this point
+        break;
+
+      default: break;
+    }
+  }
+
+  cache_step_unlock();
+  return true;
+}
+
+// Validate and start an user operation
+static bool op_start(uint8_t state, uint8_t daddr, uint8_t lun, void* buffer, uint64_t lba, uint32_t count,
+                     tuh_msc_cache_cb_t complete_cb, uintptr_t arg) {
+  TU_VERIFY(_cache.line_count > 0 && tuh_msc_mounted(daddr));
+
+  if (state != OP_SYNC) {
+    uint32_t const block_size = tuh_msc_get_block_size(daddr, lun);
+    TU_VERIFY(block_size > 0 && (CFG_TUH_MSC_CACHE_LINE_SIZE % block_size) == 0);
+    TU_VERIFY(count > 0 && lba + count <= tuh_msc_get_block_count64(daddr, lun));
+  }
+
+  (void) osal_mutex_lock(_cache_mutex, OSAL_TIMEOUT_WAIT_FOREVER);
+  if (_cache.op.state != OP_NONE) {
+    (void) osal_mutex_unlock(_cache_mutex);
+    return false;
+  }
+
+  cache_op_t* op = &_cache.op;
+  tu_memclr(op, sizeof(cache_op_t));
+  op->state = state;
+  op->daddr = daddr;
+  op->lun = lun;
+  op->buffer = (uint8_t*) buffer;
+  op->lba = lba;
+  op->count = count;
+  op->complete_cb = complete_cb;
+  op->arg = arg;
+
+  if (state == OP_READ) {
+    // sequential if this read continues the previous one, otherwise stop read-ahead
+    bool const sequential = (daddr == _cache.ra.daddr && lun == _cache.ra.lun && lba == _cache.ra.next_lba);
+    _cache.ra.daddr = daddr;
+    _cache.ra.lun = lun;
+    _cache.ra.end = sequential ? 1 : 0; // non-zero marks sequential, actual range is set once read is complete
+    _cache.ra.lba = _cache.ra.end;
+  }
+
+  cache_step_unlock();
+  return true;
+}
+
+//--------------------------------------------------------------------+
+// Application API
+//--------------------------------------------------------------------+
+bool tuh_msc_cache_init(void* arena, uint32_t arena_size) {
+  uint32_t const line_total = CFG_TUH_MSC_CACHE_LINE_SIZE + sizeof(cache_line_t);
+  uint32_t count = arena_size / line_total;
+  TU_VERIFY(arena != NULL && count > 0 && (((uintptr_t) arena) & 7u) == 0);
+
+  #if OSAL_MUTEX_REQUIRED
+  if (_cache_mutex == NULL) {
+    _cache_mutex = osal_mutex_create(&_cache_mutexdef);
+  }
+  #endif
+
+  (void) osal_mutex_lock(_cache_mutex, OSAL_TIMEOUT_WAIT_FOREVER);
+  bool const busy = (_cache.op.state != OP_NONE) || _cache.io.active;
+  if (!busy) {
+    count = tu_min32(count, UINT16_MAX);
+    tu_memclr(&_cache, sizeof(_cache));
+    _cache.ways = (uint16_t) tu_min32(CFG_TUH_MSC_CACHE_WAYS, count);
+    _cache.set_count = (uint16_t) (count / _cache.ways);
+    _cache.line_count = (uint16_t) (_cache.set_count * _cache.ways);
+    _cache.data = (uint8_t*) arena;
+    _cache.lines = (cache_line_t*) (_cache.data + (uint32_t) _cache.line_count * CFG_TUH_MSC_CACHE_LINE_SIZE);
+    tu_memclr(_cache.lines, _cache.line_count * sizeof(cache_line_t));
+  }
+  (void) osal_mutex_unlock(_cache_mutex);
+
+  return !busy;
+}
+
+uint16_t tuh_msc_cache_line_count(void) {
+  return _cache.line_count;
+}
+
+bool tuh_msc_cache_busy(void) {
+  return _cache.op.state != OP_NONE;
+}
+
+bool tuh_msc_cache_read(uint8_t dev_addr, uint8_t lun, void* buffer, uint64_t lba, uint32_t count,
+                        tuh_msc_cache_cb_t complete_cb, uintptr_t arg) {
+  return op_start(OP_READ, dev_addr, lun, buffer, lba, count, complete_cb, arg);
+}
+
+bool tuh_msc_cache_write(uint8_t dev_addr, uint8_t lun, void const* buffer, uint64_t lba, uint32_t count,
+                         tuh_msc_cache_cb_t complete_cb, uintptr_t arg) {
+  return op_start(OP_WRITE, dev_addr, lun, (void*) (uintptr_t) buffer, lba, count, complete_cb, arg);
+}
+
+bool tuh_msc_cache_sync(uint8_t dev_addr, uint8_t lun, tuh_msc_cache_cb_t complete_cb, uintptr_t arg) {
+  return op_start(OP_SYNC, dev_addr, lun, NULL, 0, 0, complete_cb, arg);
+}
+
+//--------------------------------------------------------------------+
+// Internal API
+//--------------------------------------------------------------------+
+void msch_cache_close(uint8_t dev_addr) {
+  if (_cache.line_count == 0) {
+    return; // cache is not initialized
+  }
+  (void) osal_mutex_lock(_cache_mutex, OSAL_TIMEOUT_WAIT_FOREVER);
+
+  for (uint16_t i = 0; i < _cache.line_count; i++) {
+    if (_cache.lines[i].daddr == dev_addr) {
+      tu_memclr(&_cache.lines[i], sizeof(cache_line_t));
+    }
+  }
+
+  if (_cache.io.active && _cache.io.daddr == dev_addr) {
+    _cache.io.active = false; // its complete callback will never come
+  }
+
+  if (_cache.ra.daddr == dev_addr) {
+    _cache.ra.daddr = 0;
+    _cache.ra.end = 0;
+  }
+
+  uint8_t const state = _cache.op.state;
+  if (_cache.op.daddr == dev_addr && (state == OP_READ || state == OP_WRITE || state == OP_SYNC)) {
+    op_complete(false);
+  }
+
+  // resume operation of other device that may be waiting for I/O of this one
+  cache_step_unlock();
+}
+
+#endif
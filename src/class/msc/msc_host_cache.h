@@ -0,0 +1,78 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2019 Ha Thach (tinyusb.org)
+ * SPDX-License-Identifier: MIT
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#ifndef TUSB_MSC_HOST_CACHE_H_
+#define TUSB_MSC_HOST_CACHE_H_
+
+#include "msc_host.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//--------------------------------------------------------------------+
+// Class Driver Configuration
+//--------------------------------------------------------------------+
+
+// Cache line size in bytes, must be multiple of device's block size. A miss reads the whole line from device.
+#ifndef CFG_TUH_MSC_CACHE_LINE_SIZE
+  #define CFG_TUH_MSC_CACHE_LINE_SIZE 4096
+#endif
+
+// Number of lines (ways) per LRU set
+#ifndef CFG_TUH_MSC_CACHE_WAYS
+  #define CFG_TUH_MSC_CACHE_WAYS 4
+#endif
+
+// Number of lines fetched ahead in background once sequential read is detected, 0 to disable
+#ifndef CFG_TUH_MSC_CACHE_READ_AHEAD
+  #define CFG_TUH_MSC_CACHE_READ_AHEAD 1
+#endif
+
+//--------------------------------------------------------------------+
+// Application API
+//
+// Block cache on top of msc_host with LRU set-associative lines, sequential read-ahead and write-back.
+// Dirty lines are written to device on eviction or tuh_msc_cache_sync(). All operations are asynchronous: one
+// operation is accepted at a time and complete callback is invoked in usbh task once done.
+//--------------------------------------------------------------------+
+
+// Invoked when cache operation is complete
+typedef void (*tuh_msc_cache_cb_t)(uint8_t dev_addr, uint8_t lun, bool success, uintptr_t arg);
+
+// Set up cache with an application provided arena holding both line data and metadata, previous content is
+// discarded. Arena must be accessible by USB/DMA controller and aligned correctly (data is placed at its start).
+// Return false if arena is too small for a single line.
+bool tuh_msc_cache_init(void* arena, uint32_t arena_size);
+
+// Number of lines fitted in arena
+uint16_t tuh_msc_cache_line_count(void);
+
+// Check if cache is busy with an operation
+bool tuh_msc_cache_busy(void);
+
+// Read/Write count blocks starting from lba through cache
+bool tuh_msc_cache_read(uint8_t dev_addr, uint8_t lun, void* buffer, uint64_t lba, uint32_t count,
+                        tuh_msc_cache_cb_t complete_cb, uintptr_t arg);
+bool tuh_msc_cache_write(uint8_t dev_addr, uint8_t lun, void const* buffer, uint64_t lba, uint32_t count,
+                         tuh_msc_cache_cb_t complete_cb, uintptr_t arg);
+
+// Write back all dirty lines of the LUN then issue SYNCHRONIZE CACHE to device
+bool tuh_msc_cache_sync(uint8_t dev_addr, uint8_t lun, tuh_msc_cache_cb_t complete_cb, uintptr_t arg);
+
+//--------------------------------------------------------------------+
+// Internal API
+//--------------------------------------------------------------------+
+
+// Drop all lines of a device and fail its pending operation, invoked when device is unmounted
+void msch_cache_close(uint8_t dev_addr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TUSB_MSC_HOST_CACHE_H_ */
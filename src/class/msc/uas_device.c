@@ -0,0 +1,851 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2019 Ha Thach (tinyusb.org)
+ * SPDX-License-Identifier: MIT
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#include "tusb_option.h"
+
+#if (CFG_TUD_ENABLED && CFG_TUD_UAS)
+
+#include "device/usbd.h"
+#include "device/usbd_pvt.h"
+
+#include "msc_device.h"
+#include "uas_device.h"
+
+#if CFG_TUD_MSC_CACHE
+  #include "msc_device_cache.h"
+#endif
+
+// Level where CFG_TUSB_DEBUG must be at least for this driver is logged
+#ifndef CFG_TUD_UAS_LOG_LEVEL
+  #define CFG_TUD_UAS_LOG_LEVEL   CFG_TUD_LOG_LEVEL
+#endif
+
+#define TU_LOG_DRV(...)   TU_LOG(CFG_TUD_UAS_LOG_LEVEL, __VA_ARGS__)
+
+//--------------------------------------------------------------------+
+// MACRO CONSTANT TYPEDEF
+//--------------------------------------------------------------------+
+
+// USB 2.0 UAS flow (without bulk streams) for a command with data:
+//   Command IU (cmd pipe) -> Read/Write Ready IU (status pipe) -> data (data pipe) -> Sense IU (status pipe)
+// Multiple commands can be queued by host, they are executed one at a time in arrival order.
+enum {
+  UAS_CMD_QUEUED = 0, // received, not started
+  UAS_CMD_READY,      // has data, Read/Write Ready IU to be sent
+  UAS_CMD_READY_SENT,
+  UAS_CMD_DATA,
+  UAS_CMD_SENSE,      // Sense IU to be sent
+  UAS_CMD_SENSE_SENT,
+};
+
+// Command and Status IU buffer
+#define UASD_IU_BUFSIZE   64
+
+typedef struct {
+  uint16_t tag;
+  uint8_t  lun;
+  uint8_t  state;
+  uint8_t  status;  // scsi_status_t
+  bool     data_in;
+  uint8_t  cdb[16];
+} uasd_cmd_t;
+
+typedef struct {
+  uint8_t rhport;
+  uint8_t itf_num;
+  uint8_t ep_cmd;
+  uint8_t ep_status;
+  uint8_t ep_data_in;
+  uint8_t ep_data_out;
+
+  bool cmd_busy;      // command pipe is armed
+  bool data_busy;     // data pipe transfer in progress
+  bool pending_io;    // pending async media I/O
+  uint8_t status_iu;  // IU id being sent on status pipe, 0 if idle
+
+  // Response IU for task management or invalid IU, has priority on status pipe
+  bool     resp_pending;
+  uint8_t  resp_code;
+  uint16_t resp_tag;
+
+  // Command queue in arrival order, head is the active command
+  uint8_t q_head;
+  uint8_t q_count;
+  uasd_cmd_t queue[CFG_TUD_UAS_QUEUE_DEPTH];
+
+  // Data phase of active command
+  uint32_t block_size;  // READ/WRITE only
+  uint32_t total_len;
+  uint32_t xferred_len; // bytes sent to host (data-in) or consumed by media/callback (data-out)
+  uint16_t buf_len;     // data-out: bytes received in buffer
+  uint16_t buf_offset;  // data-out: bytes of buffer already consumed by media write
+} uasd_interface_t;
+
+static uasd_interface_t _uasd_itf;
+
+CFG_TUD_MEM_SECTION static struct {
+  TUD_EPBUF_DEF(cmd, UASD_IU_BUFSIZE);
+  TUD_EPBUF_DEF(status, UASD_IU_BUFSIZE);
+  TUD_EPBUF_DEF(data, CFG_TUD_UAS_EP_BUFSIZE);
+} _uasd_epbuf;
+
+//--------------------------------------------------------------------+
+// Weak stubs: invoked if no strong implementation is available
+//--------------------------------------------------------------------+
+TU_ATTR_WEAK uasd_cmd_dir_t tud_uas_cmd_dir_cb(uint8_t lun, uint8_t const scsi_cmd[16]) {
+  (void) lun; (void) scsi_cmd;
+  return UASD_CMD_UNSUPPORTED;
+}
+
+//--------------------------------------------------------------------+
+// INTERNAL OBJECT & FUNCTION DECLARATION
+//--------------------------------------------------------------------+
+static void proc_queue(uasd_interface_t* p_uas);
+static void proc_read_media(uasd_interface_t* p_uas);
+static void proc_read_io_data(uasd_interface_t* p_uas, int32_t nbytes);
+static void proc_write_xfer(uasd_interface_t* p_uas);
+static void proc_write_media(uasd_interface_t* p_uas);
+static void proc_write_io_data(uasd_interface_t* p_uas, int32_t nbytes);
+
+TU_ATTR_ALWAYS_INLINE static inline uasd_cmd_t* active_cmd(uasd_interface_t* p_uas) {
+  return p_uas->q_count ? &p_uas->queue[p_uas->q_head] : NULL;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline bool is_cmd_read(uint8_t cmd) {
+  return cmd == SCSI_CMD_READ_10 || cmd == SCSI_CMD_READ_16;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline bool is_cmd_write(uint8_t cmd) {
+  return cmd == SCSI_CMD_WRITE_10 || cmd == SCSI_CMD_WRITE_16;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline bool is_cmd_rdwr(uint8_t cmd) {
+  return is_cmd_read(cmd) || is_cmd_write(cmd);
+}
+
+// UAS command IU has no direction: it is known for built-in commands, otherwise asked to application
+static uasd_cmd_dir_t get_cmd_dir(uint8_t lun, uint8_t const cdb[]) {
+  switch (cdb[0]) {
+    case SCSI_CMD_WRITE_10:
+    case SCSI_CMD_WRITE_16:
+    case SCSI_CMD_MODE_SELECT_6:
+    case SCSI_CMD_MODE_SELECT_10:
+    case SCSI_CMD_UNMAP:
+    case SCSI_CMD_WRITE_SAME_10:
+    case SCSI_CMD_WRITE_SAME_16:
+      return UASD_CMD_DATA_OUT;
+
+    case SCSI_CMD_READ_10:
+    case SCSI_CMD_READ_16:
+    case SCSI_CMD_TEST_UNIT_READY:
+    case SCSI_CMD_REQUEST_SENSE:
+    case SCSI_CMD_INQUIRY:
+    case SCSI_CMD_MODE_SENSE_6:
+    case SCSI_CMD_START_STOP_UNIT:
+    case SCSI_CMD_PREVENT_ALLOW_MEDIUM_REMOVAL:
+    case SCSI_CMD_READ_FORMAT_CAPACITY:
+    case SCSI_CMD_READ_CAPACITY_10:
+    case SCSI_CMD_SYNCHRONIZE_CACHE_10:
+    case SCSI_CMD_SYNCHRONIZE_CACHE_16:
+    case SCSI_CMD_SERVICE_ACTION_IN_16:
+      return UASD_CMD_DATA_IN;
+
+    default:
+      return tud_uas_cmd_dir_cb(lun, cdb);
+  }
+}
+
+static uint64_t rdwr_get_lba(uint8_t const cdb[]) {
+  if (cdb[0] == SCSI_CMD_READ_16 || cdb[0] == SCSI_CMD_WRITE_16) {
+    const uint32_t lba_high = tu_unaligned_read32(cdb + offsetof(scsi_write16_t, lba));
+    const uint32_t lba_low  = tu_unaligned_read32(cdb + offsetof(scsi_write16_t, lba) + 4);
+    return (((uint64_t) tu_ntohl(lba_high)) << 32) | tu_ntohl(lba_low);
+  } else {
+    return tu_ntohl(tu_unaligned_read32(cdb + offsetof(scsi_write10_t, lba)));
+  }
+}
+
+static uint32_t rdwr_get_blockcount(uint8_t const cdb[]) {
+  if (cdb[0] == SCSI_CMD_READ_16 || cdb[0] == SCSI_CMD_WRITE_16) {
+    return tu_ntohl(tu_unaligned_read32(cdb + offsetof(scsi_write16_t, block_count)));
+  } else {
+    return tu_ntohs(tu_unaligned_read16(cdb + offsetof(scsi_write10_t, block_count)));
+  }
+}
+
+// Allocation length (data-in) or parameter list length (data-out) from CDB, since UAS command IU does not carry
+// the data transfer length as BOT's CBW does.
+static uint32_t cdb_xfer_len(uint8_t lun, uint8_t const cdb[]) {
+  switch (cdb[0]) {
+    case SCSI_CMD_INQUIRY:          return tu_ntohs(tu_unaligned_read16(cdb + 3));
+    case SCSI_CMD_READ_CAPACITY_10: return sizeof(scsi_read_capacity10_resp_t);
+
+    case SCSI_CMD_WRITE_SAME_10:
+    case SCSI_CMD_WRITE_SAME_16: {
+      // a single block of data-out
+      uint64_t block_count;
+      uint32_t block_size;
+      tud_msc_capacity16_cb(lun, &block_count, &block_size);
+      return block_size;
+    }
+
+    default: break;
+  }
+
+  // otherwise location depends on CDB size i.e group code
+  switch (cdb[0] >> 5) {
+    case 0:  return cdb[4];                                        // 6-byte
+    case 1:
+    case 2:  return tu_ntohs(tu_unaligned_read16(cdb + 7));        // 10-byte
+    case 4:  return tu_ntohl(tu_unaligned_read32(cdb + 10));       // 16-byte
+    case 5:  return tu_ntohl(tu_unaligned_read32(cdb + 6));        // 12-byte
+    default: return 0;
+  }
+}
+
+TU_ATTR_ALWAYS_INLINE static inline void set_sense_medium_not_present(uint8_t lun) {
+  (void) tud_msc_set_sense(lun, SCSI_SENSE_NOT_READY, 0x3A, 0x00);
+}
+
+// Complete active command with CHECK CONDITION, sense data is sent in Sense IU
+static void fail_cmd(uasd_interface_t* p_uas) {
+  uasd_cmd_t* cmd = active_cmd(p_uas);
+  cmd->status = SCSI_STATUS_CHECK_CONDITION;
+  cmd->state  = UAS_CMD_SENSE;
+}
+
+// Find command with tag in queue, return its position from head or -1
+static int find_tag(uasd_interface_t const* p_uas, uint16_t tag) {
+  for (uint8_t i = 0; i < p_uas->q_count; i++) {
+    if (p_uas->queue[(p_uas->q_head + i) % CFG_TUD_UAS_QUEUE_DEPTH].tag == tag) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+// Remove commands which are not started yet: matching tag if by_tag, otherwise all commands of lun (0xff for any)
+static uint8_t queue_abort(uasd_interface_t* p_uas, bool by_tag, uint16_t tag, uint8_t lun) {
+  uint8_t count = 0;
+  uint8_t keep = 0;
+  for (uint8_t i = 0; i < p_uas->q_count; i++) {
+    uasd_cmd_t const* cmd = &p_uas->queue[(p_uas->q_head + i) % CFG_TUD_UAS_QUEUE_DEPTH];
+    const bool match = by_tag ? (cmd->tag == tag) : (lun == 0xff || cmd->lun == lun);
+    if (match && cmd->state == UAS_CMD_QUEUED) {
+      count++;
+    } else {
+      // compact remaining commands toward head
+      if (keep != i) {
+        p_uas->queue[(p_uas->q_head + keep) % CFG_TUD_UAS_QUEUE_DEPTH] = *cmd;
+      }
+      keep++;
+    }
+  }
+  p_uas->q_count = keep;
+  return count;
+}
+
+//--------------------------------------------------------------------+
+// Status pipe
+//--------------------------------------------------------------------+
+static bool send_status_iu(uasd_interface_t* p_uas, uint8_t iu_id, uint16_t len) {
+  p_uas->status_iu = iu_id;
+  return usbd_edpt_xfer(p_uas->rhport, p_uas->ep_status, _uasd_epbuf.status, len, false);
+}
+
+static bool send_response(uasd_interface_t* p_uas) {
+  uas_response_iu_t* resp = (uas_response_iu_t*) _uasd_epbuf.status;
+  tu_memclr(resp, sizeof(uas_response_iu_t));
+  resp->header.iu_id  = UAS_IU_ID_RESPONSE;
+  resp->header.tag    = tu_htons(p_uas->resp_tag);
+  resp->response_code = p_uas->resp_code;
+
+  p_uas->resp_pending = false;
+  return send_status_iu(p_uas, UAS_IU_ID_RESPONSE, sizeof(uas_response_iu_t));
+}
+
+static bool send_ready(uasd_interface_t* p_uas, uasd_cmd_t* cmd) {
+  uas_iu_header_t* ready = (uas_iu_header_t*) _uasd_epbuf.status;
+  ready->iu_id    = cmd->data_in ? UAS_IU_ID_READ_READY : UAS_IU_ID_WRITE_READY;
+  ready->reserved = 0;
+  ready->tag      = tu_htons(cmd->tag);
+
+  cmd->state = UAS_CMD_READY_SENT;
+  return send_status_iu(p_uas, ready->iu_id, sizeof(uas_iu_header_t));
+}
+
+static bool send_sense(uasd_interface_t* p_uas, uasd_cmd_t* cmd) {
+  uas_sense_iu_t* sense_iu = (uas_sense_iu_t*) _uasd_epbuf.status;
+  tu_memclr(sense_iu, sizeof(uas_sense_iu_t));
+  sense_iu->header.iu_id = UAS_IU_ID_SENSE;
+  sense_iu->header.tag   = tu_htons(cmd->tag);
+  sense_iu->status       = cmd->status;
+
+  uint16_t sense_len = 0;
+  if (cmd->status == SCSI_STATUS_CHECK_CONDITION) {
+    // sense data is built by REQUEST SENSE handler, which also clears it as BOT host would do
+    uint8_t const req_sense[16] = {SCSI_CMD_REQUEST_SENSE, 0, 0, 0, sizeof(scsi_sense_fixed_resp_t)};
+    int32_t const resplen = mscd_proc_scsi_cmd(cmd->lun, req_sense, sense_iu->sense_data, sizeof(sense_iu->sense_data),
+                                               sizeof(sense_iu->sense_data));
+    sense_len = (uint16_t) (resplen > 0 ? tu_min32((uint32_t) resplen, sizeof(sense_iu->sense_data)) : 0);
+
+    scsi_sense_fixed_resp_t* sense = (scsi_sense_fixed_resp_t*) sense_iu->sense_data;
+    if (sense_len < sizeof(scsi_sense_fixed_resp_t) || sense->sense_key == SCSI_SENSE_NONE) {
+      // no sense set by callback e.g unsupported command: ILLEGAL REQUEST, INVALID COMMAND OPERATION CODE
+      sense->response_code  = 0x70;
+      sense->valid          = 1;
+      sense->add_sense_len  = sizeof(scsi_sense_fixed_resp_t) - 8;
+      sense->sense_key      = SCSI_SENSE_ILLEGAL_REQUEST;
+      sense->add_sense_code = 0x20;
+      sense_len = sizeof(scsi_sense_fixed_resp_t);
+    }
+    sense_iu->sense_length = tu_htons(sense_len);
+  }
+
+  cmd->state = UAS_CMD_SENSE_SENT;
+  return send_status_iu(p_uas, UAS_IU_ID_SENSE, (uint16_t) (offsetof(uas_sense_iu_t, sense_data) + sense_len));
+}
+
+//--------------------------------------------------------------------+
+// Command processing
+//--------------------------------------------------------------------+
+
+// Execute active command up to its data phase: non READ/WRITE data-in commands are processed here so that
+// response length is known before Read Ready IU is sent.
+static void proc_cmd_start(uasd_interface_t* p_uas, uasd_cmd_t* cmd) {
+  uint8_t const op = cmd->cdb[0];
+  uasd_cmd_dir_t const dir = get_cmd_dir(cmd->lun, cmd->cdb);
+  TU_LOG_DRV("  UAS Command [Lun%u] tag %u: 0x%02X\r\n", cmd->lun, cmd->tag, op);
+
+  p_uas->total_len   = 0;
+  p_uas->xferred_len = 0;
+  p_uas->buf_len     = 0;
+  p_uas->buf_offset  = 0;
+  cmd->status = SCSI_STATUS_GOOD;
+  cmd->state  = UAS_CMD_SENSE;
+
+  if (is_cmd_rdwr(op)) {
+    uint64_t block_count;
+    uint32_t block_size;
+    tud_msc_capacity16_cb(cmd->lun, &block_count, &block_size);
+    uint32_t const rdwr_count = rdwr_get_blockcount(cmd->cdb);
+    cmd->data_in = is_cmd_read(op);
+
+    if (block_count == 0 || block_size == 0) {
+      set_sense_medium_not_present(cmd->lun);
+      fail_cmd(p_uas);
+    } else if (!cmd->data_in && !tud_msc_is_writable_cb(cmd->lun)) {
+      // Sense = Write protected
+      (void) tud_msc_set_sense(cmd->lun, SCSI_SENSE_DATA_PROTECT, 0x27, 0x00);
+      fail_cmd(p_uas);
+    } else if (rdwr_count > UINT32_MAX / block_size) {
+      // Sense = INVALID FIELD IN CDB
+      (void) tud_msc_set_sense(cmd->lun, SCSI_SENSE_ILLEGAL_REQUEST, 0x24, 0x00);
+      fail_cmd(p_uas);
+    #if CFG_TUD_MSC_CACHE
+    } else if (rdwr_get_lba(cmd->cdb) > block_count || rdwr_count > block_count - rdwr_get_lba(cmd->cdb)) {
+      // cache accesses media on behalf of application: Sense = LBA OUT OF RANGE
+      (void) tud_msc_set_sense(cmd->lun, SCSI_SENSE_ILLEGAL_REQUEST, 0x21, 0x00);
+      fail_cmd(p_uas);
+    #endif
+    } else {
+      p_uas->block_size = block_size;
+      p_uas->total_len  = rdwr_count * block_size;
+    }
+  } else if (dir == UASD_CMD_UNSUPPORTED) {
+    TU_LOG_DRV("  UAS unsupported command\r\n");
+    // Sense = INVALID COMMAND OPERATION CODE
+    (void) tud_msc_set_sense(cmd->lun, SCSI_SENSE_ILLEGAL_REQUEST, 0x20, 0x00);
+    fail_cmd(p_uas);
+  } else if (dir == UASD_CMD_DATA_OUT) {
+    cmd->data_in = false;
+    p_uas->total_len = cdb_xfer_len(cmd->lun, cmd->cdb);
+    if (p_uas->total_len > CFG_TUD_UAS_EP_BUFSIZE) {
+      TU_LOG_DRV("  UAS reject non READ/WRITE with large data\r\n");
+      (void) tud_msc_set_sense(cmd->lun, SCSI_SENSE_ILLEGAL_REQUEST, 0x24, 0x00);
+      p_uas->total_len = 0;
+      fail_cmd(p_uas);
+    }
+  } else {
+    cmd->data_in = true;
+    uint32_t const alloc_len = cdb_xfer_len(cmd->lun, cmd->cdb);
+    int32_t const resplen = mscd_proc_scsi_cmd(cmd->lun, cmd->cdb, _uasd_epbuf.data, CFG_TUD_UAS_EP_BUFSIZE, alloc_len);
+    if (resplen < 0) {
+      TU_LOG_DRV("  UAS unsupported or failed command\r\n");
+      fail_cmd(p_uas);
+    } else {
+      // cannot return more than host expect
+      p_uas->total_len = tu_min32((uint32_t) resplen, alloc_len);
+    }
+  }
+
+  if (cmd->state == UAS_CMD_SENSE && cmd->status == SCSI_STATUS_GOOD && p_uas->total_len > 0) {
+    cmd->state = UAS_CMD_READY;
+  }
+}
+
+// Host received Read/Write Ready IU, start data phase
+static void proc_data_start(uasd_interface_t* p_uas, uasd_cmd_t* cmd) {
+  cmd->state = UAS_CMD_DATA;
+
+  if (cmd->data_in) {
+    if (is_cmd_read(cmd->cdb[0])) {
+      proc_read_media(p_uas);
+    } else {
+      // response is already in buffer
+      p_uas->data_busy = true;
+      TU_ASSERT(usbd_edpt_xfer(p_uas->rhport, p_uas->ep_data_in, _uasd_epbuf.data, (uint16_t) p_uas->total_len, false),);
+    }
+  } else {
+    proc_write_xfer(p_uas);
+  }
+}
+
+static void proc_cmd_complete(uasd_interface_t* p_uas, uasd_cmd_t* cmd) {
+  TU_LOG_DRV("  UAS Status [Lun%u] tag %u = %u\r\n", cmd->lun, cmd->tag, cmd->status);
+
+  switch (cmd->cdb[0]) {
+    case SCSI_CMD_READ_10:
+    case SCSI_CMD_READ_16:
+      tud_msc_read10_complete_cb(cmd->lun);
+      break;
+
+    case SCSI_CMD_WRITE_10:
+    case SCSI_CMD_WRITE_16:
+      tud_msc_write10_complete_cb(cmd->lun);
+      break;
+
+    default:
+      tud_msc_scsi_complete_cb(cmd->lun, cmd->cdb);
+      break;
+  }
+
+  p_uas->q_head = (uint8_t) ((p_uas->q_head + 1) % CFG_TUD_UAS_QUEUE_DEPTH);
+  p_uas->q_count--;
+}
+
+static void respond(uasd_interface_t* p_uas, uint16_t tag, uint8_t code) {
+  p_uas->resp_pending = true;
+  p_uas->resp_tag     = tag;
+  p_uas->resp_code    = code;
+}
+
+static void proc_task_mgmt(uasd_interface_t* p_uas, uas_task_mgmt_iu_t const* tmf, uint16_t tag) {
+  uint16_t const task_tag = tu_ntohs(tmf->task_tag);
+  uint8_t const lun = tmf->lun[1];
+  TU_LOG_DRV("  UAS Task Management 0x%02X tag %u\r\n", tmf->function, task_tag);
+
+  switch (tmf->function) {
+    case UAS_TMF_ABORT_TASK: {
+      int const pos = find_tag(p_uas, task_tag);
+      if (pos >= 0 && p_uas->queue[(p_uas->q_head + pos) % CFG_TUD_UAS_QUEUE_DEPTH].state != UAS_CMD_QUEUED) {
+        // active command cannot be aborted mid-way and will complete with its Sense IU: FUNCTION REJECTED
+        respond(p_uas, tag, UAS_RESPONSE_TMF_NOT_SUPPORTED);
+      } else {
+        (void) queue_abort(p_uas, true, task_tag, 0);
+        respond(p_uas, tag, UAS_RESPONSE_TMF_COMPLETE);
+      }
+      break;
+    }
+
+    case UAS_TMF_ABORT_TASK_SET:
+    case UAS_TMF_CLEAR_TASK_SET:
+    case UAS_TMF_LOGICAL_UNIT_RESET:
+      (void) queue_abort(p_uas, false, 0, lun);
+      respond(p_uas, tag, UAS_RESPONSE_TMF_COMPLETE);
+      break;
+
+    case UAS_TMF_I_T_NEXUS_RESET:
+      (void) queue_abort(p_uas, false, 0, 0xff);
+      respond(p_uas, tag, UAS_RESPONSE_TMF_COMPLETE);
+      break;
+
+    case UAS_TMF_QUERY_TASK:
+      respond(p_uas, tag, find_tag(p_uas, task_tag) >= 0 ? UAS_RESPONSE_TMF_SUCCEEDED : UAS_RESPONSE_TMF_COMPLETE);
+      break;
+
+    case UAS_TMF_QUERY_TASK_SET:
+      respond(p_uas, tag, p_uas->q_count ? UAS_RESPONSE_TMF_SUCCEEDED : UAS_RESPONSE_TMF_COMPLETE);
+      break;
+
+    default:
+      respond(p_uas, tag, UAS_RESPONSE_TMF_NOT_SUPPORTED);
+      break;
+  }
+}
+
+// New IU received on command pipe
+static void proc_iu(uasd_interface_t* p_uas, uint32_t xferred_bytes) {
+  uint8_t const* buf = _uasd_epbuf.cmd;
+  TU_VERIFY(xferred_bytes >= sizeof(uas_iu_header_t), );
+  uint16_t const tag = tu_ntohs(tu_unaligned_read16(buf + offsetof(uas_iu_header_t, tag)));
+
+  switch (buf[0]) {
+    case UAS_IU_ID_COMMAND: {
+      uas_command_iu_t const* cmd_iu = (uas_command_iu_t const*) buf;
+      if (xferred_bytes < sizeof(uas_command_iu_t) || (cmd_iu->add_cdb_len >> 2) != 0) {
+        respond(p_uas, tag, UAS_RESPONSE_INVALID_IU);
+      } else if (cmd_iu->lun[0] != 0 || cmd_iu->lun[1] >= tud_msc_get_maxlun_cb()) {
+        respond(p_uas, tag, UAS_RESPONSE_INCORRECT_LUN);
+      } else if (find_tag(p_uas, tag) >= 0) {
+        respond(p_uas, tag, UAS_RESPONSE_OVERLAPPED_TAG);
+      } else {
+        // command pipe is only armed if there is room in queue
+        TU_ASSERT(p_uas->q_count < CFG_TUD_UAS_QUEUE_DEPTH, );
+        uasd_cmd_t* cmd = &p_uas->queue[(p_uas->q_head + p_uas->q_count) % CFG_TUD_UAS_QUEUE_DEPTH];
+        tu_memclr(cmd, sizeof(uasd_cmd_t));
+        cmd->tag   = tag;
+        cmd->lun   = cmd_iu->lun[1];
+        cmd->state = UAS_CMD_QUEUED;
+        memcpy(cmd->cdb, cmd_iu->cdb, sizeof(cmd->cdb));
+        p_uas->q_count++;
+      }
+      break;
+    }
+
+    case UAS_IU_ID_TASK_MGMT:
+      if (xferred_bytes < sizeof(uas_task_mgmt_iu_t)) {
+        respond(p_uas, tag, UAS_RESPONSE_INVALID_IU);
+      } else {
+        proc_task_mgmt(p_uas, (uas_task_mgmt_iu_t const*) buf, tag);
+      }
+      break;
+
+    default:
+      respond(p_uas, tag, UAS_RESPONSE_INVALID_IU);
+      break;
+  }
+}
+
+// Drive the state machine: start active command, send pending status pipe IU and re-arm command pipe
+static void proc_queue(uasd_interface_t* p_uas) {
+  uasd_cmd_t* cmd = active_cmd(p_uas);
+  if (cmd != NULL && cmd->state == UAS_CMD_QUEUED) {
+    proc_cmd_start(p_uas, cmd);
+  }
+
+  if (p_uas->status_iu == 0) {
+    if (p_uas->resp_pending) {
+      TU_ASSERT(send_response(p_uas), );
+    } else if (cmd != NULL && cmd->state == UAS_CMD_READY) {
+      TU_ASSERT(send_ready(p_uas, cmd), );
+    } else if (cmd != NULL && cmd->state == UAS_CMD_SENSE && !p_uas->data_busy && !p_uas->pending_io) {
+      TU_ASSERT(send_sense(p_uas, cmd), );
+    } else {
+      // nothing to send
+    }
+  }
+
+  // accept next IU if there is room for it. Response IU has single slot, wait until it is sent
+  if (!p_uas->cmd_busy && !p_uas->resp_pending && p_uas->q_count < CFG_TUD_UAS_QUEUE_DEPTH) {
+    p_uas->cmd_busy = true;
+    TU_ASSERT(usbd_edpt_xfer(p_uas->rhport, p_uas->ep_cmd, _uasd_epbuf.cmd, UASD_IU_BUFSIZE, false), );
+  }
+}
+
+//--------------------------------------------------------------------+
+// READ/WRITE data phase
+//--------------------------------------------------------------------+
+
+// Read next chunk from media into data buffer
+static void proc_read_media(uasd_interface_t* p_uas) {
+  uasd_cmd_t const* cmd = active_cmd(p_uas);
+  TU_VERIFY(!p_uas->pending_io && !p_uas->data_busy && p_uas->xferred_len < p_uas->total_len, );
+
+  // Adjust lba & offset with bytes read so far
+  uint64_t const lba = rdwr_get_lba(cmd->cdb) + (p_uas->xferred_len / p_uas->block_size);
+  uint32_t const offset = p_uas->xferred_len % p_uas->block_size;
+  int32_t nbytes = (int32_t) tu_min32(CFG_TUD_UAS_EP_BUFSIZE, p_uas->total_len - p_uas->xferred_len);
+
+  p_uas->pending_io = true;
+  #if CFG_TUD_MSC_CACHE
+  nbytes = mscd_cache_read(cmd->lun, lba, offset, p_uas->block_size, _uasd_epbuf.data, (uint32_t) nbytes);
+  #else
+  if (cmd->cdb[0] == SCSI_CMD_READ_16) {
+    nbytes = tud_msc_read16_cb(cmd->lun, lba, offset, _uasd_epbuf.data, (uint32_t) nbytes);
+  } else {
+    nbytes = tud_msc_read10_cb(cmd->lun, (uint32_t) lba, offset, _uasd_epbuf.data, (uint32_t) nbytes);
+  }
+  #endif
+  if (nbytes != TUD_MSC_RET_ASYNC) {
+    p_uas->pending_io = false;
+    proc_read_io_data(p_uas, nbytes);
+  }
+}
+
+static void proc_rdwr_retry(void* param);
+
+static void proc_read_io_data(uasd_interface_t* p_uas, int32_t nbytes) {
+  if (nbytes > 0) {
+    p_uas->data_busy = true;
+    TU_ASSERT(usbd_edpt_xfer(p_uas->rhport, p_uas->ep_data_in, _uasd_epbuf.data, (uint16_t) nbytes, false), );
+  } else {
+    switch (nbytes) {
+      case TUD_MSC_RET_ERROR:
+        // host cancels remaining data transfer upon receiving Sense IU with CHECK CONDITION
+        TU_LOG_DRV("  IO read() failed\r\n");
+        set_sense_medium_not_present(active_cmd(p_uas)->lun);
+        fail_cmd(p_uas);
+        break;
+
+      case TUD_MSC_RET_BUSY:
+        // not ready yet -> retry later in usbd task
+        usbd_defer_func(proc_rdwr_retry, NULL, false);
+        break;
+
+      default: break; // nothing to do
+    }
+  }
+}
+
+// Receive next chunk from host into data buffer
+static void proc_write_xfer(uasd_interface_t* p_uas) {
+  TU_VERIFY(!p_uas->data_busy && p_uas->xferred_len < p_uas->total_len, );
+  uint16_t const nbytes = (uint16_t) tu_min32(CFG_TUD_UAS_EP_BUFSIZE, p_uas->total_len - p_uas->xferred_len);
+
+  p_uas->buf_len    = 0;
+  p_uas->buf_offset = 0;
+  p_uas->data_busy  = true;
+  TU_ASSERT(usbd_edpt_xfer(p_uas->rhport, p_uas->ep_data_out, _uasd_epbuf.data, nbytes, false), );
+}
+
+// Write received data to media
+static void proc_write_media(uasd_interface_t* p_uas) {
+  uasd_cmd_t const* cmd = active_cmd(p_uas);
+  TU_VERIFY(!p_uas->pending_io && p_uas->buf_offset < p_uas->buf_len, );
+
+  // Adjust lba & offset with bytes written so far
+  uint64_t const lba = rdwr_get_lba(cmd->cdb) + (p_uas->xferred_len / p_uas->block_size);
+  uint32_t const offset = p_uas->xferred_len % p_uas->block_size;
+  uint8_t* buf = _uasd_epbuf.data + p_uas->buf_offset;
+  uint32_t const len = (uint32_t) (p_uas->buf_len - p_uas->buf_offset);
+
+  p_uas->pending_io = true;
+  int32_t nbytes;
+  #if CFG_TUD_MSC_CACHE
+  nbytes = mscd_cache_write(cmd->lun, lba, offset, p_uas->block_size, buf, len);
+  #else
+  if (cmd->cdb[0] == SCSI_CMD_WRITE_16) {
+    nbytes = tud_msc_write16_cb(cmd->lun, lba, offset, buf, len);
+  } else {
+    nbytes = tud_msc_write10_cb(cmd->lun, (uint32_t) lba, offset, buf, len);
+  }
+  #endif
+  if (nbytes != TUD_MSC_RET_ASYNC) {
+    p_uas->pending_io = false;
+    proc_write_io_data(p_uas, nbytes);
+  }
+}
+
+static void proc_write_io_data(uasd_interface_t* p_uas, int32_t nbytes) {
+  if (nbytes < 0) {
+    if (nbytes == TUD_MSC_RET_ERROR) {
+      TU_LOG_DRV("  IO write() failed\r\n");
+      set_sense_medium_not_present(active_cmd(p_uas)->lun);
+      fail_cmd(p_uas);
+    }
+  } else {
+    p_uas->xferred_len += (uint32_t) nbytes;
+    p_uas->buf_offset = (uint16_t) (p_uas->buf_offset + nbytes);
+
+    if (p_uas->buf_offset < p_uas->buf_len) {
+      // Application consume less than what we got including TUD_MSC_RET_BUSY (0)
+      usbd_defer_func(proc_rdwr_retry, NULL, false);
+    } else if (p_uas->xferred_len >= p_uas->total_len) {
+      active_cmd(p_uas)->state = UAS_CMD_SENSE;
+    } else {
+      proc_write_xfer(p_uas);
+    }
+  }
+}
+
+// Retry media I/O which was busy or did not consume all data
+static void proc_rdwr_retry(void* param) {
+  (void) param;
+  uasd_interface_t* p_uas = &_uasd_itf;
+  uasd_cmd_t const* cmd = active_cmd(p_uas);
+  TU_VERIFY(cmd != NULL && cmd->state == UAS_CMD_DATA, );
+
+  if (is_cmd_read(cmd->cdb[0])) {
+    proc_read_media(p_uas);
+  } else if (is_cmd_write(cmd->cdb[0])) {
+    proc_write_media(p_uas);
+  } else {
+    // nothing to do
+  }
+
+  proc_queue(p_uas);
+}
+
+static void proc_async_io_done(void* bytes_io) {
+  uasd_interface_t* p_uas = &_uasd_itf;
+  TU_VERIFY(p_uas->pending_io, );
+  int32_t const nbytes = (int32_t) (intptr_t) bytes_io;
+  uasd_cmd_t const* cmd = active_cmd(p_uas);
+
+  p_uas->pending_io = false;
+  TU_VERIFY(cmd != NULL, );
+  if (is_cmd_read(cmd->cdb[0])) {
+    proc_read_io_data(p_uas, nbytes);
+  } else if (is_cmd_write(cmd->cdb[0])) {
+    proc_write_io_data(p_uas, nbytes);
+  } else {
+    // nothing to do
+  }
+
+  proc_queue(p_uas);
+}
+
+bool uasd_async_io_done(int32_t bytes_io, bool in_isr) {
+  TU_VERIFY(_uasd_itf.pending_io);
+  usbd_defer_func(proc_async_io_done, (void*) (intptr_t) bytes_io, in_isr);
+  return true;
+}
+
+//--------------------------------------------------------------------+
+// USBD Driver API
+//--------------------------------------------------------------------+
+void uasd_init(void) {
+  TU_LOG_INT(CFG_TUD_UAS_LOG_LEVEL, sizeof(uasd_interface_t));
+  tu_memclr(&_uasd_itf, sizeof(uasd_interface_t));
+}
+
+bool uasd_deinit(void) {
+  return true; // nothing to do
+}
+
+void uasd_reset(uint8_t rhport) {
+  (void) rhport;
+  tu_memclr(&_uasd_itf, sizeof(uasd_interface_t));
+}
+
+uint16_t uasd_open(uint8_t rhport, tusb_desc_interface_t const* itf_desc, uint16_t max_len) {
+  TU_VERIFY(TUSB_CLASS_MSC    == itf_desc->bInterfaceClass &&
+            MSC_SUBCLASS_SCSI == itf_desc->bInterfaceSubClass &&
+            MSC_PROTOCOL_UAS  == itf_desc->bInterfaceProtocol, 0);
+
+  uasd_interface_t* p_uas = &_uasd_itf;
+  p_uas->itf_num = itf_desc->bInterfaceNumber;
+  p_uas->rhport  = rhport;
+
+  // Each endpoint is followed by a Pipe Usage descriptor telling its role
+  uint8_t const* p_desc = tu_desc_next(itf_desc);
+  uint8_t const* desc_end = ((uint8_t const*) itf_desc) + max_len;
+  uint8_t ep_addr = 0;
+  uint8_t found = 0;
+
+  while (found < 4 && p_desc < desc_end) {
+    if (TUSB_DESC_ENDPOINT == tu_desc_type(p_desc)) {
+      tusb_desc_endpoint_t const* desc_ep = (tusb_desc_endpoint_t const*) p_desc;
+      TU_ASSERT(TUSB_XFER_BULK == desc_ep->bmAttributes.xfer, 0);
+      TU_ASSERT(usbd_edpt_open(rhport, desc_ep), 0);
+      ep_addr = desc_ep->bEndpointAddress;
+    } else if (UAS_DESC_TYPE_PIPE_USAGE == tu_desc_type(p_desc)) {
+      switch (p_desc[2]) {
+        case UAS_PIPE_ID_COMMAND:  p_uas->ep_cmd      = ep_addr; break;
+        case UAS_PIPE_ID_STATUS:   p_uas->ep_status   = ep_addr; break;
+        case UAS_PIPE_ID_DATA_IN:  p_uas->ep_data_in  = ep_addr; break;
+        case UAS_PIPE_ID_DATA_OUT: p_uas->ep_data_out = ep_addr; break;
+        default: break;
+      }
+      found++;
+    } else {
+      // skip e.g SuperSpeed endpoint companion
+    }
+    p_desc = tu_desc_next(p_desc);
+  }
+
+  TU_ASSERT(p_uas->ep_cmd && p_uas->ep_status && p_uas->ep_data_in && p_uas->ep_data_out, 0);
+  uint16_t const drv_len = (uint16_t) (p_desc - (uint8_t const*) itf_desc);
+
+  // Prepare for Command IU
+  proc_queue(p_uas);
+
+  return drv_len;
+}
+
+bool uasd_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_request_t const* request) {
+  (void) rhport;
+  (void) stage;
+
+  // UAS has no class request, Clear Feature (stall) needs no action since endpoints are never stalled by driver
+  return TUSB_REQ_TYPE_STANDARD == request->bmRequestType_bit.type;
+}
+
+bool uasd_xfer_cb(uint8_t rhport, uint8_t ep_addr, xfer_result_t event, uint32_t xferred_bytes) {
+  (void) rhport;
+  uasd_interface_t* p_uas = &_uasd_itf;
+  uasd_cmd_t* cmd = active_cmd(p_uas);
+
+  if (ep_addr == p_uas->ep_cmd) {
+    p_uas->cmd_busy = false;
+    if (event == XFER_RESULT_SUCCESS) {
+      proc_iu(p_uas, xferred_bytes);
+    }
+  } else if (ep_addr == p_uas->ep_status) {
+    uint8_t const iu_id = p_uas->status_iu;
+    p_uas->status_iu = 0;
+
+    if (cmd != NULL) {
+      if ((iu_id == UAS_IU_ID_READ_READY || iu_id == UAS_IU_ID_WRITE_READY) && cmd->state == UAS_CMD_READY_SENT) {
+        proc_data_start(p_uas, cmd);
+      } else if (iu_id == UAS_IU_ID_SENSE && cmd->state == UAS_CMD_SENSE_SENT) {
+        proc_cmd_complete(p_uas, cmd);
+      } else {
+        // nothing to do
+      }
+    }
+  } else if (ep_addr == p_uas->ep_data_in) {
+    p_uas->data_busy = false;
+    TU_VERIFY(cmd != NULL && cmd->state == UAS_CMD_DATA);
+    p_uas->xferred_len += xferred_bytes;
+
+    if (event != XFER_RESULT_SUCCESS) {
+      fail_cmd(p_uas);
+    } else if (p_uas->xferred_len >= p_uas->total_len) {
+      cmd->state = UAS_CMD_SENSE;
+    } else {
+      proc_read_media(p_uas);
+    }
+  } else if (ep_addr == p_uas->ep_data_out) {
+    p_uas->data_busy = false;
+    TU_VERIFY(cmd != NULL && cmd->state == UAS_CMD_DATA);
+
+    if (event != XFER_RESULT_SUCCESS) {
+      fail_cmd(p_uas);
+    } else {
+      // short packet: host has less data than CDB specified, only process what is received
+      if (xferred_bytes < tu_min32(CFG_TUD_UAS_EP_BUFSIZE, p_uas->total_len - p_uas->xferred_len)) {
+        p_uas->total_len = p_uas->xferred_len + xferred_bytes;
+      }
+      p_uas->buf_len = (uint16_t) xferred_bytes;
+
+      if (is_cmd_write(cmd->cdb[0])) {
+        if (xferred_bytes > 0) {
+          proc_write_media(p_uas);
+        } else {
+          cmd->state = UAS_CMD_SENSE;
+        }
+      } else {
+        p_uas->xferred_len = xferred_bytes;
+        if (mscd_proc_scsi_out(cmd->lun, cmd->cdb, _uasd_epbuf.data, xferred_bytes) < 0) {
+          TU_LOG_DRV("  UAS unsupported command\r\n");
+          fail_cmd(p_uas);
+        } else {
+          cmd->state = UAS_CMD_SENSE;
+        }
+      }
+    }
+  } else {
+    return false;
+  }
+
+  proc_queue(p_uas);
+  return true;
+}
+
+#endif
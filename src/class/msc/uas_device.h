@@ -0,0 +1,74 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2019 Ha Thach (tinyusb.org)
+ * SPDX-License-Identifier: MIT
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#ifndef TUSB_UAS_DEVICE_H_
+#define TUSB_UAS_DEVICE_H_
+
+#include "common/tusb_common.h"
+#include "msc.h"
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+//--------------------------------------------------------------------+
+// Class Driver Configuration
+//--------------------------------------------------------------------+
+
+// UAS shares SCSI command set, sense data and tud_msc_* callbacks with the MSC driver
+#if !CFG_TUD_MSC
+  #error CFG_TUD_UAS requires CFG_TUD_MSC to be enabled
+#endif
+
+// Data stage buffer, READ/WRITE larger than this are split into multiple media I/O and USB transfers
+#ifndef CFG_TUD_UAS_EP_BUFSIZE
+  #define CFG_TUD_UAS_EP_BUFSIZE  CFG_TUD_MSC_EP_BUFSIZE
+#endif
+
+// Number of commands (tags) host can have outstanding. Commands are executed in arrival order, the command pipe
+// is not re-armed while the queue is full.
+#ifndef CFG_TUD_UAS_QUEUE_DEPTH
+  #define CFG_TUD_UAS_QUEUE_DEPTH 4
+#endif
+
+TU_VERIFY_STATIC(CFG_TUD_UAS_EP_BUFSIZE >= 64 && CFG_TUD_UAS_EP_BUFSIZE < UINT16_MAX, "Size is not correct");
+TU_VERIFY_STATIC(CFG_TUD_UAS_QUEUE_DEPTH >= 1 && CFG_TUD_UAS_QUEUE_DEPTH <= 32, "Queue depth is not correct");
+
+//--------------------------------------------------------------------+
+// Application API
+//--------------------------------------------------------------------+
+// UAS uses MSC application API and callbacks: tud_msc_set_sense(), tud_msc_async_io_done(), tud_msc_read10_cb(),
+// tud_msc_write10_cb() etc... Zero-copy tud_msc_read10_map_cb()/tud_msc_write10_map_cb() are not used by UAS.
+
+typedef enum {
+  UASD_CMD_UNSUPPORTED = 0, // failed with ILLEGAL REQUEST / INVALID COMMAND OPERATION CODE
+  UASD_CMD_DATA_IN,         // data-in or no data: tud_msc_scsi_cb() is invoked to get the response
+  UASD_CMD_DATA_OUT,        // data-out: tud_msc_scsi_cb() is invoked once parameter data is received
+} uasd_cmd_dir_t;
+
+// Invoked for a SCSI command not built into the driver, since UAS Command IU does not carry data direction.
+// Optional: default returns UASD_CMD_UNSUPPORTED
+uasd_cmd_dir_t tud_uas_cmd_dir_cb(uint8_t lun, uint8_t const scsi_cmd[16]);
+
+//--------------------------------------------------------------------+
+// Internal Class Driver API
+//--------------------------------------------------------------------+
+void     uasd_init            (void);
+bool     uasd_deinit          (void);
+void     uasd_reset           (uint8_t rhport);
+uint16_t uasd_open            (uint8_t rhport, tusb_desc_interface_t const * itf_desc, uint16_t max_len);
+bool     uasd_control_xfer_cb (uint8_t rhport, uint8_t stage, tusb_control_request_t const * p_request);
+bool     uasd_xfer_cb         (uint8_t rhport, uint8_t ep_addr, xfer_result_t event, uint32_t xferred_bytes);
+
+// Async media I/O done, forwarded from tud_msc_async_io_done()
+bool     uasd_async_io_done   (int32_t bytes_io, bool in_isr);
+
+#ifdef __cplusplus
+ }
+#endif
+
+#endif /* TUSB_UAS_DEVICE_H_ */
@@ -249,6 +249,9 @@
   #define tu_htonl(u32)  (TU_BSWAP32(u32))
   #define tu_ntohl(u32)  (TU_BSWAP32(u32))
 
+  #define tu_htonll(u64) ((((uint64_t) tu_htonl((uint32_t) (u64))) << 32) | tu_htonl((uint32_t) ((u64) >> 32)))
+  #define tu_ntohll(u64) tu_htonll(u64)
+
   #define tu_htole16(u16) (u16)
   #define tu_le16toh(u16) (u16)
 
@@ -263,6 +266,9 @@
   #define tu_htonl(u32)  (u32)
   #define tu_ntohl(u32)  (u32)
 
+  #define tu_htonll(u64) (u64)
+  #define tu_ntohll(u64) (u64)
+
   #define tu_htole16(u16) (TU_BSWAP16(u16))
   #define tu_le16toh(u16) (TU_BSWAP16(u16))
 
@@ -732,6 +732,30 @@
   #define TUP_USBIP_FSDEV_APM32
   #define CFG_TUSB_FSDEV_PMA_SIZE 1024u
 
+//--------------------------------------------------------------------+
+// Virtual
+//--------------------------------------------------------------------+
+#elif TU_CHECK_MCU(OPT_MCU_LOOPBACK)
+  #define TUP_DCD_ENDPOINT_MAX 16
+  #define TUP_RHPORT_HIGHSPEED 1
+
+#elif TU_CHECK_MCU(OPT_MCU_USBIP)
+  #define TUP_DCD_ENDPOINT_MAX 16
+  #define TUP_RHPORT_HIGHSPEED 1
+
+  // TCP port and bus id exported to usbip client e.g "usbip attach -r 127.0.0.1 -b 1-1"
+  #ifndef CFG_TUD_USBIP_PORT
+    #define CFG_TUD_USBIP_PORT 3240
+  #endif
+
+  #ifndef CFG_TUD_USBIP_BIND_ADDR
+    #define CFG_TUD_USBIP_BIND_ADDR "127.0.0.1"
+  #endif
+
+  #ifndef CFG_TUD_USBIP_BUSID
+    #define CFG_TUD_USBIP_BUSID "1-1"
+  #endif
+
 #endif
 
 // External USB controller
@@ -161,7 +161,7 @@ static const usbd_class_driver_t _usbd_driver[] = {
         .control_xfer_cb  = cdcd_control_xfer_cb,
         .xfer_cb          = cdcd_xfer_cb,
         .xfer_isr         = NULL,
-        .sof              = NULL
+        .sof              = CFG_TUD_CDC_TX_COALESCE_SOF ? cdcd_sof_isr : NULL
     },
     #endif
 
@@ -179,6 +179,20 @@ static const usbd_class_driver_t _usbd_driver[] = {
     },
     #endif
 
+    #if CFG_TUD_UAS
+    {
+        .name             = DRIVER_NAME("UAS"),
+        .init             = uasd_init,
+        .deinit           = uasd_deinit,
+        .reset            = uasd_reset,
+        .open             = uasd_open,
+        .control_xfer_cb  = uasd_control_xfer_cb,
+        .xfer_cb          = uasd_xfer_cb,
+        .xfer_isr         = NULL,
+        .sof              = NULL
+    },
+    #endif
+
     #if CFG_TUD_HID
     {
         .name             = DRIVER_NAME("HID"),
@@ -278,6 +278,30 @@ bool tud_vendor_control_xfer_cb(uint8_t rhport, uint8_t stage, tusb_control_requ
   /* Endpoint In */\
   7, TUSB_DESC_ENDPOINT, _epin, TUSB_XFER_BULK, U16_TO_U8S_LE(_epsize), 0
 
+//--------------------------------------------------------------------+
+// UAS Descriptor Templates
+//--------------------------------------------------------------------+
+
+// Length of template descriptor: 53 bytes
+#define TUD_UAS_DESC_LEN    (9 + 4*(7 + 4))
+
+// Interface number, string index, EP Command Out, Status In, Data In, Data Out address, EP size
+#define TUD_UAS_DESCRIPTOR(_itfnum, _stridx, _epcmd, _epstatus, _epdatain, _epdataout, _epsize) \
+  /* Interface */\
+  9, TUSB_DESC_INTERFACE, _itfnum, 0, 4, TUSB_CLASS_MSC, MSC_SUBCLASS_SCSI, MSC_PROTOCOL_UAS, _stridx,\
+  /* Command pipe */\
+  7, TUSB_DESC_ENDPOINT, _epcmd, TUSB_XFER_BULK, U16_TO_U8S_LE(_epsize), 0,\
+  UAS_DESC_PIPE_USAGE_LEN, UAS_DESC_TYPE_PIPE_USAGE, UAS_PIPE_ID_COMMAND, 0,\
+  /* Status pipe */\
+  7, TUSB_DESC_ENDPOINT, _epstatus, TUSB_XFER_BULK, U16_TO_U8S_LE(_epsize), 0,\
+  UAS_DESC_PIPE_USAGE_LEN, UAS_DESC_TYPE_PIPE_USAGE, UAS_PIPE_ID_STATUS, 0,\
+  /* Data In pipe */\
+  7, TUSB_DESC_ENDPOINT, _epdatain, TUSB_XFER_BULK, U16_TO_U8S_LE(_epsize), 0,\
+  UAS_DESC_PIPE_USAGE_LEN, UAS_DESC_TYPE_PIPE_USAGE, UAS_PIPE_ID_DATA_IN, 0,\
+  /* Data Out pipe */\
+  7, TUSB_DESC_ENDPOINT, _epdataout, TUSB_XFER_BULK, U16_TO_U8S_LE(_epsize), 0,\
+  UAS_DESC_PIPE_USAGE_LEN, UAS_DESC_TYPE_PIPE_USAGE, UAS_PIPE_ID_DATA_OUT, 0
+
 //--------------------------------------------------------------------+
 // Printer Descriptor Templates
 //--------------------------------------------------------------------+
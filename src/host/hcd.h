@@ -145,6 +145,15 @@ bool hcd_edpt_close(uint8_t rhport, uint8_t daddr, uint8_t ep_addr);
 // Submit a transfer, when complete hcd_event_xfer_complete() must be invoked
 bool hcd_edpt_xfer(uint8_t rhport, uint8_t daddr, uint8_t ep_addr, uint8_t * buffer, uint16_t buflen);
 
+// Optional: number of transfers that can be submitted to an endpoint before previous one is complete, i.e HCD keeps
+// its own transfer descriptor list and completes them in order. Default is 1
+uint8_t hcd_edpt_xfer_depth(uint8_t rhport, uint8_t daddr, uint8_t ep_addr);
+
+// Optional: return true if hcd_edpt_xfer() may be invoked from hcd_event_handler() in ISR context with usbh spinlock
+// held, to re-arm queued transfers right away. hcd_edpt_xfer() must then not block nor take usbh_spin_lock(false).
+// Default is false: queued transfers are re-armed by usbh task
+bool hcd_edpt_xfer_isr_safe(uint8_t rhport);
+
 // Abort a queued transfer. Note: it can only abort transfer that has not been started
 // Return true if a queued transfer is aborted, false if there is no transfer to abort
 bool hcd_edpt_abort_xfer(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr);
@@ -152,6 +161,16 @@ bool hcd_edpt_abort_xfer(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr);
 // Submit a special transfer to send 8-byte Setup Packet, when complete hcd_event_xfer_complete() must be invoked
 bool hcd_setup_send(uint8_t rhport, uint8_t daddr, uint8_t const setup_packet[8]);
 
+// Optional: number of control transfers on different devices that can be in progress at the same time. Default is 1
+uint8_t hcd_control_xfer_max(uint8_t rhport);
+
+// Optional: submit an isochronous transfer. Packets are scheduled one per service interval starting at
+// xfer->start_frame (or TUH_ISO_START_ASAP). HCD must accept multiple transfers per endpoint, update start_frame and
+// each packet's actual_len/result, then invoke hcd_event_xfer_complete() once per transfer in submission order.
+// hcd_edpt_abort_xfer() must drop all of them without completion event.
+struct tuh_iso_xfer_s;
+bool hcd_edpt_iso_xfer(uint8_t rhport, uint8_t daddr, uint8_t ep_addr, struct tuh_iso_xfer_s* xfer);
+
 // clear stall, data toggle is also reset to DATA0
 bool hcd_edpt_clear_stall(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr);
 
@@ -31,14 +31,23 @@ typedef struct {
   // uint16_t wHubCharacteristics;
   bool mtt;
   hub_port_status_response_t port_status;
+  tuh_xfer_cb_t port_status_cb; // user callback of hub_port_get_status(), per hub since hubs enumerate in parallel
+
+  // status change processing
+  uint32_t change_bm;    // hub (bit 0) and ports reported by status endpoint, not processed yet
+  uint32_t enum_bm;      // ports whose device is being enumerated, their changes are handled by usbh meanwhile
+  hub_port_status_response_t change_status; // status of port being processed
+  uint8_t change_port;   // port being processed, 0 is hub
+  uint8_t change_count;  // number of CLEAR_FEATURE requests in flight
+  bool change_busy;
 } hub_interface_t;
 
 typedef struct {
   TUH_EPBUF_DEF(status_change, 4); // interrupt endpoint
+  TUH_EPBUF_DEF(change_buf, 4);    // GET_STATUS of status change processing
   TUH_EPBUF_DEF(ctrl_buf, CFG_TUH_HUB_BUFSIZE);
 } hub_epbuf_t;
 
-static tuh_xfer_cb_t user_complete_cb = NULL;
 static hub_interface_t hub_itfs[CFG_TUH_HUB];
 CFG_TUH_MEM_SECTION static hub_epbuf_t hub_epbufs[CFG_TUH_HUB];
 
@@ -97,7 +106,7 @@ bool hub_port_clear_feature(uint8_t hub_addr, uint8_t hub_port, uint8_t feature,
   };
 
   TU_LOG_DRV("HUB Clear Feature: %s, addr = %u port = %u\r\n", _hub_feature_str[feature], hub_addr, hub_port);
-  TU_ASSERT(tuh_control_xfer(&xfer));
+  TU_VERIFY(tuh_control_xfer(&xfer)); // control queue may be full, caller retries
   return true;
 }
 
@@ -130,20 +139,20 @@ bool hub_port_set_feature(uint8_t hub_addr, uint8_t hub_port, uint8_t feature,
 }
 
 static void port_get_status_complete (tuh_xfer_t* xfer) {
+  hub_interface_t* p_hub = get_hub_itf(xfer->daddr);
   if (xfer->result == XFER_RESULT_SUCCESS) {
-    hub_interface_t* p_hub = get_hub_itf(xfer->daddr);
     p_hub->port_status = *((const hub_port_status_response_t *) (uintptr_t) xfer->buffer);
   }
 
-  xfer->complete_cb = user_complete_cb;
-  user_complete_cb = NULL;
+  xfer->complete_cb = p_hub->port_status_cb;
+  p_hub->port_status_cb = NULL;
   if (xfer->complete_cb) {
     xfer->complete_cb(xfer);
   }
 }
 
-bool hub_port_get_status(uint8_t hub_addr, uint8_t hub_port, void* resp,
-                         tuh_xfer_cb_t complete_cb, uintptr_t user_data) {
+static bool get_status_xfer(uint8_t hub_addr, uint8_t hub_port, void* resp,
+                            tuh_xfer_cb_t complete_cb, uintptr_t user_data) {
   tusb_control_request_t const request = {
     .bmRequestType_bit = {
       .recipient = (hub_port == 0) ? TUSB_REQ_RCPT_DEVICE : TUSB_REQ_RCPT_OTHER,
@@ -165,19 +174,21 @@ bool hub_port_get_status(uint8_t hub_addr, uint8_t hub_port, void* resp,
     .user_data   = user_data
   };
 
+  TU_LOG_DRV("HUB Get Port Status: addr = %u port = %u\r\n", hub_addr, hub_port);
+  TU_VERIFY(tuh_control_xfer(&xfer));
+  return true;
+}
+
+bool hub_port_get_status(uint8_t hub_addr, uint8_t hub_port, void* resp,
+                         tuh_xfer_cb_t complete_cb, uintptr_t user_data) {
   if (hub_port != 0) {
     // intercept complete callback to save port status, ignore resp
-    hub_epbuf_t* p_epbuf = get_hub_epbuf(hub_addr);
-    xfer.complete_cb = port_get_status_complete;
-    xfer.buffer = p_epbuf->ctrl_buf;
-    user_complete_cb = complete_cb;
-  } else {
-    user_complete_cb = NULL;
+    resp = get_hub_epbuf(hub_addr)->ctrl_buf;
+    get_hub_itf(hub_addr)->port_status_cb = complete_cb;
+    complete_cb = port_get_status_complete;
   }
 
-  TU_LOG_DRV("HUB Get Port Status: addr = %u port = %u\r\n", hub_addr, hub_port);
-  TU_VERIFY(tuh_control_xfer(&xfer));
-  return true;
+  return get_status_xfer(hub_addr, hub_port, resp, complete_cb, user_data);
 }
 
 bool hub_port_get_status_local(uint8_t hub_addr, uint8_t hub_port, hub_port_status_response_t* resp) {
@@ -250,8 +261,11 @@ bool hub_edpt_status_xfer(uint8_t daddr) {
   hub_interface_t* p_hub = get_hub_itf(daddr);
   hub_epbuf_t* p_epbuf = get_hub_epbuf(daddr);
 
+  // bitmap of hub (bit 0) and its ports, up to 31 ports are supported
+  const uint16_t len = tu_min16((uint16_t) ((p_hub->bNbrPorts + 8u) / 8u), 4);
+
   TU_VERIFY(usbh_edpt_claim(daddr, p_hub->ep_in));
-  if (!usbh_edpt_xfer(daddr, p_hub->ep_in, p_epbuf->status_change, 1)) {
+  if (!usbh_edpt_xfer(daddr, p_hub->ep_in, p_epbuf->status_change, len)) {
     usbh_edpt_release(daddr, p_hub->ep_in);
     return false;
   }
@@ -347,135 +361,141 @@ static void config_port_power_complete (tuh_xfer_t* xfer) {
 
 //--------------------------------------------------------------------+
 // Connection Changes
+//
+// Status endpoint is kept armed and changes it reports are accumulated in change_bm. Changed ports are processed back
+// to back without waiting for next report: GET_STATUS then CLEAR_FEATURE for all of its change bits queued at once,
+// then attach/remove event is raised for connection change. A port is left to usbh while its device is enumerated
+// (port reset and its change are handled there) until hub_port_release().
 //--------------------------------------------------------------------+
 enum {
-  STATE_IDLE = 0,
-  STATE_HUB_STATUS,
-  STATE_CLEAR_CHANGE,
-  STATE_CHECK_CONN,
-  STATE_COMPLETE
+  STATE_GET_STATUS = 0,
+  STATE_CLEAR_CHANGE
 };
 
 static void process_new_status(tuh_xfer_t* xfer);
 
+// Start processing next changed hub/port if none is in progress
+static void change_process_next(uint8_t daddr) {
+  hub_interface_t* p_hub = get_hub_itf(daddr);
+  const uint32_t ready_bm = p_hub->change_bm & ~p_hub->enum_bm;
+  if (p_hub->change_busy || ready_bm == 0) {
+    return;
+  }
+
+  uint8_t port = 0;
+  while (!tu_bit_test(ready_bm, port)) {
+    port++;
+  }
+
+  p_hub->change_bm   = tu_bit_clear(p_hub->change_bm, port);
+  p_hub->change_port  = port;
+  p_hub->change_count = 0;
+  p_hub->change_busy  = true;
+  tu_memclr(&p_hub->change_status, sizeof(hub_port_status_response_t));
+
+  if (!get_status_xfer(daddr, port, get_hub_epbuf(daddr)->change_buf, process_new_status, STATE_GET_STATUS)) {
+    // control transfer queue is full, change is still pending in hub and will be reported again
+    p_hub->change_busy = false;
+  }
+}
+
+// All change bits are acknowledged: report connection change to usbh and continue with next port
+static void change_complete(uint8_t daddr) {
+  hub_interface_t* p_hub = get_hub_itf(daddr);
+  const uint8_t port = p_hub->change_port;
+  const hub_port_status_response_t* port_status = &p_hub->change_status;
+
+  if (port == 0) {
+    TU_LOG_DRV("HUB Got hub status, addr = %u, status = %04x\r\n", daddr, port_status->change.value);
+  } else if (port_status->change.connection) {
+    const hcd_event_t event = {
+      .rhport     = usbh_get_rhport(daddr),
+      .event_id   = port_status->status.connection ? HCD_EVENT_DEVICE_ATTACH : HCD_EVENT_DEVICE_REMOVE,
+      .connection = {
+        .hub_addr = daddr,
+        .hub_port = port
+      }
+    };
+    if (event.event_id == HCD_EVENT_DEVICE_ATTACH) {
+      p_hub->enum_bm = tu_bit_set(p_hub->enum_bm, port); // usbh resets and enumerates this port
+    }
+    hcd_event_handler(&event, false);
+  }
+
+  p_hub->change_busy = false;
+  change_process_next(daddr);
+}
+
+void hub_port_release(uint8_t hub_addr, uint8_t hub_port) {
+  TU_VERIFY(hub_addr > CFG_TUH_DEVICE_MAX, );
+  hub_interface_t* p_hub = get_hub_itf(hub_addr);
+  TU_VERIFY(p_hub->ep_in != 0, );
+
+  p_hub->enum_bm = tu_bit_clear(p_hub->enum_bm, hub_port);
+  change_process_next(hub_addr); // changes reported meanwhile
+}
+
 // callback as response of interrupt endpoint polling
 bool hub_xfer_cb(uint8_t daddr, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes) {
-  (void) xferred_bytes;
   (void) ep_addr;
-
-  bool processed = false; // true if new status is processed
+  hub_interface_t* p_hub = get_hub_itf(daddr);
 
   if (result == XFER_RESULT_SUCCESS) {
-    hub_interface_t* p_hub = get_hub_itf(daddr);
-    hub_epbuf_t *p_epbuf = get_hub_epbuf(daddr);
-    const uint8_t status_change = p_epbuf->status_change[0];
-    TU_LOG_DRV("  Hub Status Change = 0x%02X\r\n", status_change);
-
-    if (status_change == 0) {
-      // The status change event was neither for the hub, nor for any of its ports.
-      // This shouldn't happen, but it does with some devices. Re-Initiate the interrupt poll.
-      processed = false;
-    } else if (tu_bit_test(status_change, 0)) {
-      // Hub bit 0 is for the hub device events
-      processed = hub_get_status(daddr, p_epbuf->ctrl_buf, process_new_status, STATE_HUB_STATUS);
-    } else {
-      // Hub bits 1 to n are hub port events
-      for (uint8_t port=1; port <= p_hub->bNbrPorts; port++) {
-        if (tu_bit_test(status_change, port)) {
-          processed = hub_port_get_status(daddr, port, NULL, process_new_status, STATE_CLEAR_CHANGE);
-          break; // after completely processed one port, we will re-queue the status poll and handle next one
-        }
-      }
+    const uint8_t* status_change = get_hub_epbuf(daddr)->status_change;
+    uint32_t change_bm = 0;
+    for (uint8_t i = 0; i < tu_min32(xferred_bytes, 4); i++) {
+      change_bm |= (uint32_t) status_change[i] << (8u * i);
     }
-  }
+    TU_LOG_DRV("  Hub Status Change = 0x%08" PRIX32 "\r\n", change_bm);
 
-  // If new status event is processed: next status pool is queued by usbh.c after handled this request
-  // Otherwise re-queue the status poll here
-  if (!processed) {
-    TU_ASSERT(hub_edpt_status_xfer(daddr));
+    // Empty bitmap shouldn't happen, but it does with some devices
+    p_hub->change_bm |= change_bm;
   }
 
+  // re-queue the status poll right away so that changes of other ports are collected while processing this batch
+  change_process_next(daddr);
+  TU_ASSERT(hub_edpt_status_xfer(daddr));
+
   return true;
 }
 
 static void process_new_status(tuh_xfer_t* xfer) {
   const uint8_t daddr = xfer->daddr;
-
-  if (xfer->result != XFER_RESULT_SUCCESS) {
-    TU_ASSERT(hub_edpt_status_xfer(daddr),);
-    return;
+  hub_interface_t* p_hub = get_hub_itf(daddr);
+  if (p_hub->ep_in == 0) {
+    return; // hub is closed
   }
 
-  const uint8_t port_num = (uint8_t) tu_le16toh(xfer->setup->wIndex);
-  hub_interface_t *p_hub = get_hub_itf(daddr);
-  const uintptr_t state = xfer->user_data;
-  bool processed = false; // true if new status is processed
-
-  switch (state) {
-    case STATE_HUB_STATUS: {
-      hub_status_response_t hub_status = *((const hub_status_response_t *) (uintptr_t) xfer->buffer);
-      TU_LOG_DRV("HUB Got hub status, addr = %u, status = %04x\r\n", daddr, hub_status.change.value);
-      if (hub_status.change.local_power_source) {
-        TU_LOG_DRV("  Local Power Change\r\n");
-        processed = hub_clear_feature(daddr, HUB_FEATURE_HUB_LOCAL_POWER_CHANGE,
-                                      process_new_status, STATE_COMPLETE);
-      } else if (hub_status.change.over_current) {
-        TU_LOG_DRV("  Over Current\r\n");
-        processed = hub_clear_feature(daddr, HUB_FEATURE_HUB_OVER_CURRENT_CHANGE,
-                                      process_new_status, STATE_COMPLETE);
-      }
-      break;
-    }
-
-    case STATE_CLEAR_CHANGE:
-      // Get port status complete --> clear change
-      if (p_hub->port_status.change.connection) {
-        // Connection change
-        // Port is powered and enabled
-        //TU_VERIFY(port_status.status_current.port_power && port_status.status_current.port_enable, );
-
-        // Acknowledge Port Connection Change
-        processed = hub_port_clear_feature(daddr, port_num, HUB_FEATURE_PORT_CONNECTION_CHANGE,
-                                           process_new_status, STATE_CHECK_CONN);
-      } else if (p_hub->port_status.change.port_enable) {
-        processed = hub_port_clear_feature(daddr, port_num, HUB_FEATURE_PORT_ENABLE_CHANGE,
-                                           process_new_status, STATE_COMPLETE);
-      } else if (p_hub->port_status.change.suspend) {
-        processed = hub_port_clear_feature(daddr, port_num, HUB_FEATURE_PORT_SUSPEND_CHANGE,
-                                           process_new_status, STATE_COMPLETE);
-      } else if (p_hub->port_status.change.over_current) {
-        processed = hub_port_clear_feature(daddr, port_num, HUB_FEATURE_PORT_OVER_CURRENT_CHANGE,
-                                           process_new_status, STATE_COMPLETE);
-      } else if (p_hub->port_status.change.reset) {
-        processed = hub_port_clear_feature(daddr, port_num, HUB_FEATURE_PORT_RESET_CHANGE,
-                                           process_new_status, STATE_COMPLETE);
-      }
-      break;
-
-    case STATE_CHECK_CONN: {
-      const hcd_event_t event = {
-        .rhport     = usbh_get_rhport(daddr),
-        .event_id   = p_hub->port_status.status.connection ? HCD_EVENT_DEVICE_ATTACH : HCD_EVENT_DEVICE_REMOVE,
-        .connection = {
-          .hub_addr = daddr,
-          .hub_port = port_num
+  const uint8_t port = p_hub->change_port;
+
+  if (xfer->user_data == STATE_GET_STATUS) {
+    if (xfer->result == XFER_RESULT_SUCCESS) {
+      p_hub->change_status = *((const hub_port_status_response_t*) (uintptr_t) xfer->buffer);
+      TU_LOG_DRV("HUB Got status, addr = %u port = %u, change = %04x\r\n", daddr, port, p_hub->change_status.change.value);
+
+      // Acknowledge all changes, requests are queued and sent back to back. Port change features start at
+      // PORT_CONNECTION_CHANGE, hub ones at HUB_LOCAL_POWER_CHANGE
+      const uint16_t change_mask = (port == 0) ? 0x0003u : 0x001Fu;
+      const uint8_t  feature_base = (port == 0) ? HUB_FEATURE_HUB_LOCAL_POWER_CHANGE : HUB_FEATURE_PORT_CONNECTION_CHANGE;
+      const uint16_t change = p_hub->change_status.change.value & change_mask;
+      for (uint8_t i = 0; i < 16; i++) {
+        if (tu_bit_test(change, i)) {
+          p_hub->change_count++;
+          if (!hub_port_clear_feature(daddr, port, (uint8_t) (feature_base + i), process_new_status, STATE_CLEAR_CHANGE)) {
+            // queue is full: remaining changes are reported again, only handle the acknowledged ones
+            p_hub->change_count--;
+            p_hub->change_status.change.value &= (uint16_t) (TU_BIT(i) - 1u);
+            break;
+          }
         }
-      };
-      hcd_event_handler(&event, false);
-      // skip status for attach event, usbh will do it after handled this enumeration
-      processed = (event.event_id == HCD_EVENT_DEVICE_ATTACH);
-      break;
+      }
     }
-
-    case STATE_COMPLETE:
-    default:
-      processed = false; // complete this status, queue next status
-      break;
-
+  } else if (p_hub->change_count > 0) {
+    p_hub->change_count--;
   }
 
-  if (!processed) {
-    TU_ASSERT(hub_edpt_status_xfer(daddr),);
+  if (p_hub->change_count == 0) {
+    change_complete(daddr);
   }
 }
 
@@ -168,6 +168,10 @@ bool hub_port_get_status_local(uint8_t hub_addr, uint8_t hub_port, hub_port_stat
 // Get status from Interrupt endpoint
 bool hub_edpt_status_xfer(uint8_t daddr);
 
+// Port is no longer handled by usbh after its device is addressed or failed to enumerate: hub driver processes its
+// status change again
+void hub_port_release(uint8_t hub_addr, uint8_t hub_port);
+
 // Reset a port
 TU_ATTR_ALWAYS_INLINE static inline
 bool hub_port_reset(uint8_t hub_addr, uint8_t hub_port, tuh_xfer_cb_t complete_cb, uintptr_t user_data) {
@@ -21,6 +21,7 @@
   #define CFG_TUH_TASK_QUEUE_SZ   16
 #endif
 
+// Number of control transfers (shared by all devices) waiting for their device or a free control channel
 #ifndef CFG_TUH_CONTROL_PENDING_QUEUE_SZ
   #if CFG_TUH_HUB
     #define CFG_TUH_CONTROL_PENDING_QUEUE_SZ 4
@@ -49,6 +50,26 @@ TU_ATTR_WEAK bool hcd_configure(uint8_t rhport, uint32_t cfg_id, const void* cfg
   return false;
 }
 
+TU_ATTR_WEAK uint8_t hcd_control_xfer_max(uint8_t rhport) {
+  (void) rhport;
+  return 1;
+}
+
+TU_ATTR_WEAK uint8_t hcd_edpt_xfer_depth(uint8_t rhport, uint8_t daddr, uint8_t ep_addr) {
+  (void) rhport; (void) daddr; (void) ep_addr;
+  return 1;
+}
+
+TU_ATTR_WEAK bool hcd_edpt_xfer_isr_safe(uint8_t rhport) {
+  (void) rhport;
+  return false;
+}
+
+TU_ATTR_WEAK bool hcd_edpt_iso_xfer(uint8_t rhport, uint8_t daddr, uint8_t ep_addr, struct tuh_iso_xfer_s* xfer) {
+  (void) rhport; (void) daddr; (void) ep_addr; (void) xfer;
+  return false;
+}
+
 TU_ATTR_WEAK void tuh_enum_descriptor_device_cb(uint8_t daddr, const tusb_desc_device_t *desc_device) {
   (void) daddr; (void) desc_device;
 }
@@ -112,6 +133,25 @@ typedef struct TU_ATTR_PACKED {
 
 TU_VERIFY_STATIC( sizeof(desc_device_noheader_t) == 16u, "size is not correct");
 
+#if CFG_TUH_EDPT_XFER_QUEUE
+// Transfers queued by tuh_edpt_xfer_queue(): the first 'submitted' ones of the list are owned by HCD
+typedef struct {
+  tuh_xfer_t* head;
+  tuh_xfer_t* done;   // completed in ISR, waiting for callback in usbh task
+  uint8_t submitted;
+  uint8_t active;     // endpoint is claimed by the queue until it is drained
+} usbh_xfer_queue_t;
+#endif
+
+#if CFG_TUH_ISO_XFER
+// Isochronous transfers submitted with tuh_iso_xfer(), all owned by HCD and completed in order
+typedef struct {
+  tuh_iso_xfer_t* head;
+  uint16_t max_len;   // max bytes per (micro)frame: wMaxPacketSize including additional transactions
+  uint8_t used;       // endpoint is driven by tuh_iso_xfer(), late completion after abort is dropped
+} usbh_iso_queue_t;
+#endif
+
 typedef struct {
   tuh_bus_info_t bus_info;
   desc_device_noheader_t desc_device;
@@ -126,18 +166,8 @@ typedef struct {
   };
 
   // Endpoint & Interface
-  uint8_t itf2drv[CFG_TUH_INTERFACE_MAX];  // map interface number to driver (0xff is invalid)
-  uint8_t ep2drv[CFG_TUH_ENDPOINT_MAX][2]; // map endpoint to driver ( 0xff is invalid ), can use only 4-bit each
-
-  volatile uint8_t ep_status[CFG_TUH_ENDPOINT_MAX][2];
-
-#if CFG_TUH_API_EDPT_XFER
-  // TODO array can be CFG_TUH_ENDPOINT_MAX-1
-  struct {
-    tuh_xfer_cb_t complete_cb;
-    uintptr_t user_data;
-  }ep_callback[CFG_TUH_ENDPOINT_MAX][2];
-#endif
+  uint8_t itf2drv[CFG_TUH_INTERFACE_MAX];     // map interface number to driver (0xff is invalid)
+  uint8_t ep_idx[CFG_TUH_ENDPOINT_MAX-1][2];  // map non-control endpoint to pool entry + 1 (0 is not allocated)
 
 } usbh_device_t;
 
@@ -149,6 +179,30 @@ typedef struct {
 // TODO: hub can has its own simpler struct to save memory
 static usbh_device_t _usbh_devices[TOTAL_DEVICES];
 
+// State of non-control endpoint, shared pool for all devices
+typedef struct {
+  uint8_t daddr;  // owner device, 0 if entry is free
+  uint8_t drv_id; // bound class driver (0xff is invalid)
+  volatile uint8_t status;
+
+#if CFG_TUH_API_EDPT_XFER
+  tuh_xfer_cb_t complete_cb;
+  uintptr_t user_data;
+#endif
+
+#if CFG_TUH_EDPT_XFER_QUEUE
+  usbh_xfer_queue_t xfer_queue;
+#endif
+
+#if CFG_TUH_ISO_XFER
+  usbh_iso_queue_t iso_queue;
+#endif
+} usbh_edpt_t;
+
+TU_VERIFY_STATIC(CFG_TUH_ENDPOINT_POOL_SIZE > 0 && CFG_TUH_ENDPOINT_POOL_SIZE < 255, "Endpoint pool size is not correct");
+
+static usbh_edpt_t _usbh_edpts[CFG_TUH_ENDPOINT_POOL_SIZE];
+
 // Mutex for claiming endpoint
 #if OSAL_MUTEX_REQUIRED
 static osal_mutex_def_t _usbh_mutexdef;
@@ -165,14 +219,13 @@ OSAL_QUEUE_DEF(usbh_int_set, _usbh_qdef, CFG_TUH_TASK_QUEUE_SZ, hcd_event_t);
 static osal_queue_t _usbh_q;
 
 #if CFG_TUH_HUB
-// Deferred attachment queue, only needed when using hub
-OSAL_QUEUE_DEF(usbh_int_set, _usbh_daqdef, CFG_TUH_HUB, hcd_event_t);
+// Deferred attachment queue, only needed when using hub. A hub reports all its attached ports at once
+OSAL_QUEUE_DEF(usbh_int_set, _usbh_daqdef, TOTAL_DEVICES, hcd_event_t);
 static osal_queue_t _usbh_daq;
 #endif
 
-// Control transfers: since most controllers do not support multiple control transfers
-// on multiple devices concurrently and control transfers are not used much except for
-// enumeration, we will only execute control transfers one at a time.
+// Control transfers: each device (including address 0) has its own control context, so that transfers on different
+// devices can be in progress at the same time up to hcd_control_xfer_max(). Most controllers only support one at a time.
 typedef struct {
   uint8_t* buffer;
   tuh_xfer_cb_t complete_cb;
@@ -180,7 +233,6 @@ typedef struct {
 
   volatile uint16_t actual_len;
   volatile uint8_t stage;
-  uint8_t daddr;
   uint8_t failed_count;
 } usbh_ctrl_xfer_info_t;
 
@@ -199,15 +251,36 @@ typedef struct {
   uint8_t                daddr_gen;
 } usbh_pending_ctrl_t;
 
-// FIFO for pending async control transfers since we only execute 1 control transfer at a time
-TU_FIFO_DEF(_usbh_pending_ctrl_q, CFG_TUH_CONTROL_PENDING_QUEUE_SZ * sizeof(usbh_pending_ctrl_t), false);
+// Enumeration instance: several devices can be enumerated in parallel, but only one of them can be at address 0
+// (from port reset until SET_ADDRESS) and only one can configure class drivers since they share usbh_get_enum_buf().
+typedef struct {
+  tuh_bus_info_t bus;   // bus info of device being enumerated
+  uint8_t daddr;        // assigned address, 0 until SET_ADDRESS is complete
+  uint8_t gen;          // bumped for each enumeration to drop stale callbacks
+  uint8_t wait_state;   // delay state to resume when the waited window is released
+  struct TU_ATTR_PACKED {
+    uint8_t active     : 1;
+    uint8_t waiting    : 1; // waiting for address 0 or configuration window
+    uint8_t hub_paused : 1; // parent hub leaves port status change to us until device is addressed
+  };
+#if CFG_TUH_ENUM_CACHE
+  uint8_t cache_idx;    // cache entry being matched or filled, TUSB_INDEX_INVALID_8 if none
+#endif
+} usbh_enum_t;
 
 typedef struct {
-  uint8_t enumerating_daddr;  // device address of the device being enumerated
   uint8_t attach_debouncing_bm;  // bitmask for roothub port attach debouncing
-  tuh_bus_info_t dev0_bus;    // bus info for dev0 in enumeration
-  usbh_ctrl_xfer_info_t ctrl_xfer_info; // control transfer
-  usbh_call_after_t call_after;
+  uint8_t addr0_owner;           // enum instance at address 0, TUSB_INDEX_INVALID_8 if none
+  uint8_t config_owner;          // enum instance configuring class drivers, TUSB_INDEX_INVALID_8 if none
+  usbh_enum_t enum_dev[CFG_TUH_ENUM_MAX];
+  usbh_ctrl_xfer_info_t ctrl_xfer_info[TOTAL_DEVICES + 1]; // control transfer context per device address
+
+  // Control transfers waiting for their device context or a free HCD control channel, in submission order.
+  // Dispatched round-robin across devices so that a busy device does not starve the others.
+  usbh_pending_ctrl_t ctrl_pending[CFG_TUH_CONTROL_PENDING_QUEUE_SZ];
+  uint8_t ctrl_pending_count;
+  uint8_t ctrl_rr_daddr; // device address dispatched last
+  usbh_call_after_t call_after[CFG_TUH_ENUM_MAX];
   // Per-daddr generation counter — bumped on usbh_device_close() to identify stale pending control transfer
   uint8_t daddr_gen[TOTAL_DEVICES + 1];
 #if CFG_TUSB_OS_HAS_SCHEDULER
@@ -215,12 +288,24 @@ typedef struct {
 #endif
 } usbh_data_t;
 
-static uint8_t _usbh_controller_id = TUSB_INDEX_INVALID_8;
+// Bitmap of active roothub ports (host controllers). All of them share the event queue, device addresses and
+// enumeration, but each has its own bus: events are tagged with rhport and devices remember theirs in bus_info
+static uint8_t _usbh_rhport_bm;
+TU_VERIFY_STATIC(TUP_USBIP_CONTROLLER_NUM <= 8, "rhport bitmap is too small");
+
 static usbh_data_t _usbh_data;
 
+typedef struct {
+  TUH_EPBUF_DEF(buf, CFG_TUH_ENUMERATION_BUFSIZE);
+} usbh_enum_epbuf_t;
+
 typedef struct {
   TUH_EPBUF_TYPE_DEF(tusb_control_request_t, request);
-  TUH_EPBUF_DEF(ctrl, CFG_TUH_ENUMERATION_BUFSIZE);
+} usbh_request_epbuf_t;
+
+typedef struct {
+  usbh_request_epbuf_t setup[TOTAL_DEVICES + 1]; // setup packet of control transfer per device address
+  usbh_enum_epbuf_t ctrl[CFG_TUH_ENUM_MAX];
 } usbh_epbuf_t;
 CFG_TUH_MEM_SECTION static usbh_epbuf_t _usbh_epbuf;
 
@@ -334,52 +419,119 @@ TU_ATTR_ALWAYS_INLINE static inline usbh_class_driver_t const *get_driver(uint8_
 //--------------------------------------------------------------------+
 // Function Inline and Prototypes
 //--------------------------------------------------------------------+
-static void enum_new_device(hcd_event_t* event);
-static void enum_delay_async(uintptr_t state);
+static bool enum_new_device(hcd_event_t* event);
+static void enum_delay_async(uintptr_t arg);
+static void enum_full_complete(uint8_t idx, bool success);
 static void process_remove_event(hcd_event_t *event);
 static void remove_device_tree(uint8_t rhport, uint8_t hub_addr, uint8_t hub_port);
 
 static bool usbh_edpt_control_open(uint8_t dev_addr, uint8_t max_packet_size);
 static bool usbh_control_xfer_cb (uint8_t daddr, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes);
+static uint8_t control_xfer_pending_next(void);
+static void control_xfer_pending_pop(uint8_t idx, usbh_pending_ctrl_t* entry);
 static void control_xfer_dispatch_pending(void);
 static void control_xfer_complete(uint8_t daddr, xfer_result_t result);
 
+#if CFG_TUH_EDPT_XFER_QUEUE
+static void xfer_queue_isr(hcd_event_t const* event, bool in_isr);
+static bool xfer_queue_complete(usbh_device_t* dev, uint8_t daddr, uint8_t ep_addr);
+static void xfer_queue_abort(usbh_device_t* dev, uint8_t daddr, uint8_t ep_addr, xfer_result_t result);
+#endif
+
+#if CFG_TUH_ISO_XFER
+static bool iso_xfer_complete(usbh_device_t* dev, uint8_t ep_addr, xfer_result_t result);
+static void iso_xfer_abort(usbh_device_t* dev, uint8_t ep_addr, xfer_result_t result);
+#endif
+
 TU_ATTR_ALWAYS_INLINE static inline usbh_device_t* get_device(uint8_t dev_addr) {
   TU_VERIFY(dev_addr > 0 && dev_addr <= TOTAL_DEVICES, NULL);
   return &_usbh_devices[dev_addr-1];
 }
 
+// Get state of non-control endpoint, NULL if it is not allocated
+TU_ATTR_ALWAYS_INLINE static inline usbh_edpt_t* get_edpt(usbh_device_t* dev, uint8_t ep_addr) {
+  const uint8_t epnum = tu_edpt_number(ep_addr);
+  TU_VERIFY(epnum > 0 && epnum < CFG_TUH_ENDPOINT_MAX, NULL);
+  const uint8_t idx = dev->ep_idx[epnum-1][tu_edpt_dir(ep_addr)];
+  return (idx > 0) ? &_usbh_edpts[idx-1] : NULL;
+}
+
 TU_ATTR_ALWAYS_INLINE static inline bool is_hub_addr(uint8_t daddr) {
   return (CFG_TUH_HUB > 0) && (daddr > CFG_TUH_DEVICE_MAX); //-V560
 }
 
+TU_ATTR_ALWAYS_INLINE static inline bool enum_slot_available(void) {
+  for (uint8_t idx = 0; idx < CFG_TUH_ENUM_MAX; idx++) {
+    if (!_usbh_data.enum_dev[idx].active) {
+      return true;
+    }
+  }
+  return false;
+}
+
 TU_ATTR_ALWAYS_INLINE static inline bool queue_event(hcd_event_t const * event, bool in_isr) {
   TU_ASSERT(osal_queue_send(_usbh_q, event, in_isr));
   tuh_event_hook_cb(event->rhport, event->event_id, in_isr);
   return true;
 }
 
-TU_ATTR_ALWAYS_INLINE static inline void control_xfer_set_stage(uint8_t stage) {
-  if (_usbh_data.ctrl_xfer_info.stage != stage) {
+TU_ATTR_ALWAYS_INLINE static inline void control_xfer_set_stage(uint8_t daddr, uint8_t stage) {
+  if (_usbh_data.ctrl_xfer_info[daddr].stage != stage) {
     (void) osal_mutex_lock(_usbh_mutex, OSAL_TIMEOUT_WAIT_FOREVER);
-    _usbh_data.ctrl_xfer_info.stage = stage;
+    _usbh_data.ctrl_xfer_info[daddr].stage = stage;
     (void) osal_mutex_unlock(_usbh_mutex);
   }
 }
 
 bool usbh_defer_func_ms_async(uint32_t ms, tusb_defer_func_t func, uintptr_t param) {
-  TU_ASSERT(_usbh_data.call_after.func == NULL);
+  usbh_call_after_t* call_after = NULL;
+  for (uint8_t i = 0; i < CFG_TUH_ENUM_MAX; i++) {
+    if (_usbh_data.call_after[i].func == NULL) {
+      call_after = &_usbh_data.call_after[i];
+      break;
+    }
+  }
+  TU_ASSERT(call_after != NULL);
+
   TU_LOG_USBH("USBH schedule function after %u ms\r\n", (unsigned int)ms);
-  _usbh_data.call_after.func  = func;
-  _usbh_data.call_after.arg   = param;
+  call_after->func  = func;
+  call_after->arg   = param;
   // add one to ensure we wait at least 'ms' milliseconds
-  _usbh_data.call_after.at_ms = tusb_time_millis_api() + ms + 1;
+  call_after->at_ms = tusb_time_millis_api() + ms + 1;
   return true;
 }
 
-TU_ATTR_ALWAYS_INLINE static inline void usbh_device_close(uint8_t rhport, uint8_t daddr) {
+static void usbh_device_close(uint8_t rhport, uint8_t daddr) {
   hcd_device_close(rhport, daddr);
 
+#if CFG_TUH_EDPT_XFER_QUEUE
+  // complete all queued transfers as FAILED
+  usbh_device_t* dev = get_device(daddr);
+  if (dev != NULL) {
+    for (uint8_t epnum = 1; epnum < CFG_TUH_ENDPOINT_MAX; epnum++) {
+      for (uint8_t dir = 0; dir < 2; dir++) {
+        xfer_queue_abort(dev, daddr, tu_edpt_addr(epnum, dir), XFER_RESULT_FAILED);
+      }
+    }
+  }
+#endif
+
+#if CFG_TUH_ISO_XFER
+  // complete all isochronous transfers as FAILED
+  usbh_device_t* iso_dev = get_device(daddr);
+  if (iso_dev != NULL) {
+    for (uint8_t epnum = 1; epnum < CFG_TUH_ENDPOINT_MAX; epnum++) {
+      for (uint8_t dir = 0; dir < 2; dir++) {
+        usbh_edpt_t* ep = get_edpt(iso_dev, tu_edpt_addr(epnum, dir));
+        if (ep != NULL) {
+          iso_xfer_abort(iso_dev, tu_edpt_addr(epnum, dir), XFER_RESULT_FAILED);
+          ep->iso_queue.used = 0;
+        }
+      }
+    }
+  }
+#endif
+
   // Bump the generation under the mutex so a concurrent producer in
   // tuh_control_xfer stamps a value that is strictly monotonic w.r.t. close.
   (void) osal_mutex_lock(_usbh_mutex, OSAL_TIMEOUT_WAIT_FOREVER);
@@ -387,18 +539,31 @@ TU_ATTR_ALWAYS_INLINE static inline void usbh_device_close(uint8_t rhport, uint8
   (void) osal_mutex_unlock(_usbh_mutex);
 
   // If this device has in-flight control xfer, complete as FAILED
-  usbh_ctrl_xfer_info_t* ctrl_info = &_usbh_data.ctrl_xfer_info;
-  if (daddr == ctrl_info->daddr && ctrl_info->stage != CONTROL_STAGE_IDLE) {
+  if (_usbh_data.ctrl_xfer_info[daddr].stage != CONTROL_STAGE_IDLE) {
     control_xfer_complete(daddr, XFER_RESULT_FAILED);
   }
 
-  // invalidate if enumerating
-  if (daddr == _usbh_data.enumerating_daddr) {
-    _usbh_data.enumerating_daddr = TUSB_INDEX_INVALID_8;
-    // clear enum delay function of the device being removed
-    if (_usbh_data.call_after.func == enum_delay_async) {
-      _usbh_data.call_after.func = NULL;
+  // invalidate enumeration of this device (dev0 is the one owning address 0)
+  for (uint8_t idx = 0; idx < CFG_TUH_ENUM_MAX; idx++) {
+    usbh_enum_t* e = &_usbh_data.enum_dev[idx];
+    if (!e->active) {
+      continue;
     }
+
+    if (e->daddr == daddr && (daddr != 0 || idx == _usbh_data.addr0_owner)) {
+      enum_full_complete(idx, false);
+    }
+  #if CFG_TUH_HUB
+    else if (is_hub_addr(daddr) && e->bus.hub_addr == daddr) {
+      // parent hub is removed
+      e->hub_paused = 0;
+      if (e->daddr == 0 && idx == _usbh_data.addr0_owner) {
+        usbh_device_close(e->bus.rhport, 0);
+      } else {
+        enum_full_complete(idx, false);
+      }
+    }
+  #endif
   }
 }
 
@@ -413,7 +578,7 @@ bool tuh_mounted(uint8_t dev_addr) {
 
 bool tuh_connected(uint8_t daddr) {
   if (daddr == 0) {
-    return _usbh_data.enumerating_daddr == 0;
+    return _usbh_data.addr0_owner != TUSB_INDEX_INVALID_8;
   } else {
     const usbh_device_t* dev = get_device(daddr);
     TU_VERIFY(dev != NULL);
@@ -451,7 +616,7 @@ tusb_speed_t tuh_speed_get(uint8_t daddr) {
 }
 
 bool tuh_rhport_is_active(uint8_t rhport) {
-  return _usbh_controller_id == rhport;
+  return (rhport < TUP_USBIP_CONTROLLER_NUM) && tu_bit_test(_usbh_rhport_bm, rhport);
 }
 
 bool tuh_rhport_reset_bus(uint8_t rhport, bool active) {
@@ -472,16 +637,26 @@ bool tuh_configure(uint8_t rhport, uint32_t cfg_id, const void *cfg_param) {
 }
 
 static void clear_device(usbh_device_t* dev) {
+  // return endpoints to pool
+  for (uint8_t epnum = 1; epnum < CFG_TUH_ENDPOINT_MAX; epnum++) {
+    for (uint8_t dir = 0; dir < 2; dir++) {
+      usbh_edpt_t* ep = get_edpt(dev, tu_edpt_addr(epnum, dir));
+      if (ep != NULL) {
+        ep->daddr = 0;
+      }
+    }
+  }
+
   tu_memclr(dev, sizeof(usbh_device_t));
   (void) memset(dev->itf2drv, TUSB_INDEX_INVALID_8, sizeof(dev->itf2drv)); // invalid mapping
-  (void) memset(dev->ep2drv , TUSB_INDEX_INVALID_8, sizeof(dev->ep2drv )); // invalid mapping
 }
 
 bool tuh_inited(void) {
-  return _usbh_controller_id != TUSB_INDEX_INVALID_8;
+  return _usbh_rhport_bm != 0;
 }
 
 bool tuh_rhport_init(uint8_t rhport, const tusb_rhport_init_t* rh_init) {
+  TU_ASSERT(rhport < TUP_USBIP_CONTROLLER_NUM);
   if (tuh_rhport_is_active(rhport)) {
     return true; // skip if already initialized
   }
@@ -539,10 +714,11 @@ bool tuh_rhport_init(uint8_t rhport, const tusb_rhport_init_t* rh_init) {
 
     // Device
     tu_memclr(_usbh_devices, sizeof(_usbh_devices));
+    tu_memclr(_usbh_edpts, sizeof(_usbh_edpts));
     tu_memclr(&_usbh_data, sizeof(_usbh_data));
 
-    _usbh_controller_id = TUSB_INDEX_INVALID_8;
-    _usbh_data.enumerating_daddr = TUSB_INDEX_INVALID_8;
+    _usbh_data.addr0_owner  = TUSB_INDEX_INVALID_8;
+    _usbh_data.config_owner = TUSB_INDEX_INVALID_8;
 
     for (uint8_t i = 0; i < TOTAL_DEVICES; i++) {
       clear_device(&_usbh_devices[i]);
@@ -558,8 +734,8 @@ bool tuh_rhport_init(uint8_t rhport, const tusb_rhport_init_t* rh_init) {
     }
   }
 
-  // Init host controller
-  _usbh_controller_id = rhport;
+  // Init host controller, other active ones keep running
+  _usbh_rhport_bm |= (uint8_t) TU_BIT(rhport);
   TU_ASSERT(hcd_init(rhport, rh_init));
   hcd_int_enable(rhport);
 
@@ -571,10 +747,21 @@ bool tuh_deinit(uint8_t rhport) {
     return true;
   }
 
+  // abandon enumerations on this rhport, the ones on other rhports keep going
+  for (uint8_t idx = 0; idx < CFG_TUH_ENUM_MAX; idx++) {
+    const usbh_enum_t* e = &_usbh_data.enum_dev[idx];
+    if (e->active && e->bus.rhport == rhport) {
+      if (e->daddr == 0 && idx == _usbh_data.addr0_owner) {
+        usbh_device_close(rhport, 0); // fail its control transfer in flight
+      }
+      enum_full_complete(idx, false);
+    }
+  }
+
   // deinit host controller
   hcd_int_disable(rhport);
   TU_ASSERT(hcd_deinit(rhport));
-  _usbh_controller_id = TUSB_INDEX_INVALID_8;
+  _usbh_rhport_bm &= (uint8_t) ~TU_BIT(rhport);
 
   // remove all devices on this rhport (hub_addr = 0, hub_port = 0)
   remove_device_tree(rhport, 0, 0);
@@ -599,8 +786,9 @@ bool tuh_deinit(uint8_t rhport) {
   #endif
 
     // Fire FAILED cb for any queued async control xfer so callers aren't stranded.
-    usbh_pending_ctrl_t pending;
-    while (tu_fifo_read_n(&_usbh_pending_ctrl_q, &pending, sizeof(pending)) == sizeof(pending)) {
+    while (_usbh_data.ctrl_pending_count > 0) {
+      usbh_pending_ctrl_t pending;
+      control_xfer_pending_pop(0, &pending);
       if (pending.complete_cb) {
         tuh_xfer_t x = {
           .daddr       = pending.daddr,
@@ -615,7 +803,6 @@ bool tuh_deinit(uint8_t rhport) {
         pending.complete_cb(&x);
       }
     }
-    tu_fifo_clear(&_usbh_pending_ctrl_q);
 
   #if OSAL_MUTEX_REQUIRED
     // TODO make sure there is no task waiting on this mutex
@@ -638,22 +825,22 @@ bool tuh_task_event_ready(void) {
   }
 
   #if CFG_TUH_HUB
-  if (_usbh_data.enumerating_daddr == TUSB_INDEX_INVALID_8 &&
-      !osal_queue_empty(_usbh_daq)) {
+  if (enum_slot_available() && !osal_queue_empty(_usbh_daq)) {
     return true;
   }
   #endif
 
-  // Pending control xfer waiting for an idle slot
-  if (_usbh_data.ctrl_xfer_info.stage == CONTROL_STAGE_IDLE &&
-      !tu_fifo_empty(&_usbh_pending_ctrl_q)) {
+  // Pending control xfer that can be started
+  if (control_xfer_pending_next() < CFG_TUH_CONTROL_PENDING_QUEUE_SZ) {
     return true;
   }
 
-  if (_usbh_data.call_after.func) {
-    int32_t remain_ms = (int32_t)(_usbh_data.call_after.at_ms - tusb_time_millis_api());
-    if (remain_ms <= 0) {
-      return true;
+  for (uint8_t i = 0; i < CFG_TUH_ENUM_MAX; i++) {
+    if (_usbh_data.call_after[i].func) {
+      int32_t remain_ms = (int32_t)(_usbh_data.call_after[i].at_ms - tusb_time_millis_api());
+      if (remain_ms <= 0) {
+        return true;
+      }
     }
   }
 
@@ -700,21 +887,27 @@ void tuh_task_ext(uint32_t timeout_ms, bool in_isr) {
     }
   #endif
 
-    // Process call_after_ms function if ms is reached
-    tusb_defer_func_t after_cb = _usbh_data.call_after.func;
-    if (after_cb) {
-      int32_t remain_ms = (int32_t)(_usbh_data.call_after.at_ms - tusb_time_millis_api());
-      if (remain_ms <= 0) {
-        // delay expired, run callback now
-        TU_LOG_USBH("USBH invoke scheduled function\r\n");
-        _usbh_data.call_after.func = NULL;
-        after_cb(_usbh_data.call_after.arg);
+    // Process call_after_ms functions if ms is reached
+    for (uint8_t i = 0; i < CFG_TUH_ENUM_MAX; i++) {
+      usbh_call_after_t* call_after = &_usbh_data.call_after[i];
+      tusb_defer_func_t after_cb = call_after->func;
+      if (after_cb) {
+        int32_t remain_ms = (int32_t)(call_after->at_ms - tusb_time_millis_api());
+        if (remain_ms <= 0) {
+          // delay expired, run callback now
+          TU_LOG_USBH("USBH invoke scheduled function\r\n");
+          const uintptr_t arg = call_after->arg;
+          call_after->func = NULL;
+          after_cb(arg);
+        }
       }
+    }
 
-      // above after_cb() can re-schedule another function, we need to re-check and reduce timeout of
-      // the main event timeout to make sure we aren't blocking more than call_after remaining ms.
-      if (_usbh_data.call_after.func != NULL) {
-        remain_ms = (int32_t) (_usbh_data.call_after.at_ms - tusb_time_millis_api());
+    // above after_cb() can re-schedule another function, we need to re-check and reduce timeout of
+    // the main event timeout to make sure we aren't blocking more than call_after remaining ms.
+    for (uint8_t i = 0; i < CFG_TUH_ENUM_MAX; i++) {
+      if (_usbh_data.call_after[i].func != NULL) {
+        int32_t remain_ms = (int32_t) (_usbh_data.call_after[i].at_ms - tusb_time_millis_api());
         if (remain_ms <= 0) {
           timeout_ms = 0; // expired already
         } else if (timeout_ms > (uint32_t)remain_ms) {
@@ -723,22 +916,21 @@ void tuh_task_ext(uint32_t timeout_ms, bool in_isr) {
       }
     }
 
-    // Drain pending async control xfers. Slot transitions and dispatch are
+    // Drain pending async control xfers. Context transitions and dispatch are
     // decoupled: completion / abort / device_close set stage = IDLE via
-    // control_xfer_set_stage() and the actual FIFO drain happens here in the
+    // control_xfer_set_stage() and the actual dispatch happens here in the
     // event loop. The check is a fast non-mutex sanity gate; the dispatcher
     // itself re-checks under the mutex.
-    if (_usbh_data.ctrl_xfer_info.stage == CONTROL_STAGE_IDLE &&
-        !tu_fifo_empty(&_usbh_pending_ctrl_q)) {
+    if (_usbh_data.ctrl_pending_count > 0) {
       control_xfer_dispatch_pending();
     }
 
     hcd_event_t event;
 
   #if CFG_TUH_HUB
-    // Get deferred device attachments if none is enumerating
+    // Get deferred device attachments if an enumeration slot is available
     bool has_deferred_attach = false;
-    if (_usbh_data.enumerating_daddr == TUSB_INDEX_INVALID_8) {
+    if (enum_slot_available()) {
       // zero wait to avoid blocking the main event queue
       has_deferred_attach = osal_queue_receive(_usbh_daq, &event, 0);
     }
@@ -758,17 +950,20 @@ void tuh_task_ext(uint32_t timeout_ms, bool in_isr) {
         // Force remove currently mounted with the same bus info (rhport, hub addr, hub port) if exists
         process_remove_event(&event);
 
-        // due to the shared control buffer, we must fully complete enumerating one device first.
-        if (_usbh_data.enumerating_daddr == TUSB_INDEX_INVALID_8) {
+        // up to CFG_TUH_ENUM_MAX devices are enumerated in parallel, others must wait for a free slot
+        if (enum_slot_available()) {
           // New device attached and we are ready
           TU_LOG_USBH("[%u:] USBH Device Attach\r\n", event.rhport);
-          _usbh_data.enumerating_daddr = 0; // enumerate new device with address 0
-          enum_new_device(&event);
+          (void) enum_new_device(&event);
         }
   #if CFG_TUH_HUB
         else {
-          TU_LOG_USBH("[%u:] USBH Defer Attach until current enumeration complete\r\n", event.rhport);
-          TU_ASSERT(osal_queue_send(_usbh_daq, &event, in_isr), );
+          TU_LOG_USBH("[%u:] USBH Defer Attach until an enumeration complete\r\n", event.rhport);
+          if (!osal_queue_send(_usbh_daq, &event, in_isr)) {
+            // more attached devices than we can address: drop it, but let hub driver watch the port again
+            TU_LOG1("[%u:%u:%u] USBH Drop Attach\r\n", event.rhport, event.connection.hub_addr, event.connection.hub_port);
+            hub_port_release(event.connection.hub_addr, event.connection.hub_port);
+          }
         }
   #endif
         break;
@@ -781,7 +976,6 @@ void tuh_task_ext(uint32_t timeout_ms, bool in_isr) {
       case HCD_EVENT_XFER_COMPLETE: {
         uint8_t const ep_addr = event.xfer_complete.ep_addr;
         uint8_t const epnum = tu_edpt_number(ep_addr);
-        uint8_t const ep_dir = (uint8_t) tu_edpt_dir(ep_addr);
 
         TU_LOG_USBH("[:%u] on EP %02X with %u bytes: %s\r\n",
                     event.dev_addr, ep_addr, (unsigned int) event.xfer_complete.len, tu_str_xfer_result[event.xfer_complete.result]);
@@ -794,16 +988,32 @@ void tuh_task_ext(uint32_t timeout_ms, bool in_isr) {
           usbh_device_t* dev = get_device(event.dev_addr);
           TU_VERIFY(dev && dev->connected,);
 
-          // clear busy and claimed
-          dev->ep_status[epnum][ep_dir] &= (uint8_t) ~(TU_EDPT_STATE_BUSY | TU_EDPT_STATE_CLAIMED);
+        #if CFG_TUH_EDPT_XFER_QUEUE
+          // queued transfer: endpoint is kept busy until the queue is drained
+          if (epnum != 0 && xfer_queue_complete(dev, event.dev_addr, ep_addr)) {
+            break;
+          }
+        #endif
+
+        #if CFG_TUH_ISO_XFER
+          if (epnum != 0 && iso_xfer_complete(dev, ep_addr, (xfer_result_t) event.xfer_complete.result)) {
+            break;
+          }
+        #endif
 
           if (0 == epnum) {
             usbh_control_xfer_cb(event.dev_addr, ep_addr, (xfer_result_t) event.xfer_complete.result, event.xfer_complete.len);
           } else {
+            usbh_edpt_t* ep = get_edpt(dev, ep_addr);
+            TU_ASSERT(ep != NULL,);
+
+            // clear busy and claimed
+            ep->status &= (uint8_t) ~(TU_EDPT_STATE_BUSY | TU_EDPT_STATE_CLAIMED);
+
             // Prefer application callback over built-in one if available. This occurs when tuh_edpt_xfer() is used
             // with enabled driver e.g HID endpoint
             #if CFG_TUH_API_EDPT_XFER
-            tuh_xfer_cb_t const complete_cb = dev->ep_callback[epnum][ep_dir].complete_cb;
+            tuh_xfer_cb_t const complete_cb = ep->complete_cb;
             if (complete_cb != NULL) {
               // re-construct xfer info
               tuh_xfer_t xfer = {
@@ -814,14 +1024,13 @@ void tuh_task_ext(uint32_t timeout_ms, bool in_isr) {
                   .buflen      = 0,    // not available
                   .buffer      = NULL, // not available
                   .complete_cb = complete_cb,
-                  .user_data   = dev->ep_callback[epnum][ep_dir].user_data
+                  .user_data   = ep->user_data
               };
               complete_cb(&xfer);
             }else
             #endif
             {
-              uint8_t drv_id = dev->ep2drv[epnum][ep_dir];
-              usbh_class_driver_t const* driver = get_driver(drv_id);
+              usbh_class_driver_t const* driver = get_driver(ep->drv_id);
               if (driver != NULL) {
                 TU_LOG_USBH("  %s xfer callback\r\n", driver->name);
                 driver->xfer_cb(event.dev_addr, ep_addr, (xfer_result_t) event.xfer_complete.result,
@@ -856,8 +1065,85 @@ void tuh_task_ext(uint32_t timeout_ms, bool in_isr) {
 // Control transfer
 //--------------------------------------------------------------------+
 
+// Number of control transfers in flight on a roothub port
+static uint8_t control_xfer_inflight_count(uint8_t rhport) {
+  uint8_t count = 0;
+  for (uint8_t daddr = 0; daddr <= TOTAL_DEVICES; daddr++) {
+    if (_usbh_data.ctrl_xfer_info[daddr].stage != CONTROL_STAGE_IDLE && usbh_get_rhport(daddr) == rhport) {
+      count++;
+    }
+  }
+  return count;
+}
+
+// Check if device context is idle and HCD has a free control channel
+static bool control_xfer_can_start(uint8_t daddr) {
+  if (_usbh_data.ctrl_xfer_info[daddr].stage != CONTROL_STAGE_IDLE) {
+    return false;
+  }
+  const uint8_t rhport   = usbh_get_rhport(daddr);
+  const uint8_t max_xfer = tu_max8(hcd_control_xfer_max(rhport), 1);
+  return control_xfer_inflight_count(rhport) < max_xfer;
+}
+
+// Index of next pending transfer that can be started: oldest one of the first device after the last dispatched one
+// (round-robin). Return CFG_TUH_CONTROL_PENDING_QUEUE_SZ if none
+static uint8_t control_xfer_pending_next(void) {
+  if (_usbh_data.ctrl_pending_count == 0) {
+    return CFG_TUH_CONTROL_PENDING_QUEUE_SZ;
+  }
+
+  for (uint8_t n = 1; n <= TOTAL_DEVICES + 1; n++) {
+    const uint8_t daddr = (uint8_t) ((_usbh_data.ctrl_rr_daddr + n) % (TOTAL_DEVICES + 1));
+    for (uint8_t i = 0; i < _usbh_data.ctrl_pending_count; i++) {
+      if (_usbh_data.ctrl_pending[i].daddr == daddr) {
+        // only the oldest transfer of a device is considered to keep its order
+        if (control_xfer_can_start(daddr)) {
+          return i;
+        }
+        break;
+      }
+    }
+  }
+
+  return CFG_TUH_CONTROL_PENDING_QUEUE_SZ;
+}
+
+// Check if a new transfer of daddr must wait behind pending ones: either the same device has pending transfers
+// (keep order), or another device's transfer is only waiting for a free channel (keep fairness)
+static bool control_xfer_pending_blocks(uint8_t daddr) {
+  for (uint8_t i = 0; i < _usbh_data.ctrl_pending_count; i++) {
+    const uint8_t pending_addr = _usbh_data.ctrl_pending[i].daddr;
+    if (pending_addr == daddr || _usbh_data.ctrl_xfer_info[pending_addr].stage == CONTROL_STAGE_IDLE) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void control_xfer_pending_pop(uint8_t idx, usbh_pending_ctrl_t* entry) {
+  *entry = _usbh_data.ctrl_pending[idx];
+  _usbh_data.ctrl_pending_count--;
+  for (uint8_t i = idx; i < _usbh_data.ctrl_pending_count; i++) {
+    _usbh_data.ctrl_pending[i] = _usbh_data.ctrl_pending[i + 1];
+  }
+}
+
+// Set up device context for a new transfer, must be called with mutex held
+static void control_xfer_claim(uint8_t daddr, tusb_control_request_t const* setup, uint8_t* buffer,
+                               tuh_xfer_cb_t complete_cb, uintptr_t user_data) {
+  usbh_ctrl_xfer_info_t* ctrl_info = &_usbh_data.ctrl_xfer_info[daddr];
+  ctrl_info->stage        = CONTROL_STAGE_SETUP;
+  ctrl_info->actual_len   = 0;
+  ctrl_info->failed_count = 0;
+  ctrl_info->buffer       = buffer;
+  ctrl_info->complete_cb  = complete_cb;
+  ctrl_info->user_data    = user_data;
+  _usbh_epbuf.setup[daddr].request = *setup;
+}
+
 // Carries both fields the sync waiter cares about — capturing from xfer_temp
-// (snapshot taken before release_slot resets ctrl_info for the next pending
+// (snapshot taken before the context is released for the next pending
 // entry) so the waiter sees this xfer's data, not the next dispatched one's.
 typedef struct {
   volatile xfer_result_t result;
@@ -874,7 +1160,6 @@ static void control_xfer_sync_complete(tuh_xfer_t* xfer) {
 bool tuh_control_xfer (tuh_xfer_t* xfer) {
   const uint8_t daddr = xfer->daddr;
   TU_VERIFY(daddr <= TOTAL_DEVICES && xfer->ep_addr == 0 && xfer->setup); // EP0 with setup packet
-  usbh_ctrl_xfer_info_t* ctrl_info = &_usbh_data.ctrl_xfer_info;
 
 #if CFG_TUSB_OS_HAS_SCHEDULER
   // Sync (complete_cb == NULL) from a host-stack callback is forbidden on
@@ -886,50 +1171,52 @@ bool tuh_control_xfer (tuh_xfer_t* xfer) {
               osal_task_get_current_handle() == _usbh_data.task_hdl));
 #endif
 
-  // Slot is single-threaded — when busy, sync callers block until it frees
-  // (blocking semantics require the result); async callers get queued in the
-  // pending FIFO and submitted by control_xfer_complete() when the slot
-  // drains. The test-and-{claim|enqueue} is one critical section so a slot
-  // that becomes IDLE between the check and the enqueue can't strand an async
-  // request in a queue nothing else drains.
+  // Sync: wire control_xfer_sync_complete BEFORE claiming or queuing so a fast
+  // completion event has the cb in place. control_xfer_complete() captures both
+  // result and actual_len through this cb before the context is released.
   const bool is_nonblocking = (xfer->complete_cb != NULL);
+  volatile control_xfer_sync_param_t sync_state;
+  tuh_xfer_cb_t complete_cb = xfer->complete_cb;
+  uintptr_t user_data = xfer->user_data;
+  if (!is_nonblocking) {
+    sync_state.result = XFER_RESULT_INVALID;
+    sync_state.actual_len = 0;
+    complete_cb = control_xfer_sync_complete;
+    user_data = (uintptr_t) &sync_state;
+  }
+
+  // Transfer is started right away if its device context is idle, a control channel is free and nothing is waiting
+  // ahead of it. Otherwise it is queued in the pending pool and started by control_xfer_dispatch_pending() once its
+  // turn comes. When the pool is full, sync callers block until there is room and async callers fail. The
+  // test-and-{claim|enqueue} is one critical section so a context that becomes IDLE between the check and the
+  // enqueue can't strand a request in a pool nothing else drains.
+  bool claimed = false;
   while (true) {
     TU_VERIFY(tuh_connected(daddr));
-    bool claimed = false;
     bool is_queued = false;
     (void) osal_mutex_lock(_usbh_mutex, OSAL_TIMEOUT_WAIT_FOREVER);
-    if (ctrl_info->stage == CONTROL_STAGE_IDLE) {
-      ctrl_info->stage        = CONTROL_STAGE_SETUP;
-      ctrl_info->daddr        = daddr;
-      ctrl_info->actual_len   = 0;
-      ctrl_info->failed_count = 0;
-
-      ctrl_info->buffer       = xfer->buffer;
-      ctrl_info->complete_cb  = xfer->complete_cb;
-      ctrl_info->user_data    = xfer->user_data;
-      _usbh_epbuf.request     = (*xfer->setup);
+    if (!control_xfer_pending_blocks(daddr) && control_xfer_can_start(daddr)) {
+      control_xfer_claim(daddr, xfer->setup, xfer->buffer, complete_cb, user_data);
       claimed = true;
-    } else if (is_nonblocking) {
-      // Async + busy: queue the transfer.
-      const usbh_pending_ctrl_t entry = {
+    } else if (_usbh_data.ctrl_pending_count < CFG_TUH_CONTROL_PENDING_QUEUE_SZ) {
+      _usbh_data.ctrl_pending[_usbh_data.ctrl_pending_count++] = (usbh_pending_ctrl_t) {
         .setup       = *xfer->setup,
         .buffer      = xfer->buffer,
-        .complete_cb = xfer->complete_cb,
-        .user_data   = xfer->user_data,
+        .complete_cb = complete_cb,
+        .user_data   = user_data,
         .daddr       = daddr,
         .daddr_gen   = _usbh_data.daddr_gen[daddr]
       };
-      is_queued = tu_fifo_write_n(&_usbh_pending_ctrl_q, &entry, sizeof(entry)) == sizeof(entry);
+      is_queued = true;
     }
-
     (void) osal_mutex_unlock(_usbh_mutex);
 
-    if (claimed) {
+    if (claimed || is_queued) {
       break;
     }
 
     if (is_nonblocking) {
-      return is_queued;
+      return false; // pending pool is full
     }
 
     // - OS_HAS_SCHEDULER: delay 1 ms
@@ -940,31 +1227,24 @@ bool tuh_control_xfer (tuh_xfer_t* xfer) {
     tuh_task_ext(0, false);
 #endif
   }
-  TU_LOG_USBH("[%u:%u] %s: ", usbh_get_rhport(daddr), daddr,
-              (xfer->setup->bmRequestType_bit.type == TUSB_REQ_TYPE_STANDARD && xfer->setup->bRequest <= TUSB_REQ_SYNCH_FRAME) ?
-                  tu_str_std_request[xfer->setup->bRequest] : "Class Request");
-  TU_LOG_BUF_USBH(xfer->setup, 8);
 
-  // Sync: wire control_xfer_sync_complete BEFORE submit so a fast completion
-  // event has the cb in place. control_xfer_complete() captures both result
-  // and actual_len through this cb before release_slot overwrites ctrl_info.
-  volatile control_xfer_sync_param_t sync_state;
-  if (!is_nonblocking) {
-    sync_state.result = XFER_RESULT_INVALID;
-    sync_state.actual_len = 0;
-    ctrl_info->user_data   = (uintptr_t) &sync_state;
-    ctrl_info->complete_cb = control_xfer_sync_complete;
-  }
+  if (claimed) {
+    TU_LOG_USBH("[%u:%u] %s: ", usbh_get_rhport(daddr), daddr,
+                (xfer->setup->bmRequestType_bit.type == TUSB_REQ_TYPE_STANDARD && xfer->setup->bRequest <= TUSB_REQ_SYNCH_FRAME) ?
+                    tu_str_std_request[xfer->setup->bRequest] : "Class Request");
+    TU_LOG_BUF_USBH(xfer->setup, 8);
 
-  if (!hcd_setup_send(usbh_get_rhport(daddr), daddr, (uint8_t const *) &_usbh_epbuf.request)) {
-    control_xfer_set_stage(CONTROL_STAGE_IDLE);
-    return false;
+    if (!hcd_setup_send(usbh_get_rhport(daddr), daddr, (uint8_t const *) &_usbh_epbuf.setup[daddr].request)) {
+      control_xfer_set_stage(daddr, CONTROL_STAGE_IDLE);
+      return false;
+    }
   }
 
   if (!is_nonblocking) {
     // No tuh_connected() escape needed: usbh_device_close() routes through
-    // control_xfer_complete(daddr, FAILED) on disconnect, which fires
-    // sync_complete and unblocks this poll.
+    // control_xfer_complete(daddr, FAILED) on disconnect, and a stale pending
+    // entry is completed as FAILED by the dispatcher, both fire sync_complete
+    // and unblock this poll.
     while (sync_state.result == XFER_RESULT_INVALID) {
 #if CFG_TUSB_OS_HAS_SCHEDULER
       osal_task_delay(1);
@@ -984,25 +1264,18 @@ bool tuh_control_xfer (tuh_xfer_t* xfer) {
   return true;
 }
 
-// Start control transfer from pending fifo
+// Start control transfers from pending pool while device contexts and control channels are available
 static void control_xfer_dispatch_pending(void) {
-  usbh_ctrl_xfer_info_t* ctrl_info = &_usbh_data.ctrl_xfer_info;
-
   while (true) {
     usbh_pending_ctrl_t xfer;
     bool has_xfer = false;
 
     (void) osal_mutex_lock(_usbh_mutex, OSAL_TIMEOUT_WAIT_FOREVER);
-    if (ctrl_info->stage == CONTROL_STAGE_IDLE &&
-        tu_fifo_read_n(&_usbh_pending_ctrl_q, &xfer, sizeof(xfer)) == sizeof(xfer)) {
-      ctrl_info->stage        = CONTROL_STAGE_SETUP;
-      ctrl_info->daddr        = xfer.daddr;
-      ctrl_info->actual_len   = 0;
-      ctrl_info->failed_count = 0;
-      ctrl_info->buffer       = xfer.buffer;
-      ctrl_info->complete_cb  = xfer.complete_cb;
-      ctrl_info->user_data    = xfer.user_data;
-      _usbh_epbuf.request     = xfer.setup;
+    const uint8_t idx = control_xfer_pending_next();
+    if (idx < CFG_TUH_CONTROL_PENDING_QUEUE_SZ) {
+      control_xfer_pending_pop(idx, &xfer);
+      control_xfer_claim(xfer.daddr, &xfer.setup, xfer.buffer, xfer.complete_cb, xfer.user_data);
+      _usbh_data.ctrl_rr_daddr = xfer.daddr;
       has_xfer = true;
     }
     (void) osal_mutex_unlock(_usbh_mutex);
@@ -1011,15 +1284,16 @@ static void control_xfer_dispatch_pending(void) {
       return; // nothing to do
     }
 
-    // mismatched daddr_gen means pending transfer is stale due to the device got disconnected while in the FIFO
+    // mismatched daddr_gen means pending transfer is stale due to the device got disconnected while in the pool
     // Note: the address can be re-allocated to another device at this point.
     if (xfer.daddr_gen == _usbh_data.daddr_gen[xfer.daddr]) {
       TU_LOG_USBH("[%u:%u] %s: ", usbh_get_rhport(xfer.daddr), xfer.daddr,
                   (xfer.setup.bmRequestType_bit.type == TUSB_REQ_TYPE_STANDARD && xfer.setup.bRequest <= TUSB_REQ_SYNCH_FRAME) ?
                       tu_str_std_request[xfer.setup.bRequest] : "Class Request");
       TU_LOG_BUF_USBH(&xfer.setup, 8);
-      if (hcd_setup_send(usbh_get_rhport(xfer.daddr), xfer.daddr, (uint8_t const *) &_usbh_epbuf.request)) {
-        return; // transfer kicked-off, we are done
+      if (hcd_setup_send(usbh_get_rhport(xfer.daddr), xfer.daddr,
+                         (uint8_t const *) &_usbh_epbuf.setup[xfer.daddr].request)) {
+        continue; // transfer kicked-off, try next one
       }
     }
 
@@ -1030,10 +1304,10 @@ static void control_xfer_dispatch_pending(void) {
 
 static void control_xfer_complete(uint8_t daddr, xfer_result_t result) {
   TU_LOG_USBH("\r\n");
-  usbh_ctrl_xfer_info_t* ctrl_info = &_usbh_data.ctrl_xfer_info;
+  usbh_ctrl_xfer_info_t* ctrl_info = &_usbh_data.ctrl_xfer_info[daddr];
 
   // duplicate xfer since user can execute control transfer within callback
-  tusb_control_request_t const request = _usbh_epbuf.request;
+  tusb_control_request_t const request = _usbh_epbuf.setup[daddr].request;
   tuh_xfer_t xfer_temp = {
     .daddr       = daddr,
     .ep_addr     = 0,
@@ -1046,7 +1320,7 @@ static void control_xfer_complete(uint8_t daddr, xfer_result_t result) {
   };
 
   // set to IDLE before callback since cb can invoke another transfer
-  control_xfer_set_stage(CONTROL_STAGE_IDLE);
+  control_xfer_set_stage(daddr, CONTROL_STAGE_IDLE);
 
   if (xfer_temp.complete_cb != NULL) {
     xfer_temp.complete_cb(&xfer_temp);
@@ -1056,13 +1330,13 @@ static void control_xfer_complete(uint8_t daddr, xfer_result_t result) {
 static bool usbh_control_xfer_cb (uint8_t daddr, uint8_t ep_addr, xfer_result_t result, uint32_t xferred_bytes) {
   (void) ep_addr;
 
+  TU_VERIFY(daddr <= TOTAL_DEVICES);
   const uint8_t rhport = usbh_get_rhport(daddr);
-  tusb_control_request_t const * request = &_usbh_epbuf.request;
-  usbh_ctrl_xfer_info_t* ctrl_info = &_usbh_data.ctrl_xfer_info;
+  tusb_control_request_t const * request = &_usbh_epbuf.setup[daddr].request;
+  usbh_ctrl_xfer_info_t* ctrl_info = &_usbh_data.ctrl_xfer_info[daddr];
 
-  // Drop stale completions: slot already released (abort/close fired its cb)
-  // or now owns a different device's xfer (a pending entry was dispatched).
-  if (ctrl_info->stage == CONTROL_STAGE_IDLE || ctrl_info->daddr != daddr) {
+  // Drop stale completions: context already released (abort/close fired its cb)
+  if (ctrl_info->stage == CONTROL_STAGE_IDLE) {
     return true;
   }
 
@@ -1098,7 +1372,7 @@ static bool usbh_control_xfer_cb (uint8_t daddr, uint8_t ep_addr, xfer_result_t
         case CONTROL_STAGE_SETUP:
           if (request->wLength > 0) {
             // DATA stage: initial data toggle is always 1
-            control_xfer_set_stage(CONTROL_STAGE_DATA);
+            control_xfer_set_stage(daddr, CONTROL_STAGE_DATA);
             const uint8_t ep_data = tu_edpt_addr(0, request->bmRequestType_bit.direction);
             TU_ASSERT(hcd_edpt_xfer(rhport, daddr, ep_data, ctrl_info->buffer, request->wLength));
             return true;
@@ -1113,7 +1387,7 @@ static bool usbh_control_xfer_cb (uint8_t daddr, uint8_t ep_addr, xfer_result_t
             ctrl_info->actual_len = (uint16_t) xferred_bytes;
 
             // ACK stage: toggle is always 1
-            control_xfer_set_stage(CONTROL_STAGE_ACK);
+            control_xfer_set_stage(daddr, CONTROL_STAGE_ACK);
             const uint8_t ep_status = tu_edpt_addr(0, 1 - request->bmRequestType_bit.direction);
             TU_ASSERT(hcd_edpt_xfer(rhport, daddr, ep_status, NULL, 0));
             break;
@@ -1167,26 +1441,42 @@ bool tuh_edpt_xfer(tuh_xfer_t* xfer) {
 bool tuh_edpt_abort_xfer(uint8_t daddr, uint8_t ep_addr) {
   TU_LOG_USBH("[%u] Aborted transfer on EP %02X\r\n", daddr, ep_addr);
   const uint8_t epnum = tu_edpt_number(ep_addr);
-  const uint8_t dir   = tu_edpt_dir(ep_addr);
 
   if (epnum == 0) {
     // Also include dev0 for aborting enumerating
     const uint8_t rhport = usbh_get_rhport(daddr);
 
-    // control transfer: only 1 control at a time, check if we are aborting the current one
-    const usbh_ctrl_xfer_info_t* ctrl_info = &_usbh_data.ctrl_xfer_info;
-    TU_VERIFY(daddr == ctrl_info->daddr && ctrl_info->stage != CONTROL_STAGE_IDLE);
+    // control transfer: check if device has one in progress
+    TU_VERIFY(daddr <= TOTAL_DEVICES && _usbh_data.ctrl_xfer_info[daddr].stage != CONTROL_STAGE_IDLE);
     hcd_edpt_abort_xfer(rhport, daddr, ep_addr);
     control_xfer_complete(daddr, XFER_RESULT_ABORTED);
   } else {
     usbh_device_t* dev = get_device(daddr);
     TU_VERIFY(dev);
 
-    TU_VERIFY(dev->ep_status[epnum][dir] & TU_EDPT_STATE_BUSY); // non-control skip if not busy
+    usbh_edpt_t* ep = get_edpt(dev, ep_addr);
+    TU_VERIFY(ep != NULL && (ep->status & TU_EDPT_STATE_BUSY)); // non-control skip if not busy
+
+  #if CFG_TUH_EDPT_XFER_QUEUE
+    if (ep->xfer_queue.active) {
+      hcd_edpt_abort_xfer(dev->bus_info.rhport, daddr, ep_addr);
+      xfer_queue_abort(dev, daddr, ep_addr, XFER_RESULT_ABORTED);
+      return true;
+    }
+  #endif
+
+  #if CFG_TUH_ISO_XFER
+    if (ep->iso_queue.head != NULL) {
+      hcd_edpt_abort_xfer(dev->bus_info.rhport, daddr, ep_addr);
+      iso_xfer_abort(dev, ep_addr, XFER_RESULT_ABORTED);
+      return true;
+    }
+  #endif
+
     // abort then mark as ready and release endpoint
     hcd_edpt_abort_xfer(dev->bus_info.rhport, daddr, ep_addr);
-    dev->ep_status[epnum][dir] &= (uint8_t) ~TU_EDPT_STATE_BUSY; // clear busy
-    tu_edpt_release(&dev->ep_status[epnum][dir], _usbh_mutex);
+    ep->status &= (uint8_t) ~TU_EDPT_STATE_BUSY; // clear busy
+    tu_edpt_release(&ep->status, _usbh_mutex);
   }
 
   return true;
@@ -1203,15 +1493,21 @@ uint8_t usbh_get_rhport(uint8_t daddr) {
 }
 
 uint8_t *usbh_get_enum_buf(void) {
-  return _usbh_epbuf.ctrl;
+  // buffer of the device whose class drivers are being configured
+  const uint8_t idx = (_usbh_data.config_owner < CFG_TUH_ENUM_MAX) ? _usbh_data.config_owner : 0;
+  return _usbh_epbuf.ctrl[idx].buf;
 }
 
 void usbh_int_set(bool enabled) {
-  // TODO all host controller if multiple are used since they shared the same event queue
-  if (enabled) {
-    hcd_int_enable(_usbh_controller_id);
-  } else {
-    hcd_int_disable(_usbh_controller_id);
+  // all active host controllers since they share the same event queue
+  for (uint8_t rhport = 0; rhport < TUP_USBIP_CONTROLLER_NUM; rhport++) {
+    if (tu_bit_test(_usbh_rhport_bm, rhport)) {
+      if (enabled) {
+        hcd_int_enable(rhport);
+      } else {
+        hcd_int_disable(rhport);
+      }
+    }
   }
 }
 
@@ -1235,16 +1531,42 @@ void usbh_defer_func(osal_task_func_t func, void *param, bool in_isr) {
 // Endpoint API
 //--------------------------------------------------------------------+
 
+// Allocate state of non-control endpoint from pool if not yet. It is kept until device is removed, so that driver
+// binding is preserved when endpoint is closed and re-opened e.g alternate setting change
+static usbh_edpt_t* edpt_alloc(uint8_t daddr, uint8_t ep_addr) {
+  usbh_device_t* dev = get_device(daddr);
+  TU_VERIFY(dev, NULL);
+  const uint8_t epnum = tu_edpt_number(ep_addr);
+  TU_ASSERT(epnum > 0 && epnum < CFG_TUH_ENDPOINT_MAX, NULL);
+
+  usbh_edpt_t* ep = get_edpt(dev, ep_addr);
+  if (ep == NULL) {
+    (void) osal_mutex_lock(_usbh_mutex, OSAL_TIMEOUT_WAIT_FOREVER);
+    for (uint8_t i = 0; i < CFG_TUH_ENDPOINT_POOL_SIZE; i++) {
+      if (_usbh_edpts[i].daddr == 0) {
+        ep = &_usbh_edpts[i];
+        tu_memclr(ep, sizeof(usbh_edpt_t));
+        ep->daddr  = daddr;
+        ep->drv_id = TUSB_INDEX_INVALID_8;
+        dev->ep_idx[epnum-1][tu_edpt_dir(ep_addr)] = (uint8_t) (i + 1);
+        break;
+      }
+    }
+    (void) osal_mutex_unlock(_usbh_mutex);
+    TU_ASSERT(ep != NULL, NULL); // pool is exhausted, increase CFG_TUH_ENDPOINT_POOL_SIZE
+  }
+
+  return ep;
+}
+
 // Claim an endpoint for transfer
 bool usbh_edpt_claim(uint8_t dev_addr, uint8_t ep_addr) {
   // Note: addr0 only use tuh_control_xfer
   usbh_device_t* dev = get_device(dev_addr);
   TU_ASSERT(dev && dev->connected);
 
-  uint8_t const epnum = tu_edpt_number(ep_addr);
-  uint8_t const dir = tu_edpt_dir(ep_addr);
-
-  TU_VERIFY(tu_edpt_claim(&dev->ep_status[epnum][dir], _usbh_mutex));
+  usbh_edpt_t* ep = get_edpt(dev, ep_addr);
+  TU_VERIFY(ep != NULL && tu_edpt_claim(&ep->status, _usbh_mutex));
   TU_LOG_USBH("[%u] Claimed EP 0x%02x\r\n", dev_addr, ep_addr);
 
   return true;
@@ -1256,10 +1578,8 @@ bool usbh_edpt_release(uint8_t dev_addr, uint8_t ep_addr) {
   usbh_device_t* dev = get_device(dev_addr);
   TU_VERIFY(dev && dev->connected);
 
-  uint8_t const epnum = tu_edpt_number(ep_addr);
-  uint8_t const dir = tu_edpt_dir(ep_addr);
-
-  TU_VERIFY(tu_edpt_release(&dev->ep_status[epnum][dir], _usbh_mutex));
+  usbh_edpt_t* ep = get_edpt(dev, ep_addr);
+  TU_VERIFY(ep != NULL && tu_edpt_release(&ep->status, _usbh_mutex));
   TU_LOG_USBH("[%u] Released EP 0x%02x\r\n", dev_addr, ep_addr);
 
   return true;
@@ -1274,9 +1594,9 @@ bool usbh_edpt_xfer_with_callback(uint8_t dev_addr, uint8_t ep_addr, uint8_t* bu
   usbh_device_t* dev = get_device(dev_addr);
   TU_VERIFY(dev);
 
-  uint8_t const epnum = tu_edpt_number(ep_addr);
-  uint8_t const dir = tu_edpt_dir(ep_addr);
-  volatile uint8_t* ep_state = &dev->ep_status[epnum][dir];
+  usbh_edpt_t* ep = get_edpt(dev, ep_addr);
+  TU_VERIFY(ep);
+  volatile uint8_t* ep_state = &ep->status;
 
   TU_LOG_USBH("  Queue EP %02X with %u bytes ... \r\n", ep_addr, total_bytes);
 
@@ -1288,8 +1608,8 @@ bool usbh_edpt_xfer_with_callback(uint8_t dev_addr, uint8_t ep_addr, uint8_t* bu
   *ep_state |= TU_EDPT_STATE_BUSY;
 
 #if CFG_TUH_API_EDPT_XFER
-  dev->ep_callback[epnum][dir].complete_cb = complete_cb;
-  dev->ep_callback[epnum][dir].user_data   = user_data;
+  ep->complete_cb = complete_cb;
+  ep->user_data   = user_data;
 #endif
 
   if (hcd_edpt_xfer(dev->bus_info.rhport, dev_addr, ep_addr, buffer, total_bytes)) {
@@ -1304,6 +1624,331 @@ bool usbh_edpt_xfer_with_callback(uint8_t dev_addr, uint8_t ep_addr, uint8_t* bu
   }
 }
 
+#if CFG_TUH_EDPT_XFER_QUEUE
+// Get transfer queue of endpoint, NULL if endpoint is not allocated
+TU_ATTR_ALWAYS_INLINE static inline usbh_xfer_queue_t* xfer_queue_get(usbh_device_t* dev, uint8_t ep_addr) {
+  usbh_edpt_t* ep = get_edpt(dev, ep_addr);
+  return (ep != NULL) ? &ep->xfer_queue : NULL;
+}
+
+// Submit queued transfers not handed to HCD yet, up to its depth. Must be called with spinlock held.
+// Return false if HCD rejects a transfer, which is then kept in queue
+static bool xfer_queue_submit(usbh_device_t* dev, uint8_t daddr, uint8_t ep_addr) {
+  usbh_xfer_queue_t* q = xfer_queue_get(dev, ep_addr);
+  const uint8_t depth = tu_max8(hcd_edpt_xfer_depth(dev->bus_info.rhport, daddr, ep_addr), 1);
+
+  while (q->submitted < depth) {
+    // transfer can complete and leave the list within hcd_edpt_xfer(), walk from head each time
+    tuh_xfer_t* xfer = q->head;
+    for (uint8_t i = 0; i < q->submitted && xfer != NULL; i++) {
+      xfer = xfer->next;
+    }
+    if (xfer == NULL) {
+      break; // all submitted
+    }
+
+    q->submitted++;
+    if (!hcd_edpt_xfer(dev->bus_info.rhport, daddr, ep_addr, xfer->buffer, (uint16_t) xfer->buflen)) {
+      q->submitted--;
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// Release endpoint if queue is drained
+static void xfer_queue_release_if_idle(usbh_device_t* dev, uint8_t ep_addr) {
+  usbh_xfer_queue_t* q = xfer_queue_get(dev, ep_addr);
+  usbh_spin_lock(false);
+  const bool is_idle = (q->head == NULL && q->done == NULL);
+  if (is_idle) {
+    q->active = 0;
+  }
+  usbh_spin_unlock(false);
+
+  if (is_idle) {
+    get_edpt(dev, ep_addr)->status &= (uint8_t) ~(TU_EDPT_STATE_BUSY | TU_EDPT_STATE_CLAIMED);
+  }
+}
+
+bool tuh_edpt_xfer_queue(tuh_xfer_t* xfer) {
+  const uint8_t daddr   = xfer->daddr;
+  const uint8_t ep_addr = xfer->ep_addr;
+  TU_VERIFY(daddr && tu_edpt_number(ep_addr) && xfer->complete_cb != NULL);
+
+  usbh_device_t* dev = get_device(daddr);
+  TU_VERIFY(dev && dev->connected);
+  usbh_xfer_queue_t* q = xfer_queue_get(dev, ep_addr);
+  TU_VERIFY(q);
+
+  xfer->next       = NULL;
+  xfer->result     = XFER_RESULT_INVALID;
+  xfer->actual_len = 0;
+
+  if (!q->active) {
+    // first transfer takes the endpoint until queue is drained
+    TU_VERIFY(usbh_edpt_claim(daddr, ep_addr));
+    get_edpt(dev, ep_addr)->status |= TU_EDPT_STATE_BUSY;
+    q->active = 1;
+  }
+
+  TU_LOG_USBH("  Queue EP %02X with %" PRIu32 " bytes\r\n", ep_addr, xfer->buflen);
+
+  usbh_spin_lock(false);
+  tuh_xfer_t** tail = &q->head;
+  while (*tail != NULL) {
+    tail = &(*tail)->next;
+  }
+  *tail = xfer;
+
+  // rejected if HCD fails and there is no transfer in flight to retry it later
+  const bool is_rejected = !xfer_queue_submit(dev, daddr, ep_addr) && (q->submitted == 0);
+  if (is_rejected) {
+    *tail = NULL;
+  }
+  usbh_spin_unlock(false);
+
+  if (is_rejected) {
+    xfer_queue_release_if_idle(dev, ep_addr);
+    return false;
+  }
+
+  return true;
+}
+
+// Transfer complete in ISR: move the oldest queued transfer to done list. Endpoint is re-armed right away if HCD
+// allows hcd_edpt_xfer() in ISR, otherwise by xfer_queue_complete() in usbh task
+static void xfer_queue_isr(hcd_event_t const* event, bool in_isr) {
+  const uint8_t ep_addr = event->xfer_complete.ep_addr;
+  usbh_device_t* dev = get_device(event->dev_addr);
+  if (dev == NULL) {
+    return;
+  }
+  usbh_xfer_queue_t* q = xfer_queue_get(dev, ep_addr);
+  if (q == NULL) {
+    return;
+  }
+
+  usbh_spin_lock(in_isr);
+  tuh_xfer_t* xfer = q->head;
+  if (q->submitted > 0 && xfer != NULL) {
+    q->head = xfer->next;
+    q->submitted--;
+
+    xfer->next       = NULL;
+    xfer->result     = (xfer_result_t) event->xfer_complete.result;
+    xfer->actual_len = event->xfer_complete.len;
+
+    tuh_xfer_t** tail = &q->done;
+    while (*tail != NULL) {
+      tail = &(*tail)->next;
+    }
+    *tail = xfer;
+
+    if (xfer->result == XFER_RESULT_SUCCESS && hcd_edpt_xfer_isr_safe(dev->bus_info.rhport)) {
+      (void) xfer_queue_submit(dev, event->dev_addr, ep_addr); // retried in usbh task if failed
+    }
+  }
+  usbh_spin_unlock(in_isr);
+}
+
+// Invoke callback of a completed queued transfer. Return false if endpoint is not driven by the queue
+static bool xfer_queue_complete(usbh_device_t* dev, uint8_t daddr, uint8_t ep_addr) {
+  usbh_xfer_queue_t* q = xfer_queue_get(dev, ep_addr);
+  if (q == NULL || !q->active) {
+    return false;
+  }
+
+  usbh_spin_lock(false);
+  tuh_xfer_t* xfer = q->done;
+  if (xfer != NULL) {
+    q->done    = xfer->next;
+    xfer->next = NULL;
+  }
+
+  bool is_failed = (xfer != NULL && xfer->result != XFER_RESULT_SUCCESS);
+  if (!is_failed) {
+    // re-arm unless already done in ISR, give up if nothing is in flight
+    is_failed = !xfer_queue_submit(dev, daddr, ep_addr) && (q->submitted == 0);
+  }
+  usbh_spin_unlock(false);
+
+  if (xfer != NULL) {
+    xfer->complete_cb(xfer);
+  }
+
+  if (is_failed) {
+    // remaining transfers cannot be continued
+    if (q->submitted > 0) {
+      hcd_edpt_abort_xfer(dev->bus_info.rhport, daddr, ep_addr);
+    }
+    xfer_queue_abort(dev, daddr, ep_addr, XFER_RESULT_ABORTED);
+  } else {
+    xfer_queue_release_if_idle(dev, ep_addr);
+  }
+
+  return true;
+}
+
+// Complete all queued transfers with result and release endpoint. HCD transfer must be aborted by caller
+static void xfer_queue_abort(usbh_device_t* dev, uint8_t daddr, uint8_t ep_addr, xfer_result_t result) {
+  (void) daddr;
+  usbh_xfer_queue_t* q = xfer_queue_get(dev, ep_addr);
+  if (q == NULL || !q->active) {
+    return;
+  }
+
+  usbh_spin_lock(false);
+  tuh_xfer_t* done    = q->done;
+  tuh_xfer_t* pending = q->head;
+  q->head      = NULL;
+  q->done      = NULL;
+  q->submitted = 0;
+  q->active    = 0;
+  usbh_spin_unlock(false);
+
+  get_edpt(dev, ep_addr)->status &= (uint8_t) ~(TU_EDPT_STATE_BUSY | TU_EDPT_STATE_CLAIMED);
+
+  // already completed ones keep their result, callbacks are invoked in order
+  while (done != NULL) {
+    tuh_xfer_t* xfer = done;
+    done = xfer->next;
+    xfer->next = NULL;
+    xfer->complete_cb(xfer);
+  }
+
+  while (pending != NULL) {
+    tuh_xfer_t* xfer = pending;
+    pending = xfer->next;
+    xfer->next   = NULL;
+    xfer->result = result;
+    xfer->complete_cb(xfer);
+  }
+}
+#endif
+
+#if CFG_TUH_ISO_XFER
+// Get isochronous queue of endpoint, NULL if endpoint is not allocated
+TU_ATTR_ALWAYS_INLINE static inline usbh_iso_queue_t* iso_queue_get(usbh_device_t* dev, uint8_t ep_addr) {
+  usbh_edpt_t* ep = get_edpt(dev, ep_addr);
+  return (ep != NULL) ? &ep->iso_queue : NULL;
+}
+
+bool tuh_iso_xfer(tuh_iso_xfer_t* xfer) {
+  const uint8_t daddr   = xfer->daddr;
+  const uint8_t ep_addr = xfer->ep_addr;
+  TU_VERIFY(daddr && tu_edpt_number(ep_addr) && xfer->num_packets && xfer->complete_cb != NULL);
+
+  usbh_device_t* dev = get_device(daddr);
+  TU_VERIFY(dev && dev->connected);
+  usbh_iso_queue_t* q = iso_queue_get(dev, ep_addr);
+  TU_VERIFY(q);
+  volatile uint8_t* ep_state = &get_edpt(dev, ep_addr)->status;
+
+  // packet is at most one (micro)frame of endpoint, HCD relies on this to split transfer into TDs
+  for (uint16_t i = 0; i < xfer->num_packets; i++) {
+    TU_VERIFY(xfer->packets[i].length <= q->max_len);
+  }
+
+  xfer->next   = NULL;
+  xfer->result = XFER_RESULT_INVALID;
+  for (uint16_t i = 0; i < xfer->num_packets; i++) {
+    xfer->packets[i].actual_len = 0;
+    xfer->packets[i].result     = XFER_RESULT_INVALID;
+  }
+
+  if (q->head == NULL) {
+    // first transfer takes the endpoint until all transfers are complete
+    TU_VERIFY(usbh_edpt_claim(daddr, ep_addr));
+    *ep_state |= TU_EDPT_STATE_BUSY;
+    q->used = 1;
+  }
+
+  TU_LOG_USBH("  ISO EP %02X with %u packets\r\n", ep_addr, xfer->num_packets);
+
+  // link before submitting since transfer can complete right away
+  usbh_spin_lock(false);
+  tuh_iso_xfer_t** tail = &q->head;
+  while (*tail != NULL) {
+    tail = &(*tail)->next;
+  }
+  *tail = xfer;
+  usbh_spin_unlock(false);
+
+  if (!hcd_edpt_iso_xfer(dev->bus_info.rhport, daddr, ep_addr, xfer)) {
+    usbh_spin_lock(false);
+    *tail = NULL;
+    const bool is_idle = (q->head == NULL);
+    usbh_spin_unlock(false);
+
+    if (is_idle) {
+      *ep_state &= (uint8_t) ~(TU_EDPT_STATE_BUSY | TU_EDPT_STATE_CLAIMED);
+    }
+    return false;
+  }
+
+  return true;
+}
+
+// Invoke callback of the oldest isochronous transfer. Return false if endpoint is not driven by tuh_iso_xfer()
+static bool iso_xfer_complete(usbh_device_t* dev, uint8_t ep_addr, xfer_result_t result) {
+  usbh_iso_queue_t* q = iso_queue_get(dev, ep_addr);
+  if (q == NULL || !q->used) {
+    return false;
+  }
+
+  usbh_spin_lock(false);
+  tuh_iso_xfer_t* xfer = q->head;
+  if (xfer != NULL) {
+    q->head = xfer->next;
+    xfer->next = NULL;
+  }
+  const bool is_idle = (q->head == NULL);
+  usbh_spin_unlock(false);
+
+  if (xfer == NULL) {
+    return true; // late completion of aborted transfer
+  }
+
+  if (is_idle) {
+    get_edpt(dev, ep_addr)->status &= (uint8_t) ~(TU_EDPT_STATE_BUSY | TU_EDPT_STATE_CLAIMED);
+  }
+
+  xfer->result = result;
+  xfer->complete_cb(xfer);
+
+  return true;
+}
+
+// Complete all isochronous transfers with result and release endpoint. HCD transfers must be aborted by caller
+static void iso_xfer_abort(usbh_device_t* dev, uint8_t ep_addr, xfer_result_t result) {
+  usbh_iso_queue_t* q = iso_queue_get(dev, ep_addr);
+  if (q == NULL || !q->used) {
+    return;
+  }
+
+  usbh_spin_lock(false);
+  tuh_iso_xfer_t* pending = q->head;
+  q->head = NULL;
+  usbh_spin_unlock(false);
+
+  if (pending == NULL) {
+    return;
+  }
+
+  get_edpt(dev, ep_addr)->status &= (uint8_t) ~(TU_EDPT_STATE_BUSY | TU_EDPT_STATE_CLAIMED);
+
+  while (pending != NULL) {
+    tuh_iso_xfer_t* xfer = pending;
+    pending = xfer->next;
+    xfer->next   = NULL;
+    xfer->result = result;
+    xfer->complete_cb(xfer);
+  }
+}
+#endif
+
 static bool usbh_edpt_control_open(uint8_t dev_addr, uint8_t max_packet_size) {
   TU_LOG_USBH("[%u:%u] Open EP0 with Size = %u\r\n", usbh_get_rhport(dev_addr), dev_addr, max_packet_size);
   tusb_desc_endpoint_t ep0_desc = {
@@ -1327,6 +1972,14 @@ bool tuh_edpt_open(uint8_t dev_addr, tusb_desc_endpoint_t const* desc_ep) {
     hacked_ep->wMaxPacketSize       = tu_htole16(64);
   }
   TU_ASSERT(tu_edpt_validate(desc_ep, tuh_speed_get(dev_addr)));
+  usbh_edpt_t* ep = edpt_alloc(dev_addr, desc_ep->bEndpointAddress);
+  TU_ASSERT(ep != NULL);
+  #if CFG_TUH_ISO_XFER
+  if (desc_ep->bmAttributes.xfer == TUSB_XFER_ISOCHRONOUS) {
+    uint16_t const mult = (uint16_t) (((tu_le16toh(desc_ep->wMaxPacketSize) >> 11) & 0x03u) + 1u);
+    ep->iso_queue.max_len = (uint16_t) (tu_edpt_packet_size(desc_ep) * mult);
+  }
+  #endif
   return hcd_edpt_open(usbh_get_rhport(dev_addr), dev_addr, desc_ep);
 }
 
@@ -1340,10 +1993,16 @@ bool usbh_edpt_busy(uint8_t dev_addr, uint8_t ep_addr) {
   usbh_device_t* dev = get_device(dev_addr);
   TU_VERIFY(dev);
 
-  uint8_t const epnum = tu_edpt_number(ep_addr);
-  uint8_t const dir = tu_edpt_dir(ep_addr);
+  usbh_edpt_t const* ep = get_edpt(dev, ep_addr);
+  TU_VERIFY(ep);
 
-  return (dev->ep_status[epnum][dir] & TU_EDPT_STATE_BUSY) != 0;
+  return (ep->status & TU_EDPT_STATE_BUSY) != 0;
+}
+
+bool usbh_edpt_clear_stall(uint8_t dev_addr, uint8_t ep_addr) {
+  usbh_device_t* dev = get_device(dev_addr);
+  TU_VERIFY(dev && dev->connected);
+  return hcd_edpt_clear_stall(dev->bus_info.rhport, dev_addr, ep_addr);
 }
 
 //--------------------------------------------------------------------+
@@ -1354,8 +2013,10 @@ bool tuh_bus_info_get(uint8_t daddr, tuh_bus_info_t* bus_info) {
   usbh_device_t const* dev = get_device(daddr);
   if (dev != NULL) {
     *bus_info = dev->bus_info;
+  } else if (_usbh_data.addr0_owner < CFG_TUH_ENUM_MAX) {
+    *bus_info = _usbh_data.enum_dev[_usbh_data.addr0_owner].bus;
   } else {
-    *bus_info = _usbh_data.dev0_bus;
+    tu_memclr(bus_info, sizeof(tuh_bus_info_t));
   }
   return true;
 }
@@ -1377,6 +2038,12 @@ TU_ATTR_FAST_FUNC void hcd_event_handler(hcd_event_t const* event, bool in_isr)
       }
       break;
 
+  #if CFG_TUH_EDPT_XFER_QUEUE
+    case HCD_EVENT_XFER_COMPLETE:
+      xfer_queue_isr(event, in_isr); // retire queued transfer before the event is processed by usbh task
+      break;
+  #endif
+
     default:
       // nothing to do
       break;
@@ -1577,15 +2244,21 @@ bool tuh_interface_set(uint8_t daddr, uint8_t itf_num, uint8_t itf_alt,
 
 // process detach event from rhport:hub_addr:hub_port
 static void process_remove_event(hcd_event_t *event) {
-  if (_usbh_data.enumerating_daddr == 0 &&
-      event->rhport == _usbh_data.dev0_bus.rhport &&
-      event->connection.hub_addr == _usbh_data.dev0_bus.hub_addr &&
-      event->connection.hub_port == _usbh_data.dev0_bus.hub_port) {
-    // dev0 is unplugged while enumerating (not yet assigned an address)
-    usbh_device_close(_usbh_data.dev0_bus.rhport, 0);
-  } else {
-    remove_device_tree(event->rhport, event->connection.hub_addr, event->connection.hub_port);
+  for (uint8_t idx = 0; idx < CFG_TUH_ENUM_MAX; idx++) {
+    const usbh_enum_t* e = &_usbh_data.enum_dev[idx];
+    if (e->active && e->daddr == 0 && event->rhport == e->bus.rhport &&
+        event->connection.hub_addr == e->bus.hub_addr && event->connection.hub_port == e->bus.hub_port) {
+      // unplugged while enumerating (not yet assigned an address)
+      if (idx == _usbh_data.addr0_owner) {
+        usbh_device_close(e->bus.rhport, 0);
+      } else {
+        enum_full_complete(idx, false); // still debouncing or waiting for address 0
+      }
+      return;
+    }
   }
+
+  remove_device_tree(event->rhport, event->connection.hub_addr, event->connection.hub_port);
 }
 
 // remove a device at rhport:hub_addr:hub_port and all of its downstream
@@ -1657,8 +2330,9 @@ static void remove_device_tree(uint8_t rhport, uint8_t hub_addr, uint8_t hub_por
 //--------------------------------------------------------------------+
 // Enumeration Process
 // is a lengthy process with a series of control transfer to configure newly attached device.
-// NOTE: due to the shared control buffer, we must complete enumerating
-// one device before enumerating another one.
+// NOTE: up to CFG_TUH_ENUM_MAX devices are enumerated in parallel, each with its own buffer. Since every device
+// responds to address 0 after reset, port reset until SET_ADDRESS is serialized (address 0 window). Class driver
+// configuration is serialized as well since drivers share usbh_get_enum_buf().
 //--------------------------------------------------------------------+
 enum {                                      // USB 2.0 specs 7.1.7 for timing
   ENUM_DEBOUNCING_DELAY_MS           = 150, // T(ATTDB)  minimum 100 ms for stable connection
@@ -1687,6 +2361,7 @@ enum {
   ENUM_GET_STRING_PRODUCT,
   ENUM_GET_STRING_SERIAL_LEN,
   ENUM_GET_STRING_SERIAL,
+  ENUM_CACHE_CHECK_SERIAL,
   ENUM_GET_9BYTE_CONFIG_DESC,
   ENUM_GET_FULL_CONFIG_DESC,
   ENUM_SET_CONFIG,
@@ -1694,8 +2369,8 @@ enum {
 };
 
 static uint8_t enum_get_new_address(bool is_hub);
-static bool    enum_parse_configuration_desc(uint8_t dev_addr, const tusb_desc_configuration_t *desc_cfg);
-static void    enum_full_complete(bool success);
+static bool    enum_parse_configuration_desc(uint8_t dev_addr, const tusb_desc_configuration_t *desc_cfg,
+                                             const uint8_t* cached_drv);
 static void    process_enumeration(tuh_xfer_t *xfer);
 
 enum {
@@ -1706,43 +2381,118 @@ enum {
   ENUM_AFTER_RESET_HUB_DELAY_RETRY,
   ENUM_AFTER_RESET_RECOVERY_DELAY,
   ENUM_AFTER_SET_ADDRESS_RECOVERY_DELAY,
+  ENUM_AFTER_CONFIG_WAIT,
 };
 
+// Callback argument (xfer user_data or deferred param) of an enumeration: generation, instance index and state
+TU_ATTR_ALWAYS_INLINE static inline uintptr_t enum_arg(uint8_t idx, uint8_t state) {
+  return (uintptr_t) (((uint32_t) _usbh_data.enum_dev[idx].gen << 16) | ((uint32_t) idx << 8) | state);
+}
+
+// Get enumeration instance from callback argument, NULL if it is stale i.e instance is completed or reused
+static usbh_enum_t* enum_from_arg(uintptr_t arg, uint8_t* idx, uint8_t* state) {
+  *idx   = (uint8_t) (arg >> 8);
+  *state = (uint8_t) arg;
+  TU_VERIFY(*idx < CFG_TUH_ENUM_MAX, NULL);
+  usbh_enum_t* e = &_usbh_data.enum_dev[*idx];
+  TU_VERIFY(e->active && e->gen == (uint8_t) (arg >> 16), NULL);
+  return e;
+}
+
+// Own a window (address 0 or driver configuration), otherwise wait and resume with delay state once it is released
+static bool enum_window_acquire(uint8_t* owner, uint8_t idx, uint8_t resume_state) {
+  if (*owner == TUSB_INDEX_INVALID_8 || *owner == idx) {
+    *owner = idx;
+    return true;
+  }
+  usbh_enum_t* e = &_usbh_data.enum_dev[idx];
+  e->waiting     = 1;
+  e->wait_state  = resume_state;
+  return false;
+}
+
+static void enum_window_release(uint8_t* owner, uint8_t idx) {
+  if (*owner != idx) {
+    return;
+  }
+  *owner = TUSB_INDEX_INVALID_8;
+
+  // resume all waiting instances, the first one to run takes the window and others continue to wait
+  for (uint8_t i = 0; i < CFG_TUH_ENUM_MAX; i++) {
+    usbh_enum_t* e = &_usbh_data.enum_dev[i];
+    if (e->active && e->waiting) {
+      e->waiting = 0;
+      (void) usbh_defer_func_ms_async(0, enum_delay_async, enum_arg(i, e->wait_state));
+    }
+  }
+}
+
+// Hand port back to parent hub driver which leaves its status change (port reset) to us since attach
+static void enum_hub_resume(usbh_enum_t* e) {
+#if CFG_TUH_HUB
+  if (e->hub_paused) {
+    e->hub_paused = 0;
+    hub_port_release(e->bus.hub_addr, e->bus.hub_port);
+  }
+#else
+  (void) e;
+#endif
+}
+
 // process async delay in enumeration
-static void enum_delay_async(uintptr_t state) {
-  tuh_bus_info_t *dev0_bus = &_usbh_data.dev0_bus;
+static void enum_delay_async(uintptr_t arg) {
+  uint8_t idx;
+  uint8_t state;
+  usbh_enum_t* e = enum_from_arg(arg, &idx, &state);
+  if (e == NULL) {
+    return; // stale
+  }
+  tuh_bus_info_t *dev0_bus = &e->bus;
+  uint8_t* enum_buf = _usbh_epbuf.ctrl[idx].buf;
+
   switch (state) {
     case ENUM_AFTER_DEBOUNCING_DELAY:
+      if (dev0_bus->hub_addr == 0) {
+        _usbh_data.attach_debouncing_bm &= (uint8_t)~TU_BIT(dev0_bus->rhport); // clear roothub debouncing delay
+      }
+
+      // port reset until SET_ADDRESS is done at address 0: wait until other device is addressed
+      if (!enum_window_acquire(&_usbh_data.addr0_owner, idx, ENUM_AFTER_DEBOUNCING_DELAY)) {
+        TU_LOG_USBH("[%u:%u:%u] Wait for address 0\r\n", dev0_bus->rhport, dev0_bus->hub_addr, dev0_bus->hub_port);
+        break;
+      }
+
   #if CFG_TUH_HUB
       if (dev0_bus->hub_addr != 0) {
         // connected via hub
         TU_VERIFY(dev0_bus->hub_port != 0, );
         TU_ASSERT(hub_port_get_status(dev0_bus->hub_addr, dev0_bus->hub_port, NULL, process_enumeration,
-                                      ENUM_HUB_RERSET), );
+                                      enum_arg(idx, ENUM_HUB_RERSET)), );
       } else
   #endif
       {
         // connected directly to roothub
-        _usbh_data.attach_debouncing_bm &= (uint8_t)~TU_BIT(dev0_bus->rhport); // clear roothub debouncing delay
         if (!hcd_port_connect_status(dev0_bus->rhport)) {
           TU_LOG_USBH("Device unplugged while debouncing\r\n");
-          enum_full_complete(false);
+          enum_full_complete(idx, false);
           return;
         }
         hcd_port_reset(dev0_bus->rhport); // reset port
-        usbh_defer_func_ms_async(ENUM_RESET_ROOT_DELAY_MS, enum_delay_async, ENUM_AFTER_RESET_ROOT_DELAY);
+        usbh_defer_func_ms_async(ENUM_RESET_ROOT_DELAY_MS, enum_delay_async,
+                                 enum_arg(idx, ENUM_AFTER_RESET_ROOT_DELAY));
       }
       break;
 
     case ENUM_AFTER_RESET_ROOT_DELAY:
       hcd_port_reset_end(dev0_bus->rhport);
-      usbh_defer_func_ms_async(ENUM_RESET_ROOT_POST_DELAY_MS, enum_delay_async, ENUM_AFTER_RESET_ROOT_POST_DELAY);
+      usbh_defer_func_ms_async(ENUM_RESET_ROOT_POST_DELAY_MS, enum_delay_async,
+                               enum_arg(idx, ENUM_AFTER_RESET_ROOT_POST_DELAY));
       break;
 
-    case ENUM_AFTER_RESET_ROOT_POST_DELAY:
+    case ENUM_AFTER_RESET_ROOT_POST_DELAY: {
       if (!hcd_port_connect_status(dev0_bus->rhport)) {
         // device unplugged while delaying
-        enum_full_complete(false);
+        enum_full_complete(idx, false);
         return;
       }
 
@@ -1753,17 +2503,18 @@ static void enum_delay_async(uintptr_t state) {
       tuh_xfer_t xfer;
       xfer.daddr     = 0;
       xfer.result    = XFER_RESULT_SUCCESS;
-      xfer.user_data = ENUM_ADDR0_DEVICE_DESC;
+      xfer.user_data = enum_arg(idx, ENUM_ADDR0_DEVICE_DESC);
       process_enumeration(&xfer);
       break;
+    }
 
   #if CFG_TUH_HUB
     case ENUM_AFTER_RESET_HUB_DELAY:
     case ENUM_AFTER_RESET_HUB_DELAY_RETRY:
       // get status after reset complete to check for reset change
       TU_ASSERT(hub_port_get_status(dev0_bus->hub_addr, dev0_bus->hub_port, NULL, process_enumeration,
-                                    state == ENUM_AFTER_RESET_HUB_DELAY ? ENUM_HUB_CLEAR_RESET
-                                                                        : ENUM_HUB_CLEAR_RESET_RETRY), );
+                                    enum_arg(idx, state == ENUM_AFTER_RESET_HUB_DELAY ? ENUM_HUB_CLEAR_RESET
+                                                                                      : ENUM_HUB_CLEAR_RESET_RETRY)), );
       break;
   #endif
 
@@ -1771,27 +2522,37 @@ static void enum_delay_async(uintptr_t state) {
       // TODO probably doesn't need to open/close each enumeration
       if (!usbh_edpt_control_open(0, 8)) {
         TU_LOG_USBH("Failed to open dev0's control endpoint\r\n");
-        enum_full_complete(false); // Stop enumeration gracefully
+        enum_full_complete(idx, false); // Stop enumeration gracefully
         return;
       }
       // Get first 8 bytes of device descriptor for control endpoint size
       TU_LOG_USBH("Get 8 byte of Device Descriptor\r\n");
-      TU_ASSERT(tuh_descriptor_get_device(0, _usbh_epbuf.ctrl, 8, process_enumeration, ENUM_SET_ADDR), );
+      TU_ASSERT(tuh_descriptor_get_device(0, enum_buf, 8, process_enumeration, enum_arg(idx, ENUM_SET_ADDR)), );
       break;
 
     case ENUM_AFTER_SET_ADDRESS_RECOVERY_DELAY: {
-      const uint8_t  new_addr = _usbh_data.enumerating_daddr;
+      const uint8_t  new_addr = e->daddr;
       usbh_device_t *new_dev  = get_device(new_addr);
       TU_ASSERT(new_dev, );
       if (!usbh_edpt_control_open(new_addr, new_dev->desc_device.bMaxPacketSize0)) {
         TU_LOG_USBH("Failed to open new device's control endpoint\r\n");
         clear_device(new_dev);
-        enum_full_complete(false);
+        enum_full_complete(idx, false);
         return;
       }
       TU_LOG_USBH("Get Device Descriptor\r\n");
-      TU_ASSERT(tuh_descriptor_get_device(new_addr, _usbh_epbuf.ctrl, sizeof(tusb_desc_device_t), process_enumeration,
-                                          ENUM_GET_STRING_LANGUAGE_ID_LEN), );
+      TU_ASSERT(tuh_descriptor_get_device(new_addr, enum_buf, sizeof(tusb_desc_device_t), process_enumeration,
+                                          enum_arg(idx, ENUM_GET_STRING_LANGUAGE_ID_LEN)), );
+      break;
+    }
+
+    case ENUM_AFTER_CONFIG_WAIT: {
+      // configuration window is released, continue with driver configuration
+      tuh_xfer_t xfer;
+      xfer.daddr     = e->daddr;
+      xfer.result    = XFER_RESULT_SUCCESS;
+      xfer.user_data = enum_arg(idx, ENUM_CONFIG_DRIVER);
+      process_enumeration(&xfer);
       break;
     }
 
@@ -1800,26 +2561,274 @@ static void enum_delay_async(uintptr_t state) {
   }
 }
 
-// start a new enumeration process
-static void enum_new_device(hcd_event_t *event) {
-  tuh_bus_info_t *dev0_bus = &_usbh_data.dev0_bus;
-  dev0_bus->rhport         = event->rhport;
-  dev0_bus->hub_addr       = event->connection.hub_addr;
-  dev0_bus->hub_port       = event->connection.hub_port;
-  usbh_defer_func_ms_async(ENUM_DEBOUNCING_DELAY_MS, enum_delay_async, ENUM_AFTER_DEBOUNCING_DELAY);
+// start a new enumeration process, return false if all instances are busy
+#if CFG_TUH_ENUM_CACHE
+//--------------------------------------------------------------------+
+// Enumeration Cache
+// Device descriptor, serial number, selected configuration descriptor and class driver of each interface of recently
+// enumerated devices. Entries are kept in an application provided arena with LRU replacement.
+//--------------------------------------------------------------------+
+enum {
+  ENUM_CACHE_FREE = 0,
+  ENUM_CACHE_PENDING, // being filled by enumeration in progress
+  ENUM_CACHE_VALID
+};
+
+typedef struct {
+  uint32_t lru;          // access stamp, smallest is least recently used
+  desc_device_noheader_t desc_device;
+  uint16_t langid;       // language of serial string
+  uint16_t config_len;
+  uint8_t state;
+  uint8_t serial_len;    // length of serial string descriptor, 0 if device has no serial number
+  uint8_t config_idx;
+  uint8_t itf_drv[CFG_TUH_INTERFACE_MAX];
+  // followed by CFG_TUH_ENUMERATION_BUFSIZE bytes: configuration descriptor at start, serial string descriptor at end
+} usbh_enum_cache_entry_t;
+
+// entry size with configuration descriptor, rounded up to keep entries aligned
+#define ENUM_CACHE_ENTRY_SIZE  (4u * TU_DIV_CEIL(sizeof(usbh_enum_cache_entry_t) + CFG_TUH_ENUMERATION_BUFSIZE, 4u))
+
+static struct {
+  uint8_t* arena;
+  uint8_t count;
+  uint32_t stamp;
+} _enum_cache;
+
+TU_ATTR_ALWAYS_INLINE static inline usbh_enum_cache_entry_t* enum_cache_entry(uint8_t i) {
+  return (usbh_enum_cache_entry_t*) (uintptr_t) (_enum_cache.arena + i * ENUM_CACHE_ENTRY_SIZE);
+}
+
+TU_ATTR_ALWAYS_INLINE static inline uint8_t* enum_cache_config(usbh_enum_cache_entry_t* entry) {
+  return (uint8_t*) (entry + 1);
+}
+
+TU_ATTR_ALWAYS_INLINE static inline uint8_t* enum_cache_serial(usbh_enum_cache_entry_t* entry) {
+  return enum_cache_config(entry) + CFG_TUH_ENUMERATION_BUFSIZE - entry->serial_len;
+}
+
+// Entry of an enumeration, NULL if none
+static usbh_enum_cache_entry_t* enum_cache_get(uint8_t idx) {
+  const uint8_t i = _usbh_data.enum_dev[idx].cache_idx;
+  return (i < _enum_cache.count) ? enum_cache_entry(i) : NULL;
+}
+
+static bool enum_cache_in_use(uint8_t i) {
+  for (uint8_t idx = 0; idx < CFG_TUH_ENUM_MAX; idx++) {
+    if (_usbh_data.enum_dev[idx].active && _usbh_data.enum_dev[idx].cache_idx == i) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Claim free or least recently used entry (not used by other enumeration) to be filled by enumeration
+static usbh_enum_cache_entry_t* enum_cache_claim(uint8_t idx) {
+  uint8_t victim = TUSB_INDEX_INVALID_8;
+  for (uint8_t i = 0; i < _enum_cache.count; i++) {
+    usbh_enum_cache_entry_t const* entry = enum_cache_entry(i);
+    if (entry->state == ENUM_CACHE_PENDING || enum_cache_in_use(i)) {
+      continue;
+    }
+    if (entry->state == ENUM_CACHE_FREE) {
+      victim = i;
+      break;
+    }
+    if (victim == TUSB_INDEX_INVALID_8 || entry->lru < enum_cache_entry(victim)->lru) {
+      victim = i;
+    }
+  }
+  TU_VERIFY(victim != TUSB_INDEX_INVALID_8, NULL);
+
+  usbh_enum_cache_entry_t* entry = enum_cache_entry(victim);
+  entry->state      = ENUM_CACHE_PENDING;
+  entry->serial_len = 0;
+  entry->langid     = 0;
+  _usbh_data.enum_dev[idx].cache_idx = victim;
+  return entry;
+}
+
+// Save serial string descriptor just received into a new entry, it is the cache key together with device descriptor
+static void enum_cache_serial_save(uint8_t idx, const tuh_xfer_t* xfer) {
+  TU_VERIFY(xfer->actual_len <= CFG_TUH_ENUMERATION_BUFSIZE, );
+  usbh_enum_cache_entry_t* entry = enum_cache_claim(idx);
+  TU_VERIFY(entry != NULL, );
+  entry->langid     = tu_le16toh(xfer->setup->wIndex);
+  entry->serial_len = (uint8_t) xfer->actual_len;
+  memcpy(enum_cache_serial(entry), xfer->buffer, entry->serial_len);
+}
+
+// Configure cached device right away with cached configuration descriptor
+static bool enum_cache_set_config(uint8_t idx, uint8_t daddr) {
+  usbh_enum_cache_entry_t* entry = enum_cache_get(idx);
+  uint8_t* enum_buf = _usbh_epbuf.ctrl[idx].buf;
+  memcpy(enum_buf, enum_cache_config(entry), entry->config_len);
+
+  if (!tuh_enum_descriptor_configuration_cb(daddr, entry->config_idx, (const tusb_desc_configuration_t*) enum_buf)) {
+    // configuration is not accepted anymore, refill entry (keeping serial) with configuration descriptor from device
+    entry->state = ENUM_CACHE_PENDING;
+    return tuh_descriptor_get_configuration(daddr, 0, enum_buf, 9, process_enumeration,
+                                            enum_arg(idx, ENUM_GET_FULL_CONFIG_DESC));
+  }
+
+  TU_LOG_USBH("[%u] Cached device, Set Configuration = %u\r\n", daddr, entry->config_idx + 1u);
+  return tuh_configuration_set(daddr, entry->config_idx + 1u, process_enumeration, enum_arg(idx, ENUM_CONFIG_DRIVER));
+}
+
+// Look up device descriptor. Return true if enumeration continues with cached data: serial number is read with cached
+// language and length to pick the matching entry, otherwise device is configured right away
+static bool enum_cache_lookup(uint8_t idx, uint8_t daddr, const usbh_device_t* dev) {
+  usbh_enum_t* e = &_usbh_data.enum_dev[idx];
+  for (uint8_t i = 0; i < _enum_cache.count; i++) {
+    usbh_enum_cache_entry_t* entry = enum_cache_entry(i);
+    if (entry->state == ENUM_CACHE_VALID && 0 == memcmp(&entry->desc_device, &dev->desc_device, sizeof(desc_device_noheader_t))) {
+      e->cache_idx = i;
+      if (dev->desc_device.iSerialNumber == 0) {
+        return enum_cache_set_config(idx, daddr);
+      }
+      return tuh_descriptor_get_string(daddr, dev->desc_device.iSerialNumber, entry->langid, _usbh_epbuf.ctrl[idx].buf,
+                                       entry->serial_len, process_enumeration, enum_arg(idx, ENUM_CACHE_CHECK_SERIAL));
+    }
+  }
+  return false;
+}
+
+// Pick entry matching serial number just received. Return true if enumeration continues with cached data
+static bool enum_cache_match_serial(uint8_t idx, uint8_t daddr, const tuh_xfer_t* xfer) {
+  usbh_enum_t* e = &_usbh_data.enum_dev[idx];
+  usbh_enum_cache_entry_t const* first = enum_cache_get(idx);
+  e->cache_idx = TUSB_INDEX_INVALID_8;
+  TU_VERIFY(first != NULL);
+
+  for (uint8_t i = 0; i < _enum_cache.count; i++) {
+    usbh_enum_cache_entry_t* entry = enum_cache_entry(i);
+    if (entry->state == ENUM_CACHE_VALID && entry->serial_len == xfer->actual_len &&
+        0 == memcmp(enum_cache_serial(entry), xfer->buffer, entry->serial_len) &&
+        0 == memcmp(&entry->desc_device, &first->desc_device, sizeof(desc_device_noheader_t))) {
+      e->cache_idx = i;
+      return enum_cache_set_config(idx, daddr);
+    }
+  }
+  return false;
+}
+
+// Fill entry with configuration descriptor of device being configured. Entry is claimed when serial string is received,
+// device with serial number is not cached if that failed
+static void enum_cache_store(uint8_t idx, const usbh_device_t* dev, uint8_t config_idx, const uint8_t* desc_config) {
+  usbh_enum_t* e = &_usbh_data.enum_dev[idx];
+  usbh_enum_cache_entry_t* entry = enum_cache_get(idx);
+  if (entry == NULL || entry->state != ENUM_CACHE_PENDING) {
+    e->cache_idx = TUSB_INDEX_INVALID_8;
+    TU_VERIFY(dev->desc_device.iSerialNumber == 0, );
+    entry = enum_cache_claim(idx);
+    TU_VERIFY(entry != NULL, );
+  }
+
+  uint16_t const config_len =
+    tu_le16toh(tu_unaligned_read16(desc_config + offsetof(tusb_desc_configuration_t, wTotalLength)));
+  if (config_len + entry->serial_len > CFG_TUH_ENUMERATION_BUFSIZE) {
+    // no room for both descriptors
+    entry->state = ENUM_CACHE_FREE;
+    e->cache_idx = TUSB_INDEX_INVALID_8;
+    return;
+  }
+
+  entry->desc_device = dev->desc_device;
+  entry->config_idx  = config_idx;
+  entry->config_len  = config_len;
+  memcpy(enum_cache_config(entry), desc_config, config_len);
+}
+
+// Class driver of each interface from cache, NULL if device is not cached
+static const uint8_t* enum_cache_drivers(uint8_t idx) {
+  usbh_enum_cache_entry_t const* entry = enum_cache_get(idx);
+  return (entry != NULL && entry->state == ENUM_CACHE_VALID) ? entry->itf_drv : NULL;
+}
+
+// Validate pending entry once device is configured, drop entry of a failed enumeration since it may be stale
+static void enum_cache_complete(uint8_t idx, bool success) {
+  usbh_enum_t* e = &_usbh_data.enum_dev[idx];
+  usbh_enum_cache_entry_t* entry = enum_cache_get(idx);
+  e->cache_idx = TUSB_INDEX_INVALID_8;
+  if (entry == NULL || entry->state == ENUM_CACHE_FREE) {
+    return;
+  }
+
+  usbh_device_t const* dev = get_device(e->daddr);
+  if (success && dev != NULL) {
+    if (entry->state == ENUM_CACHE_PENDING) {
+      memcpy(entry->itf_drv, dev->itf2drv, CFG_TUH_INTERFACE_MAX);
+      entry->state = ENUM_CACHE_VALID;
+    }
+    entry->lru = ++_enum_cache.stamp;
+  } else {
+    entry->state = ENUM_CACHE_FREE;
+  }
+}
+
+bool tuh_enum_cache_init(void* arena, uint32_t arena_size) {
+  TU_VERIFY(arena != NULL && ((uintptr_t) arena & 3u) == 0 && arena_size >= ENUM_CACHE_ENTRY_SIZE);
+  _enum_cache.arena = (uint8_t*) arena;
+  _enum_cache.count = (uint8_t) tu_min32(arena_size / ENUM_CACHE_ENTRY_SIZE, TUSB_INDEX_INVALID_8 - 1u);
+  _enum_cache.stamp = 0;
+  tuh_enum_cache_clear();
+  return true;
+}
+
+void tuh_enum_cache_clear(void) {
+  for (uint8_t i = 0; i < _enum_cache.count; i++) {
+    enum_cache_entry(i)->state = ENUM_CACHE_FREE;
+  }
+  for (uint8_t idx = 0; idx < CFG_TUH_ENUM_MAX; idx++) {
+    _usbh_data.enum_dev[idx].cache_idx = TUSB_INDEX_INVALID_8;
+  }
+}
+#endif
+
+static bool enum_new_device(hcd_event_t *event) {
+  uint8_t idx;
+  for (idx = 0; idx < CFG_TUH_ENUM_MAX; idx++) {
+    if (!_usbh_data.enum_dev[idx].active) {
+      break;
+    }
+  }
+  TU_VERIFY(idx < CFG_TUH_ENUM_MAX);
+
+  usbh_enum_t* e = &_usbh_data.enum_dev[idx];
+  const uint8_t gen = (uint8_t) (e->gen + 1u);
+  tu_memclr(e, sizeof(usbh_enum_t));
+  e->gen          = gen;
+  e->active       = 1;
+  e->bus.rhport   = event->rhport;
+  e->bus.hub_addr = event->connection.hub_addr;
+  e->bus.hub_port = event->connection.hub_port;
+  e->hub_paused   = (e->bus.hub_addr != 0) ? 1 : 0; // hub.c skips this port after reporting an attach
+#if CFG_TUH_ENUM_CACHE
+  e->cache_idx    = TUSB_INDEX_INVALID_8;
+#endif
+
+  usbh_defer_func_ms_async(ENUM_DEBOUNCING_DELAY_MS, enum_delay_async, enum_arg(idx, ENUM_AFTER_DEBOUNCING_DELAY));
+  return true;
 }
 
 // process device enumeration
 static void process_enumeration(tuh_xfer_t *xfer) {
+  uint8_t idx;
+  uint8_t state;
+  usbh_enum_t* e = enum_from_arg(xfer->user_data, &idx, &state);
+  if (e == NULL) {
+    return; // stale
+  }
+
   if (XFER_RESULT_FAILED == xfer->result) {
-    enum_full_complete(false); // failed to enum
+    enum_full_complete(idx, false); // failed to enum
     return;
   }
 
   const uint8_t   daddr    = xfer->daddr;
-  const uintptr_t state    = xfer->user_data;
   usbh_device_t  *dev      = get_device(daddr);
-  tuh_bus_info_t *dev0_bus = &_usbh_data.dev0_bus;
+  tuh_bus_info_t *dev0_bus = &e->bus;
+  uint8_t        *enum_buf = _usbh_epbuf.ctrl[idx].buf;
   if (daddr > 0) {
     TU_ASSERT(dev != NULL,);
   }
@@ -1837,14 +2846,14 @@ static void process_enumeration(tuh_xfer_t *xfer) {
         is_enum_failed = true;
       } else {
         TU_ASSERT(hub_port_reset(dev0_bus->hub_addr, dev0_bus->hub_port, process_enumeration,
-                                 ENUM_HUB_RESET_COMPLETE), );
+                                 enum_arg(idx, ENUM_HUB_RESET_COMPLETE)), );
       }
       break;
     }
 
     case ENUM_HUB_RESET_COMPLETE:
       // wait for reset to take effect
-      usbh_defer_func_ms_async(ENUM_RESET_HUB_DELAY_MS, enum_delay_async, ENUM_AFTER_RESET_HUB_DELAY);
+      usbh_defer_func_ms_async(ENUM_RESET_HUB_DELAY_MS, enum_delay_async, enum_arg(idx, ENUM_AFTER_RESET_HUB_DELAY));
       break;
 
     case ENUM_HUB_CLEAR_RESET:
@@ -1855,10 +2864,11 @@ static void process_enumeration(tuh_xfer_t *xfer) {
       if (1 == port_status.change.reset) {
         // Acknowledge Port Reset Change
         TU_ASSERT(hub_port_clear_reset_change(dev0_bus->hub_addr, dev0_bus->hub_port, process_enumeration,
-                                              ENUM_HUB_CLEAR_RESET_COMPLETE), );
+                                              enum_arg(idx, ENUM_HUB_CLEAR_RESET_COMPLETE)), );
       } else if (state == ENUM_HUB_CLEAR_RESET) {
         // retry one more time if reset change not set yet
-        usbh_defer_func_ms_async(ENUM_RESET_HUB_DELAY_MS, enum_delay_async, ENUM_AFTER_RESET_HUB_DELAY_RETRY);
+        usbh_defer_func_ms_async(ENUM_RESET_HUB_DELAY_MS, enum_delay_async,
+                                 enum_arg(idx, ENUM_AFTER_RESET_HUB_DELAY_RETRY));
       } else {
         // retry but still not set --> failed
         is_enum_failed = true;
@@ -1884,11 +2894,12 @@ static void process_enumeration(tuh_xfer_t *xfer) {
   #endif
 
     case ENUM_ADDR0_DEVICE_DESC:
-      usbh_defer_func_ms_async(ENUM_RESET_RECOVERY_DELAY_MS, enum_delay_async, ENUM_AFTER_RESET_RECOVERY_DELAY);
+      usbh_defer_func_ms_async(ENUM_RESET_RECOVERY_DELAY_MS, enum_delay_async,
+                               enum_arg(idx, ENUM_AFTER_RESET_RECOVERY_DELAY));
       break;
 
     case ENUM_SET_ADDR: {
-      const tusb_desc_device_t *desc_device = (const tusb_desc_device_t *) _usbh_epbuf.ctrl;
+      const tusb_desc_device_t *desc_device = (const tusb_desc_device_t *) enum_buf;
       if (!(desc_device->bDescriptorType == TUSB_DESC_DEVICE && desc_device->bMaxPacketSize0 >= 8)) {
         TU_LOG_USBH("Invalid Device descriptor\r\n");
         is_enum_failed = true;
@@ -1903,7 +2914,7 @@ static void process_enumeration(tuh_xfer_t *xfer) {
       new_dev->connected = 1;
       new_dev->desc_device.bMaxPacketSize0 = desc_device->bMaxPacketSize0;
 
-      TU_ASSERT(tuh_address_set(0, new_addr, process_enumeration, ENUM_GET_DEVICE_DESC), );
+      TU_ASSERT(tuh_address_set(0, new_addr, process_enumeration, enum_arg(idx, ENUM_GET_DEVICE_DESC)), );
       break;
     }
 
@@ -1911,11 +2922,17 @@ static void process_enumeration(tuh_xfer_t *xfer) {
       const uint8_t  new_addr = (uint8_t)tu_le16toh(xfer->setup->wValue);
       usbh_device_t *new_dev  = get_device(new_addr);
       TU_ASSERT(new_dev, );
-      new_dev->addressed           = 1;
-      _usbh_data.enumerating_daddr = new_addr;
+      new_dev->addressed = 1;
+      e->daddr           = new_addr;
 
       usbh_device_close(dev0_bus->rhport, 0); // close dev0
-      usbh_defer_func_ms_async(ENUM_SET_ADDRESS_RECOVERY_DELAY_MS, enum_delay_async, ENUM_AFTER_SET_ADDRESS_RECOVERY_DELAY);
+
+      // address 0 is free for next device, also hand port back to hub driver while this one continues
+      enum_window_release(&_usbh_data.addr0_owner, idx);
+      enum_hub_resume(e);
+
+      usbh_defer_func_ms_async(ENUM_SET_ADDRESS_RECOVERY_DELAY_MS, enum_delay_async,
+                               enum_arg(idx, ENUM_AFTER_SET_ADDRESS_RECOVERY_DELAY));
       break;
     }
 
@@ -1923,31 +2940,47 @@ static void process_enumeration(tuh_xfer_t *xfer) {
     // to determine the length first. otherwise, some device may have buffer overflow.
     case ENUM_GET_STRING_LANGUAGE_ID_LEN: {
       // save the received device descriptor
-      tusb_desc_device_t const *desc_device = (tusb_desc_device_t const *) _usbh_epbuf.ctrl;
+      tusb_desc_device_t const *desc_device = (tusb_desc_device_t const *) enum_buf;
 
       memcpy(&dev->desc_device, (const uint8_t*) desc_device + offsetof(tusb_desc_device_t, bcdUSB), sizeof(desc_device_noheader_t));
 
       tuh_enum_descriptor_device_cb(daddr, desc_device); // callback
-      tuh_descriptor_get_string_langid(daddr, _usbh_epbuf.ctrl, 2,
-                                       process_enumeration, ENUM_GET_STRING_LANGUAGE_ID);
+#if CFG_TUH_ENUM_CACHE
+      if (enum_cache_lookup(idx, daddr, dev)) {
+        break; // continue with cached data
+      }
+#endif
+      tuh_descriptor_get_string_langid(daddr, enum_buf, 2,
+                                       process_enumeration, enum_arg(idx, ENUM_GET_STRING_LANGUAGE_ID));
       break;
     }
 
+  #if CFG_TUH_ENUM_CACHE
+    case ENUM_CACHE_CHECK_SERIAL:
+      if (enum_cache_match_serial(idx, daddr, xfer)) {
+        break;
+      }
+      // not cached, continue with full enumeration
+      tuh_descriptor_get_string_langid(daddr, enum_buf, 2,
+                                       process_enumeration, enum_arg(idx, ENUM_GET_STRING_LANGUAGE_ID));
+      break;
+  #endif
+
     case ENUM_GET_STRING_LANGUAGE_ID: {
       const uint8_t str_len = xfer->buffer[0];
-      tuh_descriptor_get_string_langid(daddr, _usbh_epbuf.ctrl, str_len,
-                                       process_enumeration, ENUM_GET_STRING_MANUFACTURER_LEN);
+      tuh_descriptor_get_string_langid(daddr, enum_buf, str_len,
+                                       process_enumeration, enum_arg(idx, ENUM_GET_STRING_MANUFACTURER_LEN));
       break;
     }
 
     case ENUM_GET_STRING_MANUFACTURER_LEN: {
-      const tusb_desc_string_t* desc_langid = (const tusb_desc_string_t *) _usbh_epbuf.ctrl;
+      const tusb_desc_string_t* desc_langid = (const tusb_desc_string_t *) enum_buf;
       if (desc_langid->bLength >= 4) {
         langid = tu_le16toh(desc_langid->utf16le[0]); // previous request is langid
       }
       if (dev->desc_device.iManufacturer != 0) {
-        tuh_descriptor_get_string(daddr, dev->desc_device.iManufacturer, langid, _usbh_epbuf.ctrl, 2,
-                                  process_enumeration, ENUM_GET_STRING_MANUFACTURER);
+        tuh_descriptor_get_string(daddr, dev->desc_device.iManufacturer, langid, enum_buf, 2,
+                                  process_enumeration, enum_arg(idx, ENUM_GET_STRING_MANUFACTURER));
         break;
       }
       TU_ATTR_FALLTHROUGH;
@@ -1957,8 +2990,8 @@ static void process_enumeration(tuh_xfer_t *xfer) {
       if (dev->desc_device.iManufacturer != 0)  {
         langid = tu_le16toh(xfer->setup->wIndex); // langid from length's request
         const uint8_t str_len = xfer->buffer[0];
-        tuh_descriptor_get_string(daddr, dev->desc_device.iManufacturer, langid, _usbh_epbuf.ctrl, str_len,
-                                  process_enumeration, ENUM_GET_STRING_PRODUCT_LEN);
+        tuh_descriptor_get_string(daddr, dev->desc_device.iManufacturer, langid, enum_buf, str_len,
+                                  process_enumeration, enum_arg(idx, ENUM_GET_STRING_PRODUCT_LEN));
         break;
       }
       TU_ATTR_FALLTHROUGH;
@@ -1969,8 +3002,8 @@ static void process_enumeration(tuh_xfer_t *xfer) {
         if (state == ENUM_GET_STRING_PRODUCT_LEN) {
           langid = tu_le16toh(xfer->setup->wIndex); // get langid from previous setup packet if not fall through
         }
-        tuh_descriptor_get_string(
-            daddr, dev->desc_device.iProduct, langid, _usbh_epbuf.ctrl, 2, process_enumeration, ENUM_GET_STRING_PRODUCT);
+        tuh_descriptor_get_string(daddr, dev->desc_device.iProduct, langid, enum_buf, 2,
+                                  process_enumeration, enum_arg(idx, ENUM_GET_STRING_PRODUCT));
         break;
       }
       TU_ATTR_FALLTHROUGH;
@@ -1980,8 +3013,8 @@ static void process_enumeration(tuh_xfer_t *xfer) {
       if (dev->desc_device.iProduct != 0) {
         langid = tu_le16toh(xfer->setup->wIndex); // langid from length's request
         const uint8_t str_len = xfer->buffer[0];
-        tuh_descriptor_get_string(daddr, dev->desc_device.iProduct, langid, _usbh_epbuf.ctrl, str_len,
-                            process_enumeration, ENUM_GET_STRING_SERIAL_LEN);
+        tuh_descriptor_get_string(daddr, dev->desc_device.iProduct, langid, enum_buf, str_len,
+                            process_enumeration, enum_arg(idx, ENUM_GET_STRING_SERIAL_LEN));
         break;
       }
       TU_ATTR_FALLTHROUGH;
@@ -1992,8 +3025,8 @@ static void process_enumeration(tuh_xfer_t *xfer) {
         if (state == ENUM_GET_STRING_SERIAL_LEN) {
           langid = tu_le16toh(xfer->setup->wIndex); // get langid from previous setup packet if not fall through
         }
-        tuh_descriptor_get_string(
-            daddr, dev->desc_device.iSerialNumber, langid, _usbh_epbuf.ctrl, 2, process_enumeration, ENUM_GET_STRING_SERIAL);
+        tuh_descriptor_get_string(daddr, dev->desc_device.iSerialNumber, langid, enum_buf, 2,
+                                  process_enumeration, enum_arg(idx, ENUM_GET_STRING_SERIAL));
         break;
       }
       TU_ATTR_FALLTHROUGH;
@@ -2003,24 +3036,30 @@ static void process_enumeration(tuh_xfer_t *xfer) {
       if (dev->desc_device.iSerialNumber != 0) {
         langid = tu_le16toh(xfer->setup->wIndex); // langid from length's request
         const uint8_t str_len = xfer->buffer[0];
-        tuh_descriptor_get_string(daddr, dev->desc_device.iSerialNumber, langid, _usbh_epbuf.ctrl, str_len,
-                                  process_enumeration, ENUM_GET_9BYTE_CONFIG_DESC);
+        tuh_descriptor_get_string(daddr, dev->desc_device.iSerialNumber, langid, enum_buf, str_len,
+                                  process_enumeration, enum_arg(idx, ENUM_GET_9BYTE_CONFIG_DESC));
         break;
       }
       TU_ATTR_FALLTHROUGH;
     }
 
     case ENUM_GET_9BYTE_CONFIG_DESC: {
+    #if CFG_TUH_ENUM_CACHE
+      if (state == ENUM_GET_9BYTE_CONFIG_DESC) {
+        enum_cache_serial_save(idx, xfer); // previous request is serial string
+      }
+    #endif
+
       // Get 9-byte for total length
       uint8_t const config_idx = 0;
       TU_LOG_USBH("Get Configuration[%u] Descriptor (9 bytes)\r\n", config_idx);
-      TU_ASSERT(tuh_descriptor_get_configuration(daddr, config_idx, _usbh_epbuf.ctrl, 9,
-                                                 process_enumeration, ENUM_GET_FULL_CONFIG_DESC),);
+      TU_ASSERT(tuh_descriptor_get_configuration(daddr, config_idx, enum_buf, 9,
+                                                 process_enumeration, enum_arg(idx, ENUM_GET_FULL_CONFIG_DESC)),);
       break;
     }
 
     case ENUM_GET_FULL_CONFIG_DESC: {
-      uint8_t const* desc_config = _usbh_epbuf.ctrl;
+      uint8_t const* desc_config = enum_buf;
 
       // Use offsetof to avoid pointer to the odd/misaligned address
       uint16_t const total_len = tu_le16toh(tu_unaligned_read16(desc_config + offsetof(tusb_desc_configuration_t, wTotalLength)));
@@ -2031,39 +3070,45 @@ static void process_enumeration(tuh_xfer_t *xfer) {
       // Get full configuration descriptor
       uint8_t const config_idx = (uint8_t) tu_le16toh(xfer->setup->wIndex);
       TU_LOG_USBH("Get Configuration[%u] Descriptor\r\n", config_idx);
-      TU_ASSERT(tuh_descriptor_get_configuration(daddr, config_idx, _usbh_epbuf.ctrl, total_len,
-                                                 process_enumeration, ENUM_SET_CONFIG),);
+      TU_ASSERT(tuh_descriptor_get_configuration(daddr, config_idx, enum_buf, total_len,
+                                                 process_enumeration, enum_arg(idx, ENUM_SET_CONFIG)),);
       break;
     }
 
     case ENUM_SET_CONFIG: {
       uint8_t config_idx = (uint8_t) tu_le16toh(xfer->setup->wIndex);
-      if (tuh_enum_descriptor_configuration_cb(daddr, config_idx, (const tusb_desc_configuration_t*) _usbh_epbuf.ctrl)) {
-        TU_ASSERT(tuh_configuration_set(daddr, config_idx+1u, process_enumeration, ENUM_CONFIG_DRIVER),);
+      if (tuh_enum_descriptor_configuration_cb(daddr, config_idx, (const tusb_desc_configuration_t*) enum_buf)) {
+      #if CFG_TUH_ENUM_CACHE
+        enum_cache_store(idx, dev, config_idx, enum_buf);
+      #endif
+        TU_ASSERT(tuh_configuration_set(daddr, config_idx+1u, process_enumeration, enum_arg(idx, ENUM_CONFIG_DRIVER)),);
       } else {
         config_idx++;
         TU_ASSERT(config_idx < dev->desc_device.bNumConfigurations,);
         TU_LOG_USBH("Get Configuration[%u] Descriptor (9 bytes)\r\n", config_idx);
-        TU_ASSERT(tuh_descriptor_get_configuration(daddr, config_idx, _usbh_epbuf.ctrl, 9,
-                                                   process_enumeration, ENUM_GET_FULL_CONFIG_DESC),);
+        TU_ASSERT(tuh_descriptor_get_configuration(daddr, config_idx, enum_buf, 9,
+                                                   process_enumeration, enum_arg(idx, ENUM_GET_FULL_CONFIG_DESC)),);
       }
       break;
     }
 
     case ENUM_CONFIG_DRIVER: {
+      // class drivers share usbh_get_enum_buf() while configuring: one device at a time
+      if (!enum_window_acquire(&_usbh_data.config_owner, idx, ENUM_AFTER_CONFIG_WAIT)) {
+        TU_LOG_USBH("[%u] Wait for other device to complete configuration\r\n", daddr);
+        break;
+      }
+
       TU_LOG_USBH("Device configured\r\n");
       dev->configured = 1;
 
-  #if CFG_TUH_HUB
-      // get next hub status now since device can be unplugged before set_configure() is complete
-      if (_usbh_data.dev0_bus.hub_addr != 0) {
-        hub_edpt_status_xfer(_usbh_data.dev0_bus.hub_addr);
-      }
-  #endif
-
-      // Parse configuration & set up drivers
+      // Parse configuration & set up drivers, class driver of each interface is tried first for cached device
       // driver_open() must not make any usb transfer
-      TU_ASSERT(enum_parse_configuration_desc(daddr, (tusb_desc_configuration_t*) _usbh_epbuf.ctrl),);
+      const uint8_t* cached_drv = NULL;
+    #if CFG_TUH_ENUM_CACHE
+      cached_drv = enum_cache_drivers(idx);
+    #endif
+      TU_ASSERT(enum_parse_configuration_desc(daddr, (tusb_desc_configuration_t*) enum_buf, cached_drv),);
 
       // Start the Set Configuration process for interfaces (itf = TUSB_INDEX_INVALID_8)
       // Since driver can perform control transfer within its set_config, this is done asynchronously.
@@ -2079,7 +3124,7 @@ static void process_enumeration(tuh_xfer_t *xfer) {
   }
 
   if (is_enum_failed) {
-    enum_full_complete(false);
+    enum_full_complete(idx, false);
   }
 }
 
@@ -2110,7 +3155,32 @@ static uint8_t enum_get_new_address(bool is_hub) {
   return 0; // invalid address
 }
 
-static bool enum_parse_configuration_desc(uint8_t dev_addr, tusb_desc_configuration_t const* desc_cfg) {
+// Bind driver to all interfaces and endpoints within p_desc, endpoint state is allocated from pool
+static bool bind_driver_to_ep_itf(uint8_t dev_addr, uint8_t drv_id, const uint8_t* p_desc, uint16_t desc_len) {
+  usbh_device_t* dev = get_device(dev_addr);
+  const uint8_t* desc_end = p_desc + desc_len;
+  while (tu_desc_in_bounds(p_desc, desc_end)) {
+    const uint8_t desc_type = tu_desc_type(p_desc);
+
+    if (desc_type == TUSB_DESC_ENDPOINT) {
+      usbh_edpt_t* ep = edpt_alloc(dev_addr, ((const tusb_desc_endpoint_t*) p_desc)->bEndpointAddress);
+      TU_ASSERT(ep != NULL);
+      ep->drv_id = drv_id;
+    } else if (desc_type == TUSB_DESC_INTERFACE) {
+      const tusb_desc_interface_t* desc_itf = (const tusb_desc_interface_t*) p_desc;
+      if (desc_itf->bAlternateSetting == 0) {
+        TU_ASSERT(desc_itf->bInterfaceNumber < CFG_TUH_INTERFACE_MAX);
+        dev->itf2drv[desc_itf->bInterfaceNumber] = drv_id;
+      }
+    }
+
+    p_desc = tu_desc_next(p_desc);
+  }
+  return true;
+}
+
+static bool enum_parse_configuration_desc(uint8_t dev_addr, tusb_desc_configuration_t const* desc_cfg,
+                                          const uint8_t* cached_drv) {
   usbh_device_t* dev = get_device(dev_addr);
   uint16_t const total_len = tu_le16toh(desc_cfg->wTotalLength);
   uint8_t const* desc_end = ((uint8_t const*) desc_cfg) + total_len;
@@ -2137,28 +3207,31 @@ static bool enum_parse_configuration_desc(uint8_t dev_addr, tusb_desc_configurat
     // uint16_t const drv_len = tu_desc_get_interface_total_len(desc_itf, assoc_itf_count, (uint16_t)
     // (desc_end-p_desc)); TU_ASSERT(drv_len >= sizeof(tusb_desc_interface_t));
 
-    // Find a driver for this interface
+    // Find a driver for this interface: cached one first if any, then all drivers in order
     const uint16_t remaining_len = (uint16_t)(desc_end - p_desc);
-    uint8_t        drv_id;
-    for (drv_id = 0; drv_id < TOTAL_DRIVER_COUNT; drv_id++) {
+    const uint8_t  cached_id = (cached_drv != NULL && desc_itf->bInterfaceNumber < CFG_TUH_INTERFACE_MAX)
+                               ? cached_drv[desc_itf->bInterfaceNumber] : TUSB_INDEX_INVALID_8;
+    bool           is_opened = false;
+    for (uint8_t i = 0; i <= TOTAL_DRIVER_COUNT && !is_opened; i++) {
+      const uint8_t drv_id = (i == 0) ? cached_id : (uint8_t) (i - 1u);
       const usbh_class_driver_t *driver = get_driver(drv_id);
-      if (driver) {
+      if (driver && !(i > 0 && drv_id == cached_id)) {
         const uint16_t drv_len = driver->open(dev->bus_info.rhport, dev_addr, desc_itf, remaining_len);
         if ((sizeof(tusb_desc_interface_t) <= drv_len) && (drv_len <= remaining_len)) {
           // open successfully
           TU_LOG_USBH("  %s opened\r\n", driver->name);
 
           // bind found driver to all interfaces and endpoint within drv_len
-          tu_bind_driver_to_ep_itf(drv_id, dev->ep2drv, dev->itf2drv, CFG_TUH_INTERFACE_MAX, p_desc, drv_len);
+          bind_driver_to_ep_itf(dev_addr, drv_id, p_desc, drv_len);
 
           p_desc += drv_len; // next Interface
-          break;             // exit driver find loop
+          is_opened = true;
         }
       }
     }
 
     // no driver found
-    if (drv_id == TOTAL_DRIVER_COUNT) {
+    if (!is_opened) {
       p_desc = tu_desc_next(p_desc); // skip this interface
       TU_LOG_USBH("[%u:%u] Interface %u: class = %u subclass = %u protocol = %u is not supported\r\n",
                   dev->bus_info.rhport, dev_addr, desc_itf->bInterfaceNumber, desc_itf->bInterfaceClass,
@@ -2187,7 +3260,11 @@ void usbh_driver_set_config_complete(uint8_t dev_addr, uint8_t itf_num) {
 
   // all interfaces are configured
   if (itf_num == CFG_TUH_INTERFACE_MAX) {
-    enum_full_complete(true);
+    for (uint8_t idx = 0; idx < CFG_TUH_ENUM_MAX; idx++) {
+      if (_usbh_data.enum_dev[idx].active && _usbh_data.enum_dev[idx].daddr == dev_addr) {
+        enum_full_complete(idx, true);
+      }
+    }
 
     if (is_hub_addr(dev_addr)) {
       TU_LOG_USBH("HUB address = %u is mounted\r\n", dev_addr);
@@ -2198,19 +3275,33 @@ void usbh_driver_set_config_complete(uint8_t dev_addr, uint8_t itf_num) {
   }
 }
 
-static void enum_full_complete(bool success) {
+static void enum_full_complete(uint8_t idx, bool success) {
   (void)success;
-  TU_LOG_USBH("Enumeration complete: success = %u\r\n", success);
+  usbh_enum_t* e = &_usbh_data.enum_dev[idx];
+  if (!e->active) {
+    return;
+  }
+  TU_LOG_USBH("[%u:%u] Enumeration complete: success = %u\r\n", e->bus.rhport, e->daddr, success);
 
-  _usbh_data.enumerating_daddr = TUSB_INDEX_INVALID_8; // mark enumeration as complete
-  _usbh_data.call_after.func = NULL;
+#if CFG_TUH_ENUM_CACHE
+  enum_cache_complete(idx, success);
+#endif
 
-  #if CFG_TUH_HUB
-  // Hub status is already requested in case of successful enumeration
-  if (!success && _usbh_data.dev0_bus.hub_addr != 0) {
-    hub_edpt_status_xfer(_usbh_data.dev0_bus.hub_addr);
+  // mark enumeration as complete and cancel its pending delay
+  e->active  = 0;
+  e->waiting = 0;
+  for (uint8_t i = 0; i < CFG_TUH_ENUM_MAX; i++) {
+    usbh_call_after_t* call_after = &_usbh_data.call_after[i];
+    if (call_after->func == enum_delay_async && (uint8_t) (call_after->arg >> 8) == idx) {
+      call_after->func = NULL;
+    }
   }
-  #endif
+
+  // Port is already handed back to hub driver once device is addressed
+  enum_hub_resume(e);
+
+  enum_window_release(&_usbh_data.addr0_owner, idx);
+  enum_window_release(&_usbh_data.config_owner, idx);
 }
 
 #endif
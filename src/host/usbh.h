@@ -50,9 +50,46 @@ struct tuh_xfer_s {
   tuh_xfer_cb_t complete_cb;
   uintptr_t user_data;
 
+#if CFG_TUH_EDPT_XFER_QUEUE
+  struct tuh_xfer_s* next;   // used by usbh to link transfers queued with tuh_edpt_xfer_queue()
+#endif
+
   // uint32_t timeout_ms;    // place holder, not supported yet
 };
 
+#if CFG_TUH_ISO_XFER
+// Start isochronous transfer right after the previous one queued on the endpoint, or as soon as possible if idle
+#define TUH_ISO_START_ASAP  UINT32_MAX
+
+// Isochronous packet descriptor
+typedef struct {
+  uint16_t length;      // OUT: bytes to send, IN: max bytes to receive
+  uint16_t actual_len;  // bytes transferred, updated on completion
+  xfer_result_t result; // packet result, updated on completion
+} tuh_iso_packet_t;
+
+struct tuh_iso_xfer_s;
+typedef struct tuh_iso_xfer_s tuh_iso_xfer_t;
+typedef void (*tuh_iso_xfer_cb_t)(tuh_iso_xfer_t* xfer);
+
+// Isochronous transfer: one packet per service interval of the endpoint. Packets are laid out back to back in buffer
+// i.e packet i starts right after packet i-1's length.
+struct tuh_iso_xfer_s {
+  uint8_t daddr;
+  uint8_t ep_addr;
+  uint16_t num_packets;
+  xfer_result_t result;        // FAILED/ABORTED if transfer could not be scheduled, packet errors are per packet
+
+  uint32_t start_frame;        // frame of first packet (hcd frame number) or TUH_ISO_START_ASAP, updated with actual one
+  uint8_t* buffer;
+  tuh_iso_packet_t* packets;
+  tuh_iso_xfer_cb_t complete_cb;
+  uintptr_t user_data;
+
+  struct tuh_iso_xfer_s* next; // used by usbh to link transfers in flight
+};
+#endif
+
 // Subject to change
 typedef struct {
   uint8_t daddr;
@@ -136,6 +173,8 @@ void tuh_event_hook_cb(uint8_t rhport, uint32_t eventid, bool in_isr);
 bool tuh_configure(uint8_t rhport, uint32_t cfg_id, const void* cfg_param);
 
 // New API to replace tuh_init() to init host stack on specific roothub port
+// Can be called for several roothub ports (host controllers) which are then served concurrently by the same
+// tuh_task(), device addresses (CFG_TUH_DEVICE_MAX, CFG_TUH_HUB) are shared among them.
 // Must be called in the same task/context as tuh_task() if RTOS is used
 bool tuh_rhport_init(uint8_t rhport, const tusb_rhport_init_t* rh_init);
 
@@ -151,7 +190,7 @@ TU_ATTR_ALWAYS_INLINE static inline bool tuh_init(uint8_t rhport) {
   return tuh_rhport_init(rhport, &rh_init);
 }
 
-// Deinit host stack on rhport
+// Deinit host stack on rhport, other active rhports keep running
 // Must be called in the same task/context as tuh_task() if RTOS is used
 bool tuh_deinit(uint8_t rhport);
 
@@ -225,6 +264,23 @@ TU_ATTR_ALWAYS_INLINE static inline bool tuh_ready(uint8_t daddr) {
 // Get bus information of device
 bool tuh_bus_info_get(uint8_t daddr, tuh_bus_info_t* bus_info);
 
+//--------------------------------------------------------------------+
+// Enumeration Cache API, require CFG_TUH_ENUM_CACHE
+// Device descriptor, serial number, configuration descriptor and class driver of each interface of enumerated devices
+// are cached. Once device descriptor and serial string of a re-connected device match an entry, it is configured with
+// cached configuration descriptor right away: language id, manufacturer/product strings and configuration descriptor
+// requests are skipped. Each entry takes CFG_TUH_ENUMERATION_BUFSIZE plus a small header, least recently used one is
+// replaced when arena is full. Device is only cached if its configuration and serial string descriptors fit together
+// in CFG_TUH_ENUMERATION_BUFSIZE.
+//--------------------------------------------------------------------+
+
+// Set up cache with application provided arena (4-byte aligned), previous entries are discarded.
+// Return false if arena is too small for one entry
+bool tuh_enum_cache_init(void* arena, uint32_t arena_size);
+
+// Discard all entries e.g when device firmware is updated
+void tuh_enum_cache_clear(void);
+
 //--------------------------------------------------------------------+
 // Transfer API
 // Each Function will make a USB transfer request to device. If
@@ -249,6 +305,22 @@ bool tuh_control_xfer(tuh_xfer_t* xfer);
 //  - sync : blocking if complete callback is NULL.
 bool tuh_edpt_xfer(tuh_xfer_t* xfer);
 
+#if CFG_TUH_EDPT_XFER_QUEUE
+// Queue a bulk/interrupt transfer (async only), endpoint is kept busy until all queued transfers are complete.
+// xfer itself is linked into the endpoint queue and must stay valid until its complete callback, which is invoked
+// with the same xfer (result and actual_len updated). The next transfer is started when previous one completes: in ISR
+// if HCD allows it (hcd_edpt_xfer_isr_safe()), otherwise by usbh task, or immediately if HCD has its own transfer list.
+// If a transfer fails, remaining ones are completed with XFER_RESULT_ABORTED.
+bool tuh_edpt_xfer_queue(tuh_xfer_t* xfer);
+#endif
+
+#if CFG_TUH_ISO_XFER
+// Submit an isochronous transfer (async only) on an opened ISO endpoint. Multiple transfers can be submitted to keep
+// the stream continuous, they are scheduled back to back and completed in order. xfer must stay valid until its
+// complete callback. Use tuh_edpt_abort_xfer() to stop the stream, pending transfers complete with XFER_RESULT_ABORTED.
+bool tuh_iso_xfer(tuh_iso_xfer_t* xfer);
+#endif
+
 // Open a non-control endpoint
 bool tuh_edpt_open(uint8_t daddr, tusb_desc_endpoint_t const * desc_ep);
 
@@ -0,0 +1,290 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2019 Ha Thach (tinyusb.org)
+ * SPDX-License-Identifier: MIT
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#include "tusb_option.h"
+
+#if CFG_TUH_ENABLED
+
+#include "tusb.h"
+#include "usbh_pvt.h"
+
+//--------------------------------------------------------------------+
+// MACRO CONSTANT TYPEDEF
+//--------------------------------------------------------------------+
+
+// Max number of periodic endpoints reserved at the same time
+#ifndef CFG_TUH_PERIODIC_MAX
+  #define CFG_TUH_PERIODIC_MAX (4*CFG_TUH_DEVICE_MAX + CFG_TUH_HUB)
+#endif
+
+#define PERIODIC_FRAMES   CFG_TUH_PERIODIC_FRAMES
+#define PERIODIC_UFRAMES  (8*CFG_TUH_PERIODIC_FRAMES)
+
+// USB 2.0 5.7.4: at most 90% of frame (full speed) and 80% of micro-frame (high speed) is for periodic transfers
+#define HS_BUDGET_NS      100000u
+#define FS_BUDGET_NS      900000u
+
+// Bus time in nanoseconds (USB 2.0 5.11.3), host delay is implementation specific
+#define BW_HOST_DELAY     1000u
+#define BW_HUB_LS_SETUP   333u
+#define BIT_TIME(_bytes)  (7u * 8u * (_bytes) / 6u) // worst case bit stuffing
+#define HS_NSECS(_bytes)     ((55u * 8u * 2083u + 2083u * (3u + BIT_TIME(_bytes))) / 1000u + 5u)
+#define HS_NSECS_ISO(_bytes) ((38u * 8u * 2083u + 2083u * (3u + BIT_TIME(_bytes))) / 1000u + 5u)
+
+// Root bus tables are indexed by rhport, followed by tables for transaction translator of high speed hubs
+#define TT_MAX            (TUP_USBIP_CONTROLLER_NUM + CFG_TUH_HUB)
+
+typedef struct {
+  uint8_t daddr;
+  uint8_t ep_addr;
+  uint8_t rhport;
+  uint8_t tt_idx;     // full/low speed endpoint: index of TT table, 0xff for high speed endpoint
+  uint16_t interval;  // micro-frames
+  uint16_t offset;    // micro-frames
+  uint16_t hs_ns;     // high speed transaction, or start-split for full/low speed
+  uint16_t cs_ns;     // complete-split
+  uint32_t fs_ns;     // full/low speed transaction
+} periodic_rsv_t;
+
+typedef struct {
+  uint8_t hub_addr;
+  uint8_t count;      // number of reservations, hub table is released when reaching zero
+  uint32_t load[PERIODIC_FRAMES];
+} periodic_tt_t;
+
+static periodic_rsv_t _rsv[CFG_TUH_PERIODIC_MAX];
+static periodic_tt_t _tt[TT_MAX];
+static uint32_t _hs_load[TUP_USBIP_CONTROLLER_NUM][PERIODIC_UFRAMES];
+
+TU_VERIFY_STATIC(PERIODIC_FRAMES >= 1 && PERIODIC_FRAMES <= 32 && (PERIODIC_FRAMES & (PERIODIC_FRAMES - 1)) == 0,
+                 "CFG_TUH_PERIODIC_FRAMES must be power of 2 and up to 32");
+
+//--------------------------------------------------------------------+
+// Helper
+//--------------------------------------------------------------------+
+
+// Full/Low speed bus time including host delay (USB 2.0 5.11.3)
+static uint32_t fs_nsecs(uint8_t speed, bool is_iso, bool is_in, uint32_t bytes) {
+  if (speed == TUSB_SPEED_LOW) {
+    if (is_in) {
+      return 64060u + 2u * BW_HUB_LS_SETUP + BW_HOST_DELAY + (67667u * (31u + 10u * BIT_TIME(bytes))) / 1000u;
+    } else {
+      return 64107u + 2u * BW_HUB_LS_SETUP + BW_HOST_DELAY + (66700u * (31u + 10u * BIT_TIME(bytes))) / 1000u;
+    }
+  }
+
+  uint32_t const overhead = is_iso ? (is_in ? 7268u : 6265u) : 9107u;
+  return overhead + BW_HOST_DELAY + (8354u * (31u + 10u * BIT_TIME(bytes))) / 1000u;
+}
+
+// Polling interval in micro-frames, rounded down to power of 2 and clamped to schedule length
+static uint16_t edpt_interval(uint8_t speed, tusb_desc_endpoint_t const* desc_ep) {
+  uint8_t const binterval = tu_max8(desc_ep->bInterval, 1);
+  uint32_t interval;
+
+  if (speed == TUSB_SPEED_HIGH) {
+    interval = TU_BIT(tu_min8(binterval, 16) - 1);
+  } else if (desc_ep->bmAttributes.xfer == TUSB_XFER_ISOCHRONOUS) {
+    interval = 8u * TU_BIT(tu_min8(binterval, 16) - 1);
+  } else {
+    interval = 8u * TU_BIT(tu_log2(binterval));
+  }
+
+  return (uint16_t) tu_min32(interval, PERIODIC_UFRAMES);
+}
+
+// Find table of transaction translator serving a full/low speed device: nearest upstream high speed hub, otherwise
+// the root bus (also used as embedded TT by some EHCI controllers)
+static uint8_t tt_find(tuh_bus_info_t const* bus_info, bool allocate) {
+  uint8_t hub_addr = bus_info->hub_addr;
+  while (hub_addr != 0) {
+    tuh_bus_info_t hub_info;
+    tuh_bus_info_get(hub_addr, &hub_info);
+    if (hub_info.speed == TUSB_SPEED_HIGH) {
+      break;
+    }
+    hub_addr = hub_info.hub_addr;
+  }
+
+  if (hub_addr == 0) {
+    return bus_info->rhport;
+  }
+
+  uint8_t free_idx = TUSB_INDEX_INVALID_8;
+  for (uint8_t i = TUP_USBIP_CONTROLLER_NUM; i < TT_MAX; i++) {
+    if (_tt[i].count > 0 && _tt[i].hub_addr == hub_addr) {
+      return i;
+    }
+    if (_tt[i].count == 0 && free_idx == TUSB_INDEX_INVALID_8) {
+      free_idx = i;
+    }
+  }
+
+  if (allocate && free_idx != TUSB_INDEX_INVALID_8) {
+    tu_memclr(&_tt[free_idx], sizeof(periodic_tt_t));
+    _tt[free_idx].hub_addr = hub_addr;
+  }
+  return free_idx;
+}
+
+// Add or remove load of a reservation on all (micro)frames it occupies
+static void rsv_charge(periodic_rsv_t const* rsv, bool add) {
+  uint32_t* hs_load = _hs_load[rsv->rhport];
+
+  for (uint32_t uf = rsv->offset; uf < PERIODIC_UFRAMES; uf += rsv->interval) {
+    if (rsv->tt_idx == TUSB_INDEX_INVALID_8) {
+      hs_load[uf] = add ? (hs_load[uf] + rsv->hs_ns) : (hs_load[uf] - rsv->hs_ns);
+    } else {
+      // start-split at Y, complete-split at Y+2, Y+3, Y+4
+      uint32_t* fs_load = &_tt[rsv->tt_idx].load[uf / 8];
+      *fs_load = add ? (*fs_load + rsv->fs_ns) : (*fs_load - rsv->fs_ns);
+      hs_load[uf] = add ? (hs_load[uf] + rsv->hs_ns) : (hs_load[uf] - rsv->hs_ns);
+      for (uint32_t cs = uf + 2; cs <= uf + 4; cs++) {
+        hs_load[cs] = add ? (hs_load[cs] + rsv->cs_ns) : (hs_load[cs] - rsv->cs_ns);
+      }
+    }
+  }
+}
+
+// Worst load over all (micro)frames a candidate offset would occupy
+static void rsv_peak(periodic_rsv_t const* rsv, uint32_t* hs_peak, uint32_t* fs_peak) {
+  uint32_t const* hs_load = _hs_load[rsv->rhport];
+  *hs_peak = 0;
+  *fs_peak = 0;
+
+  for (uint32_t uf = rsv->offset; uf < PERIODIC_UFRAMES; uf += rsv->interval) {
+    if (rsv->tt_idx == TUSB_INDEX_INVALID_8) {
+      *hs_peak = tu_max32(*hs_peak, hs_load[uf] + rsv->hs_ns);
+    } else {
+      *fs_peak = tu_max32(*fs_peak, _tt[rsv->tt_idx].load[uf / 8] + rsv->fs_ns);
+      *hs_peak = tu_max32(*hs_peak, hs_load[uf] + rsv->hs_ns);
+      for (uint32_t cs = uf + 2; cs <= uf + 4; cs++) {
+        *hs_peak = tu_max32(*hs_peak, hs_load[cs] + rsv->cs_ns);
+      }
+    }
+  }
+}
+
+//--------------------------------------------------------------------+
+// Periodic Bandwidth API
+//--------------------------------------------------------------------+
+bool usbh_periodic_alloc(uint8_t daddr, tusb_desc_endpoint_t const* desc_ep, usbh_periodic_slot_t* slot) {
+  uint8_t const xfer_type = desc_ep->bmAttributes.xfer;
+  TU_ASSERT(xfer_type == TUSB_XFER_INTERRUPT || xfer_type == TUSB_XFER_ISOCHRONOUS);
+
+  tuh_bus_info_t bus_info;
+  tuh_bus_info_get(daddr, &bus_info);
+  TU_ASSERT(bus_info.rhport < TUP_USBIP_CONTROLLER_NUM);
+
+  periodic_rsv_t* rsv = NULL;
+  for (uint8_t i = 0; i < CFG_TUH_PERIODIC_MAX; i++) {
+    if (_rsv[i].interval == 0) {
+      rsv = &_rsv[i];
+      break;
+    }
+  }
+  TU_ASSERT(rsv);
+
+  bool const is_iso = (xfer_type == TUSB_XFER_ISOCHRONOUS);
+  bool const is_in = (tu_edpt_dir(desc_ep->bEndpointAddress) == TUSB_DIR_IN);
+  uint16_t const mps = tu_edpt_packet_size(desc_ep);
+
+  tu_memclr(rsv, sizeof(periodic_rsv_t));
+  rsv->daddr = daddr;
+  rsv->ep_addr = desc_ep->bEndpointAddress;
+  rsv->rhport = bus_info.rhport;
+  rsv->interval = edpt_interval(bus_info.speed, desc_ep);
+
+  uint32_t best_hs = UINT32_MAX;
+  uint32_t best_fs = UINT32_MAX;
+  uint16_t best_offset = 0;
+
+  if (bus_info.speed == TUSB_SPEED_HIGH) {
+    // high bandwidth endpoint has up to 3 transactions per micro-frame
+    uint32_t const bytes = mps * (1u + ((tu_le16toh(desc_ep->wMaxPacketSize) >> 11) & 0x03u));
+    rsv->tt_idx = TUSB_INDEX_INVALID_8;
+    rsv->hs_ns = (uint16_t) (is_iso ? HS_NSECS_ISO(bytes) : HS_NSECS(bytes));
+
+    for (uint16_t offset = 0; offset < rsv->interval; offset++) {
+      uint32_t hs_peak, fs_peak;
+      rsv->offset = offset;
+      rsv_peak(rsv, &hs_peak, &fs_peak);
+      if (hs_peak <= HS_BUDGET_NS && hs_peak < best_hs) {
+        best_hs = hs_peak;
+        best_offset = offset;
+      }
+    }
+  } else {
+    uint8_t const tt_idx = tt_find(&bus_info, false);
+    TU_ASSERT(tt_idx != TUSB_INDEX_INVALID_8);
+    rsv->tt_idx = tt_idx;
+    rsv->fs_ns = fs_nsecs(bus_info.speed, is_iso, is_in, mps);
+    // split transactions on high speed bus: data is carried by start-split for OUT, complete-split for IN
+    rsv->hs_ns = (uint16_t) HS_NSECS(is_in ? 0u : mps);
+    rsv->cs_ns = (uint16_t) HS_NSECS(is_in ? mps : 0u);
+
+    // frame phase, then start-split micro-frame Y (0-3) so that complete-splits Y+2..Y+4 stay within the frame
+    for (uint16_t phase = 0; phase < rsv->interval; phase += 8) {
+      for (uint16_t y = 0; y < 4; y++) {
+        uint32_t hs_peak, fs_peak;
+        rsv->offset = phase + y;
+        rsv_peak(rsv, &hs_peak, &fs_peak);
+        if (fs_peak <= FS_BUDGET_NS && hs_peak <= HS_BUDGET_NS &&
+            (fs_peak < best_fs || (fs_peak == best_fs && hs_peak < best_hs))) {
+          best_fs = fs_peak;
+          best_hs = hs_peak;
+          best_offset = rsv->offset;
+        }
+      }
+    }
+  }
+
+  if (best_hs == UINT32_MAX) {
+    TU_LOG_USBH("Periodic bandwidth exceeded for %u:%02X\r\n", daddr, desc_ep->bEndpointAddress);
+    rsv->interval = 0;
+    return false;
+  }
+
+  if (rsv->tt_idx != TUSB_INDEX_INVALID_8) {
+    (void) tt_find(&bus_info, true); // claim hub table
+    _tt[rsv->tt_idx].count++;
+  }
+  rsv->offset = best_offset;
+  rsv_charge(rsv, true);
+
+  slot->interval = rsv->interval;
+  slot->offset = rsv->offset;
+  if (rsv->tt_idx == TUSB_INDEX_INVALID_8) {
+    slot->smask = 0;
+    for (uint16_t uf = rsv->offset % 8; uf < 8; uf += rsv->interval) {
+      slot->smask |= (uint8_t) TU_BIT(uf);
+    }
+    slot->cmask = 0;
+  } else {
+    slot->smask = (uint8_t) TU_BIT(rsv->offset % 8);
+    slot->cmask = (uint8_t) (0x1Cu << (rsv->offset % 8));
+  }
+
+  TU_LOG_USBH("Periodic %u:%02X interval = %u offset = %u\r\n", daddr, desc_ep->bEndpointAddress, slot->interval,
+              slot->offset);
+  return true;
+}
+
+void usbh_periodic_free(uint8_t daddr, uint8_t ep_addr) {
+  for (uint8_t i = 0; i < CFG_TUH_PERIODIC_MAX; i++) {
+    periodic_rsv_t* rsv = &_rsv[i];
+    if (rsv->interval != 0 && rsv->daddr == daddr && (ep_addr == 0xff || rsv->ep_addr == ep_addr)) {
+      rsv_charge(rsv, false);
+      if (rsv->tt_idx != TUSB_INDEX_INVALID_8) {
+        _tt[rsv->tt_idx].count--;
+      }
+      rsv->interval = 0;
+    }
+  }
+}
+
+#endif
@@ -81,6 +81,28 @@ bool usbh_edpt_release(uint8_t dev_addr, uint8_t ep_addr);
 // Check if endpoint transferring is complete
 bool usbh_edpt_busy(uint8_t dev_addr, uint8_t ep_addr);
 
+// Clear halt and reset data toggle of endpoint on host side, after device accepted CLEAR_FEATURE(ENDPOINT_HALT)
+bool usbh_edpt_clear_stall(uint8_t dev_addr, uint8_t ep_addr);
+
+//--------------------------------------------------------------------+
+// Periodic Bandwidth API
+// Used by HCD to place interrupt/isochronous endpoints on the periodic schedule with bus time accounting per root
+// bus and per transaction translator (TT). Offset is picked to balance load over the schedule.
+//--------------------------------------------------------------------+
+
+typedef struct {
+  uint16_t interval; // micro-frames, power of 2 and up to 8*CFG_TUH_PERIODIC_FRAMES
+  uint16_t offset;   // micro-frame offset within interval: frame = offset/8, micro-frame = offset%8
+  uint8_t  smask;    // high speed: micro-frames of transaction within a frame. Full/Low speed: start-split micro-frame
+  uint8_t  cmask;    // full/low speed complete-split micro-frames, 0 for high speed
+} usbh_periodic_slot_t;
+
+// Reserve bus time for a periodic endpoint. Return false if bus or TT is out of periodic bandwidth
+bool usbh_periodic_alloc(uint8_t daddr, tusb_desc_endpoint_t const* desc_ep, usbh_periodic_slot_t* slot);
+
+// Release reservation of an endpoint, or all endpoints of device if ep_addr is 0xff
+void usbh_periodic_free(uint8_t daddr, uint8_t ep_addr);
+
 #ifdef __cplusplus
  }
 #endif
@@ -0,0 +1,272 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2019 Ha Thach (tinyusb.org)
+ * SPDX-License-Identifier: MIT
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#ifndef TUSB_OSAL_POSIX_H_
+#define TUSB_OSAL_POSIX_H_
+
+// POSIX threads e.g Linux: tud_task()/tuh_task() can run in their own threads and block on the event queue.
+// Requires pthread_condattr_setclock() and pthread_mutex_timedlock(), build with _POSIX_C_SOURCE >= 200112L (or
+// _DEFAULT_SOURCE/_GNU_SOURCE) and link with -pthread. There is no interrupt context, the port driver's event
+// source (e.g dcd_int_handler) should also run in a thread, in_isr is therefore ignored.
+
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//--------------------------------------------------------------------+
+// TASK API
+//--------------------------------------------------------------------+
+// pthread_t is an integer or pointer depending on libc, stack compares handle with NULL and ==
+typedef void* osal_task_handle_t;
+
+TU_ATTR_ALWAYS_INLINE static inline osal_task_handle_t osal_task_get_current_handle(void) {
+  return (osal_task_handle_t) (uintptr_t) pthread_self();
+}
+
+TU_ATTR_ALWAYS_INLINE static inline void osal_task_delay(uint32_t msec) {
+  struct timespec ts = {.tv_sec = (time_t) (msec / 1000), .tv_nsec = (long) (msec % 1000) * 1000000L};
+  while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {}
+}
+
+TU_ATTR_ALWAYS_INLINE static inline uint32_t osal_time_millis(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t) ((uint64_t) ts.tv_sec * 1000u + (uint64_t) ts.tv_nsec / 1000000u);
+}
+
+// Absolute deadline msec from now on clock
+TU_ATTR_ALWAYS_INLINE static inline struct timespec _osal_deadline(clockid_t clock, uint32_t msec) {
+  struct timespec ts;
+  clock_gettime(clock, &ts);
+  ts.tv_sec += (time_t) (msec / 1000);
+  ts.tv_nsec += (long) (msec % 1000) * 1000000L;
+  if (ts.tv_nsec >= 1000000000L) {
+    ts.tv_sec++;
+    ts.tv_nsec -= 1000000000L;
+  }
+  return ts;
+}
+
+// Mutex and condition variable pair of semaphore and queue, cond waits on CLOCK_MONOTONIC
+TU_ATTR_ALWAYS_INLINE static inline void _osal_cond_init(pthread_mutex_t* mutex, pthread_cond_t* cond) {
+  pthread_condattr_t attr;
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(cond, &attr);
+  pthread_condattr_destroy(&attr);
+  pthread_mutex_init(mutex, NULL);
+}
+
+TU_ATTR_ALWAYS_INLINE static inline void _osal_cond_deinit(pthread_mutex_t* mutex, pthread_cond_t* cond) {
+  pthread_cond_destroy(cond);
+  pthread_mutex_destroy(mutex);
+}
+
+// Wait with mutex locked until ready(ctx) is true. Return false on timeout
+TU_ATTR_ALWAYS_INLINE static inline bool _osal_cond_wait(pthread_mutex_t* mutex, pthread_cond_t* cond,
+                                                         bool (*ready)(void* ctx), void* ctx, uint32_t msec) {
+  if (msec == OSAL_TIMEOUT_WAIT_FOREVER) {
+    while (!ready(ctx)) {
+      pthread_cond_wait(cond, mutex);
+    }
+  } else if (msec > 0) {
+    struct timespec const deadline = _osal_deadline(CLOCK_MONOTONIC, msec);
+    while (!ready(ctx)) {
+      if (pthread_cond_timedwait(cond, mutex, &deadline) == ETIMEDOUT) {
+        break;
+      }
+    }
+  }
+  return ready(ctx);
+}
+
+//--------------------------------------------------------------------+
+// Spinlock API
+//--------------------------------------------------------------------+
+// Recursive mutex, since lock can be nested within the same context as bare-metal spinlock of osal_none
+typedef pthread_mutex_t osal_spinlock_t;
+
+#define OSAL_SPINLOCK_DEF(_name, _int_set) \
+  osal_spinlock_t _name
+
+TU_ATTR_ALWAYS_INLINE static inline void osal_spin_init(osal_spinlock_t *ctx) {
+  pthread_mutexattr_t attr;
+  pthread_mutexattr_init(&attr);
+  pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+  pthread_mutex_init(ctx, &attr);
+  pthread_mutexattr_destroy(&attr);
+}
+
+TU_ATTR_ALWAYS_INLINE static inline void osal_spin_deinit(osal_spinlock_t *ctx) {
+  pthread_mutex_destroy(ctx);
+}
+
+TU_ATTR_ALWAYS_INLINE static inline void osal_spin_lock(osal_spinlock_t *ctx, bool in_isr) {
+  (void) in_isr;
+  pthread_mutex_lock(ctx);
+}
+
+TU_ATTR_ALWAYS_INLINE static inline void osal_spin_unlock(osal_spinlock_t *ctx, bool in_isr) {
+  (void) in_isr;
+  pthread_mutex_unlock(ctx);
+}
+
+//--------------------------------------------------------------------+
+// Binary Semaphore API
+//--------------------------------------------------------------------+
+typedef struct {
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  bool available;
+} osal_semaphore_def_t;
+
+typedef osal_semaphore_def_t* osal_semaphore_t;
+
+TU_ATTR_ALWAYS_INLINE static inline osal_semaphore_t osal_semaphore_create(osal_semaphore_def_t* semdef) {
+  _osal_cond_init(&semdef->mutex, &semdef->cond);
+  semdef->available = false;
+  return semdef;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline bool osal_semaphore_delete(osal_semaphore_t semd_hdl) {
+  _osal_cond_deinit(&semd_hdl->mutex, &semd_hdl->cond);
+  return true;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline bool osal_semaphore_post(osal_semaphore_t sem_hdl, bool in_isr) {
+  (void) in_isr;
+  pthread_mutex_lock(&sem_hdl->mutex);
+  sem_hdl->available = true;
+  pthread_cond_signal(&sem_hdl->cond);
+  pthread_mutex_unlock(&sem_hdl->mutex);
+  return true;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline bool _osal_semaphore_ready(void* ctx) {
+  return ((osal_semaphore_t) ctx)->available;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline bool osal_semaphore_wait(osal_semaphore_t sem_hdl, uint32_t msec) {
+  pthread_mutex_lock(&sem_hdl->mutex);
+  bool const success = _osal_cond_wait(&sem_hdl->mutex, &sem_hdl->cond, _osal_semaphore_ready, sem_hdl, msec);
+  if (success) {
+    sem_hdl->available = false;
+  }
+  pthread_mutex_unlock(&sem_hdl->mutex);
+  return success;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline void osal_semaphore_reset(osal_semaphore_t sem_hdl) {
+  pthread_mutex_lock(&sem_hdl->mutex);
+  sem_hdl->available = false;
+  pthread_mutex_unlock(&sem_hdl->mutex);
+}
+
+//--------------------------------------------------------------------+
+// MUTEX API
+// Within tinyusb, mutex is never used in ISR context
+//--------------------------------------------------------------------+
+typedef pthread_mutex_t osal_mutex_def_t;
+typedef pthread_mutex_t* osal_mutex_t;
+
+TU_ATTR_ALWAYS_INLINE static inline osal_mutex_t osal_mutex_create(osal_mutex_def_t* mdef) {
+  pthread_mutex_init(mdef, NULL);
+  return mdef;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline bool osal_mutex_delete(osal_mutex_t mutex_hdl) {
+  return pthread_mutex_destroy(mutex_hdl) == 0;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline bool osal_mutex_lock(osal_mutex_t mutex_hdl, uint32_t msec) {
+  if (msec == OSAL_TIMEOUT_WAIT_FOREVER) {
+    return pthread_mutex_lock(mutex_hdl) == 0;
+  } else if (msec == 0) {
+    return pthread_mutex_trylock(mutex_hdl) == 0;
+  } else {
+    // pthread_mutex_timedlock() only takes CLOCK_REALTIME deadline
+    struct timespec const deadline = _osal_deadline(CLOCK_REALTIME, msec);
+    return pthread_mutex_timedlock(mutex_hdl, &deadline) == 0;
+  }
+}
+
+TU_ATTR_ALWAYS_INLINE static inline bool osal_mutex_unlock(osal_mutex_t mutex_hdl) {
+  return pthread_mutex_unlock(mutex_hdl) == 0;
+}
+
+//--------------------------------------------------------------------+
+// QUEUE API
+//--------------------------------------------------------------------+
+#include "common/tusb_fifo.h"
+
+typedef struct {
+  uint16_t item_size;
+  tu_fifo_t ff;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond; // signaled when an item is sent
+} osal_queue_def_t;
+
+typedef osal_queue_def_t* osal_queue_t;
+
+// _int_set is not used with an OS
+#define OSAL_QUEUE_DEF(_int_set, _name, _depth, _type)  \
+  uint8_t          _name##_buf[_depth * sizeof(_type)]; \
+  osal_queue_def_t _name = {.item_size = sizeof(_type), .ff = TU_FIFO_INIT(_name##_buf, _depth * sizeof(_type), false)}
+
+TU_ATTR_ALWAYS_INLINE static inline osal_queue_t osal_queue_create(osal_queue_def_t* qdef) {
+  _osal_cond_init(&qdef->mutex, &qdef->cond);
+  tu_fifo_clear(&qdef->ff);
+  return qdef;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline bool osal_queue_delete(osal_queue_t qhdl) {
+  _osal_cond_deinit(&qhdl->mutex, &qhdl->cond);
+  return true;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline bool _osal_queue_ready(void* ctx) {
+  return !tu_fifo_empty(&((osal_queue_t) ctx)->ff);
+}
+
+TU_ATTR_ALWAYS_INLINE static inline bool osal_queue_receive(osal_queue_t qhdl, void* data, uint32_t msec) {
+  pthread_mutex_lock(&qhdl->mutex);
+  bool success = _osal_cond_wait(&qhdl->mutex, &qhdl->cond, _osal_queue_ready, qhdl, msec);
+  if (success) {
+    success = (tu_fifo_read_n(&qhdl->ff, data, qhdl->item_size) > 0);
+  }
+  pthread_mutex_unlock(&qhdl->mutex);
+  return success;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline bool osal_queue_send(osal_queue_t qhdl, void const* data, bool in_isr) {
+  (void) in_isr;
+  pthread_mutex_lock(&qhdl->mutex);
+  bool const success = (tu_fifo_write_n(&qhdl->ff, data, qhdl->item_size) > 0);
+  if (success) {
+    pthread_cond_signal(&qhdl->cond);
+  }
+  pthread_mutex_unlock(&qhdl->mutex);
+  TU_ASSERT(success);
+  return success;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline bool osal_queue_empty(osal_queue_t qhdl) {
+  pthread_mutex_lock(&qhdl->mutex);
+  bool const empty = tu_fifo_empty(&qhdl->ff);
+  pthread_mutex_unlock(&qhdl->mutex);
+  return empty;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -52,15 +52,33 @@
 
 // Total queue head pool. TODO should be user configurable and more optimize memory usage in the future
 #define QHD_MAX      (CFG_TUH_DEVICE_MAX*CFG_TUH_ENDPOINT_MAX + CFG_TUH_HUB)
-#define QTD_MAX      QHD_MAX
+
+// Total qTD pool. Each opened non-control endpoint keeps one as list tail, a transfer takes one qTD per 5 pages (20KB)
+#ifndef CFG_TUH_EHCI_QTD_MAX
+  #define CFG_TUH_EHCI_QTD_MAX (2*QHD_MAX)
+#endif
+#define QTD_MAX      CFG_TUH_EHCI_QTD_MAX
+
+// Number of transfers that can be queued on a non-control endpoint, subject to free qTDs in pool
+#ifndef CFG_TUH_EHCI_XFER_DEPTH
+  #define CFG_TUH_EHCI_XFER_DEPTH 4
+#endif
+
+// Software data of qTD, kept separately since all qTD words are used by HC
+typedef struct {
+  uint32_t buffer;         // start of buffer for dcache invalidate, since qTD's buffer offset is modified by HC
+  uint16_t expected_bytes;
+  uint8_t used;
+  uint8_t is_last;         // last qTD of a transfer
+} qtd_extra_t;
 
 typedef struct {
   ehci_link_t period_framelist[FRAMELIST_SIZE];
 
-  // TODO only implement 1 ms & 2 ms & 4 ms, 8 ms (framelist)
-  // [0] : 1ms, [1] : 2ms, [2] : 4ms, [3] : 8 ms
+  // Polling interval tree with one head per interval (1, 2, 4 ... CFG_TUH_PERIODIC_FRAMES ms) and frame phase:
+  // [0] : 1ms, [1-2] : 2ms, [3-6] : 4ms, [7-14] : 8ms etc. Head of interval N and phase P is at (N-1) + P
   // TODO better implementation without dummy head to save SRAM
-  ehci_qhd_t period_head_arr[4];
+  ehci_qhd_t period_head_arr[2*CFG_TUH_PERIODIC_FRAMES - 1];
 
   // Note control qhd of dev0 is used as head of async list
   struct {
@@ -71,12 +89,17 @@ typedef struct {
   ehci_qhd_t qhd_pool[QHD_MAX];
   ehci_qtd_t qtd_pool[QTD_MAX] TU_ATTR_ALIGNED(32);
 
+  qtd_extra_t qtd_extra_control[CFG_TUH_DEVICE_MAX+CFG_TUH_HUB+1];
+  qtd_extra_t qtd_extra[QTD_MAX];
+
   ehci_registers_t* regs;         // operational register
   ehci_cap_registers_t* cap_regs; // capability register
 
   volatile uint32_t uframe_number;
 }ehci_data_t;
 
+TU_VERIFY_STATIC(CFG_TUH_PERIODIC_FRAMES <= FRAMELIST_SIZE, "Periodic schedule is longer than frame list");
+
 // Periodic frame list must be 4K alignment
 CFG_TUH_MEM_SECTION TU_ATTR_ALIGNED(4096) static ehci_data_t ehci_data;
 
@@ -127,7 +150,8 @@ TU_ATTR_ALWAYS_INLINE static inline ehci_qhd_t* qhd_control(uint8_t dev_addr);
 TU_ATTR_ALWAYS_INLINE static inline ehci_qhd_t* qhd_next (ehci_qhd_t const * p_qhd);
 TU_ATTR_ALWAYS_INLINE static inline ehci_qhd_t* qhd_find_free (void);
 static ehci_qhd_t* qhd_get_from_addr (uint8_t dev_addr, uint8_t ep_addr);
-static void qhd_init(ehci_qhd_t *p_qhd, uint8_t dev_addr, tusb_desc_endpoint_t const * ep_desc);
+static void qhd_init(ehci_qhd_t *p_qhd, uint8_t dev_addr, tusb_desc_endpoint_t const * ep_desc,
+                     usbh_periodic_slot_t const* slot);
 static void qhd_attach_qtd(ehci_qhd_t *qhd, ehci_qtd_t *qtd);
 static void qhd_remove_qtd(ehci_qhd_t *qhd);
 TU_ATTR_ALWAYS_INLINE static inline bool qhd_is_periodic(ehci_qhd_t const *qhd) {
@@ -138,10 +162,25 @@ TU_ATTR_ALWAYS_INLINE static inline uint8_t qhd_ep_addr(ehci_qhd_t const *qhd) {
 }
 
 TU_ATTR_ALWAYS_INLINE static inline ehci_qtd_t* qtd_control(uint8_t dev_addr);
-TU_ATTR_ALWAYS_INLINE static inline ehci_qtd_t* qtd_find_free (void);
-static void qtd_init (ehci_qtd_t* qtd, void const* buffer, uint16_t total_bytes);
-
-TU_ATTR_ALWAYS_INLINE static inline ehci_link_t* list_get_period_head(uint8_t rhport, uint32_t interval_ms);
+static ehci_qtd_t* qtd_reserve(uint32_t count);
+TU_ATTR_ALWAYS_INLINE static inline ehci_qtd_t* qtd_reserve_next(ehci_qtd_t** list);
+TU_ATTR_ALWAYS_INLINE static inline qtd_extra_t* qtd_get_extra(ehci_qtd_t const* qtd);
+static void qtd_init (ehci_qtd_t* qtd, void const* buffer, uint16_t total_bytes, bool active);
+static void qtd_init_tail(ehci_qtd_t* qtd);
+static uint32_t qtd_free_count(void);
+static ehci_qtd_t* qtd_free_xfer(ehci_qtd_t* qtd);
+static void qhd_free_qtd_list(ehci_qhd_t* qhd);
+
+TU_ATTR_ALWAYS_INLINE static inline ehci_link_t* list_get_period_head(uint8_t rhport, uint8_t idx);
+
+// Index of period head for interval (power of 2 ms) and frame phase
+TU_ATTR_ALWAYS_INLINE static inline uint8_t period_head_idx(uint32_t interval_ms, uint32_t frame) {
+  return (uint8_t) ((interval_ms - 1) + (frame % interval_ms));
+}
+TU_ATTR_ALWAYS_INLINE static inline bool is_period_head(uintptr_t addr) {
+  return addr >= (uintptr_t) ehci_data.period_head_arr &&
+         addr < (uintptr_t) (ehci_data.period_head_arr + TU_ARRAY_SIZE(ehci_data.period_head_arr));
+}
 TU_ATTR_ALWAYS_INLINE static inline ehci_qhd_t* list_get_async_head(uint8_t rhport);
 TU_ATTR_ALWAYS_INLINE static inline ehci_link_t* list_next (ehci_link_t const *p_link);
 TU_ATTR_ALWAYS_INLINE static inline void list_insert (ehci_link_t *current, ehci_link_t *entry, uint8_t type);
@@ -283,6 +322,7 @@ void hcd_device_close(uint8_t rhport, uint8_t daddr) {
   for (uint8_t i = 0; i < TU_ARRAY_SIZE(ehci_data.period_head_arr); i++) {
     list_remove_qhd_by_addr((ehci_link_t *) &ehci_data.period_head_arr[i], daddr, TUSB_INDEX_INVALID_8);
   }
+  usbh_periodic_free(daddr, 0xff);
 
   // Async doorbell (EHCI 4.8.2 for operational details)
   ehci_data.regs->command_bm.async_adv_doorbell = 1;
@@ -291,40 +331,27 @@ void hcd_device_close(uint8_t rhport, uint8_t daddr) {
 static void init_periodic_list(uint8_t rhport) {
   (void) rhport;
 
-  // Build the polling interval tree with 1 ms, 2 ms, 4 ms and 8 ms (framesize) only
+  // Build the polling interval tree: each head links to the head of half interval with the same phase, ending at 1ms
   for ( uint32_t i = 0; i < TU_ARRAY_SIZE(ehci_data.period_head_arr); i++ ) {
     ehci_data.period_head_arr[i].int_smask          = 1; // queue head in period list must have smask non-zero
     ehci_data.period_head_arr[i].qtd_overlay.halted = 1; // dummy node, always inactive
   }
 
-  // TODO EHCI_FRAMELIST_SIZE with other size than 8
-  // all links --> period_head_arr[0] (1ms)
-  // 0, 2, 4, 6 etc --> period_head_arr[1] (2ms)
-  // 1, 5 --> period_head_arr[2] (4ms)
-  // 3 --> period_head_arr[3] (8ms)
-
-  ehci_link_t * const framelist  = ehci_data.period_framelist;
-  ehci_link_t * const head_1ms = (ehci_link_t *) &ehci_data.period_head_arr[0];
-  ehci_link_t * const head_2ms = (ehci_link_t *) &ehci_data.period_head_arr[1];
-  ehci_link_t * const head_4ms = (ehci_link_t *) &ehci_data.period_head_arr[2];
-  ehci_link_t * const head_8ms = (ehci_link_t *) &ehci_data.period_head_arr[3];
+  for (uint32_t interval = 2; interval <= CFG_TUH_PERIODIC_FRAMES; interval *= 2) {
+    for (uint32_t phase = 0; phase < interval; phase++) {
+      ehci_link_t* head = list_get_period_head(rhport, period_head_idx(interval, phase));
+      head->address = (uint32_t) list_get_period_head(rhport, period_head_idx(interval / 2, phase));
+      head->type = EHCI_QTYPE_QHD;
+    }
+  }
+  list_get_period_head(rhport, 0)->terminate = 1;
 
+  // frame i --> head of longest interval with phase i
+  ehci_link_t * const framelist = ehci_data.period_framelist;
   for (uint32_t i = 0; i < FRAMELIST_SIZE; i++) {
-    framelist[i].address = (uint32_t) head_1ms;
+    framelist[i].address = (uint32_t) list_get_period_head(rhport, period_head_idx(CFG_TUH_PERIODIC_FRAMES, i));
     framelist[i].type = EHCI_QTYPE_QHD;
   }
-
-  for (uint32_t i = 0; i < FRAMELIST_SIZE; i += 2) {
-    list_insert(framelist + i, head_2ms, EHCI_QTYPE_QHD);
-  }
-
-  for (uint32_t i = 1; i < FRAMELIST_SIZE; i += 4) {
-    list_insert(framelist + i, head_4ms, EHCI_QTYPE_QHD);
-  }
-
-  list_insert(framelist + 3, head_8ms, EHCI_QTYPE_QHD);
-
-  head_1ms->terminate = 1;
 }
 
 bool ehci_init(uint8_t rhport, uint32_t capability_reg, uint32_t operatial_reg)
@@ -428,7 +455,32 @@ bool hcd_edpt_open(uint8_t rhport, uint8_t dev_addr, tusb_desc_endpoint_t const
     p_qhd = qhd_find_free();
   }
   TU_ASSERT(p_qhd);
-  qhd_init(p_qhd, dev_addr, ep_desc);
+
+  // list starts with an inactive tail qTD, which becomes the first qTD of next transfer. Reserved before anything
+  // else so that there is nothing to roll back if pool is exhausted
+  ehci_qtd_t* tail = NULL;
+  if (tu_edpt_number(ep_desc->bEndpointAddress) != 0) {
+    tail = qtd_reserve(1);
+    TU_ASSERT(tail);
+  }
+
+  // interrupt endpoint's interval phase and micro-frame masks are picked by periodic bandwidth allocator
+  usbh_periodic_slot_t slot = {0};
+  if (ep_desc->bmAttributes.xfer == TUSB_XFER_INTERRUPT && dev_addr != 0) {
+    bool const allocated = usbh_periodic_alloc(dev_addr, ep_desc, &slot);
+    if (!allocated && tail != NULL) {
+      qtd_get_extra(tail)->used = 0;
+    }
+    TU_ASSERT(allocated);
+  }
+  qhd_init(p_qhd, dev_addr, ep_desc, &slot);
+
+  if (tail != NULL) {
+    qtd_init_tail(tail);
+    p_qhd->tail_qtd = tail;
+    p_qhd->attached_qtd = tail;
+    p_qhd->qtd_overlay.next.address = (uint32_t) tail;
+  }
 
   // control of dev0 always exists as async head
   if (dev_addr == 0) {
@@ -444,7 +496,7 @@ bool hcd_edpt_open(uint8_t rhport, uint8_t dev_addr, tusb_desc_endpoint_t const
       break;
 
     case TUSB_XFER_INTERRUPT:
-      list_head = list_get_period_head(rhport, p_qhd->interval_ms);
+      list_head = list_get_period_head(rhport, p_qhd->period_idx);
       break;
 
     case TUSB_XFER_ISOCHRONOUS:
@@ -471,7 +523,8 @@ bool hcd_edpt_close(uint8_t rhport, uint8_t daddr, uint8_t ep_addr) {
   ehci_link_t * list_head;
   if (qhd_is_periodic(qhd)) {
     // interrupt endpoint
-    list_head = list_get_period_head(rhport, qhd->interval_ms);;
+    list_head = list_get_period_head(rhport, qhd->period_idx);
+    usbh_periodic_free(daddr, ep_addr);
   } else {
     list_head = (ehci_link_t *) list_get_async_head(rhport);
   }
@@ -486,7 +539,7 @@ bool hcd_setup_send(uint8_t rhport, uint8_t dev_addr, uint8_t const setup_packet
   ehci_qhd_t* qhd = &ehci_data.control[dev_addr].qhd;
   ehci_qtd_t* td  = &ehci_data.control[dev_addr].qtd;
 
-  qtd_init(td, setup_packet, 8);
+  qtd_init(td, setup_packet, 8, true);
   td->pid = EHCI_PID_SETUP;
 
   hcd_dcache_clean(setup_packet, 8);
@@ -502,6 +555,79 @@ bool hcd_setup_send(uint8_t rhport, uint8_t dev_addr, uint8_t const setup_packet
   return true;
 }
 
+// Each device has its own control QHD in the async list, controller services all of them in round-robin
+uint8_t hcd_control_xfer_max(uint8_t rhport) {
+  (void) rhport;
+  return CFG_TUH_DEVICE_MAX + CFG_TUH_HUB + 1;
+}
+
+// Non-control transfers are chained in the endpoint's qTD list
+uint8_t hcd_edpt_xfer_depth(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr) {
+  (void) rhport; (void) dev_addr;
+  return tu_edpt_number(ep_addr) ? CFG_TUH_EHCI_XFER_DEPTH : 1;
+}
+
+// Bytes of a qTD starting at buffer: up to 5 pages and non-last qTD must end on a packet boundary
+TU_ATTR_ALWAYS_INLINE static inline uint16_t qtd_xfer_len(uint32_t buffer, uint32_t remaining, uint16_t mps) {
+  uint32_t len = tu_min32(remaining, 5*4096u - tu_offset4k(buffer));
+  if (len < remaining) {
+    len -= len % mps;
+  }
+  return (uint16_t) len;
+}
+
+// Queue a transfer as qTD chain at the end of endpoint's list. The current tail becomes first qTD of the transfer and
+// is activated last, so that HC never works on a partially built chain.
+static bool qhd_queue_xfer(ehci_qhd_t* qhd, uint8_t* buffer, uint16_t buflen) {
+  uint16_t const mps = qhd->max_packet_size;
+
+  // the first qTD reuses the tail, one new qTD is needed for each other one plus a new tail
+  uint32_t qtd_count = 0;
+  uint32_t offset = 0;
+  do {
+    offset += qtd_xfer_len((uint32_t) buffer + offset, buflen - offset, mps);
+    qtd_count++;
+  } while (offset < buflen);
+  ehci_qtd_t* reserved = qtd_reserve(qtd_count);
+  TU_VERIFY(reserved != NULL);
+
+  ehci_qtd_t* const first = qhd->tail_qtd;
+  ehci_qtd_t* const new_tail = qtd_reserve_next(&reserved);
+  qtd_init_tail(new_tail);
+
+  ehci_qtd_t* qtd = first;
+  offset = 0;
+  while (1) {
+    uint16_t const len = qtd_xfer_len((uint32_t) buffer + offset, buflen - offset, mps);
+    bool const is_last = (offset + len >= buflen);
+    ehci_qtd_t* next = is_last ? new_tail : qtd_reserve_next(&reserved);
+
+    // first qTD is the live tail of the list, it must stay inactive until the whole chain is built
+    qtd_init(qtd, buffer + offset, len, qtd != first);
+    qtd->pid                = qhd->pid;
+    qtd->int_on_complete    = is_last ? 1 : 0;
+    qtd->next.address       = (uint32_t) next;
+    qtd->alternate.address  = (uint32_t) new_tail; // short packet skips remaining qTDs of this transfer
+    qtd_get_extra(qtd)->is_last = is_last ? 1 : 0;
+    hcd_dcache_clean(qtd, sizeof(ehci_qtd_t));
+
+    if (is_last) {
+      break;
+    }
+    qtd = next;
+    offset += len;
+  }
+
+  // activate the chain, protect against ISR walking the list
+  usbh_spin_lock(false);
+  qhd->tail_qtd = new_tail;
+  first->active = 1;
+  hcd_dcache_clean(first, sizeof(ehci_qtd_t));
+  usbh_spin_unlock(false);
+
+  return true;
+}
+
 bool hcd_edpt_xfer(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr, uint8_t * buffer, uint16_t buflen) {
   (void) rhport;
 
@@ -510,7 +636,13 @@ bool hcd_edpt_xfer(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr, uint8_t *
 
   ehci_qhd_t* qhd = qhd_get_from_addr(dev_addr, ep_addr);
   TU_VERIFY(qhd != NULL);
-  ehci_qtd_t* qtd;
+
+  // IN transfer: invalidate buffer, OUT transfer: clean buffer
+  if (dir) {
+    hcd_dcache_invalidate(buffer, buflen);
+  }else {
+    hcd_dcache_clean(buffer, buflen);
+  }
 
   if (epnum == 0) {
     // Control endpoint never be stalled. Skip reset Data Toggle since it is fixed per stage
@@ -518,33 +650,21 @@ bool hcd_edpt_xfer(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr, uint8_t *
       qhd->qtd_overlay.halted = false;
     }
 
-    qtd = qtd_control(dev_addr);
-    qtd_init(qtd, buffer, buflen);
+    ehci_qtd_t* qtd = qtd_control(dev_addr);
+    qtd_init(qtd, buffer, buflen, true);
 
     // first data toggle is always 1 (data & setup stage)
     qtd->data_toggle = 1;
     qtd->pid = dir ? EHCI_PID_IN : EHCI_PID_OUT;
+
+    // attach TD to QHD -> start transferring
+    qhd_attach_qtd(qhd, qtd);
   } else {
     // skip if endpoint is halted
     TU_VERIFY(!qhd->qtd_overlay.halted);
-
-    qtd = qtd_find_free();
-    TU_ASSERT(qtd);
-
-    qtd_init(qtd, buffer, buflen);
-    qtd->pid = qhd->pid;
-  }
-
-  // IN transfer: invalidate buffer, OUT transfer: clean buffer
-  if (dir) {
-    hcd_dcache_invalidate(buffer, buflen);
-  }else {
-    hcd_dcache_clean(buffer, buflen);
+    TU_VERIFY(qhd_queue_xfer(qhd, buffer, buflen));
   }
 
-  // attach TD to QHD -> start transferring
-  qhd_attach_qtd(qhd, qtd);
-
   return true;
 }
 
@@ -553,6 +673,31 @@ bool hcd_edpt_abort_xfer(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr) {
 
   // TODO ISO not supported yet
   ehci_qhd_t* qhd = qhd_get_from_addr(dev_addr, ep_addr);
+  TU_VERIFY(qhd != NULL);
+
+  if (tu_edpt_number(ep_addr) != 0) {
+    TU_VERIFY(qhd->attached_qtd != qhd->tail_qtd); // no queued transfer
+
+    bool const is_period = qhd_is_periodic(qhd);
+    ehci_disable_schedule(ehci_data.regs, is_period);
+
+    // drop all queued transfers including the one in progress, HC resumes at tail qTD
+    usbh_spin_lock(false);
+    while (qhd->attached_qtd != qhd->tail_qtd) {
+      qhd->attached_qtd = qtd_free_xfer(qhd->attached_qtd);
+    }
+
+    hcd_dcache_invalidate(qhd, sizeof(ehci_qhd_t));
+    qhd->qtd_overlay.active              = 0;
+    qhd->qtd_overlay.next.address        = (uint32_t) qhd->tail_qtd;
+    qhd->qtd_overlay.alternate.terminate = 1;
+    hcd_dcache_clean(qhd, sizeof(ehci_qhd_t));
+    usbh_spin_unlock(false);
+
+    ehci_enable_schedule(ehci_data.regs, is_period);
+    return true;
+  }
+
   ehci_qtd_t * volatile qtd = qhd->attached_qtd;
   TU_VERIFY(qtd != NULL); // no queued transfer
 
@@ -560,7 +705,7 @@ bool hcd_edpt_abort_xfer(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr) {
   TU_VERIFY(qtd->active); // transfer is already complete
 
   // HC is still processing, disable HC list schedule before making changes
-  bool const is_period = (qhd->interval_ms > 0);
+  bool const is_period = qhd_is_periodic(qhd);
 
   ehci_disable_schedule(ehci_data.regs, is_period);
 
@@ -604,6 +749,7 @@ void async_advance_isr(uint8_t rhport) {
   ehci_qhd_t *qhd_pool = ehci_data.qhd_pool;
   for (uint32_t i = 0; i < QHD_MAX; i++) {
     if (qhd_pool[i].removing) {
+      qhd_free_qtd_list(&qhd_pool[i]);
       qhd_pool[i].removing = 0;
       qhd_pool[i].used = 0;
     }
@@ -626,10 +772,69 @@ void port_connect_status_change_isr(uint8_t rhport) {
   }
 }
 
+// Complete transfers of non-control endpoint in queued order. A transfer is done when its last qTD is retired, or
+// earlier on short packet (HC has continued with alternate qTD) or halt.
+static void qhd_list_complete_isr(ehci_qhd_t* qhd) {
+  while (qhd->attached_qtd != qhd->tail_qtd) {
+    ehci_qtd_t* qtd = qhd->attached_qtd;
+    uint32_t xferred_bytes = 0;
+    xfer_result_t xfer_result = XFER_RESULT_SUCCESS;
+
+    // walk qTDs of the oldest transfer, stop if HC is still working on it
+    while (1) {
+      hcd_dcache_invalidate(qtd, sizeof(ehci_qtd_t)); // HC may have written back TD
+      if (qtd->active) {
+        return;
+      }
+
+      qtd_extra_t const* extra = qtd_get_extra(qtd);
+      uint32_t const len = extra->expected_bytes - qtd->total_bytes;
+      if (qhd->pid == EHCI_PID_IN && len > 0) {
+        hcd_dcache_invalidate((void*) extra->buffer, len);
+      }
+      xferred_bytes += len;
+
+      if (qtd->halted) {
+        // endpoint is halted due to STALL if no error bits are set
+        xfer_result = (qtd->xact_err || qtd->err_count == 0 || qtd->buffer_err || qtd->babble_err) ?
+                      XFER_RESULT_FAILED : XFER_RESULT_STALLED;
+        break;
+      }
+
+      if (extra->is_last || qtd->total_bytes > 0) {
+        break;
+      }
+      qtd = (ehci_qtd_t*) tu_align32(qtd->next.address);
+    }
+
+    // remove and free TDs before invoking callback
+    ehci_qtd_t* next_xfer = qtd_free_xfer(qhd->attached_qtd);
+    qhd->attached_qtd = next_xfer;
+
+    if (xfer_result != XFER_RESULT_SUCCESS) {
+      // skip remaining TDs of the failed transfer. Clear halted if not caused by STALL to allow more transfer,
+      // stalled endpoint is resumed by clear stall
+      qhd->qtd_overlay.next.address        = (uint32_t) next_xfer;
+      qhd->qtd_overlay.alternate.terminate = 1;
+      if (xfer_result == XFER_RESULT_FAILED) {
+        qhd->qtd_overlay.halted = false;
+      }
+      hcd_dcache_clean(qhd, sizeof(ehci_qhd_t));
+    }
+
+    hcd_event_xfer_complete(qhd->dev_addr, qhd_ep_addr(qhd), xferred_bytes, xfer_result, true);
+  }
+}
+
 // Check queue head for potential transfer complete (successful or error)
 TU_ATTR_ALWAYS_INLINE static inline
 void qhd_xfer_complete_isr(ehci_qhd_t * qhd) {
   hcd_dcache_invalidate(qhd, sizeof(ehci_qhd_t)); // HC may have updated the overlay
+  if (qhd->ep_number != 0) {
+    qhd_list_complete_isr(qhd);
+    return;
+  }
+
   volatile ehci_qtd_t *qtd_overlay = &qhd->qtd_overlay;
 
   // process non-active (completed) QHD with attached (scheduled) TD
@@ -655,12 +860,13 @@ void qhd_xfer_complete_isr(ehci_qhd_t * qhd) {
     ehci_qtd_t * volatile qtd = qhd->attached_qtd;
     hcd_dcache_invalidate(qtd, sizeof(ehci_qtd_t)); // HC may have written back TD
 
+    qtd_extra_t const* extra = qtd_get_extra(qtd);
     uint8_t const dir = (qtd->pid == EHCI_PID_IN) ? 1 : 0;
-    uint32_t const xferred_bytes = qtd->expected_bytes - qtd->total_bytes;
+    uint32_t const xferred_bytes = extra->expected_bytes - qtd->total_bytes;
 
     // invalidate dcache if IN transfer with data
-    if (dir == 1 && qhd->attached_buffer != 0 && xferred_bytes > 0) {
-      hcd_dcache_invalidate((void*) qhd->attached_buffer, xferred_bytes);
+    if (dir == 1 && extra->buffer != 0 && xferred_bytes > 0) {
+      hcd_dcache_invalidate((void*) extra->buffer, xferred_bytes);
     }
 
     // remove and free TD before invoking callback
@@ -683,18 +889,16 @@ void proccess_async_xfer_isr(ehci_qhd_t * const list_head) {
 }
 
 TU_ATTR_ALWAYS_INLINE static inline
-void process_period_xfer_isr(uint8_t rhport, uint32_t interval_ms) {
-  uint32_t const period_1ms_addr = (uint32_t) list_get_period_head(rhport, 1u);
-  ehci_link_t next_link = *list_get_period_head(rhport, interval_ms);
+void process_period_xfer_isr(uint8_t rhport, uint8_t head_idx) {
+  ehci_link_t next_link = *list_get_period_head(rhport, head_idx);
 
   while (!next_link.terminate) {
-    if (interval_ms > 1 && period_1ms_addr == tu_align32(next_link.address)) {
-      // 1ms period list is end of list for all larger interval
+    uintptr_t const entry_addr = tu_align32(next_link.address);
+    if (is_period_head(entry_addr)) {
+      // head of shorter interval is end of list for this head
       break;
     }
 
-    uintptr_t const entry_addr = tu_align32(next_link.address);
-
     switch (next_link.type) {
       case EHCI_QTYPE_QHD: {
         ehci_qhd_t *qhd = (ehci_qhd_t *) entry_addr;
@@ -750,7 +954,7 @@ void hcd_int_handler(uint8_t rhport, bool in_isr) {
   if (usb_int) {
     proccess_async_xfer_isr(list_get_async_head(rhport));
 
-    for ( uint32_t i = 1; i <= FRAMELIST_SIZE; i *= 2 ) {
+    for (uint8_t i = 0; i < TU_ARRAY_SIZE(ehci_data.period_head_arr); i++) {
       process_period_xfer_isr(rhport, i);
     }
 
@@ -770,9 +974,9 @@ void hcd_int_handler(uint8_t rhport, bool in_isr) {
 //--------------------------------------------------------------------+
 
 // Get head of periodic list
-TU_ATTR_ALWAYS_INLINE static inline ehci_link_t* list_get_period_head(uint8_t rhport, uint32_t interval_ms) {
+TU_ATTR_ALWAYS_INLINE static inline ehci_link_t* list_get_period_head(uint8_t rhport, uint8_t idx) {
   (void) rhport;
-  return (ehci_link_t*) &ehci_data.period_head_arr[ tu_log2( tu_min32(FRAMELIST_SIZE, interval_ms) ) ];
+  return (ehci_link_t*) &ehci_data.period_head_arr[idx];
 }
 
 // Get head of async list
@@ -802,6 +1006,7 @@ TU_ATTR_ALWAYS_INLINE static inline void list_remove(ehci_link_t* head, ehci_lin
 
   if (qhd_is_periodic(qhd)) {
     // period list queue element is guarantee to be free in the next frame (1 ms)
+    qhd_free_qtd_list(qhd);
     qhd->used = 0;
   } else {
     // async list use async advance handshake. Mark as removing, will completely re-usable when async advance isr occurs
@@ -883,7 +1088,8 @@ static ehci_qhd_t *qhd_get_from_addr(uint8_t dev_addr, uint8_t ep_addr) {
 }
 
 // Init queue head with endpoint descriptor
-static void qhd_init(ehci_qhd_t *p_qhd, uint8_t dev_addr, tusb_desc_endpoint_t const * ep_desc) {
+static void qhd_init(ehci_qhd_t *p_qhd, uint8_t dev_addr, tusb_desc_endpoint_t const * ep_desc,
+                     usbh_periodic_slot_t const* slot) {
   // address 0 is used as async head, which always on the list --> cannot be cleared (ehci halted otherwise)
   if (dev_addr != 0) {
     tu_memclr(p_qhd, sizeof(ehci_qhd_t));
@@ -893,7 +1099,6 @@ static void qhd_init(ehci_qhd_t *p_qhd, uint8_t dev_addr, tusb_desc_endpoint_t c
   tuh_bus_info_get(dev_addr, &bus_info);
 
   uint8_t const xfer_type = ep_desc->bmAttributes.xfer;
-  uint8_t const interval = ep_desc->bInterval;
 
   p_qhd->dev_addr           = dev_addr;
   p_qhd->fl_inactive_next_xact = 0;
@@ -911,26 +1116,15 @@ static void qhd_init(ehci_qhd_t *p_qhd, uint8_t dev_addr, tusb_desc_endpoint_t c
       p_qhd->int_smask = p_qhd->fl_int_cmask = 0;
       break;
 
-    case TUSB_XFER_INTERRUPT:
-      if (TUSB_SPEED_HIGH == p_qhd->ep_speed) {
-        TU_ASSERT(interval <= 16, );
-        if (interval < 4) {
-          // sub millisecond interval
-          p_qhd->interval_ms = 0;
-          p_qhd->int_smask = (interval == 1) ? 0xff : // 0b11111111
-                             (interval == 2) ? 0xaa /* 0b10101010 */ : 0x44 /* 0b01000100 */;
-        } else {
-          p_qhd->interval_ms = (uint8_t) tu_min16(1 << (interval - 4), 255);
-          p_qhd->int_smask = TU_BIT(interval % 8);
-        }
-      } else {
-        TU_ASSERT(0 != interval, );
-        // Full/Low: 4.12.2.1 (EHCI) case 1 schedule start split at 1 us & complete split at 2,3,4 uframes
-        p_qhd->int_smask = 0x01;
-        p_qhd->fl_int_cmask = 0x1c; // 0b11100
-        p_qhd->interval_ms = interval;
-      }
+    case TUSB_XFER_INTERRUPT: {
+      // Full/Low: 4.12.2.1 (EHCI) start split at Y & complete split at Y+2,3,4 uframes
+      uint16_t const interval_ms = slot->interval / 8; // 0 for sub millisecond
+      p_qhd->int_smask    = slot->smask;
+      p_qhd->fl_int_cmask = slot->cmask;
+      p_qhd->interval_ms  = (uint8_t) interval_ms;
+      p_qhd->period_idx   = period_head_idx(tu_max16(interval_ms, 1), slot->offset / 8);
       break;
+    }
 
     case TUSB_XFER_ISOCHRONOUS:
       // TODO not support ISO yet
@@ -959,10 +1153,9 @@ static void qhd_init(ehci_qhd_t *p_qhd, uint8_t dev_addr, tusb_desc_endpoint_t c
   }
 }
 
-// Attach a TD to queue head
+// Attach a TD to queue head, only used by control endpoint
 static void qhd_attach_qtd(ehci_qhd_t *qhd, ehci_qtd_t *qtd) {
   qhd->attached_qtd = qtd;
-  qhd->attached_buffer = qtd->buffer[0];
 
   // clean and invalidate cache before physically write
   hcd_dcache_clean_invalidate(qtd, sizeof(ehci_qtd_t));
@@ -976,11 +1169,22 @@ static void qhd_remove_qtd(ehci_qhd_t *qhd) {
   ehci_qtd_t * volatile qtd = qhd->attached_qtd;
 
   qhd->attached_qtd = NULL;
-  qhd->attached_buffer = 0;
   hcd_dcache_clean(qhd, sizeof(ehci_qhd_t));
 
-  qtd->used = 0; // free QTD
-  hcd_dcache_clean(qtd, sizeof(ehci_qtd_t));
+  qtd_get_extra(qtd)->used = 0; // free QTD
+}
+
+// Free whole TD list including tail of a removed non-control queue head
+static void qhd_free_qtd_list(ehci_qhd_t* qhd) {
+  if (qhd->ep_number == 0 || qhd->tail_qtd == NULL) {
+    return;
+  }
+  while (qhd->attached_qtd != qhd->tail_qtd) {
+    qhd->attached_qtd = qtd_free_xfer(qhd->attached_qtd);
+  }
+  qtd_get_extra(qhd->tail_qtd)->used = 0;
+  qhd->tail_qtd = NULL;
+  qhd->attached_qtd = NULL;
 }
 
 //--------------------------------------------------------------------+
@@ -992,25 +1196,89 @@ TU_ATTR_ALWAYS_INLINE static inline ehci_qtd_t* qtd_control(uint8_t dev_addr) {
   return &ehci_data.control[dev_addr].qtd;
 }
 
-TU_ATTR_ALWAYS_INLINE static inline ehci_qtd_t *qtd_find_free(void) {
+TU_ATTR_ALWAYS_INLINE static inline qtd_extra_t* qtd_get_extra(ehci_qtd_t const* qtd) {
+  if (qtd >= ehci_data.qtd_pool && qtd < ehci_data.qtd_pool + QTD_MAX) {
+    return &ehci_data.qtd_extra[qtd - ehci_data.qtd_pool];
+  }
+  // control TD
+  uintptr_t const offset = (uintptr_t) qtd - (uintptr_t) &ehci_data.control[0].qtd;
+  return &ehci_data.qtd_extra_control[offset / sizeof(ehci_data.control[0])];
+}
+
+static uint32_t qtd_free_count(void) {
+  uint32_t count = 0;
   for (uint32_t i = 0; i < QTD_MAX; i++) {
-    if (!ehci_data.qtd_pool[i].used) return &ehci_data.qtd_pool[i];
+    if (!ehci_data.qtd_extra[i].used) {
+      count++;
+    }
   }
-  return NULL;
+  return count;
+}
+
+// Mark count free TDs as used at once, they are linked by next pointer. Return NULL (nothing reserved) if pool does
+// not have enough free TDs. Pool is shared by all endpoints and TDs are freed in ISR, protect against both.
+static ehci_qtd_t* qtd_reserve(uint32_t count) {
+  ehci_qtd_t* list = NULL;
+  usbh_spin_lock(false);
+  if (count <= qtd_free_count()) {
+    for (uint32_t i = 0; i < QTD_MAX && count > 0; i++) {
+      if (!ehci_data.qtd_extra[i].used) {
+        ehci_data.qtd_extra[i].used = 1;
+        ehci_data.qtd_pool[i].next.address = (uint32_t) list;
+        list = &ehci_data.qtd_pool[i];
+        count--;
+      }
+    }
+  }
+  usbh_spin_unlock(false);
+  return list;
+}
+
+// Take next TD from list returned by qtd_reserve()
+TU_ATTR_ALWAYS_INLINE static inline ehci_qtd_t* qtd_reserve_next(ehci_qtd_t** list) {
+  ehci_qtd_t* qtd = *list;
+  *list = (ehci_qtd_t*) qtd->next.address;
+  return qtd;
+}
+
+// Free TDs of a transfer starting from its first TD, return first TD of next transfer (or list tail)
+static ehci_qtd_t* qtd_free_xfer(ehci_qtd_t* qtd) {
+  while (1) {
+    qtd_extra_t* extra = qtd_get_extra(qtd);
+    ehci_qtd_t* next = (ehci_qtd_t*) tu_align32(qtd->next.address);
+    bool const is_last = extra->is_last;
+    extra->used = 0;
+    if (is_last) {
+      return next;
+    }
+    qtd = next;
+  }
+}
+
+// Inactive TD at the end of endpoint's list
+static void qtd_init_tail(ehci_qtd_t* qtd) {
+  tu_memclr(qtd, sizeof(ehci_qtd_t));
+  qtd->next.terminate      = 1;
+  qtd->alternate.terminate = 1;
+  hcd_dcache_clean(qtd, sizeof(ehci_qtd_t));
 }
 
-static void qtd_init(ehci_qtd_t* qtd, void const* buffer, uint16_t total_bytes) {
+// Caller links next/alternate when qTD is part of a chain
+static void qtd_init(ehci_qtd_t* qtd, void const* buffer, uint16_t total_bytes, bool active) {
   tu_memclr(qtd, sizeof(ehci_qtd_t));
-  qtd->used                = 1;
+  qtd_extra_t* extra = qtd_get_extra(qtd);
+  extra->buffer         = (uint32_t) buffer;
+  extra->expected_bytes = total_bytes;
+  extra->used           = 1;
+  extra->is_last        = 1;
 
   qtd->next.terminate      = 1; // init to null
-  qtd->alternate.terminate = 1; // not used, always set to terminated
-  qtd->active              = 1;
+  qtd->alternate.terminate = 1; // init to null
+  qtd->active              = active ? 1 : 0;
   qtd->err_count           = 3; // TODO 3 consecutive errors tolerance
   qtd->data_toggle         = 0;
   qtd->int_on_complete     = 1;
   qtd->total_bytes         = total_bytes;
-  qtd->expected_bytes      = total_bytes;
 
   qtd->buffer[0] = (uint32_t) buffer;
   for(uint8_t i=1; i<5; i++) {
@@ -68,16 +68,8 @@ typedef struct {
   // Word 0 Next QTD Pointer
   ehci_link_t next;
 
-  // Word 1 Alternate Next QTD Pointer (not used)
-  union {
-    ehci_link_t alternate;
-    struct {
-      uint32_t                : 5;
-      uint32_t used           : 1;
-      uint32_t                : 10;
-      uint32_t expected_bytes : 16;
-    };
-  };
+  // Word 1 Alternate Next QTD Pointer, followed on short packet to skip remaining qTDs of a transfer
+  ehci_link_t alternate;
 
   // Word 2 qTQ Token
   volatile uint32_t ping_err             : 1;  // For Highspeed: 0 Out, 1 Ping. Full/Slow used as error indicator
@@ -141,11 +133,12 @@ typedef struct TU_ATTR_ALIGNED(32) {
   uint8_t pid;
   uint8_t interval_ms;// polling interval in frames (or millisecond)
 
-  uint8_t TU_RESERVED[4];
+  uint8_t period_idx; // index of period list head
+  uint8_t TU_RESERVED[3];
 
-  // Attached TD management, note usbh will only queue 1 TD per QHD.
-  // buffer for dcache invalidate since td's buffer is modified by HC and finding initial buffer address is not trivial
-  uint32_t attached_buffer;
+  // Attached TD management. Control endpoint has only 1 TD, other endpoints have a TD list from attached (oldest)
+  // to tail, which is an inactive TD that becomes the first TD of next queued transfer.
+  ehci_qtd_t *volatile tail_qtd;
   ehci_qtd_t *volatile attached_qtd;
 } ehci_qhd_t;
 TU_VERIFY_STATIC( sizeof(ehci_qhd_t) == 64, "size is not correct" );
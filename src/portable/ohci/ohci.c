@@ -147,13 +147,17 @@ static ohci_ed_t * const p_ed_head[] = {
     [TUSB_XFER_CONTROL]     = hcd_dcache_uncached(&ohci_data.control[0].ed),
     [TUSB_XFER_BULK   ]     = hcd_dcache_uncached(&ohci_data.bulk_head_ed),
     [TUSB_XFER_INTERRUPT]   = hcd_dcache_uncached(&ohci_data.period_head_ed),
-    [TUSB_XFER_ISOCHRONOUS] = NULL // TODO Isochronous
+    [TUSB_XFER_ISOCHRONOUS] = hcd_dcache_uncached(&ohci_data.period_head_ed), // iso EDs are kept after interrupt EDs
 };
 
 static void ed_list_insert(ohci_ed_t * p_pre, ohci_ed_t * p_ed);
+static void ed_list_append(ohci_ed_t * p_head, ohci_ed_t * p_ed);
 static void ed_list_remove_by_addr(ohci_ed_t * p_head, uint8_t dev_addr);
 static gtd_extra_data_t *gtd_get_extra_data(ohci_gtd_t const * const gtd);
 static ohci_ed_t* ed_from_addr(uint8_t dev_addr, uint8_t ep_addr);
+#if CFG_TUH_ISO_XFER
+static void itd_detach(uint8_t dev_addr, uint8_t ep_addr);
+#endif
 
 TU_ATTR_ALWAYS_INLINE static inline ohci_ed_t* ed_control(uint8_t daddr) {
   return hcd_dcache_uncached(&ohci_data.control[daddr].ed);
@@ -221,7 +225,8 @@ bool hcd_init(uint8_t rhport, const tusb_rhport_init_t* rh_init) {
       OHCI_INT_MASTER_ENABLE_MASK;
 
   OHCI_REG->control = OHCI_CONTROL_CONTROL_BULK_RATIO | OHCI_CONTROL_LIST_CONTROL_ENABLE_MASK |
-       OHCI_CONTROL_LIST_BULK_ENABLE_MASK | OHCI_CONTROL_LIST_PERIODIC_ENABLE_MASK; // TODO Isochronous
+       OHCI_CONTROL_LIST_BULK_ENABLE_MASK | OHCI_CONTROL_LIST_PERIODIC_ENABLE_MASK |
+       (CFG_TUH_ISO_XFER ? OHCI_CONTROL_LIST_ISOCHRONOUS_ENABLE_MASK : 0);
 
   OHCI_REG->frame_interval = (OHCI_FMINTERVAL_FSMPS << 16) | OHCI_FMINTERVAL_FI;
   OHCI_REG->frame_interval ^= (1ul << 31); //Must toggle when frame_interval is updated.
@@ -277,8 +282,10 @@ void hcd_device_close(uint8_t rhport, uint8_t dev_addr) {
   } else {
     ed_list_remove_by_addr(p_ed_head[TUSB_XFER_CONTROL], dev_addr); // remove control
     ed_list_remove_by_addr(p_ed_head[TUSB_XFER_BULK], dev_addr); // remove bulk
-    ed_list_remove_by_addr(p_ed_head[TUSB_XFER_INTERRUPT], dev_addr); // remove interrupt
-    // TODO remove ISO
+    ed_list_remove_by_addr(p_ed_head[TUSB_XFER_INTERRUPT], dev_addr); // remove interrupt and iso
+#if CFG_TUH_ISO_XFER
+    itd_detach(dev_addr, 0); // retired itds in done queue must not touch transfers of removed device
+#endif
   }
 }
 
@@ -374,6 +381,16 @@ static void ed_list_insert(ohci_ed_t * p_pre, ohci_ed_t * p_ed) {
   p_pre->next = (uint32_t) _phys_addr(p_ed);
 }
 
+// Link ED at the end of list, used for iso EDs which must be after interrupt EDs in periodic list
+static void ed_list_append(ohci_ed_t * p_head, ohci_ed_t * p_ed) {
+  ohci_ed_t* p_prev = p_head;
+  while (p_prev->next) {
+    p_prev = hcd_dcache_uncached((ohci_ed_t*)_virt_addr((void*)p_prev->next));
+  }
+  p_ed->next = 0;
+  p_prev->next = (uint32_t) _phys_addr(p_ed);
+}
+
 static void ed_list_remove_by_addr(ohci_ed_t * p_head, uint8_t dev_addr) {
   ohci_ed_t* p_prev = p_head;
 
@@ -423,14 +440,73 @@ static ohci_gtd_t* gtd_find_free(void) {
   return NULL;
 }
 
+#if CFG_TUH_ISO_XFER
+static ohci_itd_t* itd_find_free(void) {
+  for (uint8_t i = 0; i < ITD_MAX; i++) {
+    if (!ohci_data.itd_pool[i].used) {
+      ohci_data.itd_pool[i].used = 1;
+      return &ohci_data.itd_pool[i];
+    }
+  }
+  return NULL;
+}
+
+static uint8_t itd_free_count(void) {
+  uint8_t count = 0;
+  for (uint8_t i = 0; i < ITD_MAX; i++) {
+    if (!ohci_data.itd_pool[i].used) {
+      count++;
+    }
+  }
+  return count;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline itd_extra_data_t* itd_get_extra_data(ohci_itd_t const* itd) {
+  return &ohci_data.itd_extra[itd - ohci_data.itd_pool];
+}
+
+// Detach allocated itds of an endpoint (all iso endpoints if ep_addr is 0) from their transfers
+static void itd_detach(uint8_t dev_addr, uint8_t ep_addr) {
+  for (uint8_t i = 0; i < ITD_MAX; i++) {
+    itd_extra_data_t* extra = &ohci_data.itd_extra[i];
+    const ohci_ed_t* ed = hcd_dcache_uncached(&ohci_data.ed_pool[extra->ed_idx]);
+    if (ohci_data.itd_pool[i].used && ed->w0.dev_addr == dev_addr &&
+        (ep_addr == 0 || ep_addr == tu_edpt_addr(ed->w0.ep_number, ed->w0.pid == PID_IN))) {
+      extra->xfer = NULL;
+    }
+  }
+}
+
+// Number of packets starting from packets[0] at physical address addr that fit into one itd: up to 8 packets and
+// buffer must not span more than 2 pages. Total bytes of these packets is returned in p_bytes.
+static uint8_t itd_packet_count(uint32_t addr, tuh_iso_packet_t const* packets, uint16_t count, uint32_t* p_bytes) {
+  uint32_t const page0 = tu_align4k(addr);
+  uint32_t bytes = 0;
+  uint8_t n = 0;
+  while (n < 8 && n < count) {
+    uint32_t const len = packets[n].length;
+    uint32_t const last = addr + bytes + (len ? len - 1 : 0);
+    if (tu_align4k(last) - page0 > 0x1000u) {
+      break;
+    }
+    bytes += len;
+    n++;
+  }
+  *p_bytes = bytes;
+  return n;
+}
+#endif
+
 //--------------------------------------------------------------------+
 // Endpoint API
 //--------------------------------------------------------------------+
 bool hcd_edpt_open(uint8_t rhport, uint8_t dev_addr, tusb_desc_endpoint_t const* ep_desc) {
   (void)rhport;
 
-  // TODO iso support
-  TU_ASSERT(ep_desc->bmAttributes.xfer != TUSB_XFER_ISOCHRONOUS);
+  // iso endpoint is only supported for full speed with 1 packet per frame
+  if (ep_desc->bmAttributes.xfer == TUSB_XFER_ISOCHRONOUS) {
+    TU_ASSERT(CFG_TUH_ISO_XFER && ep_desc->bInterval == 1);
+  }
 
   //------------- Prepare Queue Head -------------//
   ohci_ed_t* p_ed;
@@ -450,6 +526,22 @@ bool hcd_edpt_open(uint8_t rhport, uint8_t dev_addr, tusb_desc_endpoint_t const*
     return true;
   }
 
+#if CFG_TUH_ISO_XFER
+  if (ep_desc->bmAttributes.xfer == TUSB_XFER_ISOCHRONOUS) {
+    // same as gtd, an empty ITD is used as the end-of-list marker
+    ohci_itd_t* itd = itd_find_free();
+    TU_ASSERT(itd);
+    itd_extra_data_t* extra = itd_get_extra_data(itd);
+    extra->xfer = NULL;
+    extra->ed_idx = (uint8_t) (p_ed - ohci_data.ed_pool);
+    p_ed->td_head.address = (uint32_t)_phys_addr(itd);
+    p_ed->td_tail = (uint32_t)_phys_addr(itd);
+
+    ed_list_append(p_ed_head[TUSB_XFER_ISOCHRONOUS], p_ed);
+    return true;
+  }
+#endif
+
   if (tu_edpt_number(ep_desc->bEndpointAddress) != 0) {
     // Get an empty TD and use it as the end-of-list marker.
     // This marker TD will be used when a transfer is made on this EP
@@ -544,11 +636,132 @@ bool hcd_edpt_xfer(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr, uint8_t *
   return true;
 }
 
+#if CFG_TUH_ISO_XFER
+bool hcd_edpt_iso_xfer(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr, struct tuh_iso_xfer_s* xfer) {
+  ohci_ed_t* ed = ed_from_addr(dev_addr, ep_addr);
+  TU_ASSERT(ed && ed->w0.is_iso && xfer->num_packets);
+  uint8_t const ed_idx = (uint8_t) (ed - ohci_data.ed_pool);
+  uint32_t const buf_addr = (uint32_t) _phys_addr(xfer->buffer);
+
+  // count required itds first so that nothing is queued if pool is short
+  uint32_t total_bytes = 0;
+  uint16_t itd_count = 0;
+  for (uint16_t idx = 0; idx < xfer->num_packets; itd_count++) {
+    uint32_t bytes;
+    uint8_t const n = itd_packet_count(buf_addr + total_bytes, &xfer->packets[idx], xfer->num_packets - idx, &bytes);
+    TU_VERIFY(n > 0); // packet spans more than 2 pages
+    idx += n;
+    total_bytes += bytes;
+  }
+  TU_VERIFY(itd_count <= itd_free_count());
+
+  // IN transfer: invalidate buffer, OUT transfer: clean buffer
+  if (tu_edpt_dir(ep_addr)) {
+    hcd_dcache_invalidate(xfer->buffer, total_bytes);
+  } else {
+    hcd_dcache_clean(xfer->buffer, total_bytes);
+  }
+
+  // ASAP continues right after queued packets, or a few frames ahead of HC if endpoint is idle or late
+  uint16_t const cur_frame = (uint16_t) OHCI_REG->frame_number;
+  uint16_t frame;
+  if (xfer->start_frame != TUH_ISO_START_ASAP) {
+    frame = (uint16_t) xfer->start_frame;
+  } else if ((ed->td_head.address & ~0x0Fu) != ed->td_tail &&
+             (int16_t) (ohci_data.iso_next_frame[ed_idx] - cur_frame) > 1) {
+    frame = ohci_data.iso_next_frame[ed_idx];
+  } else {
+    frame = (uint16_t) (cur_frame + 2);
+  }
+  xfer->start_frame = hcd_frame_number(rhport) + (uint32_t) (int32_t) (int16_t) (frame - cur_frame);
+  ohci_data.iso_next_frame[ed_idx] = (uint16_t) (frame + xfer->num_packets);
+
+  // fill the current tail then chain a new empty tail after each itd
+  ohci_itd_t* itd = (ohci_itd_t*) _virt_addr((void*) ed->td_tail);
+  uint32_t addr = buf_addr;
+  for (uint16_t idx = 0; idx < xfer->num_packets;) {
+    uint32_t bytes;
+    uint8_t const n = itd_packet_count(addr, &xfer->packets[idx], xfer->num_packets - idx, &bytes);
+    bool const is_last = (idx + n == xfer->num_packets);
+
+    itd->starting_frame  = frame;
+    itd->delay_interrupt = is_last ? OHCI_INT_ON_COMPLETE_YES : OHCI_INT_ON_COMPLETE_NO;
+    itd->frame_count     = (uint8_t) (n - 1) & 0x07u;
+    itd->condition_code  = OHCI_CCODE_NOT_ACCESSED;
+    itd->buffer_page0    = tu_align4k(addr);
+    itd->buffer_end      = bytes ? (addr + bytes - 1) : addr;
+
+    uint32_t offset = addr;
+    for (uint8_t i = 0; i < 8; i++) {
+      // PSW is initialized with NOT_ACCESSED code, page select bit and offset within page
+      uint16_t psw = 0;
+      if (i < n) {
+        psw = (uint16_t) (0xE000u | (tu_align4k(offset) != itd->buffer_page0 ? 0x1000u : 0) | tu_offset4k(offset));
+        offset += xfer->packets[idx + i].length;
+      }
+      itd->offset_packetstatus[i] = psw;
+    }
+
+    itd_extra_data_t* extra = itd_get_extra_data(itd);
+    extra->xfer       = xfer;
+    extra->packet_idx = idx;
+    extra->ed_idx     = ed_idx;
+    extra->is_last    = is_last ? 1 : 0;
+
+    ohci_itd_t* new_itd = itd_find_free(); // guaranteed by free count check above
+    itd_get_extra_data(new_itd)->xfer   = NULL;
+    itd_get_extra_data(new_itd)->ed_idx = ed_idx;
+
+    itd->next = (uint32_t) _phys_addr(new_itd);
+    hcd_dcache_clean(itd, sizeof(ohci_itd_t));
+
+    // HC can start processing this itd once tail is moved past it
+    ed->td_tail = (uint32_t) _phys_addr(new_itd);
+
+    itd = new_itd;
+    idx = (uint16_t) (idx + n);
+    addr += bytes;
+    frame = (uint16_t) (frame + n);
+  }
+
+  return true;
+}
+#endif
+
 bool hcd_edpt_abort_xfer(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr) {
   (void) rhport;
+
+#if CFG_TUH_ISO_XFER
+  ohci_ed_t* ed = ed_from_addr(dev_addr, ep_addr);
+  if (ed != NULL && tu_edpt_number(ep_addr) != 0 && ed->w0.is_iso) {
+    // Skip ED and wait for next frame so that HC no longer works on its itds.
+    // Frame number only advances while HC is operational (not in reset/suspend)
+    ed->w0.skip = 1;
+    uint16_t const frame = (uint16_t) OHCI_REG->frame_number;
+    while (OHCI_REG->control_bit.hc_functional_state == OHCI_CONTROL_FUNCSTATE_OPERATIONAL &&
+           (uint16_t) OHCI_REG->frame_number == frame) {}
+
+    // itds already retired to done queue are freed by ISR without reporting
+    itd_detach(dev_addr, ep_addr);
+
+    // free queued itds, keep tail as end-of-list marker
+    uint32_t td_addr = ed->td_head.address & ~0x0Fu;
+    while (td_addr != ed->td_tail) {
+      ohci_itd_t* itd = (ohci_itd_t*) _virt_addr((void*) (uintptr_t) td_addr);
+      hcd_dcache_invalidate(itd, sizeof(ohci_itd_t));
+      td_addr = itd->next;
+      itd->used = 0;
+    }
+    ed->td_head.address = ed->td_tail;
+    ed->w0.skip = 0;
+    return true;
+  }
+#else
   (void) dev_addr;
   (void) ep_addr;
-  // TODO not implemented yet
+#endif
+
+  // TODO not implemented yet for non-iso endpoints
   return false;
 }
 
@@ -574,8 +787,13 @@ bool hcd_edpt_clear_stall(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr) {
 // OHCI Interrupt Handler
 //--------------------------------------------------------------------+
 TU_ATTR_ALWAYS_INLINE static inline bool is_itd(ohci_td_item_t* item) {
+#if CFG_TUH_ISO_XFER
+  return ((uintptr_t) item >= (uintptr_t) ohci_data.itd_pool) &&
+         ((uintptr_t) item < (uintptr_t) (ohci_data.itd_pool + ITD_MAX));
+#else
   (void) item;
-  return false; // ISO not supported yet
+  return false;
+#endif
 }
 
 static ohci_td_item_t* list_reverse(ohci_td_item_t* td_head) {
@@ -630,6 +848,46 @@ TU_ATTR_ALWAYS_INLINE static inline uint32_t gtd_xfer_byte_left(uint32_t buffer_
          tu_offset4k(buffer_end) - tu_offset4k(current_buffer) + 1;
 }
 
+#if CFG_TUH_ISO_XFER
+// Update packet status of transfer from retired itd, transfer is complete with its last itd
+static void itd_complete_isr(ohci_itd_t* itd) {
+  itd_extra_data_t const* extra = itd_get_extra_data(itd);
+  tuh_iso_xfer_t* xfer = extra->xfer;
+  itd->used = 0; // free TD
+  if (xfer == NULL) {
+    return; // aborted
+  }
+
+  const ohci_ed_word0_t ed_w0 = hcd_dcache_uncached(&ohci_data.ed_pool[extra->ed_idx])->w0;
+  bool const is_in = (ed_w0.pid == PID_IN);
+
+  for (uint8_t i = 0; i <= itd->frame_count; i++) {
+    // PSW: condition code in 15:12, received size in 10:0
+    uint16_t const psw = itd->offset_packetstatus[i];
+    uint8_t const cc = (uint8_t) (psw >> 12);
+    tuh_iso_packet_t* packet = &xfer->packets[extra->packet_idx + i];
+
+    if (cc == OHCI_CCODE_NO_ERROR || (is_in && cc == OHCI_CCODE_DATA_UNDERRUN)) {
+      packet->actual_len = is_in ? (psw & 0x07FFu) : packet->length;
+      packet->result = XFER_RESULT_SUCCESS;
+    } else {
+      packet->actual_len = 0;
+      packet->result = XFER_RESULT_FAILED;
+    }
+  }
+
+  if (extra->is_last) {
+    uint32_t xferred_bytes = 0;
+    for (uint16_t i = 0; i < xfer->num_packets; i++) {
+      xferred_bytes += xfer->packets[i].actual_len;
+    }
+    // individual packet errors are reported in packet result
+    hcd_event_xfer_complete(ed_w0.dev_addr, tu_edpt_addr(ed_w0.ep_number, is_in), xferred_bytes,
+                            XFER_RESULT_SUCCESS, true);
+  }
+}
+#endif
+
 static void done_queue_isr(uint8_t hostid) {
   (void)hostid;
 
@@ -638,7 +896,14 @@ static void done_queue_isr(uint8_t hostid) {
   ohci_data.hcca.done_head = 0;
 
   while (td_head != NULL) {
-    // TODO check if td_head is iso td
+#if CFG_TUH_ISO_XFER
+    if (is_itd(td_head)) {
+      itd_complete_isr((ohci_itd_t*) td_head);
+      td_head = (ohci_td_item_t*)_virt_addr((void*)td_head->next);
+      continue;
+    }
+#endif
+
     //------------- Non ISO transfer -------------//
     ohci_gtd_t* const qtd = (ohci_gtd_t*) td_head;
     xfer_result_t const event = (qtd->condition_code == OHCI_CCODE_NO_ERROR) ? XFER_RESULT_SUCCESS :
@@ -689,7 +954,10 @@ void hcd_int_handler(uint8_t hostid, bool in_isr) {
             ohci_gtd_t *gtd = (ohci_gtd_t*)_virt_addr((void*)(uintptr_t)td_addr);
             gtd->used = 0;
           } else {
-            // TODO: Free ITD once implemented
+            #if CFG_TUH_ISO_XFER
+            ohci_itd_t *itd = (ohci_itd_t*)_virt_addr((void*)(uintptr_t)td_addr);
+            itd->used = 0;
+            #endif
           }
 
           if (td_addr == ed->td_tail) {
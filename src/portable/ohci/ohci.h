@@ -19,12 +19,15 @@
 #define OHCI_PERIODIC_LIST (defined HOST_HCD_XFER_INTERRUPT || defined HOST_HCD_XFER_ISOCHRONOUS)
 
 // TODO merge OHCI with EHCI
-enum {
-  OHCI_MAX_ITD = 4
-};
+
+// Number of isochronous TDs, each one holds up to 8 packets (frames). An opened ISO endpoint keeps one as list tail
+#ifndef CFG_TUH_OHCI_ITD_MAX
+  #define CFG_TUH_OHCI_ITD_MAX 8
+#endif
 
 #define ED_MAX       (CFG_TUH_DEVICE_MAX*CFG_TUH_ENDPOINT_MAX)
 #define GTD_MAX      ED_MAX
+#define ITD_MAX      CFG_TUH_OHCI_ITD_MAX
 
 // tinyUSB's OHCI implementation caps number of EDs to 8 bits
 TU_VERIFY_STATIC (ED_MAX <= 256, "Reduce CFG_TUH_DEVICE_MAX or CFG_TUH_ENDPOINT_MAX");
@@ -135,7 +138,8 @@ TU_VERIFY_STATIC(sizeof(ohci_ed_t) == ED_ALIGN_SIZE, "size is not correct" );
 typedef struct TU_ATTR_ALIGNED(ITD_ALIGN_SIZE) {
   /*---------- Word 1 ----------*/
   uint32_t starting_frame          : 16;
-  uint32_t                         : 5; // can be used
+  uint32_t used                    : 1;
+  uint32_t                         : 4; // can be used
   uint32_t delay_interrupt         : 3;
   uint32_t frame_count             : 3;
   uint32_t                         : 1; // can be used
@@ -161,6 +165,13 @@ typedef struct {
 } gtd_extra_data_t;
 TU_VERIFY_STATIC(sizeof(gtd_extra_data_t) == 2, "size is not correct" );
 
+typedef struct {
+  struct tuh_iso_xfer_s* xfer; // transfer the itd belongs to, NULL if aborted or list tail
+  uint16_t packet_idx;         // index of itd's first packet within transfer
+  uint8_t ed_idx;              // index of iso endpoint in ed_pool
+  uint8_t is_last;             // last itd of transfer
+} itd_extra_data_t;
+
 // structure with member alignment required from large to small
 typedef struct TU_ATTR_ALIGNED(256) {
   ohci_hcca_t hcca;
@@ -174,13 +185,19 @@ typedef struct TU_ATTR_ALIGNED(256) {
     ohci_gtd_t gtd;
   } control[CFG_TUH_DEVICE_MAX + CFG_TUH_HUB + 1];
 
-  //  ochi_itd_t itd[OHCI_MAX_ITD]; // itd requires alignment of 32
+#if CFG_TUH_ISO_XFER
+  ohci_itd_t itd_pool[ITD_MAX]; // itd requires alignment of 32
+#endif
   ohci_ed_t ed_pool[ED_MAX];
   ohci_gtd_t gtd_pool[GTD_MAX];
 
   // extra data needed by TDs that can't fit in the TD struct
   gtd_extra_data_t gtd_extra_control[CFG_TUH_DEVICE_MAX + CFG_TUH_HUB + 1];
   gtd_extra_data_t gtd_extra[GTD_MAX];
+#if CFG_TUH_ISO_XFER
+  itd_extra_data_t itd_extra[ITD_MAX];
+  uint16_t iso_next_frame[ED_MAX]; // frame following the last queued packet of iso endpoint
+#endif
 
   volatile uint16_t frame_number_hi;
   volatile uint16_t reclaim_frame;
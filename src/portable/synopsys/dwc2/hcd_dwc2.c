@@ -15,6 +15,7 @@
 
 #include "host/hcd.h"
 #include "host/usbh.h"
+#include "host/usbh_pvt.h"
 #include "dwc2_common.h"
 
   // Debug level for DWC2
@@ -61,7 +62,7 @@ typedef struct {
     uint32_t next_pid        : 2; // PID for next transfer
     uint32_t next_do_ping    : 1; // Do PING for next transfer if possible (highspeed OUT)
     uint32_t closing         : 1; // endpoint is closing
-    // uint32_t : 8;
+    uint32_t uframe_offset   : 8; // micro-frame offset within interval allocated by periodic scheduler
   };
 
   uint32_t uframe_countdown; // micro-frame count down to transfer for periodic, only need 18-bit
@@ -241,11 +242,31 @@ TU_ATTR_ALWAYS_INLINE static inline void edpt_dealloc(hcd_endpoint_t *edpt) {
   edpt->hcchar_bm.enable = 0;
 }
 
+// Micro-frames until next transfer of periodic endpoint: at least one interval from now minus schedule length, then
+// aligned to offset allocated by periodic scheduler so that endpoints are spread over (micro)frames
+static uint32_t edpt_periodic_countdown(dwc2_regs_t* dwc2, const hcd_endpoint_t* edpt) {
+  const uint32_t ucount = (hprt_speed_get(dwc2) == TUSB_SPEED_HIGH ? 1 : 8);
+  const uint32_t period = tu_min32(edpt->uframe_interval, 8 * CFG_TUH_PERIODIC_FRAMES);
+  const uint32_t offset = edpt->uframe_offset - (edpt->uframe_offset % ucount);
+  const uint32_t now = (dwc2->hfnum & HFNUM_FRNUM_Msk) * ucount;
+  const uint32_t start = now + edpt->uframe_interval - period;
+
+  uint32_t countdown = edpt->uframe_interval - period + (offset + period - (start % period)) % period;
+  if (countdown == 0) {
+    countdown = period;
+  }
+  return countdown;
+}
+
 // close an opened endpoint
 static void edpt_close(dwc2_regs_t *dwc2, uint8_t ep_id) {
   hcd_endpoint_t *edpt = &_hcd_data.edpt[ep_id];
   edpt->closing        = 1; // mark endpoint as closing
 
+  if (channel_is_periodic(edpt->hcchar)) {
+    usbh_periodic_free(edpt->hcchar_bm.dev_addr, tu_edpt_addr(edpt->hcchar_bm.ep_num, edpt->hcchar_bm.ep_dir));
+  }
+
   // disable active channel belong to this endpoint
   for (uint8_t ch_id = 0; ch_id < DWC2_CHANNEL_COUNT_MAX; ch_id++) {
     hcd_xfer_t *xfer = &_hcd_data.xfer[ch_id];
@@ -520,9 +541,19 @@ bool hcd_edpt_open(uint8_t rhport, uint8_t dev_addr, const tusb_desc_endpoint_t*
   tuh_bus_info_t bus_info;
   tuh_bus_info_get(dev_addr, &bus_info);
 
+  // reserve periodic bandwidth, interval phase is used when re-scheduling NAKed transfer
+  usbh_periodic_slot_t slot = {0};
+  const uint8_t xfer_type = desc_ep->bmAttributes.xfer;
+  if (xfer_type == TUSB_XFER_INTERRUPT || xfer_type == TUSB_XFER_ISOCHRONOUS) {
+    TU_ASSERT(usbh_periodic_alloc(dev_addr, desc_ep, &slot));
+  }
+
   // find a free endpoint
   const uint8_t ep_id = edpt_alloc();
-  TU_ASSERT(ep_id < CFG_TUH_DWC2_ENDPOINT_MAX);
+  if (ep_id >= CFG_TUH_DWC2_ENDPOINT_MAX) {
+    usbh_periodic_free(dev_addr, desc_ep->bEndpointAddress);
+    TU_ASSERT(false);
+  }
   hcd_endpoint_t* edpt = &_hcd_data.edpt[ep_id];
 
   dwc2_channel_char_t* hcchar_bm = &edpt->hcchar_bm;
@@ -546,6 +577,7 @@ bool hcd_edpt_open(uint8_t rhport, uint8_t dev_addr, const tusb_desc_endpoint_t*
 
   edpt->speed = bus_info.speed;
   edpt->next_pid = HCTSIZ_PID_DATA0;
+  edpt->uframe_offset = (uint8_t) slot.offset;
   switch (desc_ep->bmAttributes.xfer) {
     case TUSB_XFER_ISOCHRONOUS:
       edpt->uframe_interval = 1 << (desc_ep->bInterval - 1);
@@ -756,6 +788,12 @@ bool hcd_setup_send(uint8_t rhport, uint8_t dev_addr, const uint8_t setup_packet
   return hcd_edpt_xfer(rhport, dev_addr, 0, (uint8_t*)(uintptr_t) setup_packet, 8);
 }
 
+// Control transfers of different devices use their own channel, keep the other half of channels for bulk/interrupt
+uint8_t hcd_control_xfer_max(uint8_t rhport) {
+  const dwc2_regs_t* dwc2 = DWC2_REG(rhport);
+  return tu_max8((uint8_t) (dwc2_channel_count(dwc2) / 2), 1);
+}
+
 // clear stall, data toggle is also reset to DATA0
 bool hcd_edpt_clear_stall(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr) {
   (void) rhport;
@@ -808,7 +846,7 @@ static void channel_xfer_in_retry(dwc2_regs_t* dwc2, uint8_t ch_id, uint32_t hci
       // otherwise, de-allocate channel, enable SOF set frame counter for later transfer
       const dwc2_channel_tsize_t hctsiz = {.value = channel->hctsiz};
       edpt->next_pid = hctsiz.pid; // save PID
-      edpt->uframe_countdown = edpt->uframe_interval - ucount;
+      edpt->uframe_countdown = edpt_periodic_countdown(dwc2, edpt);
       // enable SOF interrupt if not already enabled
       if (0 == (dwc2->gintmsk & GINTMSK_SOFM)) {
         dwc2->gintsts = GINTSTS_SOF;
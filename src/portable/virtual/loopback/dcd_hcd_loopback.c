@@ -0,0 +1,770 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2019 Ha Thach (tinyusb.org)
+ * SPDX-License-Identifier: MIT
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#include "tusb_option.h"
+
+#if CFG_TUSB_MCU == OPT_MCU_LOOPBACK && (CFG_TUD_ENABLED || CFG_TUH_ENABLED)
+
+#if !(CFG_TUD_ENABLED && CFG_TUH_ENABLED)
+  #error "Loopback port connects host and device stack, both CFG_TUD_ENABLED and CFG_TUH_ENABLED are required"
+#endif
+
+#include "device/dcd.h"
+#include "host/hcd.h"
+#include "host/usbh.h"
+#include "loopback.h"
+
+//--------------------------------------------------------------------+
+// MACRO TYPEDEF CONSTANT ENUM DECLARATION
+//--------------------------------------------------------------------+
+#define LOOPBACK_EP_MAX       16
+#define LOOPBACK_ISO_XFER_MAX 4
+
+// Bytes added to payload by token, data and handshake packets of a transaction (sync, PID, address, CRC, EOP)
+#define LOOPBACK_XACT_OVERHEAD 12
+
+typedef struct {
+  uint8_t* buf;
+  tu_fifo_t* ff;
+  uint16_t len;
+  uint16_t actual;
+  bool busy;
+} lb_xfer_t;
+
+typedef struct {
+  lb_xfer_t xfer;
+  uint16_t mps;
+  bool opened;
+  bool stalled;
+} lb_dcd_edpt_t;
+
+typedef struct {
+  lb_xfer_t xfer;
+  uint8_t daddr;
+  uint8_t type;        // tusb_xfer_type_t
+  bool setup;          // xfer is the SETUP packet in _lb.setup_pkt
+  uint32_t interval;   // service interval of periodic endpoint in (micro)frames
+  uint32_t next_frame; // (micro)frame when periodic endpoint is due
+
+#if CFG_TUH_ISO_XFER
+  tuh_iso_xfer_t* iso[LOOPBACK_ISO_XFER_MAX]; // queued isochronous transfers, oldest first
+  uint8_t iso_count;
+  uint16_t iso_packet;                        // next packet of oldest transfer
+  uint32_t iso_offset;                        // buffer offset of next packet
+#endif
+} lb_hcd_edpt_t;
+
+typedef struct {
+  uint8_t hrhport;
+  uint8_t drhport;
+  bool host_active;
+  bool host_int_en;
+  bool dev_active;
+  bool connected; // device pull-up is enabled
+  bool in_reset;
+  bool sof_en;
+
+  tusb_speed_t host_speed; // max speed of host and device
+  tusb_speed_t dev_speed;
+  tusb_speed_t speed;      // negotiated bus speed
+
+  uint8_t addr;
+  uint8_t new_addr;        // SET_ADDRESS takes effect after status stage
+  bool addr_pending;
+
+  uint8_t setup_pkt[8];
+
+  uint32_t frame;          // (micro)frame count
+  uint32_t frame_used_ns;  // bus time used in current (micro)frame
+  uint64_t time_ns;
+  uint32_t latency_ns;
+
+  lb_dcd_edpt_t dep[LOOPBACK_EP_MAX][2];
+  lb_hcd_edpt_t hep[LOOPBACK_EP_MAX][2];
+} loopback_bus_t;
+
+static loopback_bus_t _lb = {
+  .latency_ns = CFG_TUSB_LOOPBACK_LATENCY_NS
+};
+
+//--------------------------------------------------------------------+
+// Bus
+//--------------------------------------------------------------------+
+static uint8_t speed_rank(tusb_speed_t speed) {
+  switch (speed) {
+    case TUSB_SPEED_LOW:
+      return 0;
+    case TUSB_SPEED_FULL:
+      return 1;
+    default:
+      return 2; // high or auto
+  }
+}
+
+static tusb_speed_t bus_speed_negotiate(void) {
+  tusb_speed_t const speed = speed_rank(_lb.dev_speed) < speed_rank(_lb.host_speed) ? _lb.dev_speed : _lb.host_speed;
+  return (speed == TUSB_SPEED_AUTO) ? TUSB_SPEED_HIGH : speed;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline uint32_t frame_len_ns(void) {
+  return (_lb.speed == TUSB_SPEED_HIGH) ? 125000u : 1000000u;
+}
+
+// Claim bus time of a transaction with n data bytes, false if it does not fit into current frame
+static bool bus_claim(uint16_t n) {
+  uint32_t const bits = 8u * ((uint32_t) n + LOOPBACK_XACT_OVERHEAD);
+  uint32_t ns;
+  switch (_lb.speed) {
+    case TUSB_SPEED_HIGH:
+      ns = bits * 25u / 12u; // 480 Mbps
+      break;
+    case TUSB_SPEED_LOW:
+      ns = bits * 2000u / 3u; // 1.5 Mbps
+      break;
+    default:
+      ns = bits * 250u / 3u; // 12 Mbps
+      break;
+  }
+  ns += _lb.latency_ns;
+
+  // a transaction that does not fit into an empty frame overruns into the next ones
+  if (_lb.frame_used_ns != 0 && _lb.frame_used_ns + ns > frame_len_ns()) {
+    return false;
+  }
+  _lb.frame_used_ns += ns;
+  return true;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline bool dev_link_up(void) {
+  return _lb.dev_active && _lb.connected && !_lb.in_reset;
+}
+
+TU_ATTR_ALWAYS_INLINE static inline bool dev_present(uint8_t daddr) {
+  return dev_link_up() && daddr == _lb.addr;
+}
+
+// Move n bytes between device transfer and host buffer
+static void dev_xfer_copy(lb_xfer_t* dx, uint8_t* hbuf, uint16_t n, bool to_host) {
+  if (n == 0) {
+    return;
+  }
+  if (dx->ff != NULL) {
+    if (to_host) {
+      (void) tu_fifo_read_n(dx->ff, hbuf, n);
+    } else {
+      (void) tu_fifo_write_n(dx->ff, hbuf, n);
+    }
+  } else {
+    if (to_host) {
+      memcpy(hbuf, dx->buf + dx->actual, n);
+    } else {
+      memcpy(dx->buf + dx->actual, hbuf, n);
+    }
+  }
+  dx->actual += n;
+}
+
+static void dev_xfer_complete(uint8_t ep_addr, bool in_isr) {
+  lb_xfer_t* dx = &_lb.dep[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)].xfer;
+  dx->busy = false;
+
+  if (ep_addr == TU_EP0_IN && _lb.addr_pending) {
+    // status stage of SET_ADDRESS
+    _lb.addr = _lb.new_addr;
+    _lb.addr_pending = false;
+  }
+
+  dcd_event_xfer_complete(_lb.drhport, ep_addr, dx->actual, XFER_RESULT_SUCCESS, in_isr);
+}
+
+static void host_event_xfer_complete(uint8_t daddr, uint8_t ep_addr, uint32_t len, xfer_result_t result, bool in_isr) {
+  hcd_event_t event = {
+    .rhport   = _lb.hrhport,
+    .event_id = HCD_EVENT_XFER_COMPLETE,
+    .dev_addr = daddr,
+  };
+  event.xfer_complete.ep_addr = ep_addr;
+  event.xfer_complete.result  = result;
+  event.xfer_complete.len     = len;
+  hcd_event_handler(&event, in_isr);
+}
+
+static void host_xfer_complete(uint8_t ep_addr, xfer_result_t result, bool in_isr) {
+  lb_hcd_edpt_t* hep = &_lb.hep[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)];
+  // clear before notifying since endpoint can be re-armed from event handler
+  hep->xfer.busy = false;
+  hep->setup = false;
+  host_event_xfer_complete(hep->daddr, ep_addr, hep->xfer.actual, result, in_isr);
+}
+
+// Run one transaction of host endpoint. Return true if bus time is used, false if endpoint is idle, NAKed or frame
+// has no room for it.
+static bool host_xact(uint8_t epnum, uint8_t dir, bool in_isr) {
+  lb_hcd_edpt_t* hep = &_lb.hep[epnum][dir];
+  lb_xfer_t* hx = &hep->xfer;
+  if (!hx->busy) {
+    return false;
+  }
+
+  uint8_t const ep_addr = tu_edpt_addr(epnum, dir);
+  bool const present = dev_present(hep->daddr);
+
+  if (hep->setup) {
+    TU_VERIFY(bus_claim(8));
+    if (present) {
+      // SETUP is always accepted: it clears EP0 stall and cancels previous control transfer
+      for (uint8_t d = 0; d < 2; d++) {
+        _lb.dep[0][d].stalled = false;
+        _lb.dep[0][d].xfer.busy = false;
+      }
+      hx->actual = 8;
+      dcd_event_setup_received(_lb.drhport, _lb.setup_pkt, in_isr);
+    }
+    host_xfer_complete(ep_addr, present ? XFER_RESULT_SUCCESS : XFER_RESULT_FAILED, in_isr);
+    return true;
+  }
+
+  lb_dcd_edpt_t* dep = &_lb.dep[epnum][dir];
+  lb_xfer_t* dx = &dep->xfer;
+
+  if (!present || !dep->opened || dep->stalled) {
+    // no response (timeout) or STALL handshake
+    TU_VERIFY(bus_claim(0));
+    host_xfer_complete(ep_addr, (present && dep->opened) ? XFER_RESULT_STALLED : XFER_RESULT_FAILED, in_isr);
+    return true;
+  }
+
+  if (!dx->busy) {
+    return false; // NAK
+  }
+
+  bool const is_iso = (hep->type == TUSB_XFER_ISOCHRONOUS);
+  bool host_done;
+  bool dev_done;
+
+  if (dir == TUSB_DIR_IN) {
+    uint16_t const n = tu_min16(dep->mps, (uint16_t) (dx->len - dx->actual));
+    TU_VERIFY(bus_claim(n));
+    if (n > hx->len - hx->actual) {
+      // babble: packet is larger than remaining host buffer
+      host_xfer_complete(ep_addr, XFER_RESULT_FAILED, in_isr);
+      return true;
+    }
+    dev_xfer_copy(dx, hx->buf + hx->actual, n, true);
+    hx->actual += n;
+    dev_done  = is_iso || (dx->actual == dx->len);
+    host_done = (n < dep->mps) || (hx->actual == hx->len);
+  } else {
+    uint16_t const n = tu_min16(dep->mps, (uint16_t) (hx->len - hx->actual));
+    TU_VERIFY(bus_claim(n));
+    // data exceeding device buffer is dropped
+    dev_xfer_copy(dx, hx->buf + hx->actual, tu_min16(n, (uint16_t) (dx->len - dx->actual)), false);
+    hx->actual += n;
+    dev_done  = is_iso || (n < dep->mps) || (dx->actual == dx->len);
+    host_done = (hx->actual == hx->len);
+  }
+
+  if (dev_done) {
+    dev_xfer_complete(ep_addr, in_isr);
+  }
+  if (host_done) {
+    host_xfer_complete(ep_addr, XFER_RESULT_SUCCESS, in_isr);
+  }
+
+  return true;
+}
+
+#if CFG_TUH_ISO_XFER
+// Run next packet of queued isochronous transfer, packet is sent/received in its frame whether device is armed or not
+static bool host_iso_xact(uint8_t epnum, uint8_t dir, bool in_isr) {
+  lb_hcd_edpt_t* hep = &_lb.hep[epnum][dir];
+  if (hep->iso_count == 0) {
+    return false;
+  }
+
+  tuh_iso_xfer_t* xfer = hep->iso[0];
+  if (hep->iso_packet == 0) {
+    uint32_t const fnum = (uint32_t) (_lb.time_ns / 1000000u);
+    if (xfer->start_frame != TUH_ISO_START_ASAP && (int32_t) (xfer->start_frame - fnum) > 0) {
+      return false;
+    }
+    xfer->start_frame = fnum;
+  }
+
+  tuh_iso_packet_t* pkt = &xfer->packets[hep->iso_packet];
+  uint8_t* buf = xfer->buffer + hep->iso_offset;
+  lb_dcd_edpt_t* dep = &_lb.dep[epnum][dir];
+  lb_xfer_t* dx = &dep->xfer;
+  bool const present = dev_present(xfer->daddr) && dep->opened;
+  bool const armed = present && dx->busy;
+
+  if (dir == TUSB_DIR_IN) {
+    uint16_t const n = armed ? tu_min16(dep->mps, (uint16_t) (dx->len - dx->actual)) : 0;
+    TU_VERIFY(bus_claim(n));
+    pkt->actual_len = tu_min16(n, pkt->length);
+    if (armed) {
+      dev_xfer_copy(dx, buf, pkt->actual_len, true);
+    }
+  } else {
+    TU_VERIFY(bus_claim(pkt->length));
+    pkt->actual_len = pkt->length;
+    if (armed) {
+      dev_xfer_copy(dx, buf, tu_min16(pkt->length, (uint16_t) (dx->len - dx->actual)), false);
+    }
+  }
+  pkt->result = present ? XFER_RESULT_SUCCESS : XFER_RESULT_FAILED;
+
+  if (armed) {
+    dev_xfer_complete(tu_edpt_addr(epnum, dir), in_isr);
+  }
+
+  hep->iso_offset += pkt->length;
+  hep->iso_packet++;
+  if (hep->iso_packet == xfer->num_packets) {
+    hep->iso_count--;
+    memmove(&hep->iso[0], &hep->iso[1], hep->iso_count * sizeof(hep->iso[0]));
+    hep->iso_packet = 0;
+    hep->iso_offset = 0;
+    host_event_xfer_complete(xfer->daddr, tu_edpt_addr(epnum, dir), 0, XFER_RESULT_SUCCESS, in_isr);
+  }
+
+  return true;
+}
+#endif
+
+// Run one (micro)frame of bus time
+static void bus_run_frame(bool in_isr) {
+  uint32_t const frame_ns = frame_len_ns();
+  _lb.frame_used_ns = (_lb.frame_used_ns > frame_ns) ? (_lb.frame_used_ns - frame_ns) : 0;
+
+  if (_lb.sof_en && dev_link_up()) {
+    dcd_event_sof(_lb.drhport, (uint32_t) (_lb.time_ns / 1000000u) & 0x7ffu, in_isr);
+  }
+
+  // periodic endpoints are scheduled first, one transaction per service interval
+  for (uint8_t epnum = 1; epnum < LOOPBACK_EP_MAX; epnum++) {
+    for (uint8_t dir = 0; dir < 2; dir++) {
+      lb_hcd_edpt_t* hep = &_lb.hep[epnum][dir];
+      if ((hep->type != TUSB_XFER_INTERRUPT && hep->type != TUSB_XFER_ISOCHRONOUS) ||
+          (int32_t) (_lb.frame - hep->next_frame) < 0) {
+        continue;
+      }
+
+      bool xact;
+    #if CFG_TUH_ISO_XFER
+      if (hep->type == TUSB_XFER_ISOCHRONOUS) {
+        xact = host_iso_xact(epnum, dir, in_isr);
+      } else
+    #endif
+      {
+        xact = host_xact(epnum, dir, in_isr);
+      }
+
+      if (xact) {
+        hep->next_frame = _lb.frame + hep->interval;
+      }
+    }
+  }
+
+  // control and bulk endpoints share the rest of frame round-robin
+  bool progress;
+  do {
+    progress = false;
+    for (uint8_t epnum = 0; epnum < LOOPBACK_EP_MAX; epnum++) {
+      for (uint8_t dir = 0; dir < 2; dir++) {
+        uint8_t const type = _lb.hep[epnum][dir].type;
+        if ((type == TUSB_XFER_CONTROL || type == TUSB_XFER_BULK) && host_xact(epnum, dir, in_isr)) {
+          progress = true;
+        }
+      }
+    }
+  } while (progress);
+
+  _lb.frame++;
+  _lb.time_ns += frame_ns;
+}
+
+// Device reset by bus reset or disconnect: address and non-control endpoints are cleared
+static void dev_bus_reset(void) {
+  _lb.addr = 0;
+  _lb.addr_pending = false;
+  for (uint8_t epnum = 0; epnum < LOOPBACK_EP_MAX; epnum++) {
+    for (uint8_t dir = 0; dir < 2; dir++) {
+      lb_dcd_edpt_t* dep = &_lb.dep[epnum][dir];
+      if (epnum == 0) {
+        dep->stalled = false;
+        dep->xfer.busy = false;
+      } else {
+        tu_memclr(dep, sizeof(lb_dcd_edpt_t));
+      }
+    }
+  }
+}
+
+//--------------------------------------------------------------------+
+// Application API
+//--------------------------------------------------------------------+
+void loopback_latency_set(uint32_t latency_ns) {
+  _lb.latency_ns = latency_ns;
+}
+
+uint64_t loopback_time_us(void) {
+  return _lb.time_ns / 1000u;
+}
+
+//--------------------------------------------------------------------+
+// Device Controller API
+//--------------------------------------------------------------------+
+bool dcd_init(uint8_t rhport, const tusb_rhport_init_t* rh_init) {
+  _lb.drhport = rhport;
+  _lb.dev_speed = rh_init->speed;
+  _lb.dev_active = true;
+  _lb.sof_en = false;
+
+  tu_memclr(_lb.dep, sizeof(_lb.dep));
+  for (uint8_t dir = 0; dir < 2; dir++) {
+    _lb.dep[0][dir].mps = CFG_TUD_ENDPOINT0_SIZE;
+    _lb.dep[0][dir].opened = true;
+  }
+  dev_bus_reset();
+
+  dcd_connect(rhport);
+  return true;
+}
+
+bool dcd_deinit(uint8_t rhport) {
+  dcd_disconnect(rhport);
+  _lb.dev_active = false;
+  return true;
+}
+
+// Bus is driven by host controller, see hcd_int_handler()
+void dcd_int_handler(uint8_t rhport) {
+  (void) rhport;
+}
+
+void dcd_int_enable(uint8_t rhport) {
+  (void) rhport;
+}
+
+void dcd_int_disable(uint8_t rhport) {
+  (void) rhport;
+}
+
+void dcd_set_address(uint8_t rhport, uint8_t dev_addr) {
+  _lb.new_addr = dev_addr;
+  _lb.addr_pending = true;
+
+  // response with status
+  (void) dcd_edpt_xfer(rhport, TU_EP0_IN, NULL, 0, false);
+}
+
+// Suspend/resume is not modeled
+void dcd_remote_wakeup(uint8_t rhport) {
+  (void) rhport;
+}
+
+void dcd_connect(uint8_t rhport) {
+  (void) rhport;
+  if (_lb.connected) {
+    return;
+  }
+  _lb.connected = true;
+  if (_lb.host_active) {
+    _lb.speed = bus_speed_negotiate();
+    hcd_event_device_attach(_lb.hrhport, false);
+  }
+}
+
+void dcd_disconnect(uint8_t rhport) {
+  (void) rhport;
+  if (!_lb.connected) {
+    return;
+  }
+  _lb.connected = false;
+  dev_bus_reset();
+  if (_lb.host_active) {
+    hcd_event_device_remove(_lb.hrhport, false);
+  }
+}
+
+void dcd_sof_enable(uint8_t rhport, bool en) {
+  (void) rhport;
+  _lb.sof_en = en;
+}
+
+#if CFG_TUD_TEST_MODE
+void dcd_enter_test_mode(uint8_t rhport, tusb_feature_test_mode_t test_selector) {
+  (void) rhport;
+  (void) test_selector;
+}
+#endif
+
+//--------------------------------------------------------------------+
+// Device Endpoint API
+//--------------------------------------------------------------------+
+bool dcd_edpt_open(uint8_t rhport, tusb_desc_endpoint_t const* desc_ep) {
+  (void) rhport;
+  uint8_t const epnum = tu_edpt_number(desc_ep->bEndpointAddress);
+  TU_ASSERT(epnum < LOOPBACK_EP_MAX);
+
+  lb_dcd_edpt_t* dep = &_lb.dep[epnum][tu_edpt_dir(desc_ep->bEndpointAddress)];
+  tu_memclr(dep, sizeof(lb_dcd_edpt_t));
+  dep->mps = tu_edpt_packet_size(desc_ep);
+  dep->opened = true;
+  return true;
+}
+
+// There is no packet buffer to allocate
+bool dcd_edpt_iso_alloc(uint8_t rhport, uint8_t ep_addr, uint16_t largest_packet_size) {
+  (void) rhport;
+  (void) largest_packet_size;
+  TU_ASSERT(tu_edpt_number(ep_addr) < LOOPBACK_EP_MAX);
+  return true;
+}
+
+bool dcd_edpt_iso_activate(uint8_t rhport, tusb_desc_endpoint_t const* desc_ep) {
+  return dcd_edpt_open(rhport, desc_ep);
+}
+
+void dcd_edpt_close_all(uint8_t rhport) {
+  (void) rhport;
+  tu_memclr(&_lb.dep[1], sizeof(_lb.dep) - sizeof(_lb.dep[0]));
+}
+
+bool dcd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t* buffer, uint16_t total_bytes, bool is_isr) {
+  (void) rhport;
+  (void) is_isr;
+  lb_dcd_edpt_t* dep = &_lb.dep[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)];
+  TU_VERIFY(dep->opened);
+
+  dep->xfer.buf = buffer;
+  dep->xfer.ff = NULL;
+  dep->xfer.len = total_bytes;
+  dep->xfer.actual = 0;
+  dep->xfer.busy = true;
+  return true;
+}
+
+bool dcd_edpt_xfer_fifo(uint8_t rhport, uint8_t ep_addr, tu_fifo_t* ff, uint16_t total_bytes, bool is_isr) {
+  TU_VERIFY(dcd_edpt_xfer(rhport, ep_addr, NULL, total_bytes, is_isr));
+  _lb.dep[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)].xfer.ff = ff;
+  return true;
+}
+
+void dcd_edpt_stall(uint8_t rhport, uint8_t ep_addr) {
+  (void) rhport;
+  lb_dcd_edpt_t* dep = &_lb.dep[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)];
+  dep->stalled = true;
+  dep->xfer.busy = false;
+}
+
+void dcd_edpt_clear_stall(uint8_t rhport, uint8_t ep_addr) {
+  (void) rhport;
+  _lb.dep[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)].stalled = false;
+}
+
+//--------------------------------------------------------------------+
+// Host Controller API
+//--------------------------------------------------------------------+
+bool hcd_init(uint8_t rhport, const tusb_rhport_init_t* rh_init) {
+  _lb.hrhport = rhport;
+  _lb.host_speed = rh_init->speed;
+  _lb.host_active = true;
+  _lb.frame = 0;
+  _lb.time_ns = 0;
+  tu_memclr(_lb.hep, sizeof(_lb.hep));
+
+  // device is already connected
+  if (_lb.connected) {
+    _lb.speed = bus_speed_negotiate();
+    hcd_event_device_attach(rhport, false);
+  }
+  return true;
+}
+
+bool hcd_deinit(uint8_t rhport) {
+  (void) rhport;
+  _lb.host_active = false;
+  _lb.host_int_en = false;
+  tu_memclr(_lb.hep, sizeof(_lb.hep));
+  return true;
+}
+
+// Each call runs one (micro)frame of the bus
+void hcd_int_handler(uint8_t rhport, bool in_isr) {
+  (void) rhport;
+  if (_lb.host_active && _lb.host_int_en) {
+    bus_run_frame(in_isr);
+  }
+}
+
+void hcd_int_enable(uint8_t rhport) {
+  (void) rhport;
+  _lb.host_int_en = true;
+}
+
+void hcd_int_disable(uint8_t rhport) {
+  (void) rhport;
+  _lb.host_int_en = false;
+}
+
+uint32_t hcd_frame_number(uint8_t rhport) {
+  (void) rhport;
+  return (uint32_t) (_lb.time_ns / 1000000u);
+}
+
+//--------------------------------------------------------------------+
+// Host Port API
+//--------------------------------------------------------------------+
+bool hcd_port_connect_status(uint8_t rhport) {
+  (void) rhport;
+  return _lb.dev_active && _lb.connected;
+}
+
+void hcd_port_reset(uint8_t rhport) {
+  (void) rhport;
+  if (!hcd_port_connect_status(rhport)) {
+    return;
+  }
+  _lb.in_reset = true;
+  _lb.speed = bus_speed_negotiate();
+  dev_bus_reset();
+  dcd_event_bus_signal(_lb.drhport, DCD_EVENT_BUS_RESET_START, false);
+}
+
+void hcd_port_reset_end(uint8_t rhport) {
+  (void) rhport;
+  if (!_lb.in_reset) {
+    return;
+  }
+  _lb.in_reset = false;
+  if (hcd_port_connect_status(rhport)) {
+    dcd_event_bus_reset(_lb.drhport, _lb.speed, false);
+  }
+}
+
+tusb_speed_t hcd_port_speed_get(uint8_t rhport) {
+  (void) rhport;
+  return _lb.speed;
+}
+
+void hcd_device_close(uint8_t rhport, uint8_t dev_addr) {
+  (void) rhport;
+  for (uint8_t epnum = 0; epnum < LOOPBACK_EP_MAX; epnum++) {
+    for (uint8_t dir = 0; dir < 2; dir++) {
+      if (_lb.hep[epnum][dir].daddr == dev_addr) {
+        tu_memclr(&_lb.hep[epnum][dir], sizeof(lb_hcd_edpt_t));
+      }
+    }
+  }
+}
+
+//--------------------------------------------------------------------+
+// Host Endpoints API
+//--------------------------------------------------------------------+
+bool hcd_edpt_open(uint8_t rhport, uint8_t daddr, tusb_desc_endpoint_t const* ep_desc) {
+  (void) rhport;
+  uint8_t const epnum = tu_edpt_number(ep_desc->bEndpointAddress);
+  TU_ASSERT(epnum < LOOPBACK_EP_MAX);
+
+  uint8_t const type = ep_desc->bmAttributes.xfer;
+  uint8_t const binterval = tu_max8(ep_desc->bInterval, 1);
+
+  lb_hcd_edpt_t* hep = &_lb.hep[epnum][tu_edpt_dir(ep_desc->bEndpointAddress)];
+  hep->daddr = daddr;
+  hep->type = type;
+  if (_lb.speed == TUSB_SPEED_HIGH || type == TUSB_XFER_ISOCHRONOUS) {
+    hep->interval = 1u << (tu_min8(binterval, 16) - 1);
+  } else {
+    hep->interval = binterval;
+  }
+  hep->next_frame = _lb.frame;
+
+  if (epnum == 0) {
+    // both directions of control endpoint
+    _lb.hep[0][1 - tu_edpt_dir(ep_desc->bEndpointAddress)].daddr = daddr;
+  }
+  return true;
+}
+
+bool hcd_edpt_close(uint8_t rhport, uint8_t daddr, uint8_t ep_addr) {
+  (void) rhport;
+  lb_hcd_edpt_t* hep = &_lb.hep[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)];
+  TU_VERIFY(hep->daddr == daddr);
+  tu_memclr(hep, sizeof(lb_hcd_edpt_t));
+  return true;
+}
+
+bool hcd_edpt_xfer(uint8_t rhport, uint8_t daddr, uint8_t ep_addr, uint8_t* buffer, uint16_t buflen) {
+  (void) rhport;
+  lb_hcd_edpt_t* hep = &_lb.hep[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)];
+  TU_VERIFY(!hep->xfer.busy);
+
+  hep->daddr = daddr;
+  hep->setup = false;
+  hep->xfer.buf = buffer;
+  hep->xfer.len = buflen;
+  hep->xfer.actual = 0;
+  hep->xfer.busy = true;
+  return true;
+}
+
+#if CFG_TUH_ISO_XFER
+bool hcd_edpt_iso_xfer(uint8_t rhport, uint8_t daddr, uint8_t ep_addr, struct tuh_iso_xfer_s* xfer) {
+  (void) rhport;
+  lb_hcd_edpt_t* hep = &_lb.hep[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)];
+  TU_VERIFY(hep->daddr == daddr && hep->type == TUSB_XFER_ISOCHRONOUS);
+  TU_VERIFY(hep->iso_count < LOOPBACK_ISO_XFER_MAX);
+
+  hep->iso[hep->iso_count++] = xfer;
+  return true;
+}
+#endif
+
+bool hcd_edpt_abort_xfer(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr) {
+  (void) rhport;
+  lb_hcd_edpt_t* hep = &_lb.hep[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)];
+  TU_VERIFY(hep->daddr == dev_addr);
+
+  bool aborted = hep->xfer.busy;
+  hep->xfer.busy = false;
+  hep->setup = false;
+
+#if CFG_TUH_ISO_XFER
+  aborted = aborted || (hep->iso_count > 0);
+  hep->iso_count = 0;
+  hep->iso_packet = 0;
+  hep->iso_offset = 0;
+#endif
+
+  return aborted;
+}
+
+bool hcd_setup_send(uint8_t rhport, uint8_t daddr, uint8_t const setup_packet[8]) {
+  (void) rhport;
+  lb_hcd_edpt_t* hep = &_lb.hep[0][TUSB_DIR_OUT];
+
+  memcpy(_lb.setup_pkt, setup_packet, 8);
+  hep->daddr = daddr;
+  hep->setup = true;
+  hep->xfer.buf = _lb.setup_pkt;
+  hep->xfer.len = 8;
+  hep->xfer.actual = 0;
+  hep->xfer.busy = true;
+  return true;
+}
+
+// Data toggle is not modeled, stall is cleared on device side by CLEAR_FEATURE request
+bool hcd_edpt_clear_stall(uint8_t rhport, uint8_t dev_addr, uint8_t ep_addr) {
+  (void) rhport;
+  (void) dev_addr;
+  (void) ep_addr;
+  return true;
+}
+
+#endif
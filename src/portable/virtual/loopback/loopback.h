@@ -0,0 +1,48 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2019 Ha Thach (tinyusb.org)
+ * SPDX-License-Identifier: MIT
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#ifndef TUSB_LOOPBACK_H_
+#define TUSB_LOOPBACK_H_
+
+#include "common/tusb_common.h"
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+//--------------------------------------------------------------------+
+// Loopback virtual bus (CFG_TUSB_MCU = OPT_MCU_LOOPBACK)
+//
+// Software only port implementing both dcd.h and hcd.h: the host stack on one rhport is wired to the device stack
+// on the other rhport of the same process, e.g to run class regression tests and throughput benchmarks without
+// hardware:
+// - Bus speed is the lower of the speeds passed to tusb_rhport_init() of the host and device rhport.
+// - Each tusb_int_handler() call on the host rhport runs one frame (1ms) or microframe (125us for highspeed) of bus
+//   time. Periodic endpoints are serviced first (at most once per interval), control and bulk endpoints share the
+//   rest of frame round-robin. Each transaction costs its bit time plus a configurable latency.
+// - Bus time is virtual and only advances with tusb_int_handler(), which should be called from the same thread as
+//   tud_task() and tuh_task(). Call it on a 1ms timer for real-time pacing, or as fast as possible for benchmarks
+//   and measure with loopback_time_us().
+// - NAK, suspend/resume and data toggle are not modeled.
+//--------------------------------------------------------------------+
+
+// Default latency of every transaction in nanoseconds, e.g inter-packet delay and device response time
+#ifndef CFG_TUSB_LOOPBACK_LATENCY_NS
+  #define CFG_TUSB_LOOPBACK_LATENCY_NS 0
+#endif
+
+// Change transaction latency at runtime
+void loopback_latency_set(uint32_t latency_ns);
+
+// Virtual bus time in microseconds since host controller is initialized
+uint64_t loopback_time_us(void);
+
+#ifdef __cplusplus
+ }
+#endif
+
+#endif
@@ -0,0 +1,820 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2019 Ha Thach (tinyusb.org)
+ * SPDX-License-Identifier: MIT
+ *
+ * This file is part of the TinyUSB stack.
+ */
+
+#include "tusb_option.h"
+
+#if CFG_TUD_ENABLED && CFG_TUSB_MCU == OPT_MCU_USBIP
+
+// USB/IP server: device stack is exported over TCP and attached by the usbip client of a (Linux) host, e.g
+//   usbip attach -r 127.0.0.1 -b 1-1
+// The socket is polled by dcd_int_handler(), which should be called from the same thread as tud_task(). Each URB
+// is mapped onto transfers of the device stack: control URB is SETUP + data + status stage, bulk/interrupt URB is
+// completed on short packet or full buffer, isochronous URB takes one device transfer per packet.
+// URBs are buffered on heap since the number in flight is only bounded by the client. SOF and suspend/resume are
+// not generated.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "device/dcd.h"
+#include "device/usbd.h"
+
+//--------------------------------------------------------------------+
+// MACRO TYPEDEF CONSTANT ENUM DECLARATION
+//--------------------------------------------------------------------+
+#define USBIP_VERSION        0x0111u
+
+#define USBIP_OP_REQ_DEVLIST 0x8005u
+#define USBIP_OP_REP_DEVLIST 0x0005u
+#define USBIP_OP_REQ_IMPORT  0x8003u
+#define USBIP_OP_REP_IMPORT  0x0003u
+
+#define USBIP_CMD_SUBMIT     1u
+#define USBIP_CMD_UNLINK     2u
+#define USBIP_RET_SUBMIT     3u
+#define USBIP_RET_UNLINK     4u
+
+#define USBIP_DIR_IN         1u
+#define USBIP_URB_ZERO_PACKET 0x0040u
+
+#define USBIP_HDR_SIZE       48u
+#define USBIP_ISO_DESC_SIZE  16u
+#define USBIP_BUSNUM         1u
+#define USBIP_DEVNUM         2u
+
+#define USBIP_EP_MAX         16u
+
+enum {
+  RX_OP_HDR = 0,  // waiting for operation request, before import
+  RX_OP_BUSID,    // busid of import request
+  RX_CMD_HDR,     // waiting for URB command, after import
+  RX_CMD_DATA,    // OUT data of submitted URB
+  RX_CMD_ISO,     // isochronous packet descriptors of submitted URB
+};
+
+// same layout as usbip_iso_packet_descriptor, converted in place after receiving
+typedef struct {
+  uint32_t offset;
+  uint32_t length;
+  uint32_t actual;
+  uint32_t status;
+} usbip_iso_packet_t;
+
+typedef struct usbip_urb_s {
+  struct usbip_urb_s* next; // next URB on the same endpoint
+  uint32_t seqnum;
+  uint32_t flags;
+  uint32_t len;
+  uint32_t actual;
+  uint32_t num_packets;     // as sent by client, 0 or 0xffffffff for non-isochronous
+  uint32_t iso_count;
+  uint32_t iso_index;       // next isochronous packet
+  usbip_iso_packet_t* iso;  // located after buf
+  uint8_t ep_addr;
+  bool setup_sent;
+  uint8_t setup[8];
+  TU_ATTR_ALIGNED(4) uint8_t buf[];
+} usbip_urb_t;
+
+typedef struct {
+  uint8_t* buf;
+  tu_fifo_t* ff;
+  uint16_t len;
+  uint16_t actual;
+  uint16_t mps;
+  uint8_t type;
+  bool busy;
+  bool opened;
+  bool stalled;
+} usbip_edpt_t;
+
+typedef struct {
+  uint8_t rhport;
+  tusb_speed_t speed;
+  int listen_fd;
+  int fd;
+  bool imported;
+  uint8_t cfg_num;
+
+  // receive state
+  uint8_t rx_state;
+  uint8_t rx_hdr[USBIP_HDR_SIZE];
+  uint8_t* rx_ptr;
+  uint32_t rx_need;
+  uint32_t rx_count;
+  usbip_urb_t* rx_urb;
+
+  usbip_edpt_t edpt[USBIP_EP_MAX][2];
+  usbip_urb_t* urb_head[USBIP_EP_MAX][2]; // oldest URB of endpoint, control URBs are queued on EP0 OUT
+} usbip_data_t;
+
+static usbip_data_t _usbip = {
+  .listen_fd = -1,
+  .fd = -1
+};
+
+//--------------------------------------------------------------------+
+// Socket
+//--------------------------------------------------------------------+
+TU_ATTR_ALWAYS_INLINE static inline void put_u32(uint8_t* buf, uint32_t value) {
+  tu_unaligned_write32(buf, tu_htonl(value));
+}
+
+TU_ATTR_ALWAYS_INLINE static inline void put_u16(uint8_t* buf, uint16_t value) {
+  tu_unaligned_write16(buf, tu_htons(value));
+}
+
+TU_ATTR_ALWAYS_INLINE static inline uint32_t get_u32(const uint8_t* buf) {
+  return tu_ntohl(tu_unaligned_read32(buf));
+}
+
+TU_ATTR_ALWAYS_INLINE static inline uint16_t get_u16(const uint8_t* buf) {
+  return tu_ntohs(tu_unaligned_read16(buf));
+}
+
+static bool sock_send(const void* data, size_t len) {
+  const uint8_t* p = (const uint8_t*) data;
+  while (len > 0) {
+    ssize_t const n = send(_usbip.fd, p, len, MSG_NOSIGNAL);
+    if (n < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+        continue; // client is slow to read, wait for socket buffer
+      }
+      return false;
+    }
+    p += n;
+    len -= (size_t) n;
+  }
+  return true;
+}
+
+static bool sock_listen(void) {
+  int const fd = socket(AF_INET, SOCK_STREAM, 0);
+  TU_ASSERT(fd >= 0);
+
+  int const one = 1;
+  (void) setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+  struct sockaddr_in addr;
+  tu_memclr(&addr, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = tu_htons(CFG_TUD_USBIP_PORT);
+  addr.sin_addr.s_addr = inet_addr(CFG_TUD_USBIP_BIND_ADDR);
+
+  if (bind(fd, (struct sockaddr*) &addr, sizeof(addr)) != 0 || listen(fd, 1) != 0) {
+    TU_LOG1("USBIP: failed to listen on port %u, errno = %d\r\n", CFG_TUD_USBIP_PORT, errno);
+    close(fd);
+    return false;
+  }
+  (void) fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+  _usbip.listen_fd = fd;
+  return true;
+}
+
+static void rx_expect(uint8_t state, void* dst, uint32_t len) {
+  _usbip.rx_state = state;
+  _usbip.rx_ptr = (uint8_t*) dst;
+  _usbip.rx_need = len;
+  _usbip.rx_count = 0;
+}
+
+// Receive pending bytes of current expectation. Return 1 if complete, 0 if more is needed, -1 if connection is closed
+static int rx_fill(void) {
+  while (_usbip.rx_count < _usbip.rx_need) {
+    ssize_t const n = recv(_usbip.fd, _usbip.rx_ptr + _usbip.rx_count, _usbip.rx_need - _usbip.rx_count, MSG_DONTWAIT);
+    if (n == 0) {
+      return -1;
+    }
+    if (n < 0) {
+      return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -1;
+    }
+    _usbip.rx_count += (uint32_t) n;
+  }
+  return 1;
+}
+
+//--------------------------------------------------------------------+
+// URB
+//--------------------------------------------------------------------+
+TU_ATTR_ALWAYS_INLINE static inline usbip_urb_t** urb_head_ptr(uint8_t ep_addr) {
+  uint8_t const epnum = tu_edpt_number(ep_addr);
+  return &_usbip.urb_head[epnum][epnum ? tu_edpt_dir(ep_addr) : TUSB_DIR_OUT];
+}
+
+TU_ATTR_ALWAYS_INLINE static inline usbip_urb_t* urb_head(uint8_t ep_addr) {
+  return *urb_head_ptr(ep_addr);
+}
+
+static usbip_urb_t* urb_alloc(uint32_t len, uint32_t iso_count) {
+  uint32_t const buf_size = tu_div_ceil(len, 4) * 4;
+  usbip_urb_t* urb = (usbip_urb_t*) malloc(sizeof(usbip_urb_t) + buf_size + iso_count * sizeof(usbip_iso_packet_t));
+  TU_VERIFY(urb, NULL);
+  tu_memclr(urb, sizeof(usbip_urb_t));
+  urb->len = len;
+  urb->iso_count = iso_count;
+  urb->iso = (usbip_iso_packet_t*) (uintptr_t) (urb->buf + buf_size);
+  return urb;
+}
+
+static void urb_enqueue(usbip_urb_t* urb) {
+  usbip_urb_t** p_urb = urb_head_ptr(urb->ep_addr);
+  while (*p_urb != NULL) {
+    p_urb = &(*p_urb)->next;
+  }
+  *p_urb = urb;
+}
+
+// Remove URB from its endpoint queue and free it
+static void urb_remove(usbip_urb_t* urb) {
+  usbip_urb_t** p_urb = urb_head_ptr(urb->ep_addr);
+  while (*p_urb != NULL) {
+    if (*p_urb == urb) {
+      *p_urb = urb->next;
+      break;
+    }
+    p_urb = &(*p_urb)->next;
+  }
+  free(urb);
+}
+
+// Send RET_SUBMIT with status (0 or negative errno) and free URB
+static void urb_complete(usbip_urb_t* urb, int32_t status) {
+  bool const is_in = tu_edpt_dir(urb->ep_addr) == TUSB_DIR_IN;
+
+  uint8_t hdr[USBIP_HDR_SIZE];
+  tu_memclr(hdr, sizeof(hdr));
+  put_u32(hdr + 0, USBIP_RET_SUBMIT);
+  put_u32(hdr + 4, urb->seqnum);
+  put_u32(hdr + 20, (uint32_t) status);
+  put_u32(hdr + 24, urb->actual);
+  put_u32(hdr + 32, urb->num_packets);
+
+  bool ok = sock_send(hdr, sizeof(hdr));
+  if (is_in && urb->actual > 0) {
+    if (urb->iso_count > 0) {
+      // isochronous IN data is sent packed i.e without gaps between packets
+      for (uint32_t i = 0; i < urb->iso_count && ok; i++) {
+        ok = sock_send(urb->buf + urb->iso[i].offset, urb->iso[i].actual);
+      }
+    } else {
+      ok = ok && sock_send(urb->buf, urb->actual);
+    }
+  }
+  for (uint32_t i = 0; i < urb->iso_count && ok; i++) {
+    uint8_t desc[USBIP_ISO_DESC_SIZE];
+    put_u32(desc + 0, urb->iso[i].offset);
+    put_u32(desc + 4, urb->iso[i].length);
+    put_u32(desc + 8, urb->iso[i].actual);
+    put_u32(desc + 12, 0);
+    ok = sock_send(desc, sizeof(desc));
+  }
+  if (!ok) {
+    TU_LOG1("USBIP: failed to send RET_SUBMIT\r\n");
+  }
+
+  urb_remove(urb);
+}
+
+static void urb_unlink(uint32_t seqnum, uint32_t unlink_seqnum) {
+  int32_t status = 0;
+  for (uint8_t i = 0; i < USBIP_EP_MAX * 2 && status == 0; i++) {
+    for (usbip_urb_t* urb = _usbip.urb_head[i / 2][i % 2]; urb != NULL; urb = urb->next) {
+      if (urb->seqnum == unlink_seqnum) {
+        urb_remove(urb);
+        status = -ECONNRESET; // RET_SUBMIT is not sent for unlinked URB
+        break;
+      }
+    }
+  }
+
+  uint8_t hdr[USBIP_HDR_SIZE];
+  tu_memclr(hdr, sizeof(hdr));
+  put_u32(hdr + 0, USBIP_RET_UNLINK);
+  put_u32(hdr + 4, seqnum);
+  put_u32(hdr + 20, (uint32_t) status);
+  (void) sock_send(hdr, sizeof(hdr));
+}
+
+//--------------------------------------------------------------------+
+// Endpoint data mapping
+//--------------------------------------------------------------------+
+// Move n bytes between device transfer and URB buffer
+static void edpt_copy(usbip_edpt_t* ep, uint8_t* urb_buf, uint16_t n, bool is_in) {
+  if (n > 0) {
+    if (ep->ff != NULL) {
+      if (is_in) {
+        (void) tu_fifo_read_n(ep->ff, urb_buf, n);
+      } else {
+        (void) tu_fifo_write_n(ep->ff, urb_buf, n);
+      }
+    } else {
+      if (is_in) {
+        memcpy(urb_buf, ep->buf + ep->actual, n);
+      } else {
+        memcpy(ep->buf + ep->actual, urb_buf, n);
+      }
+    }
+  }
+  ep->actual += n;
+}
+
+static void edpt_complete(uint8_t ep_addr) {
+  usbip_edpt_t* ep = &_usbip.edpt[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)];
+  ep->busy = false;
+  dcd_event_xfer_complete(_usbip.rhport, ep_addr, ep->actual, XFER_RESULT_SUCCESS, true);
+}
+
+static void control_service(void) {
+  usbip_urb_t* urb = urb_head(TU_EP0_OUT);
+  if (urb == NULL) {
+    return;
+  }
+
+  if (!urb->setup_sent) {
+    // SETUP is always accepted: it clears EP0 stall and cancels previous control transfer
+    urb->setup_sent = true;
+    for (uint8_t dir = 0; dir < 2; dir++) {
+      _usbip.edpt[0][dir].stalled = false;
+      _usbip.edpt[0][dir].busy = false;
+    }
+
+    tusb_control_request_t const* req = (tusb_control_request_t const*) urb->setup;
+    if (req->bmRequestType == 0 && req->bRequest == TUSB_REQ_SET_CONFIGURATION) {
+      _usbip.cfg_num = (uint8_t) tu_le16toh(req->wValue);
+    }
+    dcd_event_setup_received(_usbip.rhport, urb->setup, true);
+    return; // device responds after processing in tud_task()
+  }
+
+  if (_usbip.edpt[0][0].stalled || _usbip.edpt[0][1].stalled) {
+    urb_complete(urb, -EPIPE);
+    return;
+  }
+
+  tusb_control_request_t const* req = (tusb_control_request_t const*) urb->setup;
+  uint16_t const wlength = tu_le16toh(req->wLength);
+  uint8_t const data_dir = (req->bmRequestType & TUSB_DIR_IN_MASK) ? TUSB_DIR_IN : TUSB_DIR_OUT;
+  uint8_t const status_dir = (wlength == 0 || data_dir == TUSB_DIR_OUT) ? TUSB_DIR_IN : TUSB_DIR_OUT;
+
+  usbip_edpt_t* data_ep = &_usbip.edpt[0][data_dir];
+  if (wlength > 0 && data_ep->busy && data_ep->len > 0) {
+    uint32_t const urb_len = tu_min32(urb->len, wlength);
+    uint16_t const n = (uint16_t) tu_min32(urb_len - urb->actual, (uint32_t) (data_ep->len - data_ep->actual));
+    edpt_copy(data_ep, urb->buf + urb->actual, n, data_dir == TUSB_DIR_IN);
+    urb->actual += n;
+    edpt_complete(tu_edpt_addr(0, data_dir));
+    return;
+  }
+
+  usbip_edpt_t* status_ep = &_usbip.edpt[0][status_dir];
+  if (status_ep->busy && status_ep->len == 0) {
+    edpt_complete(tu_edpt_addr(0, status_dir));
+    urb_complete(urb, 0);
+  }
+}
+
+// Map one packet of isochronous URB to a device transfer
+static void iso_service(usbip_urb_t* urb, usbip_edpt_t* ep, bool is_in) {
+  usbip_iso_packet_t* pkt = &urb->iso[urb->iso_index];
+  uint16_t const n = (uint16_t) tu_min32(pkt->length, (uint32_t) (ep->len - ep->actual));
+  edpt_copy(ep, urb->buf + pkt->offset, n, is_in);
+  pkt->actual = is_in ? n : pkt->length;
+  urb->actual += pkt->actual;
+  edpt_complete(urb->ep_addr);
+
+  urb->iso_index++;
+  if (urb->iso_index == urb->iso_count) {
+    urb_complete(urb, 0);
+  }
+}
+
+static void edpt_service(uint8_t epnum, uint8_t dir) {
+  uint8_t const ep_addr = tu_edpt_addr(epnum, dir);
+  usbip_edpt_t* ep = &_usbip.edpt[epnum][dir];
+  bool const is_in = (dir == TUSB_DIR_IN);
+
+  usbip_urb_t* urb;
+  while ((urb = urb_head(ep_addr)) != NULL) {
+    if (!ep->opened) {
+      urb_complete(urb, -EPROTO);
+      continue;
+    }
+    if (ep->stalled) {
+      urb_complete(urb, -EPIPE);
+      continue;
+    }
+    if (!ep->busy) {
+      return;
+    }
+
+    if (urb->iso_count > 0) {
+      iso_service(urb, ep, is_in);
+      continue;
+    }
+
+    uint32_t const urb_remain = urb->len - urb->actual;
+    uint16_t const ep_remain = (uint16_t) (ep->len - ep->actual);
+    uint16_t const n = (uint16_t) tu_min32(urb_remain, ep_remain);
+    edpt_copy(ep, urb->buf + urb->actual, n, is_in);
+    urb->actual += n;
+
+    // transfer ends with a short packet when its length is not multiple of packet size
+    bool ep_done;
+    bool urb_done;
+    if (is_in) {
+      ep_done = (n == ep_remain);
+      bool const short_pkt = ep_done && (ep->len == 0 || (ep->len % ep->mps) != 0);
+      urb_done = (n == urb_remain) || short_pkt;
+    } else {
+      urb_done = (n == urb_remain);
+      bool const short_pkt =
+        urb_done && (urb->len == 0 || (urb->len % ep->mps) != 0 || (urb->flags & USBIP_URB_ZERO_PACKET));
+      ep_done = (n == ep_remain) || short_pkt;
+    }
+
+    if (ep_done) {
+      edpt_complete(ep_addr);
+    }
+    if (urb_done) {
+      urb_complete(urb, 0);
+    }
+  }
+}
+
+//--------------------------------------------------------------------+
+// Protocol
+//--------------------------------------------------------------------+
+static void connection_close(void) {
+  if (_usbip.fd >= 0) {
+    close(_usbip.fd);
+    _usbip.fd = -1;
+  }
+
+  for (uint8_t i = 0; i < USBIP_EP_MAX * 2; i++) {
+    usbip_urb_t** p_head = &_usbip.urb_head[i / 2][i % 2];
+    while (*p_head != NULL) {
+      urb_remove(*p_head);
+    }
+  }
+  free(_usbip.rx_urb);
+  _usbip.rx_urb = NULL;
+
+  if (_usbip.imported) {
+    _usbip.imported = false;
+    _usbip.cfg_num = 0;
+    dcd_event_bus_signal(_usbip.rhport, DCD_EVENT_UNPLUGGED, true);
+  }
+}
+
+// Fill usbip_usb_device (312 bytes) from device descriptor. Return size including interface list if requested
+static size_t device_info(uint8_t* buf, bool with_interfaces) {
+  tusb_desc_device_t const* desc_dev = (tusb_desc_device_t const*) tud_descriptor_device_cb();
+  uint8_t const* desc_cfg = tud_descriptor_configuration_cb(0);
+  uint8_t const num_itf = ((tusb_desc_configuration_t const*) desc_cfg)->bNumInterfaces;
+  uint8_t speed;
+  switch (_usbip.speed) {
+    case TUSB_SPEED_LOW:
+      speed = 1;
+      break;
+    case TUSB_SPEED_HIGH:
+      speed = 3;
+      break;
+    default:
+      speed = 2;
+      break;
+  }
+
+  tu_memclr(buf, 312);
+  (void) snprintf((char*) buf, 256, "/sys/devices/tinyusb/%s", CFG_TUD_USBIP_BUSID);
+  (void) snprintf((char*) buf + 256, 32, "%s", CFG_TUD_USBIP_BUSID);
+  put_u32(buf + 288, USBIP_BUSNUM);
+  put_u32(buf + 292, USBIP_DEVNUM);
+  put_u32(buf + 296, speed);
+  put_u16(buf + 300, tu_le16toh(desc_dev->idVendor));
+  put_u16(buf + 302, tu_le16toh(desc_dev->idProduct));
+  put_u16(buf + 304, tu_le16toh(desc_dev->bcdDevice));
+  buf[306] = desc_dev->bDeviceClass;
+  buf[307] = desc_dev->bDeviceSubClass;
+  buf[308] = desc_dev->bDeviceProtocol;
+  buf[309] = _usbip.cfg_num;
+  buf[310] = desc_dev->bNumConfigurations;
+  buf[311] = num_itf;
+
+  size_t len = 312;
+  if (with_interfaces) {
+    // interface class triples of alternate setting 0
+    uint8_t const* p_desc = desc_cfg;
+    uint8_t const* desc_end = desc_cfg + tu_le16toh(((tusb_desc_configuration_t const*) desc_cfg)->wTotalLength);
+    while (p_desc < desc_end) {
+      tusb_desc_interface_t const* desc_itf = (tusb_desc_interface_t const*) p_desc;
+      if (tu_desc_type(p_desc) == TUSB_DESC_INTERFACE && desc_itf->bAlternateSetting == 0) {
+        buf[len++] = desc_itf->bInterfaceClass;
+        buf[len++] = desc_itf->bInterfaceSubClass;
+        buf[len++] = desc_itf->bInterfaceProtocol;
+        buf[len++] = 0;
+      }
+      p_desc = tu_desc_next(p_desc);
+    }
+  }
+  return len;
+}
+
+static bool op_reply(uint16_t code, uint32_t status) {
+  uint8_t buf[8 + 4 + 312 + 4 * 32];
+  put_u16(buf + 0, USBIP_VERSION);
+  put_u16(buf + 2, code);
+  put_u32(buf + 4, status);
+  size_t len = 8;
+
+  if (code == USBIP_OP_REP_DEVLIST) {
+    put_u32(buf + 8, 1);
+    len = 12 + device_info(buf + 12, true);
+  } else if (status == 0) {
+    len += device_info(buf + 8, false);
+  }
+  return sock_send(buf, len);
+}
+
+// Process completely received item. Return false if connection should be closed
+static bool rx_process(void) {
+  switch (_usbip.rx_state) {
+    case RX_OP_HDR: {
+      uint16_t const code = get_u16(_usbip.rx_hdr + 2);
+      if (code == USBIP_OP_REQ_DEVLIST) {
+        (void) op_reply(USBIP_OP_REP_DEVLIST, 0);
+        return false; // client closes after device list
+      }
+      TU_VERIFY(code == USBIP_OP_REQ_IMPORT);
+      rx_expect(RX_OP_BUSID, _usbip.rx_hdr + 8, 32);
+      return true;
+    }
+
+    case RX_OP_BUSID: {
+      _usbip.rx_hdr[8 + 31] = 0;
+      bool const match = (0 == strcmp((const char*) _usbip.rx_hdr + 8, CFG_TUD_USBIP_BUSID));
+      TU_VERIFY(op_reply(USBIP_OP_REP_IMPORT, match ? 0 : 1) && match);
+
+      TU_LOG1("USBIP: device imported\r\n");
+      _usbip.imported = true;
+      dcd_event_bus_reset(_usbip.rhport, _usbip.speed, true);
+      rx_expect(RX_CMD_HDR, _usbip.rx_hdr, USBIP_HDR_SIZE);
+      return true;
+    }
+
+    case RX_CMD_HDR: {
+      uint8_t const* hdr = _usbip.rx_hdr;
+      uint32_t const command = get_u32(hdr + 0);
+      uint32_t const seqnum = get_u32(hdr + 4);
+
+      if (command == USBIP_CMD_UNLINK) {
+        urb_unlink(seqnum, get_u32(hdr + 20));
+        rx_expect(RX_CMD_HDR, _usbip.rx_hdr, USBIP_HDR_SIZE);
+        return true;
+      }
+      TU_VERIFY(command == USBIP_CMD_SUBMIT);
+
+      uint8_t const dir = (get_u32(hdr + 12) == USBIP_DIR_IN) ? TUSB_DIR_IN : TUSB_DIR_OUT;
+      uint32_t const epnum = get_u32(hdr + 16);
+      uint32_t const len = get_u32(hdr + 24);
+      uint32_t const num_packets = get_u32(hdr + 32);
+      uint32_t const iso_count = (num_packets == 0xffffffffu) ? 0 : num_packets;
+      TU_VERIFY(epnum < USBIP_EP_MAX && len <= INT32_MAX && iso_count <= UINT16_MAX);
+
+      usbip_urb_t* urb = urb_alloc(len, iso_count);
+      TU_VERIFY(urb);
+      urb->seqnum = seqnum;
+      urb->ep_addr = tu_edpt_addr((uint8_t) epnum, dir);
+      urb->flags = get_u32(hdr + 20);
+      urb->num_packets = num_packets;
+      memcpy(urb->setup, hdr + 40, 8);
+      _usbip.rx_urb = urb;
+
+      if (dir == TUSB_DIR_OUT && len > 0) {
+        rx_expect(RX_CMD_DATA, urb->buf, len);
+        return true;
+      }
+      TU_ATTR_FALLTHROUGH;
+    }
+
+    case RX_CMD_DATA: {
+      usbip_urb_t* urb = _usbip.rx_urb;
+      if (urb->iso_count > 0) {
+        rx_expect(RX_CMD_ISO, urb->iso, urb->iso_count * USBIP_ISO_DESC_SIZE);
+        return true;
+      }
+      TU_ATTR_FALLTHROUGH;
+    }
+
+    case RX_CMD_ISO: {
+      usbip_urb_t* urb = _usbip.rx_urb;
+      for (uint32_t i = 0; i < urb->iso_count; i++) {
+        usbip_iso_packet_t* pkt = &urb->iso[i];
+        pkt->offset = tu_ntohl(pkt->offset);
+        pkt->length = tu_ntohl(pkt->length);
+        pkt->actual = 0;
+        pkt->status = 0;
+        TU_VERIFY(pkt->offset <= urb->len && pkt->length <= urb->len - pkt->offset);
+      }
+
+      urb_enqueue(urb);
+      _usbip.rx_urb = NULL;
+      rx_expect(RX_CMD_HDR, _usbip.rx_hdr, USBIP_HDR_SIZE);
+      return true;
+    }
+
+    default:
+      return false;
+  }
+}
+
+static void socket_poll(void) {
+  if (_usbip.fd < 0) {
+    if (_usbip.listen_fd < 0) {
+      return;
+    }
+    int const fd = accept(_usbip.listen_fd, NULL, NULL);
+    if (fd < 0) {
+      return;
+    }
+    int const one = 1;
+    (void) setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    _usbip.fd = fd;
+    rx_expect(RX_OP_HDR, _usbip.rx_hdr, 8);
+  }
+
+  while (1) {
+    int const ret = rx_fill();
+    if (ret == 0) {
+      return;
+    }
+    if (ret < 0 || !rx_process()) {
+      TU_LOG1("USBIP: connection closed\r\n");
+      connection_close();
+      return;
+    }
+  }
+}
+
+//--------------------------------------------------------------------+
+// Controller API
+//--------------------------------------------------------------------+
+bool dcd_init(uint8_t rhport, const tusb_rhport_init_t* rh_init) {
+  _usbip.rhport = rhport;
+  _usbip.speed = (rh_init->speed == TUSB_SPEED_AUTO) ? TUSB_SPEED_HIGH : rh_init->speed;
+
+  tu_memclr(_usbip.edpt, sizeof(_usbip.edpt));
+  for (uint8_t dir = 0; dir < 2; dir++) {
+    _usbip.edpt[0][dir].mps = CFG_TUD_ENDPOINT0_SIZE;
+    _usbip.edpt[0][dir].opened = true;
+  }
+
+  dcd_connect(rhport);
+  return true;
+}
+
+bool dcd_deinit(uint8_t rhport) {
+  dcd_disconnect(rhport);
+  return true;
+}
+
+// Poll socket and map URBs onto pending transfers
+void dcd_int_handler(uint8_t rhport) {
+  (void) rhport;
+  socket_poll();
+  if (!_usbip.imported) {
+    return;
+  }
+
+  control_service();
+  for (uint8_t epnum = 1; epnum < USBIP_EP_MAX; epnum++) {
+    for (uint8_t dir = 0; dir < 2; dir++) {
+      edpt_service(epnum, dir);
+    }
+  }
+}
+
+void dcd_int_enable(uint8_t rhport) {
+  (void) rhport;
+}
+
+void dcd_int_disable(uint8_t rhport) {
+  (void) rhport;
+}
+
+// Address is assigned by usbip client, SET_ADDRESS is normally not forwarded
+void dcd_set_address(uint8_t rhport, uint8_t dev_addr) {
+  (void) dev_addr;
+  (void) dcd_edpt_xfer(rhport, TU_EP0_IN, NULL, 0, false);
+}
+
+void dcd_remote_wakeup(uint8_t rhport) {
+  (void) rhport;
+}
+
+// Connect by listening for usbip client
+void dcd_connect(uint8_t rhport) {
+  (void) rhport;
+  if (_usbip.listen_fd < 0) {
+    (void) sock_listen();
+  }
+}
+
+void dcd_disconnect(uint8_t rhport) {
+  (void) rhport;
+  connection_close();
+  if (_usbip.listen_fd >= 0) {
+    close(_usbip.listen_fd);
+    _usbip.listen_fd = -1;
+  }
+}
+
+void dcd_sof_enable(uint8_t rhport, bool en) {
+  (void) rhport;
+  (void) en;
+}
+
+#if CFG_TUD_TEST_MODE
+void dcd_enter_test_mode(uint8_t rhport, tusb_feature_test_mode_t test_selector) {
+  (void) rhport;
+  (void) test_selector;
+}
+#endif
+
+//--------------------------------------------------------------------+
+// Endpoint API
+//--------------------------------------------------------------------+
+bool dcd_edpt_open(uint8_t rhport, tusb_desc_endpoint_t const* desc_ep) {
+  (void) rhport;
+  uint8_t const epnum = tu_edpt_number(desc_ep->bEndpointAddress);
+  TU_ASSERT(epnum < USBIP_EP_MAX);
+
+  usbip_edpt_t* ep = &_usbip.edpt[epnum][tu_edpt_dir(desc_ep->bEndpointAddress)];
+  tu_memclr(ep, sizeof(usbip_edpt_t));
+  ep->mps = tu_edpt_packet_size(desc_ep);
+  ep->type = desc_ep->bmAttributes.xfer;
+  ep->opened = true;
+  return true;
+}
+
+// There is no packet buffer to allocate
+bool dcd_edpt_iso_alloc(uint8_t rhport, uint8_t ep_addr, uint16_t largest_packet_size) {
+  (void) rhport;
+  (void) largest_packet_size;
+  TU_ASSERT(tu_edpt_number(ep_addr) < USBIP_EP_MAX);
+  return true;
+}
+
+bool dcd_edpt_iso_activate(uint8_t rhport, tusb_desc_endpoint_t const* desc_ep) {
+  return dcd_edpt_open(rhport, desc_ep);
+}
+
+void dcd_edpt_close_all(uint8_t rhport) {
+  (void) rhport;
+  tu_memclr(&_usbip.edpt[1], sizeof(_usbip.edpt) - sizeof(_usbip.edpt[0]));
+}
+
+bool dcd_edpt_xfer(uint8_t rhport, uint8_t ep_addr, uint8_t* buffer, uint16_t total_bytes, bool is_isr) {
+  (void) rhport;
+  (void) is_isr;
+  usbip_edpt_t* ep = &_usbip.edpt[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)];
+  TU_VERIFY(ep->opened);
+
+  ep->buf = buffer;
+  ep->ff = NULL;
+  ep->len = total_bytes;
+  ep->actual = 0;
+  ep->busy = true;
+  return true;
+}
+
+bool dcd_edpt_xfer_fifo(uint8_t rhport, uint8_t ep_addr, tu_fifo_t* ff, uint16_t total_bytes, bool is_isr) {
+  TU_VERIFY(dcd_edpt_xfer(rhport, ep_addr, NULL, total_bytes, is_isr));
+  _usbip.edpt[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)].ff = ff;
+  return true;
+}
+
+void dcd_edpt_stall(uint8_t rhport, uint8_t ep_addr) {
+  (void) rhport;
+  usbip_edpt_t* ep = &_usbip.edpt[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)];
+  ep->stalled = true;
+  ep->busy = false;
+}
+
+void dcd_edpt_clear_stall(uint8_t rhport, uint8_t ep_addr) {
+  (void) rhport;
+  _usbip.edpt[tu_edpt_number(ep_addr)][tu_edpt_dir(ep_addr)].stalled = false;
+}
+
+#endif
@@ -12,6 +12,8 @@ TINYUSB_SRC_C += \
 	src/class/midi/midi_device.c \
 	src/class/midi/midi2_device.c \
 	src/class/msc/msc_device.c \
+	src/class/msc/msc_device_cache.c \
+	src/class/msc/uas_device.c \
 	src/class/mtp/mtp_device.c \
 	src/class/net/ecm_rndis_device.c \
 	src/class/net/ncm_device.c \
@@ -21,8 +23,10 @@ TINYUSB_SRC_C += \
 	src/class/vendor/vendor_device.c \
   src/host/usbh.c \
   src/host/hub.c \
+  src/host/usbh_periodic.c \
   src/class/cdc/cdc_host.c \
   src/class/hid/hid_host.c \
   src/class/midi/midi_host.c \
   src/class/midi/midi2_host.c \
   src/class/msc/msc_host.c \
+  src/class/msc/msc_host_cache.c \
@@ -34,6 +34,9 @@
 
   #if CFG_TUH_MSC
     #include "class/msc/msc_host.h"
+    #if CFG_TUH_MSC_CACHE
+      #include "class/msc/msc_host_cache.h"
+    #endif
   #endif
 
   #if CFG_TUH_CDC
@@ -68,6 +71,13 @@
 
   #if CFG_TUD_MSC
     #include "class/msc/msc_device.h"
+    #if CFG_TUD_MSC_CACHE
+      #include "class/msc/msc_device_cache.h"
+    #endif
+  #endif
+
+  #if CFG_TUD_UAS
+    #include "class/msc/uas_device.h"
   #endif
 
   #if CFG_TUD_PRINTER
@@ -210,6 +210,10 @@
 // Geehy
 #define OPT_MCU_APM32F0XX        2800  ///< Geehy APM32F0xx
 
+// Virtual
+#define OPT_MCU_LOOPBACK         2900  ///< Software loopback bus between host and device stack, no hardware
+#define OPT_MCU_USBIP            2901  ///< USB/IP server exporting device stack over TCP on a POSIX host
+
 // Check if configured MCU is one of listed
 // Apply TU_MCU_IS_EQUAL with || as separator to list of input
 #define TU_MCU_IS_EQUAL(_m)  (CFG_TUSB_MCU == (_m))
@@ -228,6 +232,7 @@
 #define OPT_OS_RTX4       7  ///< Keil RTX 4
 #define OPT_OS_ZEPHYR     8  ///< Zephyr
 #define OPT_OS_THREADX    9  ///< ThreadX
+#define OPT_OS_POSIX     10  ///< POSIX threads e.g Linux
 
 //--------------------------------------------------------------------+
 // Mode and Speed
@@ -680,6 +685,15 @@
   #define CFG_TUD_MSC             0
 #endif
 
+#ifndef CFG_TUD_UAS
+  #define CFG_TUD_UAS             0
+#endif
+
+// Enable erase block cache (msc_device_cache.h) between the MSC driver and media callbacks
+#ifndef CFG_TUD_MSC_CACHE
+  #define CFG_TUD_MSC_CACHE       0
+#endif
+
 #ifndef CFG_TUD_MTP
   #define CFG_TUD_MTP             0
 #endif
@@ -753,6 +767,24 @@
     #define CFG_TUH_ENUMERATION_BUFSIZE 256
   #endif
 
+  // Number of devices that can be enumerated in parallel e.g behind hubs. Each one has its own enumeration buffer.
+  // Only one device is at address 0 at a time, others wait until the current one is addressed.
+  #ifndef CFG_TUH_ENUM_MAX
+    #define CFG_TUH_ENUM_MAX 1
+  #endif
+
+  // Enable enumeration cache (see tuh_enum_cache_init()): re-connected device with the same device descriptor and
+  // serial number skips string and configuration descriptor requests
+  #ifndef CFG_TUH_ENUM_CACHE
+    #define CFG_TUH_ENUM_CACHE 0
+  #endif
+
+  // Number of non-control endpoints shared by all devices. Endpoint state is allocated from this pool when endpoint
+  // is opened or bound to a class driver and released when its device is removed.
+  #ifndef CFG_TUH_ENDPOINT_POOL_SIZE
+    #define CFG_TUH_ENDPOINT_POOL_SIZE (8*CFG_TUH_DEVICE_MAX + CFG_TUH_HUB)
+  #endif
+
 #endif // CFG_TUH_ENABLED
 
 // Attribute to place data in accessible RAM for host controller (default: CFG_TUSB_MEM_SECTION)
@@ -894,11 +926,31 @@
   #define CFG_TUH_MSC    0
 #endif
 
+// Enable block cache layer (msc_host_cache.h) with read-ahead and write-back
+#ifndef CFG_TUH_MSC_CACHE
+  #define CFG_TUH_MSC_CACHE 0
+#endif
+
 
 #ifndef CFG_TUH_API_EDPT_XFER
   #define CFG_TUH_API_EDPT_XFER 0
 #endif
 
+// Enable tuh_edpt_xfer_queue() to queue multiple transfers per endpoint
+#ifndef CFG_TUH_EDPT_XFER_QUEUE
+  #define CFG_TUH_EDPT_XFER_QUEUE 0
+#endif
+
+// Enable tuh_iso_xfer() for isochronous endpoints, requires HCD support
+#ifndef CFG_TUH_ISO_XFER
+  #define CFG_TUH_ISO_XFER 0
+#endif
+
+// Length in frames of periodic schedule used for bandwidth allocation, longer polling interval is clamped to this
+#ifndef CFG_TUH_PERIODIC_FRAMES
+  #define CFG_TUH_PERIODIC_FRAMES 8
+#endif
+
 #ifndef CFG_TUH_EDPT_DEDICATED_HWFIFO
   #define CFG_TUH_EDPT_DEDICATED_HWFIFO 0
 #endif